@@ -22,46 +22,186 @@
  *  Handling various archive files.
  */
 
+#include <cstring>
+
 #include "src/common/system.h"
+#include "src/common/util.h"
 
 #include "src/aurora/archive.h"
+#include "src/aurora/namedictionary.h"
 
 namespace Aurora {
 
 Archive::Resource::Resource() : hash(0), type(kFileTypeNone), index(0xFFFFFFFF) {
 }
 
-Archive::Archive() {
+/** The identifier to give to the next created archive. */
+static boost::atomic<uint64> nextArchiveID(1);
+
+Archive::Archive() : _archiveID(nextArchiveID.fetch_add(1)), _hasIndex(false), _hasResourceList(false) {
 }
 
 Archive::~Archive() {
 }
 
-uint32 Archive::getResourceSize(uint32 UNUSED(index)) const {
-	return 0xFFFFFFFF;
+uint64 Archive::getID() const {
+	return _archiveID;
+}
+
+const Archive::ResourceList &Archive::getResources() const {
+	if (_hasResourceList.load(boost::memory_order_acquire))
+		return _resourceList;
+
+	Common::StackLock lock(_resourceListMutex);
+	if (_hasResourceList.load(boost::memory_order_relaxed))
+		return _resourceList;
+
+	const ResourceTable &table = getResourceTable();
+
+	_resourceList.clear();
+	for (size_t i = 0; i < table.size(); i++) {
+		_resourceList.push_back(Resource());
+
+		Resource &res = _resourceList.back();
+
+		res.name  = table.getNameString(i);
+		res.hash  = table.getHash(i);
+		res.type  = table.getType(i);
+		res.index = table.getIndex(i);
+	}
+
+	_hasResourceList.store(true, boost::memory_order_release);
+	return _resourceList;
+}
+
+uint64 Archive::getResourceSize(uint32 UNUSED(index)) const {
+	return 0xFFFFFFFFFFFFFFFFULL;
+}
+
+uint64 Archive::getResourceOffset(uint32 UNUSED(index)) const {
+	return 0xFFFFFFFFFFFFFFFFULL;
 }
 
 Common::HashAlgo Archive::getNameHashAlgo() const {
 	return Common::kHashNone;
 }
 
+uint64 Archive::getIndexKey(const char *name, size_t nameLength, FileType type) {
+	uint64 key = 0xCBF29CE484222325LL;
+
+	for (size_t i = 0; i < nameLength; i++)
+		key = Common::hashFNV64(key, (byte) Common::UStringView::toLowerASCII(name[i]));
+
+	return Common::hashFNV64(key, (uint32) type);
+}
+
+void Archive::buildIndex() const {
+	if (_hasIndex.load(boost::memory_order_acquire))
+		return;
+
+	Common::StackLock lock(_indexMutex);
+	if (_hasIndex.load(boost::memory_order_relaxed))
+		return;
+
+	const ResourceTable &resources = getResourceTable();
+	const bool hasHashes = getNameHashAlgo() != Common::kHashNone;
+
+	_nameIndex.clear();
+	_hashIndex.clear();
+
+	_nameIndex.reserve(resources.size());
+	if (hasHashes)
+		_hashIndex.reserve(resources.size());
+
+	for (size_t i = 0; i < resources.size(); i++) {
+		const ResourceTable::Name name = resources.getName(i);
+
+		_nameIndex.insert(std::make_pair(getIndexKey(name.data(), name.size(), resources.getType(i)), i));
+
+		// Like a linear search, the first resource with a given hash wins
+		if (hasHashes)
+			_hashIndex.insert(std::make_pair(resources.getHash(i), i));
+	}
+
+	_hasIndex.store(true, boost::memory_order_release);
+}
+
 uint32 Archive::findResource(uint64 hash) const {
 	if (getNameHashAlgo() == Common::kHashNone)
 		return 0xFFFFFFFF;
 
-	for (ResourceList::const_iterator r = getResources().begin(); r != getResources().end(); ++r)
-		if (r->hash == hash)
-			return r->index;
+	buildIndex();
+
+	HashIndex::const_iterator r = _hashIndex.find(hash);
+	if (r == _hashIndex.end())
+		return 0xFFFFFFFF;
 
-	return 0xFFFFFFFF;
+	return getResourceTable().getIndex(r->second);
 }
 
-uint32 Archive::findResource(const Common::UString &name, FileType type) const {
-	for (ResourceList::const_iterator r = getResources().begin(); r != getResources().end(); ++r)
-		if ((r->type == type) && (r->name == name))
-			return r->index;
+uint32 Archive::findResource(Common::UStringView name, FileType type) const {
+	buildIndex();
+
+	const ResourceTable &resources = getResourceTable();
+
+	uint32 found = 0xFFFFFFFF;
+
+	/* Several resources might share the same key, either because of a
+	 * hash collision or because their names only differ in case. Of
+	 * those that actually match, return the one with the lowest index. */
+
+	std::pair<NameIndex::const_iterator, NameIndex::const_iterator> range =
+		_nameIndex.equal_range(getIndexKey(name.data(), name.size(), type));
+
+	for (NameIndex::const_iterator r = range.first; r != range.second; ++r) {
+		if (resources.getType(r->second) != type)
+			continue;
+
+		if (!resources.getName(r->second).equalsIgnoreCase(name))
+			continue;
+
+		found = MIN(found, resources.getIndex(r->second));
+	}
+
+	return found;
+}
+
+size_t Archive::recoverNames(const NameDictionary &dictionary) {
+	if (getNameHashAlgo() != dictionary.getNameHashAlgo())
+		return 0;
+
+	ResourceTable *resources = getModifiableResourceTable();
+	if (!resources)
+		return 0;
+
+	const size_t recovered = dictionary.recoverNames(*resources);
+	if (recovered > 0)
+		invalidateIndex();
+
+	return recovered;
+}
+
+ResourceTable *Archive::getModifiableResourceTable() {
+	return 0;
+}
+
+void Archive::invalidateIndex() {
+	{
+		Common::StackLock lock(_indexMutex);
+
+		_nameIndex.clear();
+		_hashIndex.clear();
+
+		_hasIndex.store(false, boost::memory_order_release);
+	}
+
+	{
+		Common::StackLock lock(_resourceListMutex);
+
+		_resourceList.clear();
 
-	return 0xFFFFFFFF;
+		_hasResourceList.store(false, boost::memory_order_release);
+	}
 }
 
 } // End of namespace Aurora
@@ -26,14 +26,18 @@
 #define AURORA_ARCHIVE_H
 
 #include <list>
+#include <unordered_map>
 
 #include <boost/noncopyable.hpp>
 
 #include "src/common/types.h"
 #include "src/common/ustring.h"
 #include "src/common/hash.h"
+#include "src/common/atomic.h"
+#include "src/common/mutex.h"
 
 #include "src/aurora/types.h"
+#include "src/aurora/resourcetable.h"
 
 namespace Common {
 	class SeekableReadStream;
@@ -41,6 +45,8 @@ namespace Common {
 
 namespace Aurora {
 
+class NameDictionary;
+
 /** An abstract file archive. */
 class Archive : boost::noncopyable {
 public:
@@ -59,11 +65,36 @@ public:
 	Archive();
 	virtual ~Archive();
 
-	/** Return the list of resources. */
-	virtual const ResourceList &getResources() const = 0;
+	/** Return an identifier for this archive that is unique within the process.
+	 *
+	 *  Unlike the address of the archive object, this identifier is never
+	 *  reused, even after the archive has been destroyed.
+	 */
+	uint64 getID() const;
+
+	/** Return the table of resources. */
+	virtual const ResourceTable &getResourceTable() const = 0;
 
-	/** Return the size of a resource. */
-	virtual uint32 getResourceSize(uint32 index) const;
+	/** Return the list of resources.
+	 *
+	 *  The list is created from the resource table on first use and then
+	 *  kept around for the lifetime of the archive. New code should use
+	 *  getResourceTable() instead, which doesn't need the extra memory.
+	 */
+	const ResourceList &getResources() const;
+
+	/** Return the size of a resource.
+	 *
+	 *  If the size is not known, 0xFFFFFFFFFFFFFFFF is returned.
+	 */
+	virtual uint64 getResourceSize(uint32 index) const;
+
+	/** Return the offset of a resource's data within the archive.
+	 *
+	 *  This is meant for ordering bulk reads, so that they stay sequential
+	 *  on disk. If the offset is not known, 0xFFFFFFFFFFFFFFFF is returned.
+	 */
+	virtual uint64 getResourceOffset(uint32 index) const;
 
 	/** Return a stream of the resource's contents.
 	 *
@@ -78,8 +109,66 @@ public:
 
 	/** Return the index of the resource matching the hash, or 0xFFFFFFFF if not found. */
 	uint32 findResource(uint64 hash) const;
-	/** Return the index of the resource matching the name and type, or 0xFFFFFFFF if not found. */
-	uint32 findResource(const Common::UString &name, FileType type) const;
+	/** Return the index of the resource matching the name and type, or 0xFFFFFFFF if not found.
+	 *
+	 *  Resource names are matched case-insensitively, following the rules of
+	 *  Common::UString::toLower(): only the ASCII letters are folded, all other
+	 *  characters have to match exactly.
+	 */
+	uint32 findResource(Common::UStringView name, FileType type) const;
+
+	/** Fill in the names of resources that only have a hashed name.
+	 *
+	 *  Only archives hashing their names with the algorithm of the dictionary
+	 *  are affected. This modifies the resource table, so it should be done
+	 *  right after opening the archive, before it is used by several threads.
+	 *
+	 *  @return The number of resource names that were filled in.
+	 */
+	size_t recoverNames(const NameDictionary &dictionary);
+
+protected:
+	/** Return the resource table for modification, or 0 if it can't be modified. */
+	virtual ResourceTable *getModifiableResourceTable();
+
+	/** Throw away the lookup index and resource list after the resource table changed. */
+	void invalidateIndex();
+
+private:
+	/** The archive's process-wide unique identifier. */
+	const uint64 _archiveID;
+
+	/** Map of lookup keys onto positions within the resource table. */
+	typedef std::unordered_multimap<uint64, uint32> NameIndex;
+	/** Map of hashed names onto positions within the resource table. */
+	typedef std::unordered_map<uint64, uint32> HashIndex;
+
+	/** Lookup index over the resource names and types. */
+	mutable NameIndex _nameIndex;
+	/** Lookup index over the hashed resource names. */
+	mutable HashIndex _hashIndex;
+
+	/** Has the lookup index been built yet? */
+	mutable boost::atomic<bool> _hasIndex;
+	/** Mutex protecting the lazy creation of the lookup index. */
+	mutable Common::Mutex _indexMutex;
+
+	/** The resource table in list form, for getResources(). */
+	mutable ResourceList _resourceList;
+
+	/** Has the resource list been created yet? */
+	mutable boost::atomic<bool> _hasResourceList;
+	/** Mutex protecting the lazy creation of the resource list. */
+	mutable Common::Mutex _resourceListMutex;
+
+	/** Build the lookup index, if it doesn't exist yet. */
+	void buildIndex() const;
+
+	/** Hash a resource name and type into a lookup index key.
+	 *
+	 *  The name is lowercased ASCII-only, like in findResource().
+	 */
+	static uint64 getIndexKey(const char *name, size_t nameLength, FileType type);
 };
 
 } // End of namespace Aurora
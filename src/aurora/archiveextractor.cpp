@@ -0,0 +1,212 @@
+/* Phaethon - A FLOSS resource explorer for BioWare's Aurora engine games
+ *
+ * Phaethon is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * Phaethon is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * Phaethon is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Phaethon. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  Bulk extraction of archive resources into a directory.
+ */
+
+#include <algorithm>
+#include <map>
+
+#include <boost/thread/thread.hpp>
+
+#include "src/common/util.h"
+#include "src/common/scopedptr.h"
+#include "src/common/readstream.h"
+#include "src/common/writefile.h"
+#include "src/common/filepath.h"
+
+#include "src/aurora/archiveextractor.h"
+#include "src/aurora/archive.h"
+#include "src/aurora/util.h"
+
+namespace Aurora {
+
+bool ArchiveExtractor::Job::operator<(const Job &right) const {
+	if (offset != right.offset)
+		return offset < right.offset;
+
+	return index < right.index;
+}
+
+
+ArchiveExtractor::ArchiveExtractor(const Archive &archive, size_t threadCount) :
+	_archive(&archive), _threadCount(threadCount), _nextJob(0), _extracted(0) {
+
+	if (_threadCount == 0)
+		_threadCount = MAX<size_t>(boost::thread::hardware_concurrency(), 1);
+}
+
+ArchiveExtractor::~ArchiveExtractor() {
+}
+
+const ArchiveExtractor::FailureList &ArchiveExtractor::getFailures() const {
+	return _failures;
+}
+
+size_t ArchiveExtractor::extractAll(const Common::UString &directory) {
+	const ResourceTable &resources = _archive->getResourceTable();
+
+	std::vector<uint32> indices;
+	indices.reserve(resources.size());
+
+	for (size_t i = 0; i < resources.size(); i++)
+		indices.push_back(resources.getIndex(i));
+
+	return extract(indices, directory);
+}
+
+size_t ArchiveExtractor::extract(const std::vector<uint32> &indices, const Common::UString &directory) {
+	_failures.clear();
+
+	_nextJob.store(0);
+	_extracted.store(0);
+
+	createJobs(indices, directory);
+	runJobs();
+
+	_jobs.clear();
+
+	return _extracted.load();
+}
+
+void ArchiveExtractor::createJobs(const std::vector<uint32> &indices, const Common::UString &directory) {
+	/* Everything that isn't safe to do from several threads at once, like
+	 * creating the directory and querying the file type manager, is done
+	 * here, before the workers start. */
+
+	Common::FilePath::createDirectories(directory);
+
+	const ResourceTable &resources = _archive->getResourceTable();
+
+	// Map the local indices back onto positions within the resource table
+	std::vector<uint32> positions(resources.size(), 0xFFFFFFFF);
+	for (size_t i = 0; i < resources.size(); i++)
+		if (resources.getIndex(i) < positions.size())
+			positions[resources.getIndex(i)] = i;
+
+	// The paths we're going to write to, and which resource goes there
+	std::map<Common::UString, uint32> paths;
+
+	_jobs.clear();
+	_jobs.reserve(indices.size());
+
+	for (std::vector<uint32>::const_iterator i = indices.begin(); i != indices.end(); ++i) {
+		const uint32 position = (*i < positions.size()) ? positions[*i] : 0xFFFFFFFF;
+		if (position == 0xFFFFFFFF) {
+			Failure failure;
+
+			failure.index = *i;
+			failure.error = Common::Exception("Resource index out of range (%u/%u)", *i, (uint)resources.size());
+
+			_failures.push_back(failure);
+			continue;
+		}
+
+		Common::UString name = resources.getNameString(position);
+		if (name.empty())
+			name = Common::UString::format("0x%08X%08X", (uint)(resources.getHash(position) >> 32),
+			                                             (uint)(resources.getHash(position) & 0xFFFFFFFF));
+
+		Job job;
+
+		job.index = *i;
+		job.path  = directory + "/" + TypeMan.setFileType(name, resources.getType(position));
+
+		std::pair<std::map<Common::UString, uint32>::const_iterator, bool> path =
+			paths.insert(std::make_pair(job.path, *i));
+
+		if (!path.second) {
+			Failure failure;
+
+			failure.index = *i;
+			failure.path  = job.path;
+			failure.error = Common::Exception("Resource %u would overwrite resource %u in \"%s\"",
+			                                  *i, path.first->second, job.path.c_str());
+
+			_failures.push_back(failure);
+			continue;
+		}
+
+		try {
+			job.offset = _archive->getResourceOffset(*i);
+		} catch (...) {
+			job.offset = 0xFFFFFFFFFFFFFFFFULL;
+		}
+
+		_jobs.push_back(job);
+	}
+
+	std::sort(_jobs.begin(), _jobs.end());
+}
+
+void ArchiveExtractor::runJobs() {
+	const size_t threadCount = MIN<size_t>(_threadCount, _jobs.size());
+	if (threadCount <= 1) {
+		work();
+		return;
+	}
+
+	// The calling thread works on the jobs as well
+	boost::thread_group threads;
+	for (size_t i = 1; i < threadCount; i++)
+		threads.create_thread([this]() { work(); });
+
+	work();
+
+	threads.join_all();
+}
+
+void ArchiveExtractor::work() {
+	size_t n;
+	while ((n = _nextJob.fetch_add(1)) < _jobs.size())
+		extractJob(_jobs[n]);
+}
+
+void ArchiveExtractor::extractJob(const Job &job) {
+	Failure failure;
+
+	try {
+		Common::ScopedPtr<Common::SeekableReadStream> res(_archive->getResource(job.index, true));
+
+		Common::WriteFile file(job.path);
+
+		file.writeStream(*res);
+		file.flush();
+
+		_extracted.fetch_add(1);
+		return;
+
+	} catch (Common::Exception &e) {
+		failure.error = e;
+	} catch (std::exception &e) {
+		failure.error = Common::Exception(e);
+	}
+
+	failure.index = job.index;
+	failure.path  = job.path;
+
+	failure.error.add("Failed extracting resource %u to \"%s\"", job.index, job.path.c_str());
+
+	Common::StackLock lock(_failureMutex);
+	_failures.push_back(failure);
+}
+
+} // End of namespace Aurora
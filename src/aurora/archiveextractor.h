@@ -0,0 +1,131 @@
+/* Phaethon - A FLOSS resource explorer for BioWare's Aurora engine games
+ *
+ * Phaethon is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * Phaethon is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * Phaethon is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Phaethon. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  Bulk extraction of archive resources into a directory.
+ */
+
+#ifndef AURORA_ARCHIVEEXTRACTOR_H
+#define AURORA_ARCHIVEEXTRACTOR_H
+
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+#include "src/common/types.h"
+#include "src/common/ustring.h"
+#include "src/common/error.h"
+#include "src/common/atomic.h"
+#include "src/common/mutex.h"
+
+namespace Aurora {
+
+class Archive;
+
+/** Extract many resources of an archive at once.
+ *
+ *  The resources are read, decompressed and written to disk by a pool of
+ *  worker threads. They are processed in the order of their offsets
+ *  within the archive, so that the reads stay mostly sequential.
+ *
+ *  Each resource is written into a file named after the resource's name
+ *  and type. Resources without a name (for example in ERF V3.0 archives)
+ *  are named after their hashed name instead. If several resources would
+ *  be written into the same file, only the first one is extracted and
+ *  the others are reported as failures.
+ */
+class ArchiveExtractor : boost::noncopyable {
+public:
+	/** A resource that could not be extracted. */
+	struct Failure {
+		uint32 index; ///< The resource's local index within the archive.
+
+		Common::UString   path;  ///< The file the resource should have been written to.
+		Common::Exception error; ///< What went wrong.
+	};
+
+	typedef std::vector<Failure> FailureList;
+
+	/** Create an extractor for this archive.
+	 *
+	 *  @param archive The archive to extract resources from.
+	 *  @param threadCount The number of worker threads to use. 0 means one
+	 *                     thread for each available processor core.
+	 */
+	ArchiveExtractor(const Archive &archive, size_t threadCount = 0);
+	~ArchiveExtractor();
+
+	/** Extract the resources with these local indices into a directory.
+	 *
+	 *  The directory is created if it doesn't exist yet. Resources that
+	 *  fail to extract don't stop the extraction of the others; they are
+	 *  collected and can be queried with getFailures() afterwards.
+	 *
+	 *  @return The number of resources successfully extracted.
+	 */
+	size_t extract(const std::vector<uint32> &indices, const Common::UString &directory);
+	/** Extract all resources of the archive into a directory. */
+	size_t extractAll(const Common::UString &directory);
+
+	/** Return the resources that failed to extract during the last extraction. */
+	const FailureList &getFailures() const;
+
+private:
+	/** A resource waiting to be extracted. */
+	struct Job {
+		uint64 offset; ///< The offset of the resource's data within the archive.
+		uint32 index;  ///< The resource's local index within the archive.
+
+		Common::UString path; ///< The file to write the resource to.
+
+		bool operator<(const Job &right) const;
+	};
+
+	typedef std::vector<Job> JobList;
+
+	const Archive *_archive;
+
+	size_t _threadCount;
+
+	/** The resources to extract, in the order they should be extracted in. */
+	JobList _jobs;
+
+	/** The position of the next job to be taken by a worker. */
+	boost::atomic<size_t> _nextJob;
+	/** The number of successfully extracted resources. */
+	boost::atomic<size_t> _extracted;
+
+	FailureList   _failures;
+	Common::Mutex _failureMutex;
+
+	/** Create the job list for these resources. */
+	void createJobs(const std::vector<uint32> &indices, const Common::UString &directory);
+	/** Run the jobs, in parallel if possible. */
+	void runJobs();
+
+	/** Take and run jobs until none are left. */
+	void work();
+	/** Extract a single resource. */
+	void extractJob(const Job &job);
+};
+
+} // End of namespace Aurora
+
+#endif // AURORA_ARCHIVEEXTRACTOR_H
@@ -32,6 +32,7 @@
 #include "src/common/strutil.h"
 #include "src/common/error.h"
 #include "src/common/memreadstream.h"
+#include "src/common/fixedtable.h"
 
 #include "src/aurora/biffile.h"
 
@@ -80,30 +81,34 @@ void BIFFile::load(Common::SeekableReadStream &bif) {
 }
 
 void BIFFile::readVarResTable(Common::SeekableReadStream &bif, uint32 offset) {
-	bif.seek(offset);
+	// ID, plus flags in version 1.1, then offset, size and type
+	const size_t fieldStart = (_version == kVersion11) ? 8 : 4;
 
-	for (ResourceList::iterator res = _resources.begin(); res != _resources.end(); ++res) {
-		bif.skip(4); // ID
+	const Common::FixedTable table(bif, offset, _resources.size(), fieldStart + 12);
 
-		if (_version == kVersion11)
-			bif.skip(4); // Flags
+	for (size_t i = 0; i < table.size(); i++) {
+		const byte *entry = table[i] + fieldStart;
 
-		res->offset = bif.readUint32LE();
-		res->size   = bif.readUint32LE();
-		res->type   = (FileType) bif.readUint32LE();
+		_resources[i].offset = READ_LE_UINT32(entry + 0);
+		_resources[i].size   = READ_LE_UINT32(entry + 4);
+		_resources[i].type   = (FileType) READ_LE_UINT32(entry + 8);
 
-		res->packedSize = res->size;
+		_resources[i].packedSize = _resources[i].size;
 	}
 }
 
-Common::SeekableReadStream *BIFFile::getResource(uint32 index) const {
+Common::SeekableReadStream *BIFFile::getResource(uint32 index, bool tryNoCopy) const {
 	const Resource &res = getRes(index);
 	if (res.size == 0)
 		return new Common::MemoryReadStream(static_cast<const byte *>(0), 0);
 
-	_bif->seek(res.offset);
+	if (tryNoCopy) {
+		Common::SeekableReadStream *view = Common::createMemoryView(*_bif, res.offset, res.offset + res.size);
+		if (view)
+			return view;
+	}
 
-	Common::ScopedPtr<Common::SeekableReadStream> resStream(_bif->readStream(res.size));
+	Common::ScopedPtr<Common::SeekableReadStream> resStream(_bif->readStreamAt(res.offset, res.size));
 
 	if (!resStream || (((uint32) resStream->size()) != res.size))
 		throw Common::Exception(Common::kReadError);
@@ -67,7 +67,7 @@ public:
 	~BIFFile();
 
 	/** Return a stream of the resource's contents. */
-	Common::SeekableReadStream *getResource(uint32 index) const;
+	Common::SeekableReadStream *getResource(uint32 index, bool tryNoCopy = false) const;
 
 private:
 	Common::ScopedPtr<Common::SeekableReadStream> _bif;
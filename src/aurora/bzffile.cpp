@@ -28,9 +28,11 @@
 #include <cassert>
 
 #include "src/common/util.h"
+#include "src/common/scopedptr.h"
 #include "src/common/strutil.h"
 #include "src/common/error.h"
 #include "src/common/memreadstream.h"
+#include "src/common/fixedtable.h"
 #include "src/common/lzma.h"
 
 #include "src/aurora/bzffile.h"
@@ -79,14 +81,15 @@ void BZFFile::load(Common::SeekableReadStream &bzf) {
 }
 
 void BZFFile::readVarResTable(Common::SeekableReadStream &bzf, uint32 offset) {
-	bzf.seek(offset);
+	// ID, offset, size and type
+	const Common::FixedTable table(bzf, offset, _resources.size(), 16);
 
-	for (uint32_t i = 0; i < _resources.size(); i++) {
-		bzf.skip(4); // ID
+	for (size_t i = 0; i < table.size(); i++) {
+		const byte *entry = table[i];
 
-		_resources[i].offset = bzf.readUint32LE();
-		_resources[i].size   = bzf.readUint32LE();
-		_resources[i].type   = (FileType) bzf.readUint32LE();
+		_resources[i].offset = READ_LE_UINT32(entry +  4);
+		_resources[i].size   = READ_LE_UINT32(entry +  8);
+		_resources[i].type   = (FileType) READ_LE_UINT32(entry + 12);
 
 		if (i > 0)
 			_resources[i - 1].packedSize = _resources[i].offset - _resources[i - 1].offset;
@@ -96,14 +99,22 @@ void BZFFile::readVarResTable(Common::SeekableReadStream &bzf, uint32 offset) {
 		_resources.back().packedSize = bzf.size() - _resources.back().offset;
 }
 
-Common::SeekableReadStream *BZFFile::getResource(uint32 index) const {
+Common::SeekableReadStream *BZFFile::getResource(uint32 index, bool tryNoCopy) const {
 	const Resource &res = getRes(index);
 	if ((res.packedSize == 0) || (res.size == 0))
 		return new Common::MemoryReadStream(static_cast<const byte *>(0), 0);
 
-	_bzf->seek(res.offset);
+	/* Decompress on the fly. If we may, read the compressed data straight
+	 * out of the BZF. Otherwise, the compressed data is copied first, so
+	 * that the resource stream doesn't depend on the BZF anymore. */
 
-	return Common::decompressLZMA1(*_bzf, res.packedSize, res.size);
+	Common::SeekableReadStream *packed = 0;
+	if (tryNoCopy)
+		packed = new Common::SeekableSubReadStream(_bzf.get(), res.offset, res.offset + res.packedSize);
+	else
+		packed = _bzf->readStreamAt(res.offset, res.packedSize);
+
+	return new Common::LZMAReadStream(packed, res.size);
 }
 
 } // End of namespace Aurora
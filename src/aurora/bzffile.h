@@ -51,7 +51,7 @@ public:
 	~BZFFile();
 
 	/** Return a stream of the resource's contents. */
-	Common::SeekableReadStream *getResource(uint32 index) const;
+	Common::SeekableReadStream *getResource(uint32 index, bool tryNoCopy = false) const;
 
 private:
 	Common::ScopedPtr<Common::SeekableReadStream> _bzf;
@@ -28,11 +28,16 @@
 
 #include <cassert>
 
+#include <boost/thread.hpp>
+
 #include "src/common/memreadstream.h"
+#include "src/common/bufferedreadstream.h"
+#include "src/common/fixedtable.h"
 #include "src/common/readfile.h"
 #include "src/common/util.h"
 #include "src/common/strutil.h"
 #include "src/common/error.h"
+#include "src/common/mutex.h"
 #include "src/common/encoding.h"
 #include "src/common/md5.h"
 #include "src/common/blowfish.h"
@@ -89,6 +94,29 @@ static const byte kNWNPremiumKeys[][kNWNPremiumKeyLength] = {
 	}
 };
 
+/** The size of a Neverwinter Nights premium module header, which is tried to decrypt with each key. */
+static const size_t kNWNPremiumHeaderSize = 152;
+
+/** The NWN premium keys found so far, by the MD5 they were found for. */
+static std::map<std::vector<byte>, size_t> nwnPremiumKeys;
+static Common::Mutex nwnPremiumKeysMutex;
+
+static size_t getKnownNWNPremiumKey(const std::vector<byte> &md5) {
+	Common::StackLock lock(nwnPremiumKeysMutex);
+
+	std::map<std::vector<byte>, size_t>::const_iterator k = nwnPremiumKeys.find(md5);
+	if (k == nwnPremiumKeys.end())
+		return SIZE_MAX;
+
+	return k->second;
+}
+
+static void setKnownNWNPremiumKey(const std::vector<byte> &md5, size_t key) {
+	Common::StackLock lock(nwnPremiumKeysMutex);
+
+	nwnPremiumKeys[md5] = key;
+}
+
 
 ERFFile::ERFHeader::ERFHeader() {
 	clear();
@@ -208,11 +236,9 @@ void ERFFile::verifyPasswordDigest() {
 		for (size_t i = 0; i < sizeof(buffer); i++)
 			buffer[i] = i;
 
-		Common::MemoryReadStream bufferStream(buffer);
-		Common::ScopedPtr<Common::SeekableReadStream>
-			bufferEncrypted(Common::encryptBlowfishEBC(bufferStream, _password));
+		Common::encryptBlowfishEBC(buffer, sizeof(buffer), _password);
 
-		if (!Common::compareMD5Digest(*bufferEncrypted, _header.passwordDigest))
+		if (!Common::compareMD5Digest(buffer, sizeof(buffer), _header.passwordDigest))
 			throw Common::Exception("Password digest does not match");
 
 		return;
@@ -221,15 +247,28 @@ void ERFFile::verifyPasswordDigest() {
 	throw Common::Exception("Invalid encryption type %u", (uint)_header.encryption);
 }
 
-bool ERFFile::decryptNWNPremiumHeader(Common::SeekableReadStream &erf, ERFHeader &header,
+bool ERFFile::decryptNWNPremiumHeader(const byte *cryptHeader, size_t fileSize, ERFHeader &header,
                                       const std::vector<byte> &password) {
 
-	Common::ScopedPtr<Common::SeekableReadStream>
-		decryptERF(decrypt(erf, erf.pos(), 152, kEncryptionBlowfishNWN, password));
+	byte data[kNWNPremiumHeaderSize];
+	std::memcpy(data, cryptHeader, kNWNPremiumHeaderSize);
 
-	readV11Header(*decryptERF, header);
+	Common::decryptBlowfishEBC(data, kNWNPremiumHeaderSize, *Common::getBlowfishContext(password));
 
-	return header.isSensible(erf.size());
+	Common::MemoryReadStream decryptERF(data);
+	readV11Header(decryptERF, header);
+
+	return header.isSensible(fileSize);
+}
+
+bool ERFFile::tryNWNPremiumKey(const byte *cryptHeader, size_t fileSize, ERFHeader &header,
+                               const std::vector<byte> &password) {
+
+	try {
+		return decryptNWNPremiumHeader(cryptHeader, fileSize, header, password);
+	} catch (Common::Exception &) {
+		return false;
+	}
 }
 
 bool ERFFile::findNWNPremiumKey(Common::SeekableReadStream &erf, ERFHeader &header,
@@ -237,20 +276,36 @@ bool ERFFile::findNWNPremiumKey(Common::SeekableReadStream &erf, ERFHeader &head
 
 	assert(md5.empty() || (md5.size() == Common::kMD5Length));
 
-	password.resize(kNWNPremiumKeyLength);
-	const size_t headerPos = erf.pos();
+	byte cryptHeader[kNWNPremiumHeaderSize];
+	if (erf.read(cryptHeader, kNWNPremiumHeaderSize) != kNWNPremiumHeaderSize)
+		throw Common::Exception(Common::kReadError);
 
-	for (size_t i = 0; i < ARRAYSIZE(kNWNPremiumKeys); i++) {
-		std::memcpy(&password[0], kNWNPremiumKeys[i], kNWNPremiumKeyLength);
+	const size_t keyCount = ARRAYSIZE(kNWNPremiumKeys);
+
+	std::vector< std::vector<byte> > keys(keyCount);
+	for (size_t i = 0; i < keyCount; i++) {
+		keys[i].assign(kNWNPremiumKeys[i], kNWNPremiumKeys[i] + kNWNPremiumKeyLength);
 		if (!md5.empty())
-			std::memcpy(&password[0] + kNWNPremiumKeyLength - Common::kMD5Length, &md5[0], Common::kMD5Length);
+			std::memcpy(&keys[i][0] + kNWNPremiumKeyLength - Common::kMD5Length, &md5[0], Common::kMD5Length);
+	}
 
-		erf.seek(headerPos);
-		if (decryptNWNPremiumHeader(erf, header, password))
-			return true;
+	// If we already found the key for this MD5 before, it's most likely the right one again
+	size_t key = getKnownNWNPremiumKey(md5);
+	if ((key >= keyCount) || !decryptNWNPremiumHeader(cryptHeader, erf.size(), header, keys[key])) {
+
+		// Otherwise, try all candidate keys, one after the other
+		for (key = 0; key < keyCount; key++)
+			if (tryNWNPremiumKey(cryptHeader, erf.size(), header, keys[key]))
+				break;
+
+		if (key >= keyCount)
+			return false;
+
+		setKnownNWNPremiumKey(md5, key);
 	}
 
-	return false;
+	password = keys[key];
+	return true;
 }
 
 void ERFFile::readNWNPremiumHeader(Common::SeekableReadStream &erf, ERFHeader &header,
@@ -303,7 +358,11 @@ void ERFFile::decryptNWNPremium() {
 
 	_erf->seek(0);
 
-	_erf.reset(decrypt(*_erf, kEncryptionBlowfishNWN, _password));
+	/* The whole archive is decrypted up front, before anything else can happen,
+	 * so large archives are split across all cores. */
+	const size_t threadCount = MAX<size_t>(boost::thread::hardware_concurrency(), 1);
+
+	_erf.reset(decrypt(*_erf, kEncryptionBlowfishNWN, _password, threadCount));
 
 	_header.encryption = kEncryptionNone;
 }
@@ -485,91 +544,87 @@ void ERFFile::readDescription(LocString &description, Common::SeekableReadStream
 	description.readLocString(erf, header.descriptionID, header.langCount);
 }
 
-void ERFFile::readResources(Common::SeekableReadStream &erf, const ERFHeader &header) {
-	_resources.resize(header.resCount);
+void ERFFile::readResources(Common::SeekableReadStream &stream, const ERFHeader &header) {
+	_resources.clear();
+	_resources.reserve(header.resCount);
 	_iResources.resize(header.resCount);
 
 	if        (_version == kVersion10) {
 
-		readV10KeyList(erf, header); // Read name and type part of the resource list
-		readV10ResList(erf, header); // Read offset and size part of the resource list
+		readV10KeyList(stream, header); // Read name and type part of the resource list
+		readV10ResList(stream, header); // Read offset and size part of the resource list
 
 	} else if (_version == kVersion11) {
 
 		// Read name and type part of the resource list
 		if (header.isNWNPremium)
-			readV10KeyList(erf, header);
+			readV10KeyList(stream, header);
 		else
-			readV11KeyList(erf, header);
+			readV11KeyList(stream, header);
 
-		readV10ResList (erf, header); // Read offset and size part of the resource list
+		readV10ResList (stream, header); // Read offset and size part of the resource list
 
 	} else if (_version == kVersion20) {
 
 		// Read the resource list
+		Common::BufferedReadStream erf(&stream);
 		readV20ResList(erf, header);
 
 	} else if (_version == kVersion22) {
 
 		// Read the resource list
+		Common::BufferedReadStream erf(&stream);
 		readV22ResList(erf, header);
 
 	} else if (_version == kVersion30) {
 
 		// Read the resource list
+		Common::BufferedReadStream erf(&stream);
 		readV30ResList(erf, header);
 
 	}
 
 }
 
-void ERFFile::readV10KeyList(Common::SeekableReadStream &erf, const ERFHeader &header) {
-	erf.seek(header.offKeyList);
+void ERFFile::readKeyList(Common::SeekableReadStream &erf, const ERFHeader &header, size_t nameSize) {
+	// Name, resource ID, type and reserved
+	const Common::FixedTable table(erf, header.offKeyList, header.resCount, nameSize + 8);
 
-	uint32 index = 0;
-	for (ResourceList::iterator res = _resources.begin(); res != _resources.end(); ++index, ++res) {
-		res->name = Common::readStringFixed(erf, Common::kEncodingASCII, 16);
-		erf.skip(4); // Resource ID
-		res->type = (FileType) erf.readUint16LE();
-		erf.skip(2); // Reserved
-		res->index = index;
+	for (size_t i = 0; i < table.size(); i++) {
+		const byte *entry = table[i];
+
+		_resources.addFixed(entry, nameSize, (FileType) READ_LE_UINT16(entry + nameSize + 4), i);
 	}
 }
 
-void ERFFile::readV11KeyList(Common::SeekableReadStream &erf, const ERFHeader &header) {
-	erf.seek(header.offKeyList);
+void ERFFile::readV10KeyList(Common::SeekableReadStream &erf, const ERFHeader &header) {
+	readKeyList(erf, header, 16);
+}
 
-	uint32 index = 0;
-	for (ResourceList::iterator res = _resources.begin(); res != _resources.end(); ++index, ++res) {
-		res->name = Common::readStringFixed(erf, Common::kEncodingASCII, 32);
-		erf.skip(4); // Resource ID
-		res->type = (FileType) erf.readUint16LE();
-		erf.skip(2); // Reserved
-		res->index = index;
-	}
+void ERFFile::readV11KeyList(Common::SeekableReadStream &erf, const ERFHeader &header) {
+	readKeyList(erf, header, 32);
 }
 
 void ERFFile::readV10ResList(Common::SeekableReadStream &erf, const ERFHeader &header) {
-	erf.seek(header.offResList);
+	// Offset and size
+	const Common::FixedTable table(erf, header.offResList, _iResources.size(), 8);
 
-	for (IResourceList::iterator res = _iResources.begin(); res != _iResources.end(); ++res) {
-		res->offset                         = erf.readUint32LE();
-		res->packedSize = res->unpackedSize = erf.readUint32LE();
+	for (size_t i = 0; i < table.size(); i++) {
+		const byte *entry = table[i];
+
+		_iResources[i].offset                                   = READ_LE_UINT32(entry + 0);
+		_iResources[i].packedSize = _iResources[i].unpackedSize = READ_LE_UINT32(entry + 4);
 	}
 }
 
-void ERFFile::readV20ResList(Common::SeekableReadStream &erf, const ERFHeader &header) {
+void ERFFile::readV20ResList(Common::BufferedReadStream &erf, const ERFHeader &header) {
 	erf.seek(header.offResList);
 
 	uint32 index = 0;
-	ResourceList::iterator   res = _resources.begin();
-	IResourceList::iterator iRes = _iResources.begin();
-	for (; (res != _resources.end()) && (iRes != _iResources.end()); ++index, ++res, ++iRes) {
+	for (IResourceList::iterator iRes = _iResources.begin(); iRes != _iResources.end(); ++index, ++iRes) {
 		Common::UString name = Common::readStringFixed(erf, Common::kEncodingUTF16LE, 64);
 
-		res->name  = TypeMan.setFileType(name, kFileTypeNone);
-		res->type  = TypeMan.getFileType(name);
-		res->index = index;
+		_resources.add(TypeMan.setFileType(name, kFileTypeNone), TypeMan.getFileType(name), index);
 
 		iRes->offset                          = erf.readUint32LE();
 		iRes->packedSize = iRes->unpackedSize = erf.readUint32LE();
@@ -577,18 +632,14 @@ void ERFFile::readV20ResList(Common::SeekableReadStream &erf, const ERFHeader &h
 
 }
 
-void ERFFile::readV22ResList(Common::SeekableReadStream &erf, const ERFHeader &header) {
+void ERFFile::readV22ResList(Common::BufferedReadStream &erf, const ERFHeader &header) {
 	erf.seek(header.offResList);
 
 	uint32 index = 0;
-	ResourceList::iterator   res = _resources.begin();
-	IResourceList::iterator iRes = _iResources.begin();
-	for (; (res != _resources.end()) && (iRes != _iResources.end()); ++index, ++res, ++iRes) {
+	for (IResourceList::iterator iRes = _iResources.begin(); iRes != _iResources.end(); ++index, ++iRes) {
 		Common::UString name = Common::readStringFixed(erf, Common::kEncodingUTF16LE, 64);
 
-		res->name  = TypeMan.setFileType(name, kFileTypeNone);
-		res->type  = TypeMan.getFileType(name);
-		res->index = index;
+		_resources.add(TypeMan.setFileType(name, kFileTypeNone), TypeMan.getFileType(name), index);
 
 		iRes->offset       = erf.readUint32LE();
 		iRes->packedSize   = erf.readUint32LE();
@@ -597,33 +648,34 @@ void ERFFile::readV22ResList(Common::SeekableReadStream &erf, const ERFHeader &h
 
 }
 
-void ERFFile::readV30ResList(Common::SeekableReadStream &erf, const ERFHeader &header) {
+void ERFFile::readV30ResList(Common::BufferedReadStream &erf, const ERFHeader &header) {
 	erf.seek(header.offResList);
 
 	uint32 index = 0;
-	ResourceList::iterator   res = _resources.begin();
-	IResourceList::iterator iRes = _iResources.begin();
-	for (; (res != _resources.end()) && (iRes != _iResources.end()); ++index, ++res, ++iRes) {
+	for (IResourceList::iterator iRes = _iResources.begin(); iRes != _iResources.end(); ++index, ++iRes) {
 		int32 nameOffset = erf.readSint32LE();
 
+		Common::UString name;
+		FileType type = kFileTypeNone;
+
 		if (nameOffset >= 0) {
 			if ((uint32)nameOffset >= header.stringTableSize)
 				throw Common::Exception("Invalid ERF string table offset");
 
-			Common::UString name = header.stringTable.get() + nameOffset;
-			res->name = TypeMan.setFileType(name, kFileTypeNone);
-			res->type = TypeMan.getFileType(name);
+			name = header.stringTable.get() + nameOffset;
+			type = TypeMan.getFileType(name);
+			name = TypeMan.setFileType(name, kFileTypeNone);
 		}
 
-		res->index = index;
-		res->hash  = erf.readUint64LE();
-
+		uint64 hash     = erf.readUint64LE();
 		uint32 typeHash = erf.readUint32LE();
 
 		// Look up the file type by its hash
-		FileType type = TypeMan.getFileType(Common::kHashFNV32, typeHash);
-		if (type != kFileTypeNone)
-			res->type = type;
+		FileType hashedType = TypeMan.getFileType(Common::kHashFNV32, typeHash);
+		if (hashedType != kFileTypeNone)
+			type = hashedType;
+
+		_resources.add(name, type, index, hash);
 
 		iRes->offset       = erf.readUint32LE();
 		iRes->packedSize   = erf.readUint32LE();
@@ -644,10 +696,14 @@ const LocString &ERFFile::getDescription() const {
 	return _description;
 }
 
-const Archive::ResourceList &ERFFile::getResources() const {
+const ResourceTable &ERFFile::getResourceTable() const {
 	return _resources;
 }
 
+ResourceTable *ERFFile::getModifiableResourceTable() {
+	return &_resources;
+}
+
 const ERFFile::IResource &ERFFile::getIResource(uint32 index) const {
 	if (index >= _iResources.size())
 		throw Common::Exception("Resource index out of range (%u/%u)", index, (uint)_iResources.size());
@@ -655,36 +711,56 @@ const ERFFile::IResource &ERFFile::getIResource(uint32 index) const {
 	return _iResources[index];
 }
 
-uint32 ERFFile::getResourceSize(uint32 index) const {
+uint64 ERFFile::getResourceSize(uint32 index) const {
 	return getIResource(index).unpackedSize;
 }
 
+uint64 ERFFile::getResourceOffset(uint32 index) const {
+	return getIResource(index).offset;
+}
+
 Common::SeekableReadStream *ERFFile::getResource(uint32 index, bool tryNoCopy) const {
 	const IResource &res = getIResource(index);
 
-	if (tryNoCopy && (_header.encryption == kEncryptionNone) && (_header.compression == kCompressionNone))
-		return new Common::SeekableSubReadStream(_erf.get(), res.offset, res.offset + res.packedSize);
+	if (tryNoCopy) {
+		if ((_header.encryption == kEncryptionNone) && (_header.compression == kCompressionNone)) {
+			Common::SeekableReadStream *view = Common::createMemoryView(*_erf, res.offset, res.offset + res.packedSize);
+			if (view)
+				return view;
+
+			return new Common::SeekableSubReadStream(_erf.get(), res.offset, res.offset + res.packedSize);
+		}
+
+		/* Decrypt and decompress on the fly, straight out of the ERF. The
+		 * data is decrypted right within the inflater's input buffer. */
+		Common::ScopedPtr<Common::SeekableReadStream>
+			stream(new Common::SeekableSubReadStream(_erf.get(), res.offset, res.offset + res.packedSize));
 
-	_erf->seek(res.offset);
+		if (_header.encryption != kEncryptionNone)
+			stream.reset(createDecryptStream(stream.release(), _header.encryption, _password));
 
-	// Read
-	Common::MemoryReadStream *stream = _erf->readStream(res.packedSize);
+		return decompress(stream.release(), res.unpackedSize);
+	}
+
+	// Read into a single buffer, which is then decrypted in place and decompressed from
+	Common::ScopedArray<byte> data(new byte[res.packedSize]);
+	if (_erf->readAt(res.offset, data.get(), res.packedSize) != res.packedSize)
+		throw Common::Exception(Common::kReadError);
 
-	// Decrypt
 	if (_header.encryption != kEncryptionNone)
-		stream = decrypt(stream, _header.encryption, _password);
+		decrypt(data.get(), res.packedSize, _header.encryption, _password);
 
-	// Decompress
-	return decompress(stream, res.unpackedSize);
+	return decompress(new Common::MemoryReadStream(data.release(), res.packedSize, true), res.unpackedSize);
 }
 
 Common::MemoryReadStream *ERFFile::decrypt(Common::SeekableReadStream &cryptStream,
-                                           Encryption encryption, const std::vector<byte> &password) {
+                                           Encryption encryption, const std::vector<byte> &password,
+                                           size_t threadCount) {
 	switch (encryption) {
 		case kEncryptionBlowfishDAO:
 		case kEncryptionBlowfishDA2:
 		case kEncryptionBlowfishNWN:
-			return Common::decryptBlowfishEBC(cryptStream, password);
+			return Common::decryptBlowfishEBC(cryptStream, password, threadCount);
 
 		default:
 			throw Common::Exception("Invalid ERF encryption %u", (uint) encryption);
@@ -713,10 +789,42 @@ Common::SeekableReadStream *ERFFile::decrypt(Common::SeekableReadStream &erf, si
 	return decrypt(erf, erf.pos(), size, encryption, password);
 }
 
-Common::SeekableReadStream *ERFFile::decompress(Common::MemoryReadStream *packedStream,
-                                                uint32 unpackedSize) const {
+void ERFFile::decrypt(byte *data, size_t size, Encryption encryption, const std::vector<byte> &password) {
+	switch (encryption) {
+		case kEncryptionBlowfishDAO:
+		case kEncryptionBlowfishDA2:
+		case kEncryptionBlowfishNWN:
+			Common::decryptBlowfishEBC(data, size, password);
+			break;
+
+		default:
+			throw Common::Exception("Invalid ERF encryption %u", (uint) encryption);
+	}
+}
+
+Common::SeekableReadStream *ERFFile::createDecryptStream(Common::SeekableReadStream *cryptStream,
+                                                         Encryption encryption,
+                                                         const std::vector<byte> &password) {
+
+	assert(cryptStream);
+
+	Common::ScopedPtr<Common::SeekableReadStream> stream(cryptStream);
+
+	switch (encryption) {
+		case kEncryptionBlowfishDAO:
+		case kEncryptionBlowfishDA2:
+		case kEncryptionBlowfishNWN:
+			return new Common::BlowfishReadStream(stream.release(), password);
+
+		default:
+			throw Common::Exception("Invalid ERF encryption %u", (uint) encryption);
+	}
+}
+
+Common::SeekableReadStream *ERFFile::decompress(Common::SeekableReadStream *packedStream,
+                                                size_t unpackedSize) const {
 
-	Common::ScopedPtr<Common::MemoryReadStream> stream(packedStream);
+	Common::ScopedPtr<Common::SeekableReadStream> stream(packedStream);
 
 	switch (_header.compression) {
 		case kCompressionNone:
@@ -738,43 +846,36 @@ Common::SeekableReadStream *ERFFile::decompress(Common::MemoryReadStream *packed
 	throw Common::Exception("Invalid ERF compression %u", (uint) _header.compression);
 }
 
-Common::SeekableReadStream *ERFFile::decompressBiowareZlib(Common::MemoryReadStream *packedStream,
-                                                           uint32 unpackedSize) const {
+Common::SeekableReadStream *ERFFile::decompressBiowareZlib(Common::SeekableReadStream *packedStream,
+                                                           size_t unpackedSize) const {
 
 	/* Decompress using raw inflate. An extra one byte header specifies the window size. */
 
 	assert(packedStream);
 
-	Common::ScopedPtr<Common::MemoryReadStream> stream(packedStream);
+	Common::ScopedPtr<Common::SeekableReadStream> stream(packedStream);
 
-	const byte * const compressedData = stream->getData();
-	const uint32 packedSize = stream->size();
+	const int windowBits = stream->readByte() >> 4;
 
-	return decompressZlib(compressedData + 1, packedSize - 1, unpackedSize, *compressedData >> 4);
+	return decompressZlib(stream.release(), unpackedSize, windowBits);
 }
 
-Common::SeekableReadStream *ERFFile::decompressHeaderlessZlib(Common::MemoryReadStream *packedStream,
-                                                              uint32 unpackedSize) const {
+Common::SeekableReadStream *ERFFile::decompressHeaderlessZlib(Common::SeekableReadStream *packedStream,
+                                                              size_t unpackedSize) const {
 
 	/* Decompress using raw inflate. Use the default maximum window size (15). */
 
 	assert(packedStream);
 
-	Common::ScopedPtr<Common::MemoryReadStream> stream(packedStream);
-
-	const byte * const compressedData = stream->getData();
-	const uint32 packedSize = stream->size();
-
-	return decompressZlib(compressedData, packedSize, unpackedSize, Common::kWindowBitsMax);
+	return decompressZlib(packedStream, unpackedSize, Common::kWindowBitsMax);
 }
 
-Common::SeekableReadStream *ERFFile::decompressZlib(const byte *compressedData, uint32 packedSize,
-                                                    uint32 unpackedSize, int windowBits) const {
-
-	// Decompress. Negative window size to signal not to look for a gzip header.
-	const byte *data = Common::decompressDeflate(compressedData, packedSize, unpackedSize, -windowBits);
+Common::SeekableReadStream *ERFFile::decompressZlib(Common::SeekableReadStream *packedStream,
+                                                    size_t unpackedSize, int windowBits) const {
 
-	return new Common::MemoryReadStream(data, unpackedSize, true);
+	/* Decompress on the fly, starting at the current position of the packed stream.
+	 * Negative window size to signal not to look for a gzip header. */
+	return new Common::InflateReadStream(packedStream, unpackedSize, -windowBits);
 }
 
 Common::HashAlgo ERFFile::getNameHashAlgo() const {
@@ -795,7 +896,7 @@ LocString ERFFile::getDescription(Common::SeekableReadStream &erf) {
 	try {
 		std::vector<byte> password;
 		readERFHeader(erf, header, version, password);
-	} catch (...) {
+	} catch (Common::Exception &) {
 		return description;
 	}
 
@@ -38,6 +38,7 @@
 
 namespace Common {
 	class SeekableReadStream;
+	class BufferedReadStream;
 }
 
 namespace Aurora {
@@ -115,11 +116,14 @@ public:
 	ERFFile(Common::SeekableReadStream *erf, const std::vector<byte> &password = std::vector<byte>());
 	~ERFFile();
 
-	/** Return the list of resources. */
-	const ResourceList &getResources() const;
+	/** Return the table of resources. */
+	const ResourceTable &getResourceTable() const;
 
 	/** Return the size of a resource. */
-	uint32 getResourceSize(uint32 index) const;
+	uint64 getResourceSize(uint32 index) const;
+
+	/** Return the offset of a resource's data within the ERF. */
+	uint64 getResourceOffset(uint32 index) const;
 
 	/** Return a stream of the resource's contents. */
 	Common::SeekableReadStream *getResource(uint32 index, bool tryNoCopy = false) const;
@@ -138,6 +142,9 @@ public:
 	static LocString getDescription(Common::SeekableReadStream &erf);
 	static LocString getDescription(const Common::UString &fileName);
 
+protected:
+	ResourceTable *getModifiableResourceTable();
+
 private:
 	enum Encryption {
 		kEncryptionNone        =  0, ///< No encryption at all.
@@ -193,9 +200,9 @@ private:
 
 	/** Internal resource information. */
 	struct IResource {
-		uint32 offset;       ///< The offset of the resource within the ERF.
-		uint32 packedSize;   ///< The resource's packed size.
-		uint32 unpackedSize; ///< The resource's unpacked size.
+		uint64 offset;       ///< The offset of the resource within the ERF.
+		uint64 packedSize;   ///< The resource's packed size.
+		uint64 unpackedSize; ///< The resource's unpacked size.
 	};
 
 	typedef std::vector<IResource> IResourceList;
@@ -207,8 +214,8 @@ private:
 	/** The ERF's description. */
 	LocString _description;
 
-	/** External list of resource names and types. */
-	ResourceList _resources;
+	/** External table of resource names and types. */
+	ResourceTable _resources;
 
 	/** Internal list of resource offsets and sizes. */
 	IResourceList _iResources;
@@ -227,6 +234,7 @@ private:
                               const ERFHeader &header);
 
 	void readResources(Common::SeekableReadStream &erf, const ERFHeader &header);
+	void readKeyList(Common::SeekableReadStream &erf, const ERFHeader &header, size_t nameSize);
 	// '---
 
 	// .--- V1.0
@@ -242,24 +250,25 @@ private:
 
 	// .--- V2.0
 	static void readV20Header(Common::SeekableReadStream &erf, ERFHeader &header);
-	void readV20ResList(Common::SeekableReadStream &erf, const ERFHeader &header);
+	void readV20ResList(Common::BufferedReadStream &erf, const ERFHeader &header);
 	// '---
 
 	// .--- V2.2
 	static void readV22Header(Common::SeekableReadStream &erf, ERFHeader &header, uint32 &flags);
-	void readV22ResList(Common::SeekableReadStream &erf, const ERFHeader &header);
+	void readV22ResList(Common::BufferedReadStream &erf, const ERFHeader &header);
 	// '---
 
 	// .--- V3.0
 	static void readV30Header(Common::SeekableReadStream &erf, ERFHeader &header, uint32 &flags);
-	void readV30ResList(Common::SeekableReadStream &erf, const ERFHeader &header);
+	void readV30ResList(Common::BufferedReadStream &erf, const ERFHeader &header);
 	// '---
 
 	// .--- Encryption
 	void verifyPasswordDigest();
 
 	static Common::MemoryReadStream *decrypt(Common::SeekableReadStream &cryptStream,
-	                                         Encryption encryption, const std::vector<byte> &password);
+	                                         Encryption encryption, const std::vector<byte> &password,
+	                                         size_t threadCount = 1);
 	static Common::MemoryReadStream *decrypt(Common::SeekableReadStream *cryptStream,
 	                                         Encryption encryption, const std::vector<byte> &password);
 
@@ -268,7 +277,16 @@ private:
 	static Common::SeekableReadStream *decrypt(Common::SeekableReadStream &erf, size_t size,
 	                                           Encryption encryption, const std::vector<byte> &password);
 
-	static bool decryptNWNPremiumHeader(Common::SeekableReadStream &erf, ERFHeader &header,
+	/** Decrypt the data in place. */
+	static void decrypt(byte *data, size_t size, Encryption encryption, const std::vector<byte> &password);
+	/** Create a stream that decrypts the encrypted stream on the fly. */
+	static Common::SeekableReadStream *createDecryptStream(Common::SeekableReadStream *cryptStream,
+	                                                       Encryption encryption,
+	                                                       const std::vector<byte> &password);
+
+	static bool decryptNWNPremiumHeader(const byte *cryptHeader, size_t fileSize, ERFHeader &header,
+	                                    const std::vector<byte> &password);
+	static bool tryNWNPremiumKey       (const byte *cryptHeader, size_t fileSize, ERFHeader &header,
 	                                    const std::vector<byte> &password);
 	static bool findNWNPremiumKey      (Common::SeekableReadStream &erf, ERFHeader &header,
 	                                    const std::vector<byte> &md5, std::vector<byte> &password);
@@ -279,16 +297,16 @@ private:
 	// '---
 
 	// .--- Compression
-	Common::SeekableReadStream *decompress(Common::MemoryReadStream *packedStream,
-	                                       uint32 unpackedSize) const;
+	Common::SeekableReadStream *decompress(Common::SeekableReadStream *packedStream,
+	                                       size_t unpackedSize) const;
 
-	Common::SeekableReadStream *decompressBiowareZlib   (Common::MemoryReadStream *packedStream,
-	                                                     uint32 unpackedSize) const;
-	Common::SeekableReadStream *decompressHeaderlessZlib(Common::MemoryReadStream *packedStream,
-	                                                     uint32 unpackedSize) const;
+	Common::SeekableReadStream *decompressBiowareZlib   (Common::SeekableReadStream *packedStream,
+	                                                     size_t unpackedSize) const;
+	Common::SeekableReadStream *decompressHeaderlessZlib(Common::SeekableReadStream *packedStream,
+	                                                     size_t unpackedSize) const;
 
-	Common::SeekableReadStream *decompressZlib(const byte *compressedData, uint32 packedSize,
-	                                           uint32 unpackedSize, int windowBits) const;
+	Common::SeekableReadStream *decompressZlib(Common::SeekableReadStream *packedStream,
+	                                           size_t unpackedSize, int windowBits) const;
 	// '---
 
 	const IResource &getIResource(uint32 index) const;
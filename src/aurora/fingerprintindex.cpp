@@ -0,0 +1,696 @@
+/* Phaethon - A FLOSS resource explorer for BioWare's Aurora engine games
+ *
+ * Phaethon is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * Phaethon is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * Phaethon is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Phaethon. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  An index of the contents of all resources in a game installation.
+ */
+
+#include <cstring>
+#include <algorithm>
+#include <set>
+#include <list>
+#include <map>
+
+#include <boost/thread/thread.hpp>
+
+#include "src/common/util.h"
+#include "src/common/scopedptr.h"
+#include "src/common/ptrvector.h"
+#include "src/common/readstream.h"
+#include "src/common/strutil.h"
+#include "src/common/mappedreadfile.h"
+#include "src/common/writefile.h"
+#include "src/common/filepath.h"
+#include "src/common/filetree.h"
+
+#include "src/aurora/fingerprintindex.h"
+#include "src/aurora/archive.h"
+#include "src/aurora/keyfile.h"
+#include "src/aurora/keydatafileresolver.h"
+#include "src/aurora/indexcache.h"
+#include "src/aurora/util.h"
+
+static const uint32 kIndexID      = MKTAG('P', 'H', 'F', 'X');
+static const uint32 kIndexVersion = 2;
+
+/** The number of resources a worker takes at once. */
+static const size_t kBatchSize = 16;
+/** Resources up to this size are read whole and hashed together with the rest of their batch. */
+static const size_t kMaxBatchedSize = 256 * 1024;
+
+namespace Aurora {
+
+const uint32 FingerprintIndex::kLooseFile;
+
+static void writeString(Common::WriteStream &stream, const Common::UString &str) {
+	const size_t length = std::strlen(str.c_str());
+
+	stream.writeUint32LE(length);
+	stream.write(str.c_str(), length);
+}
+
+static Common::UString readString(Common::SeekableReadStream &stream) {
+	const uint32 length = stream.readUint32LE();
+	if (length > (stream.size() - stream.pos()))
+		throw Common::Exception(Common::kReadError);
+
+	if (length == 0)
+		return "";
+
+	std::vector<char> str(length);
+	if (stream.read(&str[0], length) != length)
+		throw Common::Exception(Common::kReadError);
+
+	return Common::UString(&str[0], length);
+}
+
+/** Is this a type of archive we can fingerprint the resources of? */
+static bool isArchive(FileType type) {
+	switch (type) {
+		case kFileTypeZIP:
+		case kFileTypeERF:
+		case kFileTypeMOD:
+		case kFileTypeNWM:
+		case kFileTypeSAV:
+		case kFileTypeHAK:
+		case kFileTypeRIM:
+		case kFileTypeKEY:
+			return true;
+
+		default:
+			break;
+	}
+
+	return false;
+}
+
+/** Collect all regular files within this file tree entry. */
+static void collectFiles(const Common::FileTree::Entry &entry, std::list<Common::UString> &files) {
+	if (!entry.isDirectory()) {
+		files.push_back(entry.path.generic_string());
+		return;
+	}
+
+	for (std::list<Common::FileTree::Entry>::const_iterator c = entry.children.begin();
+	     c != entry.children.end(); ++c)
+		collectFiles(*c, files);
+}
+
+
+FingerprintIndex::Fingerprint::Fingerprint() : type(kFileTypeNone), size(0), index(kLooseFile) {
+	std::memset(digest, 0, sizeof(digest));
+}
+
+bool FingerprintIndex::Fingerprint::hasSameContents(const Fingerprint &right) const {
+	return (size == right.size) && (std::memcmp(digest, right.digest, sizeof(digest)) == 0);
+}
+
+
+FingerprintIndex::FileStamp::FileStamp() : size(0), lastModified(0) {
+}
+
+FingerprintIndex::FileStamp::FileStamp(const Common::UString &p) : path(p) {
+	size         = Common::FilePath::getFileSize(path);
+	lastModified = Common::FilePath::getLastModified(path);
+}
+
+bool FingerprintIndex::FileStamp::isCurrent() const {
+	return (size         == (uint64) Common::FilePath::getFileSize(path)) &&
+	       (lastModified == Common::FilePath::getLastModified(path));
+}
+
+
+bool FingerprintIndex::Job::operator<(const Job &right) const {
+	if (archive != right.archive)
+		return archive < right.archive;
+
+	if (offset != right.offset)
+		return offset < right.offset;
+
+	return fingerprint->index < right.fingerprint->index;
+}
+
+
+FingerprintIndex::FingerprintIndex(const Common::UString &indexFile, size_t threadCount) :
+	_indexFile(indexFile), _threadCount(threadCount), _changed(false), _hasResources(false), _nextJob(0) {
+
+	if (_threadCount == 0)
+		_threadCount = MAX<size_t>(boost::thread::hardware_concurrency(), 1);
+}
+
+FingerprintIndex::~FingerprintIndex() {
+}
+
+Common::UString FingerprintIndex::getDefaultIndexFile(const Common::UString &path) {
+	const uint64 hash = Common::hashStringFNV64(Common::FilePath::normalize(path));
+
+	return Common::FilePath::getUserDataFile(Common::UString::format("fingerprints/%08X%08X.idx",
+		(uint)(hash >> 32), (uint)(hash & 0xFFFFFFFF)));
+}
+
+bool FingerprintIndex::load() {
+	_locations.clear();
+	_hasResources = false;
+
+	_changed = false;
+
+	if (_indexFile.empty() || !Common::FilePath::isRegularFile(_indexFile))
+		return false;
+
+	try {
+		Common::ScopedPtr<Common::SeekableReadStream> stream(Common::openReadFile(_indexFile));
+
+		read(*stream);
+	} catch (...) {
+		// An outdated or broken index is just thrown away
+		_locations.clear();
+
+		return false;
+	}
+
+	return true;
+}
+
+void FingerprintIndex::save() {
+	if (!_changed || _indexFile.empty())
+		return;
+
+	// Write into a temporary file first, so that a crash can't leave a torn index file behind
+	const Common::UString tempFile = _indexFile + ".tmp";
+
+	try {
+		Common::WriteFile file(tempFile);
+
+		write(file);
+		file.flush();
+		file.close();
+
+		Common::FilePath::renameFile(tempFile, _indexFile);
+
+	} catch (Common::Exception &e) {
+		e.add("Failed to write fingerprint index \"%s\"", _indexFile.c_str());
+		throw;
+	}
+
+	_changed = false;
+}
+
+const FingerprintIndex::FailureList &FingerprintIndex::getFailures() const {
+	return _failures;
+}
+
+size_t FingerprintIndex::getLocationCount() const {
+	return _locations.size();
+}
+
+size_t FingerprintIndex::getFingerprintCount() const {
+	size_t count = 0;
+	for (LocationMap::const_iterator l = _locations.begin(); l != _locations.end(); ++l)
+		count += l->second.fingerprints.size();
+
+	return count;
+}
+
+size_t FingerprintIndex::addPath(const Common::UString &path) {
+	const Common::UString root = Common::FilePath::canonicalize(path);
+	if (!Common::FilePath::isDirectory(root) && !Common::FilePath::isRegularFile(root))
+		throw Common::Exception("No such file or directory \"%s\"", path.c_str());
+
+	_failures.clear();
+	_hasResources = false;
+
+	/* Everything that isn't safe to do from several threads at once, like
+	 * opening archives and querying the file type manager, is done here,
+	 * before the workers start. */
+
+	Common::FileTree tree;
+	tree.readPath(root, -1);
+
+	std::list<Common::UString> files;
+	collectFiles(tree.getRoot(), files);
+
+	// KEY files index data files relative to the base directory of the installation
+	const Common::UString directory = Common::FilePath::isDirectory(root) ?
+		root : Common::FilePath::getDirectory(root);
+
+	KEYDataFileResolver resolver(directory);
+	Common::PtrVector<Archive> archives;
+
+	std::set<Common::UString> present;
+
+	for (std::list<Common::UString>::const_iterator f = files.begin(); f != files.end(); ++f) {
+		const FileType type = TypeMan.getFileType(*f);
+
+		// The resources in data files are fingerprinted through their KEY files
+		if ((type == kFileTypeBIF) || (type == kFileTypeBZF))
+			continue;
+
+		present.insert(*f);
+
+		LocationMap::const_iterator l = _locations.find(*f);
+		if (l != _locations.end()) {
+			bool current = true;
+			for (std::vector<FileStamp>::const_iterator s = l->second.files.begin();
+			     current && (s != l->second.files.end()); ++s)
+				current = s->isCurrent();
+
+			if (current)
+				continue;
+		}
+
+		_locations.erase(*f);
+		_changed = true;
+
+		if (!isArchive(type)) {
+			addLooseFile(*f);
+			continue;
+		}
+
+		try {
+			archives.push_back(IndexCache::openArchiveFile(*f, &resolver));
+		} catch (Common::Exception &e) {
+			e.add("Failed opening archive \"%s\"", f->c_str());
+
+			addFailure(*f, kLooseFile, e);
+			continue;
+		}
+
+		addArchive(*f, *archives.back(), directory);
+	}
+
+	// Forget about everything that vanished from the path
+	const Common::UString prefix = Common::FilePath::isDirectory(root) ? (root + "/") : root;
+	for (LocationMap::iterator l = _locations.begin(); l != _locations.end(); ) {
+		if (l->first.beginsWith(prefix) && (present.find(l->first) == present.end())) {
+			_locations.erase(l++);
+			_changed = true;
+		} else
+			++l;
+	}
+
+	const size_t hashed = _jobs.size();
+
+	runJobs();
+
+	_jobs.clear();
+
+	removeFailures();
+
+	return hashed;
+}
+
+void FingerprintIndex::addArchive(const Common::UString &path, const Archive &archive,
+                                  const Common::UString &directory) {
+
+	Location &location = _locations[path];
+
+	location.files.push_back(FileStamp(path));
+
+	// The contents of a KEY file's resources live in its data files
+	const KEYFile *key = dynamic_cast<const KEYFile *>(&archive);
+	if (key) {
+		const std::vector<Common::UString> &dataFiles = key->getDataFileList();
+		for (std::vector<Common::UString>::const_iterator d = dataFiles.begin(); d != dataFiles.end(); ++d)
+			location.files.push_back(FileStamp(Common::FilePath::normalize(directory + "/" + *d)));
+	}
+
+	const ResourceTable &resources = archive.getResourceTable();
+
+	location.fingerprints.resize(resources.size());
+	for (size_t i = 0; i < resources.size(); i++) {
+		Fingerprint &fingerprint = location.fingerprints[i];
+
+		fingerprint.name     = resources.getNameString(i);
+		fingerprint.type     = resources.getType(i);
+		fingerprint.location = path;
+		fingerprint.index    = resources.getIndex(i);
+
+		Job job;
+
+		job.archive     = &archive;
+		job.fingerprint = &fingerprint;
+
+		try {
+			job.offset = archive.getResourceOffset(fingerprint.index);
+		} catch (...) {
+			job.offset = 0xFFFFFFFFFFFFFFFFULL;
+		}
+
+		_jobs.push_back(job);
+	}
+}
+
+void FingerprintIndex::addLooseFile(const Common::UString &path) {
+	Location &location = _locations[path];
+
+	location.files.push_back(FileStamp(path));
+	location.fingerprints.resize(1);
+
+	Fingerprint &fingerprint = location.fingerprints[0];
+
+	fingerprint.name     = TypeMan.setFileType(Common::FilePath::getFile(path), kFileTypeNone);
+	fingerprint.type     = TypeMan.getFileType(path);
+	fingerprint.location = path;
+	fingerprint.index    = kLooseFile;
+
+	Job job;
+
+	job.archive     = 0;
+	job.offset      = 0;
+	job.fingerprint = &fingerprint;
+
+	_jobs.push_back(job);
+}
+
+void FingerprintIndex::runJobs() {
+	// Keep the reads within each archive in the order of the data on disk
+	std::sort(_jobs.begin(), _jobs.end());
+
+	_nextJob.store(0);
+
+	const size_t threadCount = MIN<size_t>(_threadCount, (_jobs.size() + kBatchSize - 1) / kBatchSize);
+	if (threadCount <= 1) {
+		work();
+		return;
+	}
+
+	// The calling thread works on the jobs as well
+	boost::thread_group threads;
+	for (size_t i = 1; i < threadCount; i++)
+		threads.create_thread([this]() { work(); });
+
+	work();
+
+	threads.join_all();
+}
+
+void FingerprintIndex::work() {
+	size_t n;
+	while ((n = _nextJob.fetch_add(kBatchSize)) < _jobs.size())
+		hashJobs(n, MIN(n + kBatchSize, _jobs.size()));
+}
+
+void FingerprintIndex::hashJobs(size_t begin, size_t end) {
+	/* Small resources are read whole and then hashed all at once, which
+	 * is faster than hashing them one by one. Large resources are hashed
+	 * on their own, while they are read. */
+
+	std::vector< std::vector<byte> > buffers;
+	std::vector<Fingerprint *> buffered;
+
+	buffers.reserve(end - begin);
+	buffered.reserve(end - begin);
+
+	for (size_t i = begin; i < end; i++) {
+		const Job &job = _jobs[i];
+
+		try {
+			Common::ScopedPtr<Common::SeekableReadStream> stream(job.archive ?
+				job.archive->getResource(job.fingerprint->index, true) :
+				Common::openReadFile(job.fingerprint->location));
+
+			const size_t size = stream->size();
+
+			job.fingerprint->size = size;
+
+			if (size > kMaxBatchedSize) {
+				Common::MD5Hasher hasher;
+				hasher.update(*stream);
+
+				std::vector<byte> digest;
+				hasher.finish(digest);
+
+				std::memcpy(job.fingerprint->digest, &digest[0], Common::kMD5Length);
+				continue;
+			}
+
+			buffers.push_back(std::vector<byte>(size));
+			if ((size > 0) && (stream->read(&buffers.back()[0], size) != size)) {
+				buffers.pop_back();
+				throw Common::Exception(Common::kReadError);
+			}
+
+			buffered.push_back(job.fingerprint);
+
+		} catch (Common::Exception &e) {
+			addFailure(job.fingerprint->location, job.fingerprint->index, e);
+		} catch (std::exception &e) {
+			addFailure(job.fingerprint->location, job.fingerprint->index, Common::Exception(e));
+		}
+	}
+
+	std::vector<const byte *> data;
+	std::vector<size_t> dataLength;
+
+	data.reserve(buffers.size());
+	dataLength.reserve(buffers.size());
+
+	for (std::vector< std::vector<byte> >::const_iterator b = buffers.begin(); b != buffers.end(); ++b) {
+		data.push_back(b->empty() ? 0 : &(*b)[0]);
+		dataLength.push_back(b->size());
+	}
+
+	std::vector< std::vector<byte> > digests;
+	Common::hashMD5(data, dataLength, digests);
+
+	for (size_t i = 0; i < buffered.size(); i++)
+		std::memcpy(buffered[i]->digest, &digests[i][0], Common::kMD5Length);
+}
+
+void FingerprintIndex::addFailure(const Common::UString &location, uint32 index, const Common::Exception &error) {
+	Failure failure;
+
+	failure.location = location;
+	failure.index    = index;
+	failure.error    = error;
+
+	if (index != kLooseFile)
+		failure.error.add("Failed fingerprinting resource %u of \"%s\"", index, location.c_str());
+	else
+		failure.error.add("Failed fingerprinting \"%s\"", location.c_str());
+
+	Common::StackLock lock(_failureMutex);
+	_failures.push_back(failure);
+}
+
+void FingerprintIndex::removeFailures() {
+	// Collect the failed resources of each location first, then go through every location only once
+	typedef std::map< Common::UString, std::set<uint32> > FailedIndices;
+
+	FailedIndices failed;
+	for (FailureList::const_iterator f = _failures.begin(); f != _failures.end(); ++f)
+		failed[f->location].insert(f->index);
+
+	for (FailedIndices::const_iterator f = failed.begin(); f != failed.end(); ++f) {
+		LocationMap::iterator l = _locations.find(f->first);
+		if (l == _locations.end())
+			continue;
+
+		// Without any fingerprints, the location is tried again next time
+		if (f->second.count(kLooseFile) > 0) {
+			_locations.erase(l);
+			continue;
+		}
+
+		const std::set<uint32> &indices = f->second;
+
+		std::vector<Fingerprint> &fingerprints = l->second.fingerprints;
+		fingerprints.erase(std::remove_if(fingerprints.begin(), fingerprints.end(),
+		                                  [&indices](const Fingerprint &p) { return indices.count(p.index) > 0; }),
+		                   fingerprints.end());
+	}
+}
+
+void FingerprintIndex::buildResources() const {
+	if (_hasResources)
+		return;
+
+	_resources.clear();
+
+	for (LocationMap::const_iterator l = _locations.begin(); l != _locations.end(); ++l) {
+		const std::vector<Fingerprint> &fingerprints = l->second.fingerprints;
+
+		for (std::vector<Fingerprint>::const_iterator p = fingerprints.begin(); p != fingerprints.end(); ++p)
+			_resources[ResourceKey(p->name.toLower(), p->type)].push_back(&*p);
+	}
+
+	_hasResources = true;
+}
+
+/** Order fingerprints by their contents. */
+static bool compareContents(const FingerprintIndex::Fingerprint *a, const FingerprintIndex::Fingerprint *b) {
+	if (a->size != b->size)
+		return a->size < b->size;
+
+	return std::memcmp(a->digest, b->digest, sizeof(a->digest)) < 0;
+}
+
+FingerprintIndex::FingerprintGroups FingerprintIndex::groupByContents(const FingerprintList &copies) {
+	FingerprintList sorted = copies;
+	std::stable_sort(sorted.begin(), sorted.end(), compareContents);
+
+	FingerprintGroups groups;
+	for (FingerprintList::const_iterator c = sorted.begin(); c != sorted.end(); ++c) {
+		if (groups.empty() || !groups.back().front()->hasSameContents(**c))
+			groups.push_back(FingerprintList());
+
+		groups.back().push_back(*c);
+	}
+
+	return groups;
+}
+
+FingerprintIndex::FingerprintList FingerprintIndex::findCopies(const Common::UString &name, FileType type) const {
+	buildResources();
+
+	ResourceMap::const_iterator r = _resources.find(ResourceKey(name.toLower(), type));
+	if (r == _resources.end())
+		return FingerprintList();
+
+	return r->second;
+}
+
+FingerprintIndex::FingerprintGroups FingerprintIndex::findDifferingCopies(const Common::UString &name,
+                                                                          FileType type) const {
+
+	return groupByContents(findCopies(name, type));
+}
+
+FingerprintIndex::FingerprintGroups FingerprintIndex::findDuplicates() const {
+	buildResources();
+
+	FingerprintGroups duplicates;
+	for (ResourceMap::const_iterator r = _resources.begin(); r != _resources.end(); ++r) {
+		if (r->second.size() < 2)
+			continue;
+
+		const FingerprintGroups groups = groupByContents(r->second);
+		for (FingerprintGroups::const_iterator g = groups.begin(); g != groups.end(); ++g)
+			if (g->size() > 1)
+				duplicates.push_back(*g);
+	}
+
+	return duplicates;
+}
+
+std::vector<FingerprintIndex::FingerprintGroups> FingerprintIndex::findDifferences() const {
+	buildResources();
+
+	std::vector<FingerprintGroups> differences;
+	for (ResourceMap::const_iterator r = _resources.begin(); r != _resources.end(); ++r) {
+		if (r->second.size() < 2)
+			continue;
+
+		FingerprintGroups groups = groupByContents(r->second);
+		if (groups.size() > 1)
+			differences.push_back(groups);
+	}
+
+	return differences;
+}
+
+uint64 FingerprintIndex::getDuplicatedSize() const {
+	const FingerprintGroups duplicates = findDuplicates();
+
+	uint64 size = 0;
+	for (FingerprintGroups::const_iterator d = duplicates.begin(); d != duplicates.end(); ++d)
+		size += (uint64) d->front()->size * (d->size() - 1);
+
+	return size;
+}
+
+void FingerprintIndex::read(Common::SeekableReadStream &stream) {
+	if (stream.readUint32BE() != kIndexID)
+		throw Common::Exception("Not a fingerprint index file");
+	if (stream.readUint32LE() != kIndexVersion)
+		throw Common::Exception("Unsupported fingerprint index version");
+
+	const uint32 locationCount = stream.readUint32LE();
+	for (uint32 i = 0; i < locationCount; i++) {
+		const Common::UString path = readString(stream);
+
+		Location &location = _locations[path];
+
+		// Each file stamp needs at least 20 bytes, each fingerprint at least 36 bytes
+		const uint32 fileCount = stream.readUint32LE();
+		if (fileCount > ((stream.size() - stream.pos()) / 20))
+			throw Common::Exception(Common::kReadError);
+
+		location.files.resize(fileCount);
+		for (uint32 j = 0; j < fileCount; j++) {
+			location.files[j].path         = readString(stream);
+			location.files[j].size         = stream.readUint64LE();
+			location.files[j].lastModified = stream.readUint64LE();
+		}
+
+		const uint32 fingerprintCount = stream.readUint32LE();
+		if (fingerprintCount > ((stream.size() - stream.pos()) / 36))
+			throw Common::Exception(Common::kReadError);
+
+		location.fingerprints.resize(fingerprintCount);
+		for (uint32 j = 0; j < fingerprintCount; j++) {
+			Fingerprint &fingerprint = location.fingerprints[j];
+
+			fingerprint.name     = readString(stream);
+			fingerprint.type     = (FileType) stream.readSint32LE();
+			fingerprint.index    = stream.readUint32LE();
+			fingerprint.size     = stream.readUint64LE();
+			fingerprint.location = path;
+
+			if (stream.read(fingerprint.digest, Common::kMD5Length) != Common::kMD5Length)
+				throw Common::Exception(Common::kReadError);
+		}
+	}
+}
+
+void FingerprintIndex::write(Common::WriteStream &stream) const {
+	stream.writeUint32BE(kIndexID);
+	stream.writeUint32LE(kIndexVersion);
+
+	stream.writeUint32LE(_locations.size());
+	for (LocationMap::const_iterator l = _locations.begin(); l != _locations.end(); ++l) {
+		writeString(stream, l->first);
+
+		const Location &location = l->second;
+
+		stream.writeUint32LE(location.files.size());
+		for (std::vector<FileStamp>::const_iterator f = location.files.begin(); f != location.files.end(); ++f) {
+			writeString(stream, f->path);
+
+			stream.writeUint64LE(f->size);
+			stream.writeUint64LE(f->lastModified);
+		}
+
+		stream.writeUint32LE(location.fingerprints.size());
+		for (std::vector<Fingerprint>::const_iterator p = location.fingerprints.begin();
+		     p != location.fingerprints.end(); ++p) {
+
+			writeString(stream, p->name);
+
+			stream.writeSint32LE(p->type);
+			stream.writeUint32LE(p->index);
+			stream.writeUint64LE(p->size);
+
+			stream.write(p->digest, Common::kMD5Length);
+		}
+	}
+}
+
+} // End of namespace Aurora
@@ -0,0 +1,256 @@
+/* Phaethon - A FLOSS resource explorer for BioWare's Aurora engine games
+ *
+ * Phaethon is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * Phaethon is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * Phaethon is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Phaethon. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  An index of the contents of all resources in a game installation.
+ */
+
+#ifndef AURORA_FINGERPRINTINDEX_H
+#define AURORA_FINGERPRINTINDEX_H
+
+#include <vector>
+#include <map>
+
+#include <boost/noncopyable.hpp>
+
+#include "src/common/types.h"
+#include "src/common/ustring.h"
+#include "src/common/error.h"
+#include "src/common/md5.h"
+#include "src/common/atomic.h"
+#include "src/common/mutex.h"
+
+#include "src/aurora/types.h"
+
+namespace Common {
+	class SeekableReadStream;
+	class WriteStream;
+}
+
+namespace Aurora {
+
+class Archive;
+
+/** An index of the contents of all resources in a game installation.
+ *
+ *  Every copy of every resource, within any of the archives as well as
+ *  in loose files, is fingerprinted with the MD5 digest of its contents.
+ *  The index then answers which copies of a resource are identical, and
+ *  which differ, for example between the override directory, several
+ *  HAKs and the base game's BIFs.
+ *
+ *  The resources are hashed by a pool of worker threads. The index can be
+ *  stored on disk; when it's updated, archives and files whose size and
+ *  modification time haven't changed are not hashed again.
+ *
+ *  The index itself is not thread-safe. Fingerprints returned by the
+ *  queries stay valid until the index is changed.
+ */
+class FingerprintIndex : boost::noncopyable {
+public:
+	/** The local index of a resource that's a loose file, not within an archive. */
+	static const uint32 kLooseFile = 0xFFFFFFFF;
+
+	/** The fingerprint of one copy of a resource. */
+	struct Fingerprint {
+		Common::UString name; ///< The resource's name.
+		FileType        type; ///< The resource's type.
+		uint64          size; ///< The size of the resource's contents.
+
+		byte digest[Common::kMD5Length]; ///< The MD5 digest of the resource's contents.
+
+		Common::UString location; ///< The archive or loose file this copy is found in.
+		uint32          index;    ///< The copy's local index within the archive, or kLooseFile.
+
+		Fingerprint();
+
+		/** Do both copies have the same contents? */
+		bool hasSameContents(const Fingerprint &right) const;
+	};
+
+	typedef std::vector<const Fingerprint *> FingerprintList;
+	/** Groups of copies, where all copies within a group have the same contents. */
+	typedef std::vector<FingerprintList> FingerprintGroups;
+
+	/** A resource or archive that could not be fingerprinted. */
+	struct Failure {
+		Common::UString location; ///< The archive or loose file.
+		uint32          index;    ///< The resource's local index, or kLooseFile for the whole file.
+
+		Common::Exception error; ///< What went wrong.
+	};
+
+	typedef std::vector<Failure> FailureList;
+
+	/** Create a fingerprint index.
+	 *
+	 *  @param indexFile The file the index is stored in. If empty, the index
+	 *                   can't be loaded or saved.
+	 *  @param threadCount The number of worker threads to hash with. 0 means
+	 *                     one thread for each available processor core.
+	 */
+	FingerprintIndex(const Common::UString &indexFile = "", size_t threadCount = 0);
+	~FingerprintIndex();
+
+	/** Return the default index file for a game installation path.
+	 *
+	 *  The index files are stored in the user data directory.
+	 */
+	static Common::UString getDefaultIndexFile(const Common::UString &path);
+
+	/** Load the index from its file.
+	 *
+	 *  @return true if the index was loaded, false if the file doesn't
+	 *          exist or isn't a valid index file.
+	 */
+	bool load();
+	/** Save the index into its file, if anything changed since it was loaded. */
+	void save();
+
+	/** Fingerprint all resources in this path.
+	 *
+	 *  The path is searched recursively for archives and loose files. The
+	 *  data files indexed by KEY files are looked for relative to this path.
+	 *  Archives and files not changed since they were last fingerprinted are
+	 *  kept as they are, and those that vanished from the path are removed.
+	 *
+	 *  Resources that fail to be read don't stop the others from being
+	 *  fingerprinted; they can be queried with getFailures() afterwards.
+	 *
+	 *  @return The number of resources that were hashed.
+	 */
+	size_t addPath(const Common::UString &path);
+
+	/** Return what failed to be fingerprinted during the last addPath(). */
+	const FailureList &getFailures() const;
+
+	/** Return the number of archives and loose files in the index. */
+	size_t getLocationCount() const;
+	/** Return the number of resource copies in the index. */
+	size_t getFingerprintCount() const;
+
+	/** Return all copies of this resource. Names are matched case-insensitively. */
+	FingerprintList findCopies(const Common::UString &name, FileType type) const;
+	/** Return the copies of this resource, grouped by their contents.
+	 *
+	 *  If more than one group is returned, the copies differ.
+	 */
+	FingerprintGroups findDifferingCopies(const Common::UString &name, FileType type) const;
+
+	/** Return all groups of more than one copy of the same resource with the same contents. */
+	FingerprintGroups findDuplicates() const;
+	/** Return the copies of all resources whose copies differ, grouped by their contents. */
+	std::vector<FingerprintGroups> findDifferences() const;
+
+	/** Return the number of bytes taken up by duplicates.
+	 *
+	 *  For each group of identical copies of the same resource, all copies
+	 *  but one count as duplicated.
+	 */
+	uint64 getDuplicatedSize() const;
+
+private:
+	/** The size and modification time of a file a location depends on. */
+	struct FileStamp {
+		Common::UString path;
+
+		uint64 size;
+		uint64 lastModified;
+
+		FileStamp();
+		FileStamp(const Common::UString &p);
+
+		bool isCurrent() const;
+	};
+
+	/** The fingerprints of all resources within an archive or loose file. */
+	struct Location {
+		/** The files this location depends on: the file itself, and for KEY files its data files. */
+		std::vector<FileStamp> files;
+
+		std::vector<Fingerprint> fingerprints;
+	};
+
+	typedef std::map<Common::UString, Location> LocationMap;
+
+	/** A resource waiting to be hashed. */
+	struct Job {
+		const Archive  *archive; ///< The archive the resource is in, or 0 for a loose file.
+		uint64          offset;  ///< The offset of the resource's data within the archive.
+
+		Fingerprint *fingerprint; ///< The fingerprint to fill.
+
+		bool operator<(const Job &right) const;
+	};
+
+	typedef std::vector<Job> JobList;
+
+	/** Name (in lower case) and type of a resource. */
+	typedef std::pair<Common::UString, FileType> ResourceKey;
+	typedef std::map<ResourceKey, FingerprintList> ResourceMap;
+
+	Common::UString _indexFile;
+
+	size_t _threadCount;
+
+	LocationMap _locations;
+
+	/** Did the index change since it was loaded? */
+	bool _changed;
+
+	/** All copies of each resource, created on demand. */
+	mutable ResourceMap _resources;
+	mutable bool _hasResources;
+
+	JobList _jobs;
+
+	/** The position of the next job to be taken by a worker. */
+	boost::atomic<size_t> _nextJob;
+
+	FailureList   _failures;
+	Common::Mutex _failureMutex;
+
+	/** Add a location for this archive, and jobs for all its resources. */
+	void addArchive(const Common::UString &path, const Archive &archive, const Common::UString &directory);
+	/** Add a location for this loose file, and a job for it. */
+	void addLooseFile(const Common::UString &path);
+
+	/** Run the jobs, in parallel if possible. */
+	void runJobs();
+
+	/** Take and run jobs until none are left. */
+	void work();
+	/** Hash the resources of this range of jobs. */
+	void hashJobs(size_t begin, size_t end);
+
+	void addFailure(const Common::UString &location, uint32 index, const Common::Exception &error);
+	/** Remove the fingerprints of the resources that failed to be hashed. */
+	void removeFailures();
+
+	void buildResources() const;
+	static FingerprintGroups groupByContents(const FingerprintList &copies);
+
+	void read(Common::SeekableReadStream &stream);
+	void write(Common::WriteStream &stream) const;
+};
+
+} // End of namespace Aurora
+
+#endif // AURORA_FINGERPRINTINDEX_H
@@ -0,0 +1,624 @@
+/* Phaethon - A FLOSS resource explorer for BioWare's Aurora engine games
+ *
+ * Phaethon is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * Phaethon is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * Phaethon is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Phaethon. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  A persistent cache of a game installation's files and archive indices.
+ */
+
+#include <cstring>
+
+#include "src/common/util.h"
+#include "src/common/error.h"
+#include "src/common/scopedptr.h"
+#include "src/common/readstream.h"
+#include "src/common/writefile.h"
+#include "src/common/crc32.h"
+#include "src/common/filepath.h"
+#include "src/common/mappedreadfile.h"
+
+#include "src/aurora/indexcache.h"
+#include "src/aurora/archive.h"
+#include "src/aurora/zipfile.h"
+#include "src/aurora/erffile.h"
+#include "src/aurora/rimfile.h"
+#include "src/aurora/keyfile.h"
+#include "src/aurora/keydatafileresolver.h"
+#include "src/aurora/util.h"
+
+static const uint32 kCacheID      = MKTAG('P', 'H', 'I', 'X');
+static const uint32 kCacheVersion = 3;
+
+/** The number of bytes at the start and at the end of an archive file its checksum covers. */
+static const size_t kChecksumSize = 64 * 1024;
+
+namespace Aurora {
+
+static void writeString(Common::WriteStream &stream, const char *str, size_t length) {
+	stream.writeUint32LE(length);
+	stream.write(str, length);
+}
+
+static void writeString(Common::WriteStream &stream, const Common::UString &str) {
+	writeString(stream, str.c_str(), std::strlen(str.c_str()));
+}
+
+static void readString(Common::SeekableReadStream &stream, std::vector<char> &str) {
+	const uint32 length = stream.readUint32LE();
+	if (length > (stream.size() - stream.pos()))
+		throw Common::Exception(Common::kReadError);
+
+	str.resize(length);
+	if ((length > 0) && (stream.read(&str[0], length) != length))
+		throw Common::Exception(Common::kReadError);
+}
+
+static Common::UString readString(Common::SeekableReadStream &stream) {
+	std::vector<char> str;
+	readString(stream, str);
+
+	return str.empty() ? Common::UString() : Common::UString(&str[0], str.size());
+}
+
+
+/** An archive whose resource table comes out of the index cache.
+ *
+ *  The archive file itself is only opened once a resource is read,
+ *  or a property not in the cache is queried. The sizes of the resources
+ *  in KEY data files loaded by then are added to the cached index.
+ */
+class CachedArchive : public Archive {
+public:
+	CachedArchive(const Common::UString &path, const IndexCache::ArchiveIndexPtr &index,
+	              KEYDataFileResolver *resolver, Archive *archive = 0) :
+		_path(path), _index(index), _resolver(resolver), _archive(archive) {
+	}
+
+	~CachedArchive() {
+		const KEYFile *key = dynamic_cast<const KEYFile *>(_archive.get());
+		if (key)
+			IndexCache::fillKEYSizes(*_index, *key);
+	}
+
+	const ResourceTable &getResourceTable() const {
+		if (_resources)
+			return *_resources;
+
+		return _index->resources;
+	}
+
+	uint64 getResourceSize(uint32 index) const {
+		{
+			Common::StackLock lock(_index->mutex);
+
+			if ((index < _index->sizes.size()) && (_index->sizes[index] != 0xFFFFFFFFFFFFFFFFULL))
+				return _index->sizes[index];
+		}
+
+		const uint64 size = getArchive().getResourceSize(index);
+		fillKEYSizes(index);
+
+		return size;
+	}
+
+	uint64 getResourceOffset(uint32 index) const {
+		{
+			Common::StackLock lock(_index->mutex);
+
+			if ((index < _index->sizes.size()) && (_index->sizes[index] != 0xFFFFFFFFFFFFFFFFULL))
+				return _index->offsets[index];
+		}
+
+		const uint64 offset = getArchive().getResourceOffset(index);
+		fillKEYSizes(index);
+
+		return offset;
+	}
+
+	Common::SeekableReadStream *getResource(uint32 index, bool tryNoCopy) const {
+		return getArchive().getResource(index, tryNoCopy);
+	}
+
+	Common::HashAlgo getNameHashAlgo() const {
+		return _index->hashAlgo;
+	}
+
+protected:
+	ResourceTable *getModifiableResourceTable() {
+		// The cached index is shared, so it's copied before it's modified
+		if (!_resources)
+			_resources.reset(new ResourceTable(_index->resources));
+
+		return _resources.get();
+	}
+
+private:
+	Common::UString _path;
+
+	IndexCache::ArchiveIndexPtr _index;
+	KEYDataFileResolver *_resolver;
+
+	/** Our own copy of the resource table, once it was modified. */
+	Common::ScopedPtr<ResourceTable> _resources;
+
+	/** The actual archive, once opened. */
+	mutable Common::ScopedPtr<Archive> _archive;
+	mutable Common::Mutex _archiveMutex;
+
+	const Archive &getArchive() const {
+		Common::StackLock lock(_archiveMutex);
+
+		if (!_archive) {
+			Common::ScopedPtr<Archive> archive(IndexCache::openArchiveFile(_path, _resolver));
+
+			// Make sure the archive didn't change behind our back
+			if (archive->getResourceTable().size() != _index->resources.size())
+				throw Common::Exception("Archive \"%s\" changed since it was indexed", _path.c_str());
+
+			_archive.reset(archive.release());
+		}
+
+		return *_archive;
+	}
+
+	/** If the data file of this KEY resource was just loaded, add its resource sizes to the index. */
+	void fillKEYSizes(uint32 index) const {
+		const KEYFile *key = dynamic_cast<const KEYFile *>(&getArchive());
+		if (key && key->haveLoadedDataFile(index))
+			IndexCache::fillKEYSizes(*_index, *key);
+	}
+};
+
+
+IndexCache::DataFile::DataFile() : size(Common::kFileInvalid), lastModified(0) {
+}
+
+
+IndexCache::ArchiveIndex::ArchiveIndex() : size(0), lastModified(0), checksum(0), hashAlgo(Common::kHashNone),
+	sizesChanged(false) {
+}
+
+
+IndexCache::IndexCache(const Common::UString &cacheFile) : _cacheFile(cacheFile), _changed(false) {
+}
+
+IndexCache::~IndexCache() {
+}
+
+Common::UString IndexCache::getDefaultCacheFile(const Common::UString &path) {
+	const uint64 hash = Common::hashStringFNV64(Common::FilePath::normalize(path));
+
+	return Common::FilePath::getUserDataFile(Common::UString::format("indexcache/%08X%08X.idx",
+		(uint)(hash >> 32), (uint)(hash & 0xFFFFFFFF)));
+}
+
+const Common::UString &IndexCache::getCacheFile() const {
+	return _cacheFile;
+}
+
+bool IndexCache::load() {
+	Common::StackLock lock(_mutex);
+
+	_tree.clear();
+	_archives.clear();
+
+	_changed = false;
+
+	if (!Common::FilePath::isRegularFile(_cacheFile))
+		return false;
+
+	try {
+		Common::ScopedPtr<Common::SeekableReadStream> stream(Common::openReadFile(_cacheFile));
+
+		read(*stream);
+	} catch (...) {
+		// An outdated or broken cache is just thrown away
+		_tree.clear();
+		_archives.clear();
+
+		return false;
+	}
+
+	return true;
+}
+
+void IndexCache::save() {
+	Common::StackLock lock(_mutex);
+
+	bool changed = _changed;
+	for (ArchiveIndexMap::const_iterator a = _archives.begin(); !changed && (a != _archives.end()); ++a) {
+		Common::StackLock indexLock(a->second->mutex);
+
+		changed = a->second->sizesChanged;
+	}
+
+	if (!changed)
+		return;
+
+	// Write into a temporary file first, so that a crash can't leave a torn cache file behind
+	const Common::UString tempFile = _cacheFile + ".tmp";
+
+	try {
+		Common::WriteFile file(tempFile);
+
+		write(file);
+		file.flush();
+		file.close();
+
+		Common::FilePath::renameFile(tempFile, _cacheFile);
+
+	} catch (Common::Exception &e) {
+		e.add("Failed to write index cache \"%s\"", _cacheFile.c_str());
+		throw;
+	}
+
+	_changed = false;
+}
+
+void IndexCache::readPath(Common::FileTree &tree, const Common::UString &path, int recurseDepth) {
+	Common::StackLock lock(_mutex);
+
+	tree.readPath(path, recurseDepth, _tree);
+
+	if (tree == _tree)
+		return;
+
+	_tree    = tree;
+	_changed = true;
+}
+
+size_t IndexCache::getArchiveCount() const {
+	Common::StackLock lock(_mutex);
+
+	return _archives.size();
+}
+
+Archive *IndexCache::openArchive(const Common::UString &path, KEYDataFileResolver *resolver) {
+	const size_t size         = Common::FilePath::getFileSize(path);
+	const uint64 lastModified = Common::FilePath::getLastModified(path);
+
+	if ((size == Common::kFileInvalid) || (lastModified == 0))
+		return openArchiveFile(path, resolver);
+
+	const uint32 checksum = calculateChecksum(path);
+
+	ArchiveIndexPtr cached;
+	{
+		Common::StackLock lock(_mutex);
+
+		ArchiveIndexMap::const_iterator a = _archives.find(path);
+		if (a != _archives.end())
+			cached = a->second;
+	}
+
+	if (cached && (cached->size == size) && (cached->lastModified == lastModified) &&
+	    (cached->checksum == checksum) && haveSameDataFiles(*cached, resolver))
+		return new CachedArchive(path, cached, resolver);
+
+	Common::ScopedPtr<Archive> archive(openArchiveFile(path, resolver));
+
+	ArchiveIndexPtr index(createArchiveIndex(*archive, resolver));
+
+	index->size         = size;
+	index->lastModified = lastModified;
+	index->checksum     = checksum;
+
+	{
+		Common::StackLock lock(_mutex);
+
+		_archives[path] = index;
+		_changed = true;
+	}
+
+	/* The resource sizes of a KEY are added to the index while its data files are
+	 * loaded. With data files missing, the KEY is never taken from the cache, and
+	 * the caller gets to see the KEYFile itself, to warn about the missing ones. */
+	if (!index->dataFiles.empty() && haveAllDataFiles(*index))
+		return new CachedArchive(path, index, resolver, archive.release());
+
+	return archive.release();
+}
+
+Archive *IndexCache::openArchiveFile(const Common::UString &path, KEYDataFileResolver *resolver) {
+	switch (TypeMan.getFileType(path)) {
+		case kFileTypeZIP:
+			return new ZIPFile(Common::openReadFile(path));
+
+		case kFileTypeERF:
+		case kFileTypeMOD:
+		case kFileTypeNWM:
+		case kFileTypeSAV:
+		case kFileTypeHAK:
+			return new ERFFile(Common::openReadFile(path));
+
+		case kFileTypeRIM:
+			return new RIMFile(Common::openReadFile(path));
+
+		case kFileTypeKEY: {
+			// The data files are only loaded once their resources are accessed
+			KEYFile *key = new KEYFile(Common::openReadFile(path));
+			key->setDataFileResolver(resolver);
+
+			return key;
+		}
+
+		default:
+			break;
+	}
+
+	throw Common::Exception("Invalid archive file \"%s\"", path.c_str());
+}
+
+IndexCache::ArchiveIndex *IndexCache::createArchiveIndex(const Archive &archive, KEYDataFileResolver *resolver) {
+	Common::ScopedPtr<ArchiveIndex> index(new ArchiveIndex);
+
+	const ResourceTable &resources = archive.getResourceTable();
+
+	index->hashAlgo  = archive.getNameHashAlgo();
+	index->resources = resources;
+	index->resources.shrinkToFit();
+
+	/* The resource sizes of KEY files live in their data files. Those are only
+	 * loaded on demand, so the sizes are filled in by fillKEYSizes() later. We
+	 * can only cache them together with the state of those data files, so that
+	 * we notice when one of them changes independently of the KEY. */
+
+	const KEYFile *key = dynamic_cast<const KEYFile *>(&archive);
+	if (key && !resolver)
+		return index.release();
+
+	uint32 indexCount = 0;
+	for (size_t i = 0; i < resources.size(); i++)
+		indexCount = MAX<uint32>(indexCount, resources.getIndex(i) + 1);
+
+	index->sizes.resize(indexCount, 0xFFFFFFFFFFFFFFFFULL);
+	index->offsets.resize(indexCount, 0xFFFFFFFFFFFFFFFFULL);
+
+	if (key) {
+		const std::vector<Common::UString> &dataFiles = key->getDataFileList();
+
+		index->dataFiles.resize(dataFiles.size());
+		for (size_t i = 0; i < dataFiles.size(); i++)
+			getDataFile(*resolver, dataFiles[i], index->dataFiles[i]);
+
+		return index.release();
+	}
+
+	for (size_t i = 0; i < resources.size(); i++) {
+		const uint32 resIndex = resources.getIndex(i);
+
+		index->sizes  [resIndex] = archive.getResourceSize(resIndex);
+		index->offsets[resIndex] = archive.getResourceOffset(resIndex);
+	}
+
+	return index.release();
+}
+
+void IndexCache::fillKEYSizes(ArchiveIndex &index, const KEYFile &key) {
+	const ResourceTable &resources = key.getResourceTable();
+
+	Common::StackLock lock(index.mutex);
+
+	for (size_t i = 0; i < resources.size(); i++) {
+		const uint32 resIndex = resources.getIndex(i);
+		if ((resIndex >= index.sizes.size()) || (index.sizes[resIndex] != 0xFFFFFFFFFFFFFFFFULL))
+			continue;
+
+		// Only look at data files already loaded, we don't want to load them all here
+		if (!key.haveLoadedDataFile(resIndex))
+			continue;
+
+		index.sizes  [resIndex] = key.getResourceSize(resIndex);
+		index.offsets[resIndex] = key.getResourceOffset(resIndex);
+
+		index.sizesChanged = true;
+	}
+}
+
+uint32 IndexCache::calculateChecksum(const Common::UString &path) {
+	Common::ScopedPtr<Common::SeekableReadStream> file(Common::openReadFile(path));
+
+	const size_t size      = file->size();
+	const size_t startSize = MIN<size_t>(size, kChecksumSize);
+	const size_t endSize   = MIN<size_t>(size - startSize, kChecksumSize);
+
+	std::vector<byte> data(startSize + endSize);
+	if (data.empty())
+		return 0;
+
+	if ((file->readAt(0, &data[0], startSize) != startSize) ||
+	    (file->readAt(size - endSize, &data[startSize], endSize) != endSize))
+		throw Common::Exception(Common::kReadError);
+
+	return Common::calculateCRC32(&data[0], data.size());
+}
+
+void IndexCache::getDataFile(KEYDataFileResolver &resolver, const Common::UString &name, DataFile &dataFile) {
+	dataFile.name = name;
+
+	try {
+		const Common::UString path = resolver.findDataFile(name);
+
+		dataFile.size         = Common::FilePath::getFileSize(path);
+		dataFile.lastModified = Common::FilePath::getLastModified(path);
+	} catch (Common::Exception &) {
+		dataFile.size         = Common::kFileInvalid;
+		dataFile.lastModified = 0;
+	}
+}
+
+bool IndexCache::haveAllDataFiles(const ArchiveIndex &index) {
+	for (std::vector<DataFile>::const_iterator d = index.dataFiles.begin(); d != index.dataFiles.end(); ++d)
+		if ((d->size == Common::kFileInvalid) || (d->lastModified == 0))
+			return false;
+
+	return true;
+}
+
+bool IndexCache::haveSameDataFiles(const ArchiveIndex &index, KEYDataFileResolver *resolver) {
+	if (index.dataFiles.empty())
+		return true;
+
+	if (!resolver)
+		return false;
+
+	// A missing data file might show up at any time, so we always look again
+	if (!haveAllDataFiles(index))
+		return false;
+
+	for (std::vector<DataFile>::const_iterator d = index.dataFiles.begin(); d != index.dataFiles.end(); ++d) {
+		DataFile current;
+		getDataFile(*resolver, d->name, current);
+
+		if ((current.size != d->size) || (current.lastModified != d->lastModified))
+			return false;
+	}
+
+	return true;
+}
+
+void IndexCache::read(Common::SeekableReadStream &stream) {
+	if (stream.readUint32BE() != kCacheID)
+		throw Common::Exception("Not an index cache file");
+	if (stream.readUint32LE() != kCacheVersion)
+		throw Common::Exception("Unsupported index cache version");
+
+	if (stream.readUint32LE() != 0)
+		_tree.read(stream);
+
+	const uint32 archiveCount = stream.readUint32LE();
+	for (uint32 i = 0; i < archiveCount; i++) {
+		const Common::UString path = readString(stream);
+
+		ArchiveIndex *index = new ArchiveIndex;
+		_archives[path] = ArchiveIndexPtr(index);
+
+		readArchiveIndex(stream, *index);
+	}
+}
+
+void IndexCache::write(Common::WriteStream &stream) const {
+	stream.writeUint32BE(kCacheID);
+	stream.writeUint32LE(kCacheVersion);
+
+	stream.writeUint32LE(_tree.isEmpty() ? 0 : 1);
+	if (!_tree.isEmpty())
+		_tree.write(stream);
+
+	stream.writeUint32LE(_archives.size());
+	for (ArchiveIndexMap::const_iterator a = _archives.begin(); a != _archives.end(); ++a) {
+		writeString(stream, a->first);
+
+		writeArchiveIndex(stream, *a->second);
+	}
+}
+
+void IndexCache::readArchiveIndex(Common::SeekableReadStream &stream, ArchiveIndex &index) {
+	index.size         = stream.readUint64LE();
+	index.lastModified = stream.readUint64LE();
+	index.checksum     = stream.readUint32LE();
+	index.hashAlgo     = (Common::HashAlgo) stream.readSint32LE();
+
+	const uint32 resourceCount = stream.readUint32LE();
+	const uint32 nameLength    = stream.readUint32LE();
+
+	// Each resource needs at least 20 bytes
+	if (resourceCount > ((stream.size() - stream.pos()) / 20))
+		throw Common::Exception(Common::kReadError);
+
+	index.resources.reserve(resourceCount, MIN<size_t>(nameLength, stream.size() - stream.pos()));
+
+	std::vector<char> name;
+	for (uint32 i = 0; i < resourceCount; i++) {
+		readString(stream, name);
+
+		const FileType type     = (FileType) stream.readSint32LE();
+		const uint32   resIndex = stream.readUint32LE();
+		const uint64   hash     = stream.readUint64LE();
+
+		index.resources.add(name.empty() ? "" : &name[0], name.size(), type, resIndex, hash);
+	}
+
+	const uint32 indexCount = stream.readUint32LE();
+	if (indexCount > ((stream.size() - stream.pos()) / 16))
+		throw Common::Exception(Common::kReadError);
+
+	index.sizes.resize(indexCount);
+	index.offsets.resize(indexCount);
+
+	for (uint32 i = 0; i < indexCount; i++) {
+		index.sizes  [i] = stream.readUint64LE();
+		index.offsets[i] = stream.readUint64LE();
+	}
+
+	const uint32 dataFileCount = stream.readUint32LE();
+	if (dataFileCount > ((stream.size() - stream.pos()) / 20))
+		throw Common::Exception(Common::kReadError);
+
+	index.dataFiles.resize(dataFileCount);
+	for (std::vector<DataFile>::iterator d = index.dataFiles.begin(); d != index.dataFiles.end(); ++d) {
+		d->name         = readString(stream);
+		d->size         = stream.readUint64LE();
+		d->lastModified = stream.readUint64LE();
+	}
+}
+
+void IndexCache::writeArchiveIndex(Common::WriteStream &stream, ArchiveIndex &index) {
+	const ResourceTable &resources = index.resources;
+
+	Common::StackLock lock(index.mutex);
+
+	size_t nameLength = 0;
+	for (size_t i = 0; i < resources.size(); i++)
+		nameLength += resources.getName(i).size();
+
+	stream.writeUint64LE(index.size);
+	stream.writeUint64LE(index.lastModified);
+	stream.writeUint32LE(index.checksum);
+	stream.writeSint32LE(index.hashAlgo);
+
+	stream.writeUint32LE(resources.size());
+	stream.writeUint32LE(nameLength);
+
+	for (size_t i = 0; i < resources.size(); i++) {
+		writeString(stream, resources.getNameData(i), resources.getName(i).size());
+
+		stream.writeSint32LE(resources.getType(i));
+		stream.writeUint32LE(resources.getIndex(i));
+		stream.writeUint64LE(resources.getHash(i));
+	}
+
+	stream.writeUint32LE(index.sizes.size());
+	for (size_t i = 0; i < index.sizes.size(); i++) {
+		stream.writeUint64LE(index.sizes[i]);
+		stream.writeUint64LE(index.offsets[i]);
+	}
+
+	stream.writeUint32LE(index.dataFiles.size());
+	for (std::vector<DataFile>::const_iterator d = index.dataFiles.begin(); d != index.dataFiles.end(); ++d) {
+		writeString(stream, d->name);
+
+		stream.writeUint64LE(d->size);
+		stream.writeUint64LE(d->lastModified);
+	}
+
+	index.sizesChanged = false;
+}
+
+} // End of namespace Aurora
@@ -0,0 +1,197 @@
+/* Phaethon - A FLOSS resource explorer for BioWare's Aurora engine games
+ *
+ * Phaethon is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * Phaethon is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * Phaethon is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Phaethon. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  A persistent cache of a game installation's files and archive indices.
+ */
+
+#ifndef AURORA_INDEXCACHE_H
+#define AURORA_INDEXCACHE_H
+
+#include <vector>
+#include <map>
+
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "src/common/types.h"
+#include "src/common/ustring.h"
+#include "src/common/hash.h"
+#include "src/common/mutex.h"
+#include "src/common/filetree.h"
+
+#include "src/aurora/types.h"
+#include "src/aurora/resourcetable.h"
+
+namespace Common {
+	class SeekableReadStream;
+	class WriteStream;
+}
+
+namespace Aurora {
+
+class Archive;
+class KEYFile;
+class KEYDataFileResolver;
+
+/** A persistent cache of a game installation's files and archive indices.
+ *
+ *  Reading the file tree of a large game installation and parsing the
+ *  resource tables of all its archives takes time. The index cache keeps
+ *  both around on disk, so that they can be reused the next time.
+ *
+ *  Directories are only read again if their modification time changed.
+ *  Archives are only parsed again if their size, modification time or
+ *  the checksum over their start and end changed; otherwise, their cached
+ *  resource table is used, and the archive file itself is only opened once
+ *  a resource is read.
+ *
+ *  The resource sizes of KEY archives live in their data files, which are
+ *  only loaded on demand. They are added to the cache once their data file
+ *  was loaded, and are used as long as none of the data files changed.
+ *
+ *  All methods are thread-safe.
+ */
+class IndexCache : boost::noncopyable {
+public:
+	/** Create an index cache stored in this file. */
+	IndexCache(const Common::UString &cacheFile);
+	~IndexCache();
+
+	/** Return the default cache file for a game installation path.
+	 *
+	 *  The cache files are stored in the user data directory.
+	 */
+	static Common::UString getDefaultCacheFile(const Common::UString &path);
+
+	/** Return the file the cache is stored in. */
+	const Common::UString &getCacheFile() const;
+
+	/** Load the cache from its file.
+	 *
+	 *  If the file doesn't exist, or isn't a valid cache file, the cache
+	 *  is left empty.
+	 *
+	 *  @return true if the cache was loaded, false otherwise.
+	 */
+	bool load();
+	/** Save the cache into its file, if anything changed since it was loaded. */
+	void save();
+
+	/** Fill the file tree with this path, reusing the cached tree where possible. */
+	void readPath(Common::FileTree &tree, const Common::UString &path, int recurseDepth = -1);
+
+	/** Open the archive in this file.
+	 *
+	 *  If the archive's cached index is still valid, the returned archive
+	 *  uses it and only opens the archive file when needed. Otherwise, the
+	 *  archive file is opened and its index added to the cache.
+	 *
+	 *  @param path The path of the archive file.
+	 *  @param resolver The resolver for KEY data files. Not owned.
+	 */
+	Archive *openArchive(const Common::UString &path, KEYDataFileResolver *resolver = 0);
+
+	/** Return the number of archive indices in the cache. */
+	size_t getArchiveCount() const;
+
+	/** Open an archive file directly, bypassing any cache. */
+	static Archive *openArchiveFile(const Common::UString &path, KEYDataFileResolver *resolver = 0);
+
+private:
+	/** A data file of a KEY archive, as it was when the archive was indexed. */
+	struct DataFile {
+		Common::UString name; ///< The name of the data file, as listed in the KEY.
+
+		uint64 size;         ///< The size of the data file, or kFileInvalid if it was missing.
+		uint64 lastModified; ///< The modification time of the data file.
+
+		DataFile();
+	};
+
+	/** The cached index of an archive. */
+	struct ArchiveIndex {
+		uint64 size;         ///< The size of the archive file.
+		uint64 lastModified; ///< The modification time of the archive file.
+		uint32 checksum;     ///< The checksum over the start and end of the archive file.
+
+		Common::HashAlgo hashAlgo; ///< The algorithm the resource names are hashed with.
+
+		ResourceTable resources; ///< The archive's resource table.
+
+		std::vector<uint64> sizes;   ///< The resource sizes, by local index, or 0xFFFFFFFFFFFFFFFF if not known yet.
+		std::vector<uint64> offsets; ///< The resource offsets, by local index.
+
+		/** The data files of a KEY archive whose resource sizes are cached. */
+		std::vector<DataFile> dataFiles;
+
+		/** Were resource sizes added since the index was last written? */
+		bool sizesChanged;
+
+		/** Protects the sizes and offsets, which are filled in later for KEY archives. */
+		Common::Mutex mutex;
+
+		ArchiveIndex();
+	};
+
+	typedef boost::shared_ptr<ArchiveIndex> ArchiveIndexPtr;
+	typedef std::map<Common::UString, ArchiveIndexPtr> ArchiveIndexMap;
+
+	Common::UString _cacheFile;
+
+	Common::FileTree _tree;
+	ArchiveIndexMap  _archives;
+
+	/** Did the cache change since it was loaded? */
+	bool _changed;
+
+	mutable Common::Mutex _mutex;
+
+	void read(Common::SeekableReadStream &stream);
+	void write(Common::WriteStream &stream) const;
+
+	static void readArchiveIndex(Common::SeekableReadStream &stream, ArchiveIndex &index);
+	static void writeArchiveIndex(Common::WriteStream &stream, ArchiveIndex &index);
+
+	/** Create the index of an opened archive.
+	 *
+	 *  For KEY archives, this never loads any data files, so the index
+	 *  starts out without resource sizes.
+	 */
+	static ArchiveIndex *createArchiveIndex(const Archive &archive, KEYDataFileResolver *resolver);
+	/** Add the sizes of all resources in the already loaded data files of a KEY archive. */
+	static void fillKEYSizes(ArchiveIndex &index, const KEYFile &key);
+	/** Are all the data files of this KEY archive index there? */
+	static bool haveAllDataFiles(const ArchiveIndex &index);
+
+	/** Calculate the checksum over the start and end of an archive file. */
+	static uint32 calculateChecksum(const Common::UString &path);
+
+	/** Find the current state of a KEY data file. */
+	static void getDataFile(KEYDataFileResolver &resolver, const Common::UString &name, DataFile &dataFile);
+	/** Are all the data files of a cached KEY index still the same? */
+	static bool haveSameDataFiles(const ArchiveIndex &index, KEYDataFileResolver *resolver);
+
+	friend class CachedArchive;
+};
+
+} // End of namespace Aurora
+
+#endif // AURORA_INDEXCACHE_H
@@ -51,15 +51,23 @@ public:
 	/** Return the size of a resource. */
 	uint32 getResourceSize(uint32 index) const;
 
-	/** Return a stream of the resource's contents. */
-	virtual Common::SeekableReadStream *getResource(uint32 index) const = 0;
+	/** Return the offset of a resource within the data file. */
+	uint64 getResourceOffset(uint32 index) const;
+
+	/** Return a stream of the resource's contents.
+	 *
+	 *  @param  index The index of the resource we want.
+	 *  @param  tryNoCopy Try to return a view into the data file instead of copying.
+	 *  @return A (sub)stream of the resource's contents.
+	 */
+	virtual Common::SeekableReadStream *getResource(uint32 index, bool tryNoCopy = false) const = 0;
 
 protected:
 	/** Resource information. */
 	struct Resource {
 		FileType type; ///< The resource's type.
 
-		uint32 offset; ///< The offset of the resource within the BIF.
+		uint64 offset; ///< The offset of the resource within the BIF.
 		uint32 size;   ///< The resource's size.
 
 		uint32 packedSize; ///< Raw, uncompressed data size.
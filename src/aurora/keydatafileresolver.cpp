@@ -0,0 +1,100 @@
+/* Phaethon - A FLOSS resource explorer for BioWare's Aurora engine games
+ *
+ * Phaethon is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * Phaethon is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * Phaethon is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Phaethon. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  Finding and loading the data files indexed by KEY files.
+ */
+
+#include "src/common/error.h"
+#include "src/common/scopedptr.h"
+#include "src/common/filepath.h"
+
+#include "src/aurora/keydatafileresolver.h"
+#include "src/aurora/keydatafile.h"
+#include "src/aurora/biffile.h"
+#include "src/aurora/bzffile.h"
+#include "src/aurora/util.h"
+
+namespace Aurora {
+
+KEYDataFileResolver::KEYDataFileResolver(const Common::UString &directory, size_t maxOpenFiles) :
+	_directory(directory), _filePool(maxOpenFiles) {
+
+}
+
+KEYDataFileResolver::~KEYDataFileResolver() {
+	// The data files need to go before the file pool they read through
+	_dataFiles.clear();
+}
+
+const Common::UString &KEYDataFileResolver::getDirectory() const {
+	return _directory;
+}
+
+Common::UString KEYDataFileResolver::findDataFile(const Common::UString &name) const {
+	const Common::UString path = Common::FilePath::normalize(_directory + "/" + name);
+	if (path.empty() || !Common::FilePath::isRegularFile(path))
+		throw Common::Exception("No such file \"%s\"", (_directory + "/" + name).c_str());
+
+	return path;
+}
+
+KEYDataFile *KEYDataFileResolver::getDataFile(const Common::UString &name) {
+	FileType type = kFileTypeNone;
+
+	{
+		Common::StackLock lock(_mutex);
+
+		DataFileMap::iterator d = _dataFiles.find(name);
+		if (d != _dataFiles.end())
+			return d->second;
+
+		type = TypeMan.getFileType(name);
+	}
+
+	const Common::UString path = findDataFile(name);
+
+	// Load the data file without holding the lock, so that other data files can be found meanwhile
+	Common::ScopedPtr<KEYDataFile> dataFile;
+	switch (type) {
+		case kFileTypeBIF:
+			dataFile.reset(new BIFFile(new Common::PooledReadFile(_filePool, path)));
+			break;
+
+		case kFileTypeBZF:
+			dataFile.reset(new BZFFile(new Common::PooledReadFile(_filePool, path)));
+			break;
+
+		default:
+			throw Common::Exception("Unknown KEY data file type %d", type);
+	}
+
+	Common::StackLock lock(_mutex);
+
+	// If another thread loaded the same data file in the meantime, use that one
+	DataFileMap::iterator d = _dataFiles.find(name);
+	if (d != _dataFiles.end())
+		return d->second;
+
+	_dataFiles.insert(std::make_pair(name, dataFile.get()));
+	return dataFile.release();
+}
+
+} // End of namespace Aurora
@@ -0,0 +1,92 @@
+/* Phaethon - A FLOSS resource explorer for BioWare's Aurora engine games
+ *
+ * Phaethon is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * Phaethon is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * Phaethon is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Phaethon. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  Finding and loading the data files indexed by KEY files.
+ */
+
+#ifndef AURORA_KEYDATAFILERESOLVER_H
+#define AURORA_KEYDATAFILERESOLVER_H
+
+#include <boost/noncopyable.hpp>
+
+#include "src/common/types.h"
+#include "src/common/ustring.h"
+#include "src/common/mutex.h"
+#include "src/common/ptrmap.h"
+#include "src/common/readfilepool.h"
+
+namespace Aurora {
+
+class KEYDataFile;
+
+/** Finds and loads the data files (BIF/BZF) indexed by KEY files.
+ *
+ *  Data files are looked for relative to a base directory, and loaded
+ *  the first time they are requested. All data files read through a
+ *  shared pool of open files, so that only a limited number of files
+ *  is kept open, no matter how many data files there are.
+ *
+ *  The resolver owns all the data files it loaded. It can be shared
+ *  between several KEY files, and is thread-safe.
+ */
+class KEYDataFileResolver : boost::noncopyable {
+public:
+	/** Create a resolver for data files within this directory.
+	 *
+	 *  @param directory The directory the data file names are relative to.
+	 *  @param maxOpenFiles The maximum number of data files kept open at once.
+	 */
+	KEYDataFileResolver(const Common::UString &directory,
+	                    size_t maxOpenFiles = Common::ReadFilePool::kDefaultMaxOpenFiles);
+	~KEYDataFileResolver();
+
+	/** Return the directory the data file names are relative to. */
+	const Common::UString &getDirectory() const;
+
+	/** Return the path of the data file with this name.
+	 *
+	 *  Throws an exception if the data file can't be found.
+	 */
+	Common::UString findDataFile(const Common::UString &name) const;
+
+	/** Return the data file with this name, loading it if necessary.
+	 *
+	 *  Throws an exception if the data file can't be found or loaded.
+	 */
+	KEYDataFile *getDataFile(const Common::UString &name);
+
+private:
+	typedef Common::PtrMap<Common::UString, KEYDataFile> DataFileMap;
+
+	Common::UString _directory;
+
+	/** The pool of open files all data files read through. */
+	Common::ReadFilePool _filePool;
+
+	/** All data files loaded so far. */
+	DataFileMap _dataFiles;
+
+	Common::Mutex _mutex;
+};
+
+} // End of namespace Aurora
+
+#endif // AURORA_KEYDATAFILERESOLVER_H
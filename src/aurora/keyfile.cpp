@@ -31,10 +31,13 @@
 #include "src/common/strutil.h"
 #include "src/common/error.h"
 #include "src/common/readstream.h"
+#include "src/common/bufferedreadstream.h"
+#include "src/common/fixedtable.h"
 #include "src/common/encoding.h"
 
 #include "src/aurora/keyfile.h"
 #include "src/aurora/keydatafile.h"
+#include "src/aurora/keydatafileresolver.h"
 
 static const uint32 kKEYID     = MKTAG('K', 'E', 'Y', ' ');
 static const uint32 kVersion1  = MKTAG('V', '1', ' ', ' ');
@@ -42,7 +45,7 @@ static const uint32 kVersion11 = MKTAG('V', '1', '.', '1');
 
 namespace Aurora {
 
-KEYFile::KEYFile(Common::SeekableReadStream *key) {
+KEYFile::KEYFile(Common::SeekableReadStream *key) : _dataFileResolver(0) {
 	Common::ScopedPtr<Common::SeekableReadStream> keyStream(key);
 
 	load(*keyStream);
@@ -52,27 +55,120 @@ KEYFile::~KEYFile() {
 }
 
 bool KEYFile::haveDataFile(uint32 index) const {
-	return getIResource(index).dataFile != 0;
+	const IResource &iRes = getIResource(index);
+
+	try {
+		return getDataFile(iRes.dataFileIndex) != 0;
+	} catch (Common::Exception &) {
+		return false;
+	}
+}
+
+bool KEYFile::haveLoadedDataFile(uint32 index) const {
+	const IResource &iRes = getIResource(index);
+
+	Common::StackLock lock(_dataFileMutex);
+
+	return (iRes.dataFileIndex < _dataFileObjects.size()) && (_dataFileObjects[iRes.dataFileIndex] != 0);
 }
 
 void KEYFile::addDataFile(uint32 dataFileIndex, KEYDataFile *dataFile) {
 	if (!dataFile)
 		throw Common::Exception("KEYFile::addDataFile(): dataFile == 0");
 
-	ResourceList::iterator   res = _resources.begin();
-	IResourceList::iterator iRes = _iResources.begin();
-	for (; (res != _resources.end()) && (iRes != _iResources.end()); ++res, ++iRes) {
-		// Merge information for all resources where the data file index matches
-		if (iRes->dataFileIndex != dataFileIndex)
+	checkDataFile(dataFileIndex, *dataFile);
+
+	Common::StackLock lock(_dataFileMutex);
+
+	if (dataFileIndex < _dataFileObjects.size()) {
+		_dataFileObjects[dataFileIndex] = dataFile;
+		_triedDataFiles [dataFileIndex] = true;
+		_dataFileErrors [dataFileIndex] = Common::Exception();
+	}
+}
+
+void KEYFile::setDataFileResolver(KEYDataFileResolver *resolver) {
+	Common::StackLock lock(_dataFileMutex);
+
+	_dataFileResolver = resolver;
+}
+
+void KEYFile::checkDataFile(uint32 dataFileIndex, const KEYDataFile &dataFile) const {
+	for (size_t i = 0; i < _iResources.size(); i++) {
+		const IResource &iRes = _iResources[i];
+
+		// Check all resources where the data file index matches
+		if (iRes.dataFileIndex != dataFileIndex)
 			continue;
 
-		if (res->type != dataFile->getResourceType(iRes->resIndex))
+		const FileType type = _resources.getType(i);
+		if (type != dataFile.getResourceType(iRes.resIndex))
 			throw Common::Exception("Resource type doesn't match in data file (%d, %d, %d, %d, %d)",
-			                        res->index, iRes->dataFileIndex, iRes->resIndex,
-			                        res->type, dataFile->getResourceType(iRes->resIndex));
+			                        _resources.getIndex(i), iRes.dataFileIndex, iRes.resIndex,
+			                        type, dataFile.getResourceType(iRes.resIndex));
+	}
+}
+
+bool KEYFile::findDataFile(uint32 dataFileIndex, KEYDataFile *&dataFile, KEYDataFileResolver *&resolver) const {
+	Common::StackLock lock(_dataFileMutex);
+
+	dataFile = _dataFileObjects[dataFileIndex];
+	resolver = _dataFileResolver;
+
+	if (dataFile || !resolver)
+		return true;
+
+	if (_triedDataFiles[dataFileIndex]) {
+		if (!_dataFileErrors[dataFileIndex].empty())
+			throw _dataFileErrors[dataFileIndex];
+
+		return true;
+	}
+
+	return false;
+}
+
+KEYDataFile *KEYFile::getDataFile(uint32 dataFileIndex) const {
+	if (dataFileIndex >= _dataFileObjects.size())
+		return 0;
+
+	KEYDataFile *dataFile = 0;
+	KEYDataFileResolver *resolver = 0;
+
+	if (findDataFile(dataFileIndex, dataFile, resolver))
+		return dataFile;
 
-		iRes->dataFile = dataFile;
+	/* Loading a data file can take a while. Only hold that data file's own
+	 * mutex while doing so, so that the others can still be accessed. */
+	Common::StackLock resolveLock(*_dataFileResolveMutexes[dataFileIndex]);
+
+	// Another thread might have resolved the data file in the meantime
+	if (findDataFile(dataFileIndex, dataFile, resolver))
+		return dataFile;
+
+	Common::Exception error;
+
+	try {
+		dataFile = resolver->getDataFile(_dataFiles[dataFileIndex]);
+		checkDataFile(dataFileIndex, *dataFile);
+	} catch (Common::Exception &e) {
+		dataFile = 0;
+
+		error = e;
+		error.add("Failed to load KEY data file \"%s\"", _dataFiles[dataFileIndex].c_str());
 	}
+
+	Common::StackLock lock(_dataFileMutex);
+
+	// Only try once, so that a missing data file doesn't get looked for over and over
+	_triedDataFiles [dataFileIndex] = true;
+	_dataFileObjects[dataFileIndex] = dataFile;
+	_dataFileErrors [dataFileIndex] = error;
+
+	if (!dataFile)
+		throw error;
+
+	return dataFile;
 }
 
 const std::vector<Common::UString> &KEYFile::getDataFileList() const {
@@ -103,10 +199,20 @@ void KEYFile::load(Common::SeekableReadStream &key) {
 
 	try {
 
+		Common::BufferedReadStream buffered(&key);
+
 		_dataFiles.resize(dataFileCount);
-		readDataFileList(key, offFileTable);
+		readDataFileList(buffered, offFileTable);
 
-		_resources.resize(resCount);
+		_dataFileObjects.resize(dataFileCount, 0);
+		_triedDataFiles.resize(dataFileCount, false);
+		_dataFileErrors.resize(dataFileCount);
+
+		_dataFileResolveMutexes.reserve(dataFileCount);
+		for (uint32 i = 0; i < dataFileCount; i++)
+			_dataFileResolveMutexes.push_back(new Common::Mutex);
+
+		_resources.reserve(resCount);
 		_iResources.resize(resCount);
 		readResList(key, offResTable);
 
@@ -117,7 +223,7 @@ void KEYFile::load(Common::SeekableReadStream &key) {
 
 }
 
-void KEYFile::readDataFileList(Common::SeekableReadStream &key, uint32 offset) {
+void KEYFile::readDataFileList(Common::BufferedReadStream &key, uint32 offset) {
 	key.seek(offset);
 
 	for (std::vector<Common::UString>::iterator d = _dataFiles.begin(); d != _dataFiles.end(); ++d) {
@@ -147,34 +253,30 @@ void KEYFile::readDataFileList(Common::SeekableReadStream &key, uint32 offset) {
 }
 
 void KEYFile::readResList(Common::SeekableReadStream &key, uint32 offset) {
-	key.seek(offset);
+	// Name, type and ID, plus flags in version 1.1
+	const Common::FixedTable table(key, offset, _iResources.size(), (_version == kVersion11) ? 26 : 22);
 
-	uint32 index = 0;
-	ResourceList::iterator   res = _resources.begin();
-	IResourceList::iterator iRes = _iResources.begin();
-	for (; (res != _resources.end()) && (iRes != _iResources.end()); ++index, ++res, ++iRes) {
-		iRes->dataFile = 0;
+	for (size_t i = 0; i < table.size(); i++) {
+		const byte *entry = table[i];
 
-		res->name  = Common::readStringFixed(key, Common::kEncodingASCII, 16);
-		res->type  = (FileType) key.readUint16LE();
-		res->index = index;
+		_resources.addFixed(entry, 16, (FileType) READ_LE_UINT16(entry + 16), i);
 
-		uint32 id = key.readUint32LE();
+		const uint32 id = READ_LE_UINT32(entry + 18);
 
 		// The new flags field holds the data file index now. The rest contains fixed
 		// resource info.
 		if (_version == kVersion11) {
-			uint32 flags = key.readUint32LE();
-			iRes->dataFileIndex = (flags & 0xFFF00000) >> 20;
+			const uint32 flags = READ_LE_UINT32(entry + 22);
+			_iResources[i].dataFileIndex = (flags & 0xFFF00000) >> 20;
 		} else
-			iRes->dataFileIndex = id >> 20;
+			_iResources[i].dataFileIndex = id >> 20;
 
 		// TODO: Fixed resources?
-		iRes->resIndex = id & 0xFFFFF;
+		_iResources[i].resIndex = id & 0xFFFFF;
 	}
 }
 
-const Archive::ResourceList &KEYFile::getResources() const {
+const ResourceTable &KEYFile::getResourceTable() const {
 	return _resources;
 }
 
@@ -185,21 +287,48 @@ const KEYFile::IResource &KEYFile::getIResource(uint32 index) const {
 	return _iResources[index];
 }
 
-uint32 KEYFile::getResourceSize(uint32 index) const {
+uint64 KEYFile::getResourceSize(uint32 index) const {
 	const IResource &iRes = getIResource(index);
-	if (!iRes.dataFile)
-		return 0xFFFFFFFF;
 
-	return iRes.dataFile->getResourceSize(iRes.resIndex);
+	// A failure to resolve the data file is kept, and thrown by getResource()
+	KEYDataFile *dataFile = 0;
+	try {
+		dataFile = getDataFile(iRes.dataFileIndex);
+	} catch (Common::Exception &) {
+	}
+
+	if (!dataFile)
+		return 0xFFFFFFFFFFFFFFFFULL;
+
+	return dataFile->getResourceSize(iRes.resIndex);
 }
 
-Common::SeekableReadStream *KEYFile::getResource(uint32 index, bool UNUSED(tryNoCopy)) const {
+uint64 KEYFile::getResourceOffset(uint32 index) const {
 	const IResource &iRes = getIResource(index);
-	if (!iRes.dataFile)
+
+	// A failure to resolve the data file is kept, and thrown by getResource()
+	KEYDataFile *dataFile = 0;
+	try {
+		dataFile = getDataFile(iRes.dataFileIndex);
+	} catch (Common::Exception &) {
+	}
+
+	if (!dataFile)
+		return 0xFFFFFFFFFFFFFFFFULL;
+
+	// Order by data file first, then by the offset within the data file, which BIFs store in 32 bits
+	return (((uint64) iRes.dataFileIndex) << 32) | dataFile->getResourceOffset(iRes.resIndex);
+}
+
+Common::SeekableReadStream *KEYFile::getResource(uint32 index, bool tryNoCopy) const {
+	const IResource &iRes = getIResource(index);
+
+	KEYDataFile *dataFile = getDataFile(iRes.dataFileIndex);
+	if (!dataFile)
 		throw Common::Exception("Data files for resource %d (\"%s\") missing", index,
-		                        _dataFiles[iRes.dataFileIndex].c_str());
+		                        (iRes.dataFileIndex < _dataFiles.size()) ? _dataFiles[iRes.dataFileIndex].c_str() : "");
 
-	return iRes.dataFile->getResource(iRes.resIndex);
+	return dataFile->getResource(iRes.resIndex, tryNoCopy);
 }
 
 } // End of namespace Aurora
@@ -29,6 +29,9 @@
 
 #include "src/common/types.h"
 #include "src/common/ustring.h"
+#include "src/common/error.h"
+#include "src/common/mutex.h"
+#include "src/common/ptrvector.h"
 
 #include "src/aurora/types.h"
 #include "src/aurora/aurorafile.h"
@@ -36,11 +39,13 @@
 
 namespace Common {
 	class SeekableReadStream;
+	class BufferedReadStream;
 }
 
 namespace Aurora {
 
 class KEYDataFile;
+class KEYDataFileResolver;
 
 /** Class to hold resource index information of a KEY file.
  *
@@ -80,29 +85,59 @@ public:
 	 */
 	void addDataFile(uint32 dataFileIndex, KEYDataFile *dataFile);
 
+	/** Set a resolver to find the data files that haven't been added.
+	 *
+	 *  Data files not added with addDataFile() are then looked up through
+	 *  the resolver the first time one of their resources is accessed.
+	 *  The resolver needs to be kept around as long as the KEYFile object
+	 *  lives, but ownership of the resolver is not transferred.
+	 */
+	void setDataFileResolver(KEYDataFileResolver *resolver);
+
 	/** Return the list of data files (BIF/BZF) this KEY file indexes. */
 	const std::vector<Common::UString> &getDataFileList() const;
 
-	/** Do we have a data file associated for this resource? */
+	/** Do we have a data file associated for this resource?
+	 *
+	 *  If the data file could not be loaded by the resolver, this
+	 *  method returns false. The error is kept and thrown by
+	 *  getResource().
+	 */
 	bool haveDataFile(uint32 index) const;
+	/** Is the data file for this resource already loaded?
+	 *
+	 *  Unlike haveDataFile(), this never tries to resolve the data file.
+	 */
+	bool haveLoadedDataFile(uint32 index) const;
 
-	/** Return the list of resources. */
-	const ResourceList &getResources() const;
+	/** Return the table of resources. */
+	const ResourceTable &getResourceTable() const;
 
 	/** Return the size of a resource.
 	 *
 	 *  Note: The size of the resource is stored in data file.
 	 *        If the data files containing this resource's data
-	 *        was not added first with addDataFile(), this method
-	 *        will return 0xFFFFFFFF.
+	 *        was not added first with addDataFile(), and can't
+	 *        be found by the data file resolver either, this
+	 *        method will return 0xFFFFFFFFFFFFFFFF.
+	 */
+	uint64 getResourceSize(uint32 index) const;
+
+	/** Return the offset of a resource's data.
+	 *
+	 *  Note: Since the resource's data is stored in data files,
+	 *        the data file index makes up the upper 32 bits
+	 *        of the offset. If the data file was not added with
+	 *        addDataFile(), this method will return 0xFFFFFFFFFFFFFFFF.
 	 */
-	uint32 getResourceSize(uint32 index) const;
+	uint64 getResourceOffset(uint32 index) const;
 
 	/** Return a stream of the resource's contents.
 	 *
 	 *  Note: Since the resource's data is stored in data files,
 	 *        this method will throw an error if the respective
-	 *        data file was not added first with addDataFile().
+	 *        data file was not added first with addDataFile(),
+	 *        and can't be found by the data file resolver either.
 	 */
 	Common::SeekableReadStream *getResource(uint32 index, bool tryNoCopy = false) const;
 
@@ -111,14 +146,12 @@ private:
 	struct IResource {
 		uint32 dataFileIndex; ///< Index into the data file list.
 		uint32 resIndex;      ///< Index into the data file's resource table.
-
-		KEYDataFile *dataFile; ///< The actual data file containing this resource.
 	};
 
 	typedef std::vector<IResource> IResourceList;
 
-	/** External list of resource names and types. */
-	ResourceList _resources;
+	/** External table of resource names and types. */
+	ResourceTable _resources;
 
 	/** Internal list of resource data file indices. */
 	IResourceList _iResources;
@@ -126,12 +159,41 @@ private:
 	/** All managed data files (BIF/BZF). */
 	std::vector<Common::UString> _dataFiles;
 
+	/** The actual data files, once added or resolved. */
+	mutable std::vector<KEYDataFile *> _dataFileObjects;
+	/** Did we already try to resolve the data files? */
+	mutable std::vector<bool> _triedDataFiles;
+	/** Why resolving the data files failed, if it did. */
+	mutable std::vector<Common::Exception> _dataFileErrors;
+
+	/** The resolver for data files that haven't been added. */
+	KEYDataFileResolver *_dataFileResolver;
+
+	/** Mutex protecting the data files. */
+	mutable Common::Mutex _dataFileMutex;
+	/** Mutexes serializing the resolving of each data file. */
+	mutable Common::PtrVector<Common::Mutex> _dataFileResolveMutexes;
+
 	void load(Common::SeekableReadStream &key);
 
-	void readDataFileList(Common::SeekableReadStream &key, uint32 offset);
+	void readDataFileList(Common::BufferedReadStream &key, uint32 offset);
 	void readResList(Common::SeekableReadStream &key, uint32 offset);
 
 	const IResource &getIResource(uint32 index) const;
+
+	/** Return the data file, resolving it if necessary, or 0 if it's not available.
+	 *
+	 *  If resolving the data file failed, that error is thrown again.
+	 */
+	KEYDataFile *getDataFile(uint32 dataFileIndex) const;
+	/** Look up the data file without resolving it.
+	 *
+	 *  @return true if the data file is known, or if it can't be resolved.
+	 *          false if the data file needs to be resolved with resolver.
+	 */
+	bool findDataFile(uint32 dataFileIndex, KEYDataFile *&dataFile, KEYDataFileResolver *&resolver) const;
+	/** Check that the data file agrees with us about the types of its resources. */
+	void checkDataFile(uint32 dataFileIndex, const KEYDataFile &dataFile) const;
 };
 
 } // End of namespace Aurora
@@ -0,0 +1,363 @@
+/* Phaethon - A FLOSS resource explorer for BioWare's Aurora engine games
+ *
+ * Phaethon is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * Phaethon is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * Phaethon is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Phaethon. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  A dictionary of resource names, for recovering names from their hashes.
+ */
+
+#include <cstring>
+#include <algorithm>
+
+#include "src/common/util.h"
+#include "src/common/error.h"
+#include "src/common/scopedptr.h"
+#include "src/common/readstream.h"
+#include "src/common/writestream.h"
+#include "src/common/writefile.h"
+#include "src/common/filepath.h"
+#include "src/common/mappedreadfile.h"
+
+#include "src/aurora/namedictionary.h"
+#include "src/aurora/archive.h"
+#include "src/aurora/resourcetable.h"
+#include "src/aurora/util.h"
+
+static const uint32 kDictionaryID      = MKTAG('P', 'H', 'N', 'D');
+static const uint32 kDictionaryVersion = 1;
+
+namespace Aurora {
+
+bool NameDictionary::NewName::operator<(const NewName &right) const {
+	return hash < right.hash;
+}
+
+
+NameDictionary::NameDictionary() {
+}
+
+NameDictionary::~NameDictionary() {
+}
+
+Common::UString NameDictionary::getDefaultDictionaryFile() {
+	return Common::FilePath::getUserDataFile("names.dic");
+}
+
+Common::HashAlgo NameDictionary::getNameHashAlgo() const {
+	return Common::kHashFNV64;
+}
+
+uint64 NameDictionary::hashName(const char *name, size_t nameLength) {
+	uint64 hash = 0xCBF29CE484222325LL;
+
+	/* The hash is over the code points of the lowercased name. For ASCII
+	 * names, that's simply the lowercased bytes. Anything else goes the
+	 * long way through a string. */
+
+	for (size_t i = 0; i < nameLength; i++) {
+		const byte c = static_cast<byte>(name[i]);
+		if (c >= 0x80)
+			return Common::hashStringFNV64(Common::UString(name, nameLength).toLower());
+
+		hash = Common::hashFNV64(hash, ((c >= 'A') && (c <= 'Z')) ? (c - 'A' + 'a') : c);
+	}
+
+	return hash;
+}
+
+size_t NameDictionary::size() const {
+	return _hashes.size();
+}
+
+bool NameDictionary::empty() const {
+	return _hashes.empty();
+}
+
+void NameDictionary::clear() {
+	_hashes.clear();
+	_nameOffsets.clear();
+	_names.clear();
+}
+
+void NameDictionary::queueName(std::vector<NewName> &newNames, const char *name, size_t nameLength) {
+	if (nameLength == 0)
+		return;
+
+	NewName newName;
+
+	newName.hash       = hashName(name, nameLength);
+	newName.name       = name;
+	newName.nameLength = nameLength;
+
+	newNames.push_back(newName);
+}
+
+size_t NameDictionary::addNames(std::vector<NewName> &newNames) {
+	/* Sort the new names by hash, then merge them with the names already
+	 * in the dictionary. On duplicate hashes, the name that was there
+	 * first wins, both against existing names and among the new ones. */
+
+	std::stable_sort(newNames.begin(), newNames.end());
+
+	std::vector<uint64> hashes;
+	std::vector<uint32> nameOffsets;
+
+	hashes.reserve(_hashes.size() + newNames.size());
+	nameOffsets.reserve(_hashes.size() + newNames.size());
+
+	size_t added = 0;
+
+	std::vector<NewName>::const_iterator n = newNames.begin();
+	for (size_t i = 0; (i < _hashes.size()) || (n != newNames.end()); ) {
+		if ((n == newNames.end()) || ((i < _hashes.size()) && (_hashes[i] <= n->hash))) {
+			// Skip all new names that have the same hash as the existing one
+			while ((n != newNames.end()) && (n->hash == _hashes[i]))
+				++n;
+
+			hashes.push_back(_hashes[i]);
+			nameOffsets.push_back(_nameOffsets[i]);
+
+			i++;
+			continue;
+		}
+
+		if (!hashes.empty() && (hashes.back() == n->hash)) {
+			++n;
+			continue;
+		}
+
+		if ((_names.size() + n->nameLength + 1) > 0xFFFFFFFF)
+			throw Common::Exception("Name dictionary overflow");
+
+		hashes.push_back(n->hash);
+		nameOffsets.push_back(_names.size());
+
+		_names.insert(_names.end(), n->name, n->name + n->nameLength);
+		_names.push_back('\0');
+
+		added++;
+		++n;
+	}
+
+	_hashes.swap(hashes);
+	_nameOffsets.swap(nameOffsets);
+
+	return added;
+}
+
+bool NameDictionary::add(const Common::UString &name) {
+	std::vector<NewName> newNames;
+	queueName(newNames, name.c_str(), std::strlen(name.c_str()));
+
+	return addNames(newNames) > 0;
+}
+
+size_t NameDictionary::add(const std::vector<Common::UString> &names) {
+	std::vector<NewName> newNames;
+	newNames.reserve(names.size());
+
+	for (std::vector<Common::UString>::const_iterator n = names.begin(); n != names.end(); ++n)
+		queueName(newNames, n->c_str(), std::strlen(n->c_str()));
+
+	return addNames(newNames);
+}
+
+static inline bool isSpace(char c) {
+	return (c == ' ') || (c == '\t') || (c == '\r') || (c == '\n') || (c == '\v') || (c == '\f');
+}
+
+size_t NameDictionary::addWordList(Common::ReadStream &stream) {
+	// Read the whole list at once, the queued names point into it
+	std::vector<char> data;
+
+	char buffer[65536];
+
+	size_t bytesRead;
+	while ((bytesRead = stream.read(buffer, sizeof(buffer))) > 0)
+		data.insert(data.end(), buffer, buffer + bytesRead);
+
+	std::vector<NewName> newNames;
+
+	const char *line = data.empty() ? 0 : &data[0];
+	const char *end  = line + data.size();
+
+	while (line < end) {
+		const char *lineEnd = static_cast<const char *>(std::memchr(line, '\n', end - line));
+		if (!lineEnd)
+			lineEnd = end;
+
+		const char *nameStart = line;
+		const char *nameEnd   = lineEnd;
+
+		while ((nameStart < nameEnd) && isSpace(*nameStart))
+			nameStart++;
+		while ((nameEnd > nameStart) && isSpace(*(nameEnd - 1)))
+			nameEnd--;
+
+		if ((nameStart < nameEnd) && (*nameStart != '#'))
+			queueName(newNames, nameStart, nameEnd - nameStart);
+
+		line = lineEnd + 1;
+	}
+
+	return addNames(newNames);
+}
+
+size_t NameDictionary::addArchive(const Archive &archive) {
+	const ResourceTable &resources = archive.getResourceTable();
+
+	std::vector<Common::UString> names;
+	names.reserve(resources.size());
+
+	for (size_t i = 0; i < resources.size(); i++) {
+		const Common::UString name = resources.getNameString(i);
+		if (!name.empty())
+			names.push_back(TypeMan.setFileType(name, resources.getType(i)));
+	}
+
+	return add(names);
+}
+
+const char *NameDictionary::find(uint64 hash) const {
+	std::vector<uint64>::const_iterator h = std::lower_bound(_hashes.begin(), _hashes.end(), hash);
+	if ((h == _hashes.end()) || (*h != hash))
+		return 0;
+
+	return &_names[_nameOffsets[h - _hashes.begin()]];
+}
+
+size_t NameDictionary::recoverNames(ResourceTable &resources) const {
+	if (empty())
+		return 0;
+
+	size_t recovered = 0;
+	for (size_t i = 0; i < resources.size(); i++) {
+		if (!resources.getName(i).empty())
+			continue;
+
+		const char *name = find(resources.getHash(i));
+		if (!name)
+			continue;
+
+		const Common::UString fullName(name);
+
+		resources.setName(i, TypeMan.setFileType(fullName, kFileTypeNone));
+		if (resources.getType(i) == kFileTypeNone)
+			resources.setType(i, TypeMan.getFileType(fullName));
+
+		recovered++;
+	}
+
+	return recovered;
+}
+
+void NameDictionary::load(Common::SeekableReadStream &stream) {
+	clear();
+
+	try {
+		if (stream.readUint32BE() != kDictionaryID)
+			throw Common::Exception("Not a name dictionary file");
+		if (stream.readUint32LE() != kDictionaryVersion)
+			throw Common::Exception("Unsupported name dictionary version");
+
+		const uint32 count     = stream.readUint32LE();
+		const uint32 namesSize = stream.readUint32LE();
+
+		if (((uint64) count * 12 + namesSize) > (stream.size() - stream.pos()))
+			throw Common::Exception(Common::kReadError);
+
+		_hashes.resize(count);
+		_nameOffsets.resize(count);
+		_names.resize(namesSize);
+
+		// The arrays are stored as they are in memory, in little endian
+		if ((count > 0) && (stream.read(&_hashes[0], count * 8) != (count * 8)))
+			throw Common::Exception(Common::kReadError);
+		if ((count > 0) && (stream.read(&_nameOffsets[0], count * 4) != (count * 4)))
+			throw Common::Exception(Common::kReadError);
+		if ((namesSize > 0) && (stream.read(&_names[0], namesSize) != namesSize))
+			throw Common::Exception(Common::kReadError);
+
+		for (uint32 i = 0; i < count; i++) {
+			_hashes     [i] = FROM_LE_64(_hashes[i]);
+			_nameOffsets[i] = FROM_LE_32(_nameOffsets[i]);
+		}
+
+		// Make sure we can trust the dictionary
+		if ((namesSize > 0) && (_names.back() != '\0'))
+			throw Common::Exception("Invalid name dictionary");
+
+		for (uint32 i = 0; i < count; i++) {
+			if (((i > 0) && (_hashes[i - 1] >= _hashes[i])) || (_nameOffsets[i] >= namesSize))
+				throw Common::Exception("Invalid name dictionary");
+		}
+	} catch (...) {
+		// Don't keep a half-loaded dictionary around
+		clear();
+		throw;
+	}
+}
+
+void NameDictionary::save(Common::WriteStream &stream) const {
+	stream.writeUint32BE(kDictionaryID);
+	stream.writeUint32LE(kDictionaryVersion);
+
+	stream.writeUint32LE(_hashes.size());
+	stream.writeUint32LE(_names.size());
+
+	for (std::vector<uint64>::const_iterator h = _hashes.begin(); h != _hashes.end(); ++h)
+		stream.writeUint64LE(*h);
+	for (std::vector<uint32>::const_iterator o = _nameOffsets.begin(); o != _nameOffsets.end(); ++o)
+		stream.writeUint32LE(*o);
+
+	if (!_names.empty())
+		stream.write(&_names[0], _names.size());
+}
+
+bool NameDictionary::load(const Common::UString &file) {
+	clear();
+
+	if (file.empty() || !Common::FilePath::isRegularFile(file))
+		return false;
+
+	try {
+		Common::ScopedPtr<Common::SeekableReadStream> stream(Common::openReadFile(file));
+
+		load(*stream);
+	} catch (...) {
+		return false;
+	}
+
+	return true;
+}
+
+void NameDictionary::save(const Common::UString &file) const {
+	try {
+		Common::WriteFile writeFile(file);
+
+		save(writeFile);
+		writeFile.flush();
+
+	} catch (Common::Exception &e) {
+		e.add("Failed to write name dictionary \"%s\"", file.c_str());
+		throw;
+	}
+}
+
+} // End of namespace Aurora
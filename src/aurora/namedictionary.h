@@ -0,0 +1,147 @@
+/* Phaethon - A FLOSS resource explorer for BioWare's Aurora engine games
+ *
+ * Phaethon is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * Phaethon is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * Phaethon is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Phaethon. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  A dictionary of resource names, for recovering names from their hashes.
+ */
+
+#ifndef AURORA_NAMEDICTIONARY_H
+#define AURORA_NAMEDICTIONARY_H
+
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+#include "src/common/types.h"
+#include "src/common/ustring.h"
+#include "src/common/hash.h"
+
+namespace Common {
+	class ReadStream;
+	class SeekableReadStream;
+	class WriteStream;
+}
+
+namespace Aurora {
+
+class Archive;
+class ResourceTable;
+
+/** A dictionary of resource names, for recovering names from their hashes.
+ *
+ *  Dragon Age II's V3.0 ERF archives can leave out the names of their
+ *  resources, keeping only FNV64 hashes of the lowercased names with
+ *  their extensions. A dictionary of candidate names, gathered from other
+ *  archives or from word lists, can fill these names back in.
+ *
+ *  The names are kept in flat arrays sorted by their hashes, so finding
+ *  a hash is a binary search. The dictionary is saved with its hashes, and
+ *  loading it again is just a few bulk reads, without hashing anything.
+ */
+class NameDictionary : boost::noncopyable {
+public:
+	NameDictionary();
+	~NameDictionary();
+
+	/** Return the default dictionary file, in the user data directory. */
+	static Common::UString getDefaultDictionaryFile();
+
+	/** Return the algorithm the names are hashed with. */
+	Common::HashAlgo getNameHashAlgo() const;
+
+	/** Hash a resource name, with its extension, the way V3.0 ERFs do. */
+	static uint64 hashName(const char *name, size_t nameLength);
+
+	/** Return the number of names in the dictionary. */
+	size_t size() const;
+	/** Is the dictionary empty? */
+	bool empty() const;
+
+	/** Remove all names from the dictionary. */
+	void clear();
+
+	/** Add a name, with its extension. @return true if the name was new. */
+	bool add(const Common::UString &name);
+	/** Add several names at once. @return The number of new names. */
+	size_t add(const std::vector<Common::UString> &names);
+
+	/** Add all names in a text file, one per line.
+	 *
+	 *  Leading and trailing white space is ignored, as are empty lines
+	 *  and lines starting with a '#'.
+	 *
+	 *  @return The number of new names.
+	 */
+	size_t addWordList(Common::ReadStream &stream);
+	/** Add the names of all named resources in an archive. @return The number of new names. */
+	size_t addArchive(const Archive &archive);
+
+	/** Return the name with this hash, or 0 if there is none. */
+	const char *find(uint64 hash) const;
+
+	/** Fill in the names of all resources in the table that have none.
+	 *
+	 *  Resources without a type get the type of the name's extension.
+	 *
+	 *  @return The number of names that were filled in.
+	 */
+	size_t recoverNames(ResourceTable &resources) const;
+
+	/** Replace the dictionary with one read from this stream. */
+	void load(Common::SeekableReadStream &stream);
+	/** Write the dictionary into this stream. */
+	void save(Common::WriteStream &stream) const;
+
+	/** Replace the dictionary with the one in this file.
+	 *
+	 *  If the file doesn't exist, or isn't a valid dictionary file, the
+	 *  dictionary is left empty.
+	 *
+	 *  @return true if the dictionary was loaded, false otherwise.
+	 */
+	bool load(const Common::UString &file);
+	/** Write the dictionary into this file. */
+	void save(const Common::UString &file) const;
+
+private:
+	/** A name waiting to be added. */
+	struct NewName {
+		uint64 hash;
+		const char *name;
+		size_t nameLength;
+
+		bool operator<(const NewName &right) const;
+	};
+
+	std::vector<uint64> _hashes;      ///< The hashes of all names, sorted.
+	std::vector<uint32> _nameOffsets; ///< The offsets of the names into the name arena.
+
+	/** All names, each terminated by a \0. */
+	std::vector<char> _names;
+
+	/** Queue a name for adding. */
+	static void queueName(std::vector<NewName> &newNames, const char *name, size_t nameLength);
+	/** Merge the queued names into the dictionary. @return The number of new names. */
+	size_t addNames(std::vector<NewName> &newNames);
+};
+
+} // End of namespace Aurora
+
+#endif // AURORA_NAMEDICTIONARY_H
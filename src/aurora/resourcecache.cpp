@@ -0,0 +1,222 @@
+/* Phaethon - A FLOSS resource explorer for BioWare's Aurora engine games
+ *
+ * Phaethon is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * Phaethon is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * Phaethon is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Phaethon. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  A process-wide cache of decoded archive resources.
+ */
+
+#include "src/common/error.h"
+#include "src/common/scopedptr.h"
+#include "src/common/memreadstream.h"
+
+#include "src/aurora/resourcecache.h"
+#include "src/aurora/archive.h"
+
+DECLARE_SINGLETON(Aurora::ResourceCache)
+
+namespace Aurora {
+
+/** A memory stream over cached resource data, keeping the data alive. */
+class CachedResourceStream : public Common::MemoryReadStream {
+public:
+	CachedResourceStream(const boost::shared_array<byte> &data, size_t size) :
+		Common::MemoryReadStream(data.get(), size), _data(data) {
+	}
+
+	~CachedResourceStream() {
+	}
+
+private:
+	boost::shared_array<byte> _data;
+};
+
+
+const size_t ResourceCache::kDefaultBudget;
+
+ResourceCache::Statistics::Statistics() : hits(0), misses(0), count(0), size(0) {
+}
+
+ResourceCache::Key::Key(uint64 a, uint32 i) : archive(a), index(i) {
+}
+
+bool ResourceCache::Key::operator==(const Key &right) const {
+	return (archive == right.archive) && (index == right.index);
+}
+
+size_t ResourceCache::KeyHash::operator()(const Key &key) const {
+	return (size_t) ((key.archive * 0x9E3779B97F4A7C15ULL) ^ key.index);
+}
+
+ResourceCache::Entry::Entry(const Key &k, const boost::shared_array<byte> &d, size_t s) :
+	key(k), data(d), size(s) {
+}
+
+
+ResourceCache::ResourceCache() : _budget(kDefaultBudget), _size(0), _hits(0), _misses(0) {
+}
+
+ResourceCache::~ResourceCache() {
+}
+
+size_t ResourceCache::getBudget() const {
+	Common::StackLock lock(_mutex);
+
+	return _budget;
+}
+
+void ResourceCache::setBudget(size_t budget) {
+	Common::StackLock lock(_mutex);
+
+	_budget = budget;
+	evict(_budget);
+}
+
+Common::SeekableReadStream *ResourceCache::getResource(const Archive &archive, uint32 index) {
+	const Key key(archive.getID(), index);
+
+	boost::shared_array<byte> data;
+	size_t size = 0;
+
+	if (find(key, data, size)) {
+		_hits.fetch_add(1);
+		return createStream(data, size);
+	}
+
+	_misses.fetch_add(1);
+
+	/* Resources of unknown size, or too big to be cached anyway, are handed out
+	 * as the archive's own copy. The stream might outlive the archive, so it must
+	 * never borrow the archive's data. */
+
+	const uint64 resSize = archive.getResourceSize(index);
+	if ((resSize == 0xFFFFFFFFFFFFFFFFULL) || (resSize > getBudget()))
+		return archive.getResource(index);
+
+	/* Read the resource without holding the lock, so that other threads
+	 * can still be served from the cache in the meantime. If two threads
+	 * read the same resource at once, the first one to finish wins. */
+
+	Common::ScopedPtr<Common::SeekableReadStream> res(archive.getResource(index, true));
+
+	// The archive's idea of the resource size might have been wrong
+	size = res->size();
+	if ((size == Common::SeekableReadStream::kSizeInvalid) || (size > getBudget()))
+		return archive.getResource(index);
+
+	if (size > 0) {
+		data.reset(new byte[size]);
+
+		if (res->read(data.get(), size) != size)
+			throw Common::Exception(Common::kReadError);
+	}
+
+	add(key, data, size);
+
+	return createStream(data, size);
+}
+
+void ResourceCache::remove(const Archive &archive) {
+	Common::StackLock lock(_mutex);
+
+	const uint64 id = archive.getID();
+
+	for (EntryList::iterator e = _entries.begin(); e != _entries.end(); ) {
+		EntryList::iterator entry = e++;
+
+		if (entry->key.archive == id)
+			evict(entry);
+	}
+}
+
+void ResourceCache::clear() {
+	Common::StackLock lock(_mutex);
+
+	_entryMap.clear();
+	_entries.clear();
+
+	_size = 0;
+}
+
+ResourceCache::Statistics ResourceCache::getStatistics() const {
+	Statistics stats;
+
+	stats.hits   = _hits.load();
+	stats.misses = _misses.load();
+
+	Common::StackLock lock(_mutex);
+
+	stats.count = _entries.size();
+	stats.size  = _size;
+
+	return stats;
+}
+
+void ResourceCache::resetStatistics() {
+	_hits.store(0);
+	_misses.store(0);
+}
+
+bool ResourceCache::find(const Key &key, boost::shared_array<byte> &data, size_t &size) {
+	Common::StackLock lock(_mutex);
+
+	EntryMap::iterator e = _entryMap.find(key);
+	if (e == _entryMap.end())
+		return false;
+
+	// Move the entry to the front of the list, marking it as most recently used
+	_entries.splice(_entries.begin(), _entries, e->second);
+
+	data = e->second->data;
+	size = e->second->size;
+
+	return true;
+}
+
+void ResourceCache::add(const Key &key, const boost::shared_array<byte> &data, size_t size) {
+	Common::StackLock lock(_mutex);
+
+	if ((size > _budget) || (_entryMap.find(key) != _entryMap.end()))
+		return;
+
+	evict(_budget - size);
+
+	_entries.push_front(Entry(key, data, size));
+	_entryMap.insert(std::make_pair(key, _entries.begin()));
+
+	_size += size;
+}
+
+void ResourceCache::evict(size_t limit) {
+	while (!_entries.empty() && (_size > limit))
+		evict(--_entries.end());
+}
+
+void ResourceCache::evict(EntryList::iterator entry) {
+	_size -= entry->size;
+
+	_entryMap.erase(entry->key);
+	_entries.erase(entry);
+}
+
+Common::SeekableReadStream *ResourceCache::createStream(const boost::shared_array<byte> &data, size_t size) {
+	return new CachedResourceStream(data, size);
+}
+
+} // End of namespace Aurora
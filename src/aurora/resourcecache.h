@@ -0,0 +1,169 @@
+/* Phaethon - A FLOSS resource explorer for BioWare's Aurora engine games
+ *
+ * Phaethon is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * Phaethon is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * Phaethon is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Phaethon. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  A process-wide cache of decoded archive resources.
+ */
+
+#ifndef AURORA_RESOURCECACHE_H
+#define AURORA_RESOURCECACHE_H
+
+#include <list>
+#include <unordered_map>
+
+#include <boost/shared_array.hpp>
+
+#include "src/common/types.h"
+#include "src/common/singleton.h"
+#include "src/common/atomic.h"
+#include "src/common/mutex.h"
+
+namespace Common {
+	class SeekableReadStream;
+}
+
+namespace Aurora {
+
+class Archive;
+
+/** A cache of decoded archive resources.
+ *
+ *  Reading a resource out of an archive might involve decrypting and
+ *  decompressing it. The cache keeps the decoded contents of recently
+ *  read resources around, so that reading them again is cheap.
+ *
+ *  Resources are identified by their archive's unique ID and their
+ *  local index within that archive. The total size of all cached
+ *  resources is kept under a memory budget; when it is exceeded, the
+ *  least recently used resources are evicted first.
+ *
+ *  Streams handed out by the cache stay valid even if their resource
+ *  is evicted in the meantime. All methods are thread-safe.
+ */
+class ResourceCache : public Common::Singleton<ResourceCache> {
+public:
+	/** The default memory budget, in bytes. */
+	static const size_t kDefaultBudget = 64 * 1024 * 1024;
+
+	/** Statistics about the cache's usage. */
+	struct Statistics {
+		uint64 hits;   ///< Number of requests served from the cache.
+		uint64 misses; ///< Number of requests that had to read the archive.
+
+		size_t count; ///< Number of resources currently cached.
+		size_t size;  ///< Total size of the currently cached resources, in bytes.
+
+		Statistics();
+	};
+
+	ResourceCache();
+	~ResourceCache();
+
+	/** Return the memory budget, in bytes. */
+	size_t getBudget() const;
+	/** Set the memory budget, in bytes, evicting resources as necessary.
+	 *
+	 *  A budget of 0 disables the cache.
+	 */
+	void setBudget(size_t budget);
+
+	/** Return a stream of the resource's decoded contents.
+	 *
+	 *  If the resource is cached, the stream is created from the cached
+	 *  contents. Otherwise, the resource is read from the archive and,
+	 *  if it fits into the budget, added to the cache. Resources that
+	 *  don't fit, or whose size isn't known, are not cached; the archive's
+	 *  own copy of the resource is returned instead.
+	 *
+	 *  The returned stream never depends on the archive, so it can still
+	 *  be read after the archive was destroyed.
+	 */
+	Common::SeekableReadStream *getResource(const Archive &archive, uint32 index);
+
+	/** Remove all resources of this archive from the cache. */
+	void remove(const Archive &archive);
+	/** Remove all resources from the cache. */
+	void clear();
+
+	/** Return statistics about the cache's usage. */
+	Statistics getStatistics() const;
+	/** Reset the hit and miss counters. */
+	void resetStatistics();
+
+private:
+	/** A resource's identity. */
+	struct Key {
+		uint64 archive; ///< The unique ID of the archive.
+		uint32 index;   ///< The resource's local index within the archive.
+
+		Key(uint64 a, uint32 i);
+
+		bool operator==(const Key &right) const;
+	};
+
+	struct KeyHash {
+		size_t operator()(const Key &key) const;
+	};
+
+	/** A cached resource. */
+	struct Entry {
+		Key key;
+
+		boost::shared_array<byte> data;
+		size_t size;
+
+		Entry(const Key &k, const boost::shared_array<byte> &d, size_t s);
+	};
+
+	/** All cached resources, most recently used first. */
+	typedef std::list<Entry> EntryList;
+	typedef std::unordered_map<Key, EntryList::iterator, KeyHash> EntryMap;
+
+	size_t _budget;
+	size_t _size;
+
+	EntryList _entries;
+	EntryMap  _entryMap;
+
+	boost::atomic<uint64> _hits;
+	boost::atomic<uint64> _misses;
+
+	mutable Common::Mutex _mutex;
+
+	/** Look up a cached resource, marking it as most recently used. */
+	bool find(const Key &key, boost::shared_array<byte> &data, size_t &size);
+	/** Add a resource to the cache. */
+	void add(const Key &key, const boost::shared_array<byte> &data, size_t size);
+
+	/** Evict least recently used resources until the total size is within this limit. */
+	void evict(size_t limit);
+	/** Evict this cached resource. */
+	void evict(EntryList::iterator entry);
+
+	/** Create a stream over cached data. */
+	static Common::SeekableReadStream *createStream(const boost::shared_array<byte> &data, size_t size);
+};
+
+} // End of namespace Aurora
+
+/** Shortcut for accessing the resource cache. */
+#define ResCache ::Aurora::ResourceCache::instance()
+
+#endif // AURORA_RESOURCECACHE_H
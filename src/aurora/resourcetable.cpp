@@ -0,0 +1,133 @@
+/* Phaethon - A FLOSS resource explorer for BioWare's Aurora engine games
+ *
+ * Phaethon is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * Phaethon is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * Phaethon is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Phaethon. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  A compact table of the resources within an archive.
+ */
+
+#include <cstring>
+
+#include "src/common/error.h"
+
+#include "src/aurora/resourcetable.h"
+
+namespace Aurora {
+
+ResourceTable::ResourceTable() {
+}
+
+ResourceTable::~ResourceTable() {
+}
+
+void ResourceTable::clear() {
+	_names.clear();
+
+	_nameOffsets.clear();
+	_nameLengths.clear();
+	_hashes.clear();
+	_types.clear();
+	_indices.clear();
+}
+
+void ResourceTable::reserve(size_t count, size_t nameLength) {
+	// Each name needs room for its terminating \0 as well
+	_names.reserve(nameLength + count);
+
+	_nameOffsets.reserve(count);
+	_nameLengths.reserve(count);
+	_hashes.reserve(count);
+	_types.reserve(count);
+	_indices.reserve(count);
+}
+
+void ResourceTable::shrinkToFit() {
+	_names.shrink_to_fit();
+
+	_nameOffsets.shrink_to_fit();
+	_nameLengths.shrink_to_fit();
+	_hashes.shrink_to_fit();
+	_types.shrink_to_fit();
+	_indices.shrink_to_fit();
+}
+
+uint32 ResourceTable::addName(const char *name, size_t nameLength) {
+	if ((_names.size() + nameLength + 1) > 0xFFFFFFFF)
+		throw Common::Exception("Resource table name arena overflow");
+
+	const size_t offset = _names.size();
+
+	_names.insert(_names.end(), name, name + nameLength);
+	_names.push_back('\0');
+
+	return offset;
+}
+
+size_t ResourceTable::add(const char *name, size_t nameLength, FileType type, uint32 index, uint64 hash) {
+	const uint32 offset = addName(name, nameLength);
+
+	_nameOffsets.push_back(offset);
+	_nameLengths.push_back(nameLength);
+	_hashes.push_back(hash);
+	_types.push_back(type);
+	_indices.push_back(index);
+
+	return _indices.size() - 1;
+}
+
+size_t ResourceTable::add(const Common::UString &name, FileType type, uint32 index, uint64 hash) {
+	return add(name.c_str(), std::strlen(name.c_str()), type, index, hash);
+}
+
+size_t ResourceTable::addFixed(const byte *name, size_t fieldSize, FileType type, uint32 index, uint64 hash) {
+	const byte *nameEnd = static_cast<const byte *>(std::memchr(name, '\0', fieldSize));
+	const size_t nameLength = nameEnd ? (nameEnd - name) : fieldSize;
+
+	bool ascii = true;
+	for (size_t i = 0; i < nameLength; i++)
+		ascii &= name[i] < 0x80;
+
+	if (ascii)
+		return add(reinterpret_cast<const char *>(name), nameLength, type, index, hash);
+
+	return add(Common::UString(reinterpret_cast<const char *>(name), nameLength), type, index, hash);
+}
+
+Common::UString ResourceTable::getNameString(size_t n) const {
+	return Common::UString(getNameData(n), _nameLengths[n]);
+}
+
+void ResourceTable::setType(size_t n, FileType type) {
+	_types[n] = type;
+}
+
+void ResourceTable::setHash(size_t n, uint64 hash) {
+	_hashes[n] = hash;
+}
+
+void ResourceTable::setName(size_t n, const char *name, size_t nameLength) {
+	_nameOffsets[n] = addName(name, nameLength);
+	_nameLengths[n] = nameLength;
+}
+
+void ResourceTable::setName(size_t n, const Common::UString &name) {
+	setName(n, name.c_str(), std::strlen(name.c_str()));
+}
+
+} // End of namespace Aurora
@@ -0,0 +1,166 @@
+/* Phaethon - A FLOSS resource explorer for BioWare's Aurora engine games
+ *
+ * Phaethon is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * Phaethon is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * Phaethon is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Phaethon. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  A compact table of the resources within an archive.
+ */
+
+#ifndef AURORA_RESOURCETABLE_H
+#define AURORA_RESOURCETABLE_H
+
+#include <vector>
+
+#include "src/common/types.h"
+#include "src/common/ustring.h"
+
+#include "src/aurora/types.h"
+
+namespace Aurora {
+
+/** A compact table of the resources within an archive.
+ *
+ *  Instead of storing each resource as a separate object with its own
+ *  heap-allocated name, the properties of all resources are kept in
+ *  parallel arrays, and all names are packed into one contiguous string
+ *  arena. The n-th entry of each array describes the n-th resource.
+ *
+ *  Names are stored UTF-8 encoded and \0-terminated, and are handed out
+ *  as views into the arena. These views, like the pointers returned by
+ *  getNameData(), are only valid until the table is next modified.
+ */
+class ResourceTable {
+public:
+	/** A view onto a resource name within the table. */
+	typedef Common::UStringView Name;
+
+	ResourceTable();
+	~ResourceTable();
+
+	/** Remove all resources from the table. */
+	void clear();
+
+	/** Reserve space for this many resources, with names of this total length. */
+	void reserve(size_t count, size_t nameLength = 0);
+
+	/** Release all unused reserved space. */
+	void shrinkToFit();
+
+	/** Return the number of resources in the table. */
+	size_t size() const;
+	/** Is the table empty? */
+	bool empty() const;
+
+	/** Add a resource to the end of the table and return its position.
+	 *
+	 *  @param name The resource's UTF-8 encoded name.
+	 *  @param nameLength The length of the name, in bytes.
+	 *  @param type The resource's type.
+	 *  @param index The resource's local index within the archive.
+	 *  @param hash The resource's hashed name.
+	 */
+	size_t add(const char *name, size_t nameLength, FileType type, uint32 index, uint64 hash = 0);
+	/** Add a resource to the end of the table and return its position. */
+	size_t add(const Common::UString &name, FileType type, uint32 index, uint64 hash = 0);
+
+	/** Add a resource with a name from a fixed-size field and return its position.
+	 *
+	 *  The name is read from a field of fieldSize bytes, in the way most archive
+	 *  tables store them: ASCII, padded with \0 if shorter than the field, and
+	 *  not terminated if it fills the whole field.
+	 *
+	 *  A pure ASCII name is copied straight into the name arena. Only names
+	 *  containing other bytes go through a UString, to be checked for valid UTF-8.
+	 */
+	size_t addFixed(const byte *name, size_t fieldSize, FileType type, uint32 index, uint64 hash = 0);
+
+	/** Return the name of the n-th resource. */
+	Name getName(size_t n) const;
+	/** Return the \0-terminated name of the n-th resource. */
+	const char *getNameData(size_t n) const;
+	/** Return a copy of the name of the n-th resource. */
+	Common::UString getNameString(size_t n) const;
+
+	/** Return the hashed name of the n-th resource. */
+	uint64 getHash(size_t n) const;
+	/** Return the type of the n-th resource. */
+	FileType getType(size_t n) const;
+	/** Return the local index within the archive of the n-th resource. */
+	uint32 getIndex(size_t n) const;
+
+	/** Set the type of the n-th resource. */
+	void setType(size_t n, FileType type);
+	/** Set the hashed name of the n-th resource. */
+	void setHash(size_t n, uint64 hash);
+
+	/** Set the name of the n-th resource.
+	 *
+	 *  The new name is appended to the name arena. The space taken by the
+	 *  old name is not reclaimed, which makes this mostly useful for filling
+	 *  in names that were missing to begin with.
+	 */
+	void setName(size_t n, const char *name, size_t nameLength);
+	/** Set the name of the n-th resource. */
+	void setName(size_t n, const Common::UString &name);
+
+private:
+	/** All resource names, each terminated by a \0. */
+	std::vector<char> _names;
+
+	std::vector<uint32>   _nameOffsets; ///< Offsets of the names into the name arena.
+	std::vector<uint32>   _nameLengths; ///< Lengths of the names, in bytes.
+	std::vector<uint64>   _hashes;      ///< The hashed names.
+	std::vector<FileType> _types;       ///< The types.
+	std::vector<uint32>   _indices;     ///< The local indices within the archive.
+
+	/** Append a name to the name arena and return its offset. */
+	uint32 addName(const char *name, size_t nameLength);
+};
+
+inline size_t ResourceTable::size() const {
+	return _indices.size();
+}
+
+inline bool ResourceTable::empty() const {
+	return _indices.empty();
+}
+
+inline ResourceTable::Name ResourceTable::getName(size_t n) const {
+	return Name(&_names[_nameOffsets[n]], _nameLengths[n]);
+}
+
+inline const char *ResourceTable::getNameData(size_t n) const {
+	return &_names[_nameOffsets[n]];
+}
+
+inline uint64 ResourceTable::getHash(size_t n) const {
+	return _hashes[n];
+}
+
+inline FileType ResourceTable::getType(size_t n) const {
+	return _types[n];
+}
+
+inline uint32 ResourceTable::getIndex(size_t n) const {
+	return _indices[n];
+}
+
+} // End of namespace Aurora
+
+#endif // AURORA_RESOURCETABLE_H
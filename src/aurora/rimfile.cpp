@@ -27,8 +27,8 @@
 #include "src/common/util.h"
 #include "src/common/strutil.h"
 #include "src/common/memreadstream.h"
+#include "src/common/fixedtable.h"
 #include "src/common/error.h"
-#include "src/common/encoding.h"
 
 #include "src/aurora/rimfile.h"
 
@@ -59,7 +59,7 @@ void RIMFile::load(Common::SeekableReadStream &rim) {
 	uint32 resCount   = rim.readUint32LE(); // Number of resources in the RIM
 	uint32 offResList = rim.readUint32LE(); // Offset to the resource list
 
-	_resources.resize(resCount);
+	_resources.reserve(resCount);
 	_iResources.resize(resCount);
 
 	try {
@@ -75,22 +75,20 @@ void RIMFile::load(Common::SeekableReadStream &rim) {
 }
 
 void RIMFile::readResList(Common::SeekableReadStream &rim, uint32 offset) {
-	rim.seek(offset);
-
-	uint32 index = 0;
-	ResourceList::iterator   res = _resources.begin();
-	IResourceList::iterator iRes = _iResources.begin();
-	for (; (res != _resources.end()) && (iRes != _iResources.end()); ++index, ++res, ++iRes) {
-		res->name    = Common::readStringFixed(rim, Common::kEncodingASCII, 16);
-		res->type    = (FileType) rim.readUint16LE();
-		res->index   = index;
-		rim.skip(4 + 2); // Resource ID + Reserved
-		iRes->offset = rim.readUint32LE();
-		iRes->size   = rim.readUint32LE();
+	const Common::FixedTable table(rim, offset, _iResources.size(), 32);
+
+	for (size_t i = 0; i < table.size(); i++) {
+		const byte *entry = table[i];
+
+		// Name, type, resource ID and reserved
+		_resources.addFixed(entry, 16, (FileType) READ_LE_UINT16(entry + 16), i);
+
+		_iResources[i].offset = READ_LE_UINT32(entry + 24);
+		_iResources[i].size   = READ_LE_UINT32(entry + 28);
 	}
 }
 
-const Archive::ResourceList &RIMFile::getResources() const {
+const ResourceTable &RIMFile::getResourceTable() const {
 	return _resources;
 }
 
@@ -101,19 +99,26 @@ const RIMFile::IResource &RIMFile::getIResource(uint32 index) const {
 	return _iResources[index];
 }
 
-uint32 RIMFile::getResourceSize(uint32 index) const {
+uint64 RIMFile::getResourceSize(uint32 index) const {
 	return getIResource(index).size;
 }
 
+uint64 RIMFile::getResourceOffset(uint32 index) const {
+	return getIResource(index).offset;
+}
+
 Common::SeekableReadStream *RIMFile::getResource(uint32 index, bool tryNoCopy) const {
 	const IResource &res = getIResource(index);
 
-	if (tryNoCopy)
-		return new Common::SeekableSubReadStream(_rim.get(), res.offset, res.offset + res.size);
+	if (tryNoCopy) {
+		Common::SeekableReadStream *view = Common::createMemoryView(*_rim, res.offset, res.offset + res.size);
+		if (view)
+			return view;
 
-	_rim->seek(res.offset);
+		return new Common::SeekableSubReadStream(_rim.get(), res.offset, res.offset + res.size);
+	}
 
-	return _rim->readStream(res.size);
+	return _rim->readStreamAt(res.offset, res.size);
 }
 
 } // End of namespace Aurora
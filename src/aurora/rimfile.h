@@ -64,11 +64,14 @@ public:
 	RIMFile(Common::SeekableReadStream *rim);
 	~RIMFile();
 
-	/** Return the list of resources. */
-	const ResourceList &getResources() const;
+	/** Return the table of resources. */
+	const ResourceTable &getResourceTable() const;
 
 	/** Return the size of a resource. */
-	uint32 getResourceSize(uint32 index) const;
+	uint64 getResourceSize(uint32 index) const;
+
+	/** Return the offset of a resource's data within the RIM. */
+	uint64 getResourceOffset(uint32 index) const;
 
 	/** Return a stream of the resource's contents. */
 	Common::SeekableReadStream *getResource(uint32 index, bool tryNoCopy = false) const;
@@ -76,7 +79,7 @@ public:
 private:
 	/** Internal resource information. */
 	struct IResource {
-		uint32 offset; ///< The offset of the resource within the RIM.
+		uint64 offset; ///< The offset of the resource within the RIM.
 		uint32 size;   ///< The resource's size.
 	};
 
@@ -84,8 +87,8 @@ private:
 
 	Common::ScopedPtr<Common::SeekableReadStream> _rim;
 
-	/** External list of resource names and types. */
-	ResourceList _resources;
+	/** External table of resource names and types. */
+	ResourceTable _resources;
 
 	/** Internal list of resource offsets and sizes. */
 	IResourceList _iResources;
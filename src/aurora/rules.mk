@@ -29,12 +29,19 @@ src_aurora_libaurora_la_SOURCES += \
     src/aurora/language_strings.h \
     src/aurora/locstring.h \
     src/aurora/aurorafile.h \
+    src/aurora/resourcetable.h \
     src/aurora/archive.h \
+    src/aurora/archiveextractor.h \
+    src/aurora/resourcecache.h \
+    src/aurora/indexcache.h \
+    src/aurora/fingerprintindex.h \
+    src/aurora/namedictionary.h \
     src/aurora/zipfile.h \
     src/aurora/erffile.h \
     src/aurora/rimfile.h \
     src/aurora/keyfile.h \
     src/aurora/keydatafile.h \
+    src/aurora/keydatafileresolver.h \
     src/aurora/biffile.h \
     src/aurora/bzffile.h \
     $(EMPTY)
@@ -44,12 +51,19 @@ src_aurora_libaurora_la_SOURCES += \
     src/aurora/language.cpp \
     src/aurora/locstring.cpp \
     src/aurora/aurorafile.cpp \
+    src/aurora/resourcetable.cpp \
     src/aurora/archive.cpp \
+    src/aurora/archiveextractor.cpp \
+    src/aurora/resourcecache.cpp \
+    src/aurora/indexcache.cpp \
+    src/aurora/fingerprintindex.cpp \
+    src/aurora/namedictionary.cpp \
     src/aurora/zipfile.cpp \
     src/aurora/erffile.cpp \
     src/aurora/rimfile.cpp \
     src/aurora/keyfile.cpp \
     src/aurora/keydatafile.cpp \
+    src/aurora/keydatafileresolver.cpp \
     src/aurora/biffile.cpp \
     src/aurora/bzffile.cpp \
     $(EMPTY)
@@ -41,29 +41,28 @@ ZIPFile::ZIPFile(Common::SeekableReadStream *zip) {
 ZIPFile::~ZIPFile() {
 }
 
-const Archive::ResourceList &ZIPFile::getResources() const {
+const ResourceTable &ZIPFile::getResourceTable() const {
 	return _resources;
 }
 
-uint32 ZIPFile::getResourceSize(uint32 index) const {
+uint64 ZIPFile::getResourceSize(uint32 index) const {
 	return _zipFile->getFileSize(index);
 }
 
+uint64 ZIPFile::getResourceOffset(uint32 index) const {
+	return _zipFile->getFileOffset(index);
+}
+
 Common::SeekableReadStream *ZIPFile::getResource(uint32 index, bool tryNoCopy) const {
 	return _zipFile->getFile(index, tryNoCopy);
 }
 
 void ZIPFile::load() {
 	const Common::ZipFile::FileList &files = _zipFile->getFiles();
-	for (Common::ZipFile::FileList::const_iterator file = files.begin(); file != files.end(); ++file) {
-		Resource res;
-
-		res.name  = Common::FilePath::getStem(file->name);
-		res.type  = TypeMan.getFileType(file->name);
-		res.index = file->index;
 
-		_resources.push_back(res);
-	}
+	_resources.reserve(files.size());
+	for (Common::ZipFile::FileList::const_iterator file = files.begin(); file != files.end(); ++file)
+		_resources.add(Common::FilePath::getStem(file->name), TypeMan.getFileType(file->name), file->index);
 }
 
 } // End of namespace Aurora
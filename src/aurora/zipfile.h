@@ -45,11 +45,14 @@ public:
 	ZIPFile(Common::SeekableReadStream *zip);
 	~ZIPFile();
 
-	/** Return the list of resources. */
-	const ResourceList &getResources() const;
+	/** Return the table of resources. */
+	const ResourceTable &getResourceTable() const;
 
 	/** Return the size of a resource. */
-	uint32 getResourceSize(uint32 index) const;
+	uint64 getResourceSize(uint32 index) const;
+
+	/** Return the offset of a resource's data within the ZIP. */
+	uint64 getResourceOffset(uint32 index) const;
 
 	/** Return a stream of the resource's contents. */
 	Common::SeekableReadStream *getResource(uint32 index, bool tryNoCopy = false) const;
@@ -58,8 +61,8 @@ private:
 	/** The actual zip file. */
 	Common::ScopedPtr<Common::ZipFile> _zipFile;
 
-	/** External list of resource names and types. */
-	ResourceList _resources;
+	/** External table of resource names and types. */
+	ResourceTable _resources;
 
 	void load();
 };
@@ -0,0 +1,479 @@
+/* Phaethon - A FLOSS resource explorer for BioWare's Aurora engine games
+ *
+ * Phaethon is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * Phaethon is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * Phaethon is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Phaethon. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  Archive operations run from the command line, without the GUI.
+ */
+
+#include <cstdio>
+#include <vector>
+#include <list>
+#include <set>
+
+#include <boost/noncopyable.hpp>
+#include <boost/thread.hpp>
+
+#include "src/common/util.h"
+#include "src/common/error.h"
+#include "src/common/ustring.h"
+#include "src/common/strutil.h"
+#include "src/common/scopedptr.h"
+#include "src/common/atomic.h"
+#include "src/common/mutex.h"
+#include "src/common/readstream.h"
+#include "src/common/mappedreadfile.h"
+#include "src/common/writefile.h"
+#include "src/common/filepath.h"
+#include "src/common/filelist.h"
+
+#include "src/aurora/util.h"
+#include "src/aurora/archive.h"
+#include "src/aurora/archiveextractor.h"
+#include "src/aurora/keydatafileresolver.h"
+#include "src/aurora/indexcache.h"
+#include "src/aurora/fingerprintindex.h"
+#include "src/aurora/namedictionary.h"
+
+#include "src/images/decoder.h"
+#include "src/images/loader.h"
+
+#include "src/sound/sound.h"
+#include "src/sound/audiostream.h"
+#include "src/sound/dumpwav.h"
+
+#include "src/cline.h"
+#include "src/batch.h"
+
+/** An opened archive, together with the resolver for its KEY data files. */
+class BatchArchive : boost::noncopyable {
+public:
+	BatchArchive(const Common::UString &path) {
+		const Common::UString archivePath = Common::FilePath::canonicalize(path);
+		if (!Common::FilePath::isRegularFile(archivePath))
+			throw Common::Exception("No such file \"%s\"", path.c_str());
+
+		// KEY files index data files relative to the directory they are in
+		_resolver.reset(new Aurora::KEYDataFileResolver(Common::FilePath::getDirectory(archivePath)));
+
+		_archive.reset(Aurora::IndexCache::openArchiveFile(archivePath, _resolver.get()));
+
+		// Archives that only store name hashes get their names back from the dictionary
+		if (_archive->getNameHashAlgo() != Common::kHashNone) {
+			Aurora::NameDictionary dictionary;
+			if (dictionary.load(Aurora::NameDictionary::getDefaultDictionaryFile()))
+				_archive->recoverNames(dictionary);
+		}
+	}
+
+	~BatchArchive() {
+		// The archive might read from data files owned by the resolver
+		_archive.reset();
+	}
+
+	const Aurora::Archive &get() const {
+		return *_archive;
+	}
+
+private:
+	Common::ScopedPtr<Aurora::KEYDataFileResolver> _resolver;
+	Common::ScopedPtr<Aurora::Archive> _archive;
+};
+
+/** Return the file name of the resource at this position in the resource table. */
+static Common::UString getResourceFileName(const Aurora::ResourceTable &resources, size_t n,
+                                           Aurora::FileType type) {
+
+	Common::UString name = resources.getNameString(n);
+	if (name.empty())
+		name = Common::UString::format("0x%08X%08X", (uint)(resources.getHash(n) >> 32),
+		                                             (uint)(resources.getHash(n) & 0xFFFFFFFF));
+
+	return TypeMan.setFileType(name, type);
+}
+
+/** Does the resource file name match any of the job's patterns? */
+static bool matchesJob(const Job &job, const Common::UString &fileName) {
+	if (job.globs.empty())
+		return true;
+
+	// Resource names in Aurora games are case-insensitive
+	for (std::vector<Common::UString>::const_iterator g = job.globs.begin(); g != job.globs.end(); ++g)
+		if (Common::matchGlob(fileName, *g, true))
+			return true;
+
+	return false;
+}
+
+static size_t getThreadCount(const Job &job) {
+	if (job.threadCount != 0)
+		return job.threadCount;
+
+	return MAX<size_t>(boost::thread::hardware_concurrency(), 1);
+}
+
+void listArchive(const Job &job) {
+	BatchArchive archive(job.path);
+
+	const Aurora::ResourceTable &resources = archive.get().getResourceTable();
+
+	size_t count = 0;
+	for (size_t i = 0; i < resources.size(); i++) {
+		const Aurora::FileType type = resources.getType(i);
+
+		const Common::UString fileName = getResourceFileName(resources, i, type);
+		if (!matchesJob(job, fileName))
+			continue;
+
+		// Resources in missing data files have no known size
+		Common::UString size = "?";
+		try {
+			const uint64 resSize = archive.get().getResourceSize(resources.getIndex(i));
+			if (resSize != 0xFFFFFFFFFFFFFFFFULL)
+				size = Common::composeString(resSize);
+		} catch (Common::Exception &) {
+		}
+
+		std::printf("%10s  %-7s  %s\n", size.c_str(),
+		            Aurora::getResourceTypeDescription(TypeMan.getResourceType(type)).c_str(),
+		            fileName.c_str());
+
+		count++;
+	}
+
+	std::printf("%u of %u resources\n", (uint)count, (uint)resources.size());
+}
+
+void extractArchive(const Job &job) {
+	BatchArchive archive(job.path);
+
+	const Aurora::ResourceTable &resources = archive.get().getResourceTable();
+
+	std::vector<uint32> indices;
+	for (size_t i = 0; i < resources.size(); i++)
+		if (matchesJob(job, getResourceFileName(resources, i, resources.getType(i))))
+			indices.push_back(resources.getIndex(i));
+
+	Aurora::ArchiveExtractor extractor(archive.get(), getThreadCount(job));
+
+	const size_t extracted = extractor.extract(indices, job.outputDirectory);
+
+	const Aurora::ArchiveExtractor::FailureList &failures = extractor.getFailures();
+	for (Aurora::ArchiveExtractor::FailureList::const_iterator f = failures.begin(); f != failures.end(); ++f) {
+		Common::Exception e(f->error);
+
+		Common::printException(e, "WARNING: ");
+	}
+
+	std::printf("Extracted %u of %u resources into \"%s\"\n", (uint)extracted, (uint)indices.size(),
+	            job.outputDirectory.c_str());
+
+	if (!failures.empty())
+		throw Common::Exception("Failed to extract %u resources", (uint)failures.size());
+}
+
+/** Converts image and sound resources of an archive, using several threads. */
+class ResourceConverter : boost::noncopyable {
+public:
+	/** A resource waiting to be converted. */
+	struct Conversion {
+		uint32 index; ///< The resource's local index within the archive.
+
+		Aurora::FileType     fileType;     ///< The resource's file type.
+		Aurora::ResourceType resourceType; ///< Is the resource an image or a sound?
+
+		Common::UString path; ///< The file to write the converted resource to.
+	};
+
+	ResourceConverter(const Aurora::Archive &archive, const std::vector<Conversion> &conversions) :
+		_archive(&archive), _conversions(&conversions), _next(0), _converted(0), _failed(0) {
+	}
+
+	/** Convert all resources. @return The number of successfully converted resources. */
+	size_t run(size_t threadCount) {
+		threadCount = MIN<size_t>(threadCount, _conversions->size());
+		if (threadCount <= 1) {
+			work();
+			return _converted.load();
+		}
+
+		// The calling thread converts resources as well
+		boost::thread_group threads;
+		for (size_t i = 1; i < threadCount; i++)
+			threads.create_thread([this]() { work(); });
+
+		work();
+
+		threads.join_all();
+
+		return _converted.load();
+	}
+
+	/** Return the number of resources that failed to convert. */
+	size_t getFailed() const {
+		return _failed.load();
+	}
+
+private:
+	const Aurora::Archive *_archive;
+	const std::vector<Conversion> *_conversions;
+
+	boost::atomic<size_t> _next;
+	boost::atomic<size_t> _converted;
+	boost::atomic<size_t> _failed;
+
+	/** Keep the warnings of several threads from interleaving. */
+	Common::Mutex _printMutex;
+
+	void work() {
+		size_t n;
+		while ((n = _next.fetch_add(1)) < _conversions->size())
+			convert((*_conversions)[n]);
+	}
+
+	void convert(const Conversion &conversion) {
+		try {
+			Common::ScopedPtr<Common::SeekableReadStream> res(_archive->getResource(conversion.index, true));
+
+			if (conversion.resourceType == Aurora::kResourceImage) {
+				Common::ScopedPtr<Images::Decoder> image(Images::loadImage(*res, conversion.fileType));
+
+				image->dumpTGA(conversion.path);
+
+			} else {
+				Common::ScopedPtr<Sound::AudioStream> sound(Sound::SoundManager::makeAudioStream(res.get()));
+				res.release();
+
+				Common::WriteFile file(conversion.path);
+
+				Sound::dumpWAV(*sound, file);
+				file.flush();
+			}
+
+			_converted.fetch_add(1);
+			return;
+
+		} catch (Common::Exception &e) {
+			fail(e, conversion);
+		} catch (std::exception &e) {
+			Common::Exception se(e);
+
+			fail(se, conversion);
+		}
+	}
+
+	void fail(Common::Exception &e, const Conversion &conversion) {
+		_failed.fetch_add(1);
+
+		e.add("Failed converting resource %u to \"%s\"", conversion.index, conversion.path.c_str());
+
+		Common::StackLock lock(_printMutex);
+		Common::printException(e, "WARNING: ");
+	}
+};
+
+void convertArchive(const Job &job) {
+	BatchArchive archive(job.path);
+
+	const Aurora::ResourceTable &resources = archive.get().getResourceTable();
+
+	Common::FilePath::createDirectories(job.outputDirectory);
+
+	std::vector<ResourceConverter::Conversion> conversions;
+	std::set<Common::UString> paths;
+
+	for (size_t i = 0; i < resources.size(); i++) {
+		ResourceConverter::Conversion conversion;
+
+		conversion.index        = resources.getIndex(i);
+		conversion.fileType     = resources.getType(i);
+		conversion.resourceType = TypeMan.getResourceType(conversion.fileType);
+
+		Aurora::FileType targetType;
+		if      (conversion.resourceType == Aurora::kResourceImage)
+			targetType = Aurora::kFileTypeTGA;
+		else if (conversion.resourceType == Aurora::kResourceSound)
+			targetType = Aurora::kFileTypeWAV;
+		else
+			continue;
+
+		if (!matchesJob(job, getResourceFileName(resources, i, conversion.fileType)))
+			continue;
+
+		conversion.path = job.outputDirectory + "/" + getResourceFileName(resources, i, targetType);
+
+		// Several resources, like foo.tpc and foo.dds, might end up in the same file
+		if (!paths.insert(conversion.path).second)
+			continue;
+
+		conversions.push_back(conversion);
+	}
+
+	ResourceConverter converter(archive.get(), conversions);
+
+	const size_t converted = converter.run(getThreadCount(job));
+
+	std::printf("Converted %u of %u resources into \"%s\"\n", (uint)converted, (uint)conversions.size(),
+	            job.outputDirectory.c_str());
+
+	if (converter.getFailed() > 0)
+		throw Common::Exception("Failed to convert %u resources", (uint)converter.getFailed());
+}
+
+/** Print a group of resource copies with the same contents. */
+static void printCopies(const Aurora::FingerprintIndex::FingerprintList &copies) {
+	const Aurora::FingerprintIndex::Fingerprint &first = *copies.front();
+
+	Common::UString digest;
+	for (size_t i = 0; i < Common::kMD5Length; i++)
+		digest += Common::UString::format("%02x", first.digest[i]);
+
+	std::printf("  %10s  %s\n", Common::composeString(first.size).c_str(), digest.c_str());
+
+	for (Aurora::FingerprintIndex::FingerprintList::const_iterator c = copies.begin(); c != copies.end(); ++c) {
+		if ((*c)->index == Aurora::FingerprintIndex::kLooseFile)
+			std::printf("                %s\n", (*c)->location.c_str());
+		else
+			std::printf("                %s (resource %u)\n", (*c)->location.c_str(), (*c)->index);
+	}
+}
+
+void findDuplicates(const Job &job) {
+	// Unchanged archives and files are not hashed again
+	Aurora::FingerprintIndex index(Aurora::FingerprintIndex::getDefaultIndexFile(job.path), getThreadCount(job));
+	index.load();
+
+	const size_t hashed = index.addPath(job.path);
+
+	const Aurora::FingerprintIndex::FailureList &failures = index.getFailures();
+	for (Aurora::FingerprintIndex::FailureList::const_iterator f = failures.begin(); f != failures.end(); ++f) {
+		Common::Exception e(f->error);
+
+		Common::printException(e, "WARNING: ");
+	}
+
+	try {
+		index.save();
+	} catch (Common::Exception &e) {
+		Common::printException(e, "WARNING: ");
+	}
+
+	std::printf("Fingerprinted %u new or changed of %u resources in %u archives and files\n",
+	            (uint)hashed, (uint)index.getFingerprintCount(), (uint)index.getLocationCount());
+
+	uint64 duplicatedSize = 0;
+	size_t duplicated = 0, differing = 0;
+
+	const Aurora::FingerprintIndex::FingerprintGroups duplicates = index.findDuplicates();
+	for (Aurora::FingerprintIndex::FingerprintGroups::const_iterator d = duplicates.begin();
+	     d != duplicates.end(); ++d) {
+
+		const Aurora::FingerprintIndex::Fingerprint &first = *d->front();
+		if (!matchesJob(job, TypeMan.setFileType(first.name, first.type)))
+			continue;
+
+		std::printf("\nIdentical copies of %s:\n", TypeMan.setFileType(first.name, first.type).c_str());
+		printCopies(*d);
+
+		duplicatedSize += (uint64) first.size * (d->size() - 1);
+		duplicated++;
+	}
+
+	const std::vector<Aurora::FingerprintIndex::FingerprintGroups> differences = index.findDifferences();
+	for (std::vector<Aurora::FingerprintIndex::FingerprintGroups>::const_iterator d = differences.begin();
+	     d != differences.end(); ++d) {
+
+		const Aurora::FingerprintIndex::Fingerprint &first = *d->front().front();
+		if (!matchesJob(job, TypeMan.setFileType(first.name, first.type)))
+			continue;
+
+		std::printf("\nDiffering copies of %s:\n", TypeMan.setFileType(first.name, first.type).c_str());
+		for (Aurora::FingerprintIndex::FingerprintGroups::const_iterator g = d->begin(); g != d->end(); ++g)
+			printCopies(*g);
+
+		differing++;
+	}
+
+	std::printf("\n%u resources with identical copies, %s bytes duplicated\n", (uint)duplicated,
+	            Common::composeString(duplicatedSize).c_str());
+	std::printf("%u resources with differing copies\n", (uint)differing);
+}
+
+void collectNames(const Job &job) {
+	const Common::UString path = Common::FilePath::canonicalize(job.path);
+
+	std::list<Common::UString> files;
+	if (Common::FilePath::isDirectory(path)) {
+		const Common::FileList list(path, -1);
+
+		// Within a directory, only archives are looked at
+		for (Common::FileList::const_iterator f = list.begin(); f != list.end(); ++f)
+			if (TypeMan.getResourceType(*f) == Aurora::kResourceArchive)
+				files.push_back(*f);
+
+	} else if (Common::FilePath::isRegularFile(path))
+		files.push_back(path);
+	else
+		throw Common::Exception("No such file or directory \"%s\"", job.path.c_str());
+
+	const Common::UString dictionaryFile = Aurora::NameDictionary::getDefaultDictionaryFile();
+
+	Aurora::NameDictionary dictionary;
+	dictionary.load(dictionaryFile);
+
+	const size_t oldSize = dictionary.size();
+
+	for (std::list<Common::UString>::const_iterator f = files.begin(); f != files.end(); ++f) {
+		if (!matchesJob(job, Common::FilePath::getFile(*f)))
+			continue;
+
+		const Aurora::FileType type = TypeMan.getFileType(*f);
+
+		// The names in data files are found through their KEY files
+		if ((type == Aurora::kFileTypeBIF) || (type == Aurora::kFileTypeBZF))
+			continue;
+
+		try {
+			size_t added = 0;
+
+			if (TypeMan.getResourceType(type) == Aurora::kResourceArchive) {
+				BatchArchive archive(*f);
+
+				added = dictionary.addArchive(archive.get());
+			} else {
+				// Anything else is a list of names, one per line
+				Common::ScopedPtr<Common::SeekableReadStream> stream(Common::openReadFile(*f));
+
+				added = dictionary.addWordList(*stream);
+			}
+
+			std::printf("%s: %u new names\n", f->c_str(), (uint)added);
+
+		} catch (Common::Exception &e) {
+			e.add("Failed reading names from \"%s\"", f->c_str());
+
+			Common::printException(e, "WARNING: ");
+		}
+	}
+
+	dictionary.save(dictionaryFile);
+
+	std::printf("Added %u names, the dictionary now holds %u names\n",
+	            (uint)(dictionary.size() - oldSize), (uint)dictionary.size());
+}
@@ -0,0 +1,41 @@
+/* Phaethon - A FLOSS resource explorer for BioWare's Aurora engine games
+ *
+ * Phaethon is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * Phaethon is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * Phaethon is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Phaethon. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  Archive operations run from the command line, without the GUI.
+ */
+
+#ifndef BATCH_H
+#define BATCH_H
+
+struct Job;
+
+/** List the resources of the job's archive, with their sizes and types. */
+void listArchive(const Job &job);
+/** Extract the resources of the job's archive into its output directory. */
+void extractArchive(const Job &job);
+/** Convert the image and sound resources of the job's archive into TGA and WAV files. */
+void convertArchive(const Job &job);
+/** Find resources with several identical or differing copies within the job's path. */
+void findDuplicates(const Job &job);
+/** Add the resource names in the job's archives or word list to the name dictionary. */
+void collectNames(const Job &job);
+
+#endif // BATCH_H
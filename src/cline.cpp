@@ -22,13 +22,84 @@
  *  Command line handling.
  */
 
+#include "src/common/error.h"
+#include "src/common/strutil.h"
+
 #include "src/version/version.h"
 
 #include "src/cline.h"
 
+/** Does this operation run on several threads? */
+static bool usesThreads(Operation operation) {
+	return (operation == kOperationExtract) || (operation == kOperationConvert) ||
+	       (operation == kOperationDuplicates);
+}
+
+/** Does this operation write files into an output directory? */
+static bool usesOutputDirectory(Operation operation) {
+	return (operation == kOperationExtract) || (operation == kOperationConvert);
+}
+
+static bool parseArchiveCommandLine(const std::vector<Common::UString> &argv, Job &job) {
+	// Go through all arguments after the operation
+	for (size_t i = 2; i < argv.size(); i++) {
+		if        (argv[i] == Common::UString("-j")) {
+			// Don't silently ignore options the operation has no use for
+			if (!usesThreads(job.operation) || (++i >= argv.size()))
+				return false;
+
+			try {
+				Common::parseString(argv[i], job.threadCount);
+			} catch (Common::Exception &) {
+				return false;
+			}
+
+			if (job.threadCount == 0)
+				return false;
+
+			continue;
+		} else if (argv[i] == Common::UString("-o")) {
+			if (!usesOutputDirectory(job.operation) || (++i >= argv.size()))
+				return false;
+
+			job.outputDirectory = argv[i];
+			continue;
+		}
+
+		// The first argument is the archive or path, all others are patterns
+		if (job.path.empty())
+			job.path = argv[i];
+		else
+			job.globs.push_back(argv[i]);
+	}
+
+	return !job.path.empty();
+}
+
 Job parseCommandLine(const std::vector<Common::UString> &argv) {
 	Job job;
 
+	// Operations working on an archive without a GUI
+	if (argv.size() > 1) {
+		if      (argv[1] == Common::UString("list"))
+			job.operation = kOperationList;
+		else if (argv[1] == Common::UString("extract"))
+			job.operation = kOperationExtract;
+		else if (argv[1] == Common::UString("convert"))
+			job.operation = kOperationConvert;
+		else if (argv[1] == Common::UString("duplicates"))
+			job.operation = kOperationDuplicates;
+		else if (argv[1] == Common::UString("names"))
+			job.operation = kOperationNames;
+
+		if (job.operation != kOperationInvalid) {
+			if (!parseArchiveCommandLine(argv, job))
+				job.operation = kOperationInvalid;
+
+			return job;
+		}
+	}
+
 	// No options at all means we operate on an empty path
 	job.operation = kOperationPath;
 
@@ -72,8 +143,27 @@ Common::UString createHelpText(const Common::UString &name) {
 	text += Common::UString::format("%s - A FLOSS resource explorer for BioWare's Aurora engine games\n",
 	                                Version::getProjectName());
 	text += Common::UString::format("Usage: %s [options] [<path>]\n", name.c_str());
+	text += Common::UString::format("       %s list <archive> [<glob> ...]\n", name.c_str());
+	text += Common::UString::format("       %s extract [-j <n>] [-o <dir>] <archive> [<glob> ...]\n", name.c_str());
+	text += Common::UString::format("       %s convert [-j <n>] [-o <dir>] <archive> [<glob> ...]\n", name.c_str());
+	text += Common::UString::format("       %s duplicates [-j <n>] <path> [<glob> ...]\n", name.c_str());
+	text += Common::UString::format("       %s names <path> [<glob> ...]\n", name.c_str());
 	text += Common::UString::format("  -h      --help              Display this text and exit.\n");
-	text += Common::UString::format("  -v      --version           Display version information and exit.");
+	text += Common::UString::format("  -v      --version           Display version information and exit.\n");
+	text += Common::UString::format("\n");
+	text += Common::UString::format("Archive operations, run without starting the GUI:\n");
+	text += Common::UString::format("  list                        List the resources with their sizes and types.\n");
+	text += Common::UString::format("  extract                     Extract the resources.\n");
+	text += Common::UString::format("  convert                     Convert images to TGA and sounds to WAV.\n");
+	text += Common::UString::format("  duplicates                  Find resources in all archives and files within\n");
+	text += Common::UString::format("                              path that have identical or differing copies.\n");
+	text += Common::UString::format("  names                       Add the resource names in all archives within\n");
+	text += Common::UString::format("                              path, or the names listed in a text file, to\n");
+	text += Common::UString::format("                              the dictionary used to recover hashed names.\n");
+	text += Common::UString::format("  -j <n>                      Use n threads. Default: one per processor core.\n");
+	text += Common::UString::format("  -o <dir>                    Write the files into dir. Default: \".\".\n");
+	text += Common::UString::format("  <glob>                      Only work on resources matching this pattern.\n");
+	text += Common::UString::format("                              \"*\" matches anything, \"?\" any single character.");
 
 	return text;
 }
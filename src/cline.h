@@ -34,15 +34,25 @@ enum Operation {
 	kOperationInvalid = 0, ///< Invalid command line.
 	kOperationHelp       , ///< Show the help text.
 	kOperationVersion    , ///< Show version information.
-	kOperationPath         ///< Crawl through a game directory.
+	kOperationPath       , ///< Crawl through a game directory.
+	kOperationList       , ///< List the resources of an archive.
+	kOperationExtract    , ///< Extract resources of an archive.
+	kOperationConvert    , ///< Convert image and sound resources of an archive.
+	kOperationDuplicates , ///< Find duplicated and differing resources in a game directory.
+	kOperationNames        ///< Collect resource names into the name dictionary.
 };
 
 /** Full description of the job this tool will be doing. */
 struct Job {
 	Operation operation;  ///< The operation to perform.
-	Common::UString path; ///< The game directory to look through.
+	Common::UString path; ///< The game directory to look through, or the archive to work on.
 
-	Job() : operation(kOperationInvalid) {
+	std::vector<Common::UString> globs; ///< Only work on resources matching these patterns.
+
+	Common::UString outputDirectory; ///< The directory to write extracted files into.
+	size_t threadCount;              ///< The number of threads to use. 0 means one per core.
+
+	Job() : operation(kOperationInvalid), outputDirectory("."), threadCount(0) {
 	}
 };
 
@@ -23,10 +23,16 @@
  */
 
 #include <cassert>
+#include <cstring>
+#include <map>
+#include <list>
+
+#include <boost/thread.hpp>
 
 #include "src/common/util.h"
 #include "src/common/error.h"
 #include "src/common/scopedptr.h"
+#include "src/common/mutex.h"
 #include "src/common/memreadstream.h"
 #include "src/common/blowfish.h"
 
@@ -69,27 +75,9 @@ enum Mode {
 
 static const size_t kMinKeyLength =  4;
 static const size_t kMaxKeyLength = 56;
-static const size_t kRoundCount   = 16;
+static const size_t kRoundCount   = BlowfishContext::kRoundCount;
 static const size_t kBlockSize    =  8;
 
-struct BlowfishContext {
-	uint32 P[kRoundCount + 2]; ///< Blowfish round keys.
-	uint32 S[4][256];          ///< Key-dependant S-boxes.
-
-	BlowfishContext() {
-		std::memset(P, 0, sizeof(P));
-		std::memset(S, 0, sizeof(S));
-	}
-
-	~BlowfishContext() {
-		/* We don't care about security here, so we do *not* zeroize the buffers.
-		 * Residuals of the encryption/decryption *will* be left in memory!
-		 *
-		 * WARNING: DO NOT USE THIS CODE IN SECURITY RELEVANT SITUATIONS!
-		 */
-	}
-};
-
 static const uint32 P[kRoundCount + 2] = {
 	0x243F6A88, 0x85A308D3, 0x13198A2E, 0x03707344, 0xA4093822, 0x299F31D0, 0x082EFA98, 0xEC4E6C89,
 	0x452821E6, 0x38D01377, 0xBE5466CF, 0x34E90C6C, 0xC0AC29B7, 0xC97C50DD, 0x3F84D5B5, 0xB5470917,
@@ -244,7 +232,7 @@ static uint32 F(const BlowfishContext &ctx, uint32 x) {
 	return ((ctx.S[0][a] + ctx.S[1][b]) ^ ctx.S[2][c]) + ctx.S[3][d];
 }
 
-static void blowfishEnc(BlowfishContext &ctx, uint32 &xl, uint32 &xr) {
+static void blowfishEnc(const BlowfishContext &ctx, uint32 &xl, uint32 &xr) {
 	for (size_t i = 0; i < kRoundCount; i++) {
 		xl = xl ^ ctx.P[i];
 		xr = F(ctx, xl) ^ xr;
@@ -258,7 +246,7 @@ static void blowfishEnc(BlowfishContext &ctx, uint32 &xl, uint32 &xr) {
 	xl = xl ^ ctx.P[kRoundCount + 1];
 }
 
-static void blowfishDec(BlowfishContext &ctx, uint32 &xl, uint32 &xr) {
+static void blowfishDec(const BlowfishContext &ctx, uint32 &xl, uint32 &xr) {
 	for (size_t i = kRoundCount + 1; i > 1; i--) {
 		xl = xl ^ ctx.P[i];
 		xr = F(ctx, xl) ^ xr;
@@ -314,7 +302,23 @@ static void blowfishSetKey(BlowfishContext &ctx, const byte *key, size_t keyLeng
 	}
 }
 
-static void blowfishECB(BlowfishContext &ctx, Mode mode, const byte *input, byte *output) {
+BlowfishContext::BlowfishContext(const byte *key, size_t keyLength) {
+	blowfishSetKey(*this, key, keyLength);
+}
+
+BlowfishContext::BlowfishContext(const std::vector<byte> &key) {
+	blowfishSetKey(*this, key.empty() ? 0 : &key[0], key.size());
+}
+
+BlowfishContext::~BlowfishContext() {
+	/* We don't care about security here, so we do *not* zeroize the buffers.
+	 * Residuals of the encryption/decryption *will* be left in memory!
+	 *
+	 * WARNING: DO NOT USE THIS CODE IN SECURITY RELEVANT SITUATIONS!
+	 */
+}
+
+static void blowfishECB(const BlowfishContext &ctx, Mode mode, const byte *input, byte *output) {
 	uint32 X0 = READ_BE_UINT32(input);
 	uint32 X1 = READ_BE_UINT32(input + 4);
 
@@ -335,47 +339,328 @@ static void blowfishECB(BlowfishContext &ctx, Mode mode, const byte *input, byte
 }
 // '--- Blowfish, based on the implementation from mbed TLS ---'
 
-MemoryReadStream *blowfishEBC(SeekableReadStream &input, const std::vector<byte> &key, Mode mode) {
-	BlowfishContext ctx;
+/** The maximum number of key schedules kept in the cache. */
+static const size_t kMaxCachedContexts = 64;
+
+/** The most recently used key schedules, keyed by their keys. */
+class BlowfishContextCache : boost::noncopyable {
+public:
+	BlowfishContextPtr get(const std::vector<byte> &key) {
+		{
+			StackLock lock(_mutex);
+
+			ContextMap::iterator c = _contexts.find(key);
+			if (c != _contexts.end()) {
+				_usage.splice(_usage.begin(), _usage, c->second.second);
+				return c->second.first;
+			}
+		}
 
-	blowfishSetKey(ctx, &key[0], key.size());
+		// Compute the schedule without holding the lock, so that several can be computed at once
+		BlowfishContextPtr ctx(new BlowfishContext(key));
 
-	size_t inputSize = input.size() - input.pos();
+		StackLock lock(_mutex);
 
-	// Round up to the next multiple of the block size
-	const size_t outputSize = ((inputSize + kBlockSize - 1) / kBlockSize) * kBlockSize;
+		// Another thread might have been faster
+		ContextMap::iterator c = _contexts.find(key);
+		if (c != _contexts.end())
+			return c->second.first;
 
-	ScopedArray<byte> output(new byte[outputSize]);
+		_usage.push_front(key);
+		_contexts.insert(std::make_pair(key, std::make_pair(ctx, _usage.begin())));
+
+		if (_contexts.size() > kMaxCachedContexts) {
+			_contexts.erase(_usage.back());
+			_usage.pop_back();
+		}
+
+		return ctx;
+	}
+
+private:
+	/** All cached keys, most recently used first. */
+	typedef std::list< std::vector<byte> > UsageList;
+	typedef std::map< std::vector<byte>, std::pair<BlowfishContextPtr, UsageList::iterator> > ContextMap;
+
+	ContextMap _contexts;
+	UsageList  _usage;
+
+	Mutex _mutex;
+};
+
+BlowfishContextPtr getBlowfishContext(const std::vector<byte> &key) {
+	static BlowfishContextCache cache;
+
+	return cache.get(key);
+}
+
+/** The number of blocks run through Blowfish at the same time. */
+static const size_t kInterleaveCount = 4;
+
+/** The minimum amount of data worth handing to an extra thread. */
+static const size_t kMinThreadDataSize = 256 * 1024;
+
+/** Run several independent blocks through Blowfish at once, in place.
+ *
+ *  The rounds of all blocks are interleaved, so that the S-box lookups
+ *  of one block can overlap with those of the others, instead of each
+ *  round waiting on the lookups of the round before.
+ */
+template<Mode mode>
+static void blowfishECBInterleaved(const BlowfishContext &ctx, byte *data) {
+	uint32 xl[kInterleaveCount], xr[kInterleaveCount];
+
+	for (size_t b = 0; b < kInterleaveCount; b++) {
+		xl[b] = READ_BE_UINT32(data + b * kBlockSize);
+		xr[b] = READ_BE_UINT32(data + b * kBlockSize + 4);
+	}
+
+	for (size_t i = 0; i < kRoundCount; i++) {
+		const uint32 p = ctx.P[(mode == kModeEncrypt) ? i : (kRoundCount + 1 - i)];
+
+		for (size_t b = 0; b < kInterleaveCount; b++) {
+			xl[b] = xl[b] ^ p;
+			xr[b] = F(ctx, xl[b]) ^ xr[b];
+
+			SWAP(xl[b], xr[b]);
+		}
+	}
+
+	// Undo the last swap while writing
+	const uint32 pR = ctx.P[(mode == kModeEncrypt) ? kRoundCount     : 1];
+	const uint32 pL = ctx.P[(mode == kModeEncrypt) ? kRoundCount + 1 : 0];
+
+	for (size_t b = 0; b < kInterleaveCount; b++) {
+		WRITE_BE_UINT32(data + b * kBlockSize    , xr[b] ^ pL);
+		WRITE_BE_UINT32(data + b * kBlockSize + 4, xl[b] ^ pR);
+	}
+}
+
+/** Run the Blowfish algorithm in EBC mode over whole blocks, in place, on this thread. */
+static void blowfishEBCRange(const BlowfishContext &ctx, Mode mode, byte *data, size_t size) {
+	assert((size % kBlockSize) == 0);
+
+	static const size_t kStride = kInterleaveCount * kBlockSize;
+
+	for (; size >= kStride; data += kStride, size -= kStride) {
+		if (mode == kModeEncrypt)
+			blowfishECBInterleaved<kModeEncrypt>(ctx, data);
+		else
+			blowfishECBInterleaved<kModeDecrypt>(ctx, data);
+	}
+
+	for (; size > 0; data += kBlockSize, size -= kBlockSize)
+		blowfishECB(ctx, mode, data, data);
+}
 
-	byte buffer[kBlockSize];
-	byte *data = output.get();
-	while (inputSize > 0) {
-		const size_t toRead = MIN<size_t>(inputSize, kBlockSize);
+/** Run the Blowfish algorithm in EBC mode over whole blocks, in place.
+ *
+ *  The blocks are independent of each other, so large amounts of data
+ *  are split across up to threadCount threads.
+ */
+static void blowfishEBC(const BlowfishContext &ctx, Mode mode, byte *data, size_t size, size_t threadCount) {
+	assert((size % kBlockSize) == 0);
 
-		if (input.read(buffer, toRead) != toRead)
-			throw Exception(kReadError);
+	threadCount = MIN<size_t>(threadCount, size / kMinThreadDataSize);
+	if (threadCount <= 1) {
+		blowfishEBCRange(ctx, mode, data, size);
+		return;
+	}
 
-		if (toRead < kBlockSize)
-			std::memset(buffer + toRead, 0, kBlockSize - toRead);
+	const size_t blockCount = size / kBlockSize;
+	const size_t chunkSize  = ((blockCount + threadCount - 1) / threadCount) * kBlockSize;
 
-		blowfishECB(ctx, mode, buffer, data);
+	boost::thread_group threads;
+	for (size_t offset = chunkSize; offset < size; offset += chunkSize) {
+		byte *chunk = data + offset;
+		const size_t chunkLength = MIN<size_t>(chunkSize, size - offset);
 
-		data      += toRead;
-		inputSize -= toRead;
+		threads.create_thread([&ctx, mode, chunk, chunkLength]() {
+			blowfishEBCRange(ctx, mode, chunk, chunkLength);
+		});
 	}
 
+	// The calling thread takes care of the first chunk itself
+	blowfishEBCRange(ctx, mode, data, chunkSize);
+
+	threads.join_all();
+}
+
+static MemoryReadStream *blowfishEBC(SeekableReadStream &input, const std::vector<byte> &key, Mode mode,
+                                     size_t threadCount) {
+	const BlowfishContextPtr ctx = getBlowfishContext(key);
+
+	const size_t inputSize = input.size() - input.pos();
+
+	// Round up to the next multiple of the block size
+	const size_t outputSize = ((inputSize + kBlockSize - 1) / kBlockSize) * kBlockSize;
+
+	ScopedArray<byte> output(new byte[outputSize]);
+
+	// Read everything in one go, then work on it in place
+	if (input.read(output.get(), inputSize) != inputSize)
+		throw Exception(kReadError);
+
+	std::memset(output.get() + inputSize, 0, outputSize - inputSize);
+
+	blowfishEBC(*ctx, mode, output.get(), outputSize, threadCount);
+
 	return new MemoryReadStream(output.release(), outputSize, true);
 }
 
-MemoryReadStream *encryptBlowfishEBC(SeekableReadStream &input, const std::vector<byte> &key) {
-	return blowfishEBC(input, key, kModeEncrypt);
+MemoryReadStream *encryptBlowfishEBC(SeekableReadStream &input, const std::vector<byte> &key,
+                                     size_t threadCount) {
+
+	return blowfishEBC(input, key, kModeEncrypt, threadCount);
 }
 
-MemoryReadStream *decryptBlowfishEBC(SeekableReadStream &input, const std::vector<byte> &key) {
+MemoryReadStream *decryptBlowfishEBC(SeekableReadStream &input, const std::vector<byte> &key,
+                                     size_t threadCount) {
+
 	if ((input.size() % 8) != 0)
 		throw Exception("Blowfish operates on blocks of 8 bytes (%u)", (uint) input.size());
 
-	return blowfishEBC(input, key, kModeDecrypt);
+	return blowfishEBC(input, key, kModeDecrypt, threadCount);
+}
+
+void encryptBlowfishEBC(byte *data, size_t size, const std::vector<byte> &key, size_t threadCount) {
+	encryptBlowfishEBC(data, size, *getBlowfishContext(key), threadCount);
+}
+
+void decryptBlowfishEBC(byte *data, size_t size, const std::vector<byte> &key, size_t threadCount) {
+	decryptBlowfishEBC(data, size, *getBlowfishContext(key), threadCount);
+}
+
+void encryptBlowfishEBC(byte *data, size_t size, const BlowfishContext &ctx, size_t threadCount) {
+	if ((size % kBlockSize) != 0)
+		throw Exception("Blowfish operates on blocks of 8 bytes (%u)", (uint) size);
+
+	blowfishEBC(ctx, kModeEncrypt, data, size, threadCount);
+}
+
+void decryptBlowfishEBC(byte *data, size_t size, const BlowfishContext &ctx, size_t threadCount) {
+	if ((size % kBlockSize) != 0)
+		throw Exception("Blowfish operates on blocks of 8 bytes (%u)", (uint) size);
+
+	blowfishEBC(ctx, kModeDecrypt, data, size, threadCount);
+}
+
+
+BlowfishReadStream::BlowfishReadStream(SeekableReadStream *input, const std::vector<byte> &key,
+                                       bool disposeInput) :
+	_input(input, disposeInput), _size(0), _pos(0), _eos(false) {
+
+	assert(input);
+
+	checkSize();
+
+	_ctx = getBlowfishContext(key);
+}
+
+BlowfishReadStream::BlowfishReadStream(SeekableReadStream *input, BlowfishContextPtr ctx,
+                                       bool disposeInput) :
+	_input(input, disposeInput), _ctx(ctx), _size(0), _pos(0), _eos(false) {
+
+	assert(input && ctx);
+
+	checkSize();
+}
+
+BlowfishReadStream::~BlowfishReadStream() {
+}
+
+void BlowfishReadStream::checkSize() {
+	_size = _input->size();
+	if ((_size % kBlockSize) != 0)
+		throw Exception("Blowfish operates on blocks of 8 bytes (%u)", (uint) _size);
+}
+
+bool BlowfishReadStream::eos() const {
+	return _eos;
+}
+
+size_t BlowfishReadStream::pos() const {
+	return _pos;
+}
+
+size_t BlowfishReadStream::size() const {
+	return _size;
+}
+
+void BlowfishReadStream::readBlocks(size_t offset, byte *data, size_t size) const {
+	if (_input->readAt(offset, data, size) != size)
+		throw Exception(kReadError);
+
+	blowfishEBCRange(*_ctx, kModeDecrypt, data, size);
+}
+
+size_t BlowfishReadStream::readAt(size_t offset, void *dataPtr, size_t dataSize) const {
+	assert(dataPtr);
+
+	if (offset >= _size)
+		return 0;
+
+	dataSize = MIN(dataSize, _size - offset);
+
+	byte  *data = static_cast<byte *>(dataPtr);
+	size_t left = dataSize;
+
+	// Start in the middle of a block
+	const size_t head = offset % kBlockSize;
+	if ((head != 0) && (left > 0)) {
+		byte block[kBlockSize];
+		readBlocks(offset - head, block, kBlockSize);
+
+		const size_t n = MIN(kBlockSize - head, left);
+		std::memcpy(data, block + head, n);
+
+		data += n;
+		offset += n;
+		left -= n;
+	}
+
+	// Whole blocks are decrypted right where they were read into
+	const size_t whole = left - (left % kBlockSize);
+	if (whole > 0) {
+		readBlocks(offset, data, whole);
+
+		data += whole;
+		offset += whole;
+		left -= whole;
+	}
+
+	// End in the middle of a block
+	if (left > 0) {
+		byte block[kBlockSize];
+		readBlocks(offset, block, kBlockSize);
+
+		std::memcpy(data, block, left);
+	}
+
+	return dataSize;
+}
+
+size_t BlowfishReadStream::read(void *dataPtr, size_t dataSize) {
+	const size_t readSize = readAt(_pos, dataPtr, dataSize);
+
+	_pos += readSize;
+	if (readSize < dataSize)
+		_eos = true;
+
+	return readSize;
+}
+
+size_t BlowfishReadStream::seek(ptrdiff_t offset, Origin whence) {
+	const size_t oldPos = _pos;
+	const size_t newPos = evalSeek(offset, whence, _pos, 0, _size);
+	if (newPos > _size)
+		throw Exception(kSeekError);
+
+	_pos = newPos;
+
+	_eos = false; // reset eos on successful seek
+
+	return oldPos;
 }
 
 } // End of namespace Common
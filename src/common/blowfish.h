@@ -27,17 +27,122 @@
 
 #include <vector>
 
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
 #include "src/common/types.h"
+#include "src/common/disposableptr.h"
+#include "src/common/readstream.h"
 
 namespace Common {
 
-class SeekableReadStream;
 class MemoryReadStream;
 
+/** The key schedule of the Blowfish algorithm.
+ *
+ *  Computing the key schedule takes about as long as encrypting 4KB
+ *  of data. A context is therefore best created once per key and then
+ *  reused. It is never modified after its creation, so it can be used
+ *  by several threads at once.
+ */
+struct BlowfishContext : boost::noncopyable {
+	static const size_t kRoundCount = 16; ///< The number of Blowfish rounds.
+
+	uint32 P[kRoundCount + 2]; ///< Blowfish round keys.
+	uint32 S[4][256];          ///< Key-dependant S-boxes.
+
+	/** Compute the key schedule for this key. */
+	BlowfishContext(const byte *key, size_t keyLength);
+	/** Compute the key schedule for this key. */
+	explicit BlowfishContext(const std::vector<byte> &key);
+	~BlowfishContext();
+};
+
+typedef boost::shared_ptr<const BlowfishContext> BlowfishContextPtr;
+
+/** Return the key schedule for this key.
+ *
+ *  The key schedules of the most recently used keys are cached, so that
+ *  they are only computed once. This function is thread-safe.
+ */
+BlowfishContextPtr getBlowfishContext(const std::vector<byte> &key);
+
+/* The functions working on whole buffers can split large amounts of data,
+ * at least 256KB per thread, across up to threadCount threads. By default,
+ * they only run on the calling thread; callers that already run several
+ * workers of their own should keep it that way. */
+
 /** Encrypt the stream with the Blowfish algorithm in EBC mode. */
-MemoryReadStream *encryptBlowfishEBC(SeekableReadStream &input, const std::vector<byte> &key);
+MemoryReadStream *encryptBlowfishEBC(SeekableReadStream &input, const std::vector<byte> &key,
+                                     size_t threadCount = 1);
 /** Decrypt the stream with the Blowfish algorithm in EBC mode. */
-MemoryReadStream *decryptBlowfishEBC(SeekableReadStream &input, const std::vector<byte> &key);
+MemoryReadStream *decryptBlowfishEBC(SeekableReadStream &input, const std::vector<byte> &key,
+                                     size_t threadCount = 1);
+
+/** Encrypt data in place with the Blowfish algorithm in EBC mode.
+ *
+ *  The size of the data has to be a multiple of Blowfish's block size of 8 bytes.
+ */
+void encryptBlowfishEBC(byte *data, size_t size, const std::vector<byte> &key, size_t threadCount = 1);
+/** Decrypt data in place with the Blowfish algorithm in EBC mode.
+ *
+ *  The size of the data has to be a multiple of Blowfish's block size of 8 bytes.
+ */
+void decryptBlowfishEBC(byte *data, size_t size, const std::vector<byte> &key, size_t threadCount = 1);
+
+/** Encrypt data in place with an existing Blowfish key schedule. */
+void encryptBlowfishEBC(byte *data, size_t size, const BlowfishContext &ctx, size_t threadCount = 1);
+/** Decrypt data in place with an existing Blowfish key schedule. */
+void decryptBlowfishEBC(byte *data, size_t size, const BlowfishContext &ctx, size_t threadCount = 1);
+
+/** A stream that decrypts Blowfish EBC data on the fly, while it is read.
+ *
+ *  In EBC mode, every block of 8 bytes is decrypted on its own. Reading from
+ *  any position only needs the blocks covering the data read, and the data
+ *  is decrypted right within the buffer it is read into.
+ *
+ *  The whole input stream is decrypted, and its size has to be a multiple of
+ *  the block size. The input stream is only read with readAt(), so readAt()
+ *  on this stream is as safe to call concurrently as on the input stream.
+ */
+class BlowfishReadStream : boost::noncopyable, public SeekableReadStream {
+public:
+	/** Create a BlowfishReadStream decrypting the input stream.
+	 *
+	 *  @param input         The stream with the encrypted data.
+	 *  @param key           The key to decrypt with.
+	 *  @param disposeInput  Should the input stream be deleted together with this stream?
+	 */
+	BlowfishReadStream(SeekableReadStream *input, const std::vector<byte> &key, bool disposeInput = true);
+	/** Create a BlowfishReadStream decrypting the input stream with an existing key schedule. */
+	BlowfishReadStream(SeekableReadStream *input, BlowfishContextPtr ctx, bool disposeInput = true);
+	~BlowfishReadStream();
+
+	bool eos() const;
+
+	size_t read(void *dataPtr, size_t dataSize);
+	size_t readAt(size_t offset, void *dataPtr, size_t dataSize) const;
+
+	size_t pos() const;
+	size_t size() const;
+
+	size_t seek(ptrdiff_t offset, Origin whence = kOriginBegin);
+
+private:
+	DisposablePtr<SeekableReadStream> _input;
+
+	BlowfishContextPtr _ctx;
+
+	size_t _size;
+	size_t _pos;
+
+	bool _eos;
+
+	void checkSize();
+
+	/** Read and decrypt whole blocks at this offset. */
+	void readBlocks(size_t offset, byte *data, size_t size) const;
+};
 
 } // End of namespace Common
 
@@ -0,0 +1,164 @@
+/* Phaethon - A FLOSS resource explorer for BioWare's Aurora engine games
+ *
+ * Phaethon is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * Phaethon is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * Phaethon is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Phaethon. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  A stream reading its parent stream in large blocks.
+ */
+
+#include <cassert>
+#include <cstring>
+
+#include "src/common/bufferedreadstream.h"
+#include "src/common/memreadstream.h"
+#include "src/common/util.h"
+#include "src/common/error.h"
+
+namespace Common {
+
+BufferedReadStream::BufferedReadStream(SeekableReadStream *parentStream, bool disposeParentStream,
+                                       size_t bufferSize) :
+	_parentStream(parentStream, disposeParentStream), _bufferSize(MAX<size_t>(bufferSize, 8)),
+	_window(0), _windowOffset(0), _bufferPos(0), _bufferEnd(0), _size(0), _eos(false) {
+
+	assert(_parentStream);
+
+	_size = _parentStream->size();
+
+	const size_t startPos = _parentStream->pos();
+
+	// A stream already in memory is its own window
+	const MemoryReadStream *memStream = dynamic_cast<const MemoryReadStream *>(_parentStream.get());
+	if (memStream) {
+		_window    = memStream->getData();
+		_bufferPos = _window + startPos;
+		_bufferEnd = _window + _size;
+
+		return;
+	}
+
+	_buffer.reset(new byte[_bufferSize]);
+
+	_window       = _buffer.get();
+	_windowOffset = startPos;
+	_bufferPos    = _window;
+	_bufferEnd    = _window;
+}
+
+BufferedReadStream::~BufferedReadStream() {
+}
+
+bool BufferedReadStream::eos() const {
+	return _eos;
+}
+
+size_t BufferedReadStream::pos() const {
+	return _windowOffset + (_bufferPos - _window);
+}
+
+size_t BufferedReadStream::size() const {
+	return _size;
+}
+
+bool BufferedReadStream::fill(size_t pos) {
+	// Memory streams have all their data in the window already
+	if (!_buffer)
+		return false;
+
+	_windowOffset = pos;
+	_bufferPos    = _window;
+	_bufferEnd    = _window;
+
+	if (pos >= _size)
+		return false;
+
+	const size_t readSize = _parentStream->readAt(pos, _buffer.get(), MIN(_bufferSize, _size - pos));
+
+	_bufferEnd = _window + readSize;
+
+	return readSize > 0;
+}
+
+size_t BufferedReadStream::read(void *dataPtr, size_t dataSize) {
+	assert(dataPtr);
+
+	byte *data = static_cast<byte *>(dataPtr);
+	size_t readSize = 0;
+
+	while (readSize < dataSize) {
+		const size_t available = _bufferEnd - _bufferPos;
+		if (available > 0) {
+			const size_t n = MIN(available, dataSize - readSize);
+
+			std::memcpy(data + readSize, _bufferPos, n);
+
+			_bufferPos += n;
+			readSize   += n;
+			continue;
+		}
+
+		// Large reads bypass the buffer
+		if (_buffer && ((dataSize - readSize) >= _bufferSize)) {
+			const size_t curPos = pos();
+			const size_t n = _parentStream->readAt(curPos, data + readSize, dataSize - readSize);
+
+			readSize += n;
+
+			// Continue behind the read data with an empty window
+			_windowOffset = curPos + n;
+			_bufferPos    = _window;
+			_bufferEnd    = _window;
+			break;
+		}
+
+		if (!fill(pos()))
+			break;
+	}
+
+	if (readSize != dataSize)
+		_eos = true;
+
+	return readSize;
+}
+
+size_t BufferedReadStream::readAt(size_t offset, void *dataPtr, size_t dataSize) const {
+	return _parentStream->readAt(offset, dataPtr, dataSize);
+}
+
+size_t BufferedReadStream::seek(ptrdiff_t offset, Origin whence) {
+	const size_t oldPos = pos();
+	const size_t newPos = evalSeek(offset, whence, oldPos, 0, _size);
+	if (newPos > _size)
+		throw Exception(kSeekError);
+
+	// Seeking within the current window doesn't need to read anything
+	if ((newPos >= _windowOffset) && (newPos <= (_windowOffset + (size_t)(_bufferEnd - _window))))
+		_bufferPos = _window + (newPos - _windowOffset);
+	else {
+		_windowOffset = newPos;
+		_bufferPos    = _window;
+		_bufferEnd    = _window;
+	}
+
+	_eos = false; // reset eos on successful seek
+
+	return oldPos;
+}
+
+} // End of namespace Common
@@ -0,0 +1,201 @@
+/* Phaethon - A FLOSS resource explorer for BioWare's Aurora engine games
+ *
+ * Phaethon is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * Phaethon is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * Phaethon is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Phaethon. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  A stream reading its parent stream in large blocks.
+ */
+
+#ifndef COMMON_BUFFEREDREADSTREAM_H
+#define COMMON_BUFFEREDREADSTREAM_H
+
+#include <boost/noncopyable.hpp>
+
+#include "src/common/types.h"
+#include "src/common/endianness.h"
+#include "src/common/scopedptr.h"
+#include "src/common/disposableptr.h"
+#include "src/common/readstream.h"
+
+namespace Common {
+
+/** A stream that reads its parent stream in large blocks, and serves small
+ *  reads out of that window.
+ *
+ *  Every readUint32LE() and friends on a plain stream is a virtual read() of
+ *  a few bytes, which on a ReadFile ends up as an fread() call. Parsing a
+ *  large table field by field that way is dominated by call overhead.
+ *
+ *  BufferedReadStream hides the integer read methods of ReadStream with inline
+ *  versions that read straight from the window. Code that wants to benefit from
+ *  those needs to call them on a BufferedReadStream, not through a reference to
+ *  the base class. All other reads go through read(), which is buffered as well.
+ *
+ *  If the parent stream is a MemoryReadStream (or a MappedReadFile), its data
+ *  is used as the window directly, without any copying.
+ *
+ *  The stream starts at the parent stream's current position, and positions
+ *  are those of the parent stream. The parent stream is only read with readAt(),
+ *  so its position is never changed.
+ */
+class BufferedReadStream : boost::noncopyable, public SeekableReadStream {
+public:
+	static const size_t kDefaultBufferSize = 64 * 1024;
+
+	/** Create a BufferedReadStream reading from the parent stream.
+	 *
+	 *  @param parentStream         The stream to read from.
+	 *  @param disposeParentStream  Should the parent stream be deleted together with this stream?
+	 *  @param bufferSize           The size of the blocks read from the parent stream.
+	 */
+	BufferedReadStream(SeekableReadStream *parentStream, bool disposeParentStream = false,
+	                   size_t bufferSize = kDefaultBufferSize);
+	~BufferedReadStream();
+
+	bool eos() const;
+
+	size_t read(void *dataPtr, size_t dataSize);
+	size_t readAt(size_t offset, void *dataPtr, size_t dataSize) const;
+
+	size_t pos() const;
+	size_t size() const;
+
+	size_t seek(ptrdiff_t offset, Origin whence = kOriginBegin);
+
+	// Inline fast paths, for reads that fit into the current window
+
+	byte readByte() {
+		if (_bufferPos == _bufferEnd)
+			return SeekableReadStream::readByte();
+
+		return *_bufferPos++;
+	}
+
+	int8 readSByte() {
+		return (int8)readByte();
+	}
+
+	uint16 readUint16LE() {
+		if ((size_t)(_bufferEnd - _bufferPos) < 2)
+			return SeekableReadStream::readUint16LE();
+
+		const uint16 val = READ_LE_UINT16(_bufferPos);
+		_bufferPos += 2;
+
+		return val;
+	}
+
+	uint32 readUint32LE() {
+		if ((size_t)(_bufferEnd - _bufferPos) < 4)
+			return SeekableReadStream::readUint32LE();
+
+		const uint32 val = READ_LE_UINT32(_bufferPos);
+		_bufferPos += 4;
+
+		return val;
+	}
+
+	uint64 readUint64LE() {
+		if ((size_t)(_bufferEnd - _bufferPos) < 8)
+			return SeekableReadStream::readUint64LE();
+
+		const uint64 val = READ_LE_UINT64(_bufferPos);
+		_bufferPos += 8;
+
+		return val;
+	}
+
+	uint16 readUint16BE() {
+		if ((size_t)(_bufferEnd - _bufferPos) < 2)
+			return SeekableReadStream::readUint16BE();
+
+		const uint16 val = READ_BE_UINT16(_bufferPos);
+		_bufferPos += 2;
+
+		return val;
+	}
+
+	uint32 readUint32BE() {
+		if ((size_t)(_bufferEnd - _bufferPos) < 4)
+			return SeekableReadStream::readUint32BE();
+
+		const uint32 val = READ_BE_UINT32(_bufferPos);
+		_bufferPos += 4;
+
+		return val;
+	}
+
+	uint64 readUint64BE() {
+		if ((size_t)(_bufferEnd - _bufferPos) < 8)
+			return SeekableReadStream::readUint64BE();
+
+		const uint64 val = READ_BE_UINT64(_bufferPos);
+		_bufferPos += 8;
+
+		return val;
+	}
+
+	int16 readSint16LE() {
+		return (int16)readUint16LE();
+	}
+
+	int32 readSint32LE() {
+		return (int32)readUint32LE();
+	}
+
+	int64 readSint64LE() {
+		return (int64)readUint64LE();
+	}
+
+	int16 readSint16BE() {
+		return (int16)readUint16BE();
+	}
+
+	int32 readSint32BE() {
+		return (int32)readUint32BE();
+	}
+
+	int64 readSint64BE() {
+		return (int64)readUint64BE();
+	}
+
+private:
+	DisposablePtr<SeekableReadStream> _parentStream;
+
+	/** Our own buffer, if the parent stream isn't backed by memory. */
+	ScopedArray<byte> _buffer;
+	size_t _bufferSize;
+
+	const byte *_window;   ///< The start of the current window.
+	size_t _windowOffset;  ///< The position of the current window within the stream.
+
+	const byte *_bufferPos; ///< The current position within the window.
+	const byte *_bufferEnd; ///< The end of the data in the window.
+
+	size_t _size;
+
+	bool _eos;
+
+	/** Read a new window, starting at this position. Return false if there's nothing left to read. */
+	bool fill(size_t pos);
+};
+
+} // End of namespace Common
+
+#endif // COMMON_BUFFEREDREADSTREAM_H
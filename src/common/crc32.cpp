@@ -0,0 +1,248 @@
+/* Phaethon - A FLOSS resource explorer for BioWare's Aurora engine games
+ *
+ * Phaethon is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * Phaethon is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * Phaethon is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Phaethon. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  Calculating the CRC32 checksum of raw data.
+ */
+
+#include "src/common/util.h"
+#include "src/common/scopedptr.h"
+#include "src/common/crc32.h"
+#include "src/common/hash.h"
+#include "src/common/readstream.h"
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+	#define HAVE_CRC32_PCLMUL 1
+
+	#include <cpuid.h>
+	#include <emmintrin.h>
+	#include <smmintrin.h>
+	#include <wmmintrin.h>
+#endif
+
+namespace Common {
+
+/** The size of the chunks a stream is read in. */
+static const size_t kStreamBufferSize = 65536;
+
+/* .--- Slice-by-8 CRC32 ---.
+ *
+ * Instead of one table lookup for each byte, slice-by-8 uses 8 tables to
+ * process 8 bytes with 8 independent lookups. Table n contains the CRC
+ * of each byte value, followed by n zero bytes. The first table is the
+ * same as the byte-wise table used for string hashing, kCRC32Tab.
+ */
+
+struct CRC32Tables {
+	uint32 table[8][256];
+
+	CRC32Tables() {
+		for (size_t i = 0; i < 256; i++)
+			table[0][i] = kCRC32Tab[i];
+
+		for (size_t n = 1; n < 8; n++)
+			for (size_t i = 0; i < 256; i++)
+				table[n][i] = (table[n - 1][i] >> 8) ^ table[0][table[n - 1][i] & 0xFF];
+	}
+};
+
+static const CRC32Tables &getCRC32Tables() {
+	static const CRC32Tables tables;
+
+	return tables;
+}
+
+/** Update the raw (not inverted) CRC32 state with the data, 8 bytes at a time. */
+static uint32 updateCRC32Slice8(uint32 crc, const byte *data, size_t size) {
+	const uint32 (&t)[8][256] = getCRC32Tables().table;
+
+	while (size >= 8) {
+		const uint32 one = READ_LE_UINT32(data) ^ crc;
+		const uint32 two = READ_LE_UINT32(data + 4);
+
+		crc = t[7][ one        & 0xFF] ^ t[6][(one >>  8) & 0xFF] ^
+		      t[5][(one >> 16) & 0xFF] ^ t[4][ one >> 24        ] ^
+		      t[3][ two        & 0xFF] ^ t[2][(two >>  8) & 0xFF] ^
+		      t[1][(two >> 16) & 0xFF] ^ t[0][ two >> 24        ];
+
+		data += 8;
+		size -= 8;
+	}
+
+	while (size-- > 0)
+		crc = t[0][(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+
+	return crc;
+}
+
+// '--- Slice-by-8 CRC32 ---'
+
+#ifdef HAVE_CRC32_PCLMUL
+
+/* .--- CRC32 by folding with carry-less multiplication ---.
+ *
+ * Based on Intel's white paper "Fast CRC Computation for Generic Polynomials
+ * Using PCLMULQDQ Instruction" by Vinodh Gopal et al. The data is folded
+ * into 4 128-bit accumulators 64 bytes at a time, these are folded into one,
+ * and the result is reduced to 32 bits with a Barrett reduction. The folding
+ * constants are for the bit-reflected polynomial 0x04C11DB7.
+ *
+ * Note that SSE4.2's CRC32 instruction is no help here: it calculates the
+ * CRC32C, with the Castagnoli polynomial 0x1EDC6F41.
+ */
+
+/** The minimum amount of data worth folding. */
+static const size_t kPCLMULMinSize = 64;
+
+/** Can this CPU do carry-less multiplication (and SSE4.1)? */
+static bool hasPCLMUL() {
+	unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+	if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+		return false;
+
+	return (ecx & bit_PCLMUL) && (ecx & bit_SSE4_1);
+}
+
+/** Update the raw CRC32 state with the data, size being a multiple of 16 and at least 64. */
+__attribute__((target("pclmul,sse4.1")))
+static uint32 updateCRC32PCLMUL(uint32 crc, const byte *data, size_t size) {
+	const __m128i kR2R1    = _mm_set_epi64x(0x00000001C6E41596LL, 0x0000000154442BD4LL);
+	const __m128i kR4R3    = _mm_set_epi64x(0x00000000CCAA009ELL, 0x00000001751997D0LL);
+	const __m128i kR5      = _mm_set_epi64x(0x0000000000000000LL, 0x0000000163CD6124LL);
+	const __m128i kRUPoly  = _mm_set_epi64x(0x00000001F7011641LL, 0x00000001DB710641LL);
+	const __m128i kMask32  = _mm_set_epi32(0, 0, 0, -1);
+
+	const __m128i *block = reinterpret_cast<const __m128i *>(data);
+
+	__m128i x1 = _mm_loadu_si128(block + 0);
+	__m128i x2 = _mm_loadu_si128(block + 1);
+	__m128i x3 = _mm_loadu_si128(block + 2);
+	__m128i x4 = _mm_loadu_si128(block + 3);
+
+	x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(crc));
+
+	block += 4;
+	size  -= 64;
+
+	// Fold 64 bytes at a time
+	while (size >= 64) {
+		const __m128i x5 = _mm_clmulepi64_si128(x1, kR2R1, 0x00);
+		const __m128i x6 = _mm_clmulepi64_si128(x2, kR2R1, 0x00);
+		const __m128i x7 = _mm_clmulepi64_si128(x3, kR2R1, 0x00);
+		const __m128i x8 = _mm_clmulepi64_si128(x4, kR2R1, 0x00);
+
+		x1 = _mm_clmulepi64_si128(x1, kR2R1, 0x11);
+		x2 = _mm_clmulepi64_si128(x2, kR2R1, 0x11);
+		x3 = _mm_clmulepi64_si128(x3, kR2R1, 0x11);
+		x4 = _mm_clmulepi64_si128(x4, kR2R1, 0x11);
+
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128(block + 0));
+		x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128(block + 1));
+		x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128(block + 2));
+		x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128(block + 3));
+
+		block += 4;
+		size  -= 64;
+	}
+
+	// Fold the 4 accumulators into one
+	__m128i x5;
+
+	x5 = _mm_clmulepi64_si128(x1, kR4R3, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, kR4R3, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), x2);
+
+	x5 = _mm_clmulepi64_si128(x1, kR4R3, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, kR4R3, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), x3);
+
+	x5 = _mm_clmulepi64_si128(x1, kR4R3, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, kR4R3, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), x4);
+
+	// Fold the remaining data 16 bytes at a time
+	while (size >= 16) {
+		x5 = _mm_clmulepi64_si128(x1, kR4R3, 0x00);
+		x1 = _mm_clmulepi64_si128(x1, kR4R3, 0x11);
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128(block));
+
+		block += 1;
+		size  -= 16;
+	}
+
+	// Fold 128 bits to 64 bits
+	x5 = _mm_clmulepi64_si128(kR4R3, x1, 0x01);
+	x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x5);
+
+	x5 = _mm_srli_si128(x1, 4);
+	x1 = _mm_clmulepi64_si128(_mm_and_si128(x1, kMask32), kR5, 0x00);
+	x1 = _mm_xor_si128(x1, x5);
+
+	// Barrett reduction of 64 bits to 32 bits
+	x5 = x1;
+	x1 = _mm_clmulepi64_si128(_mm_and_si128(x1, kMask32), kRUPoly, 0x10);
+	x1 = _mm_clmulepi64_si128(_mm_and_si128(x1, kMask32), kRUPoly, 0x00);
+	x1 = _mm_xor_si128(x1, x5);
+
+	return (uint32) _mm_extract_epi32(x1, 1);
+}
+
+// '--- CRC32 by folding with carry-less multiplication ---'
+
+#endif // HAVE_CRC32_PCLMUL
+
+uint32 updateCRC32(uint32 crc, const byte *data, size_t size) {
+	crc ^= 0xFFFFFFFF;
+
+#ifdef HAVE_CRC32_PCLMUL
+	static const bool pclmul = hasPCLMUL();
+
+	if (pclmul && (size >= kPCLMULMinSize)) {
+		const size_t folded = size & ~((size_t) 15);
+
+		crc = updateCRC32PCLMUL(crc, data, folded);
+
+		data += folded;
+		size -= folded;
+	}
+#endif
+
+	crc = updateCRC32Slice8(crc, data, size);
+
+	return crc ^ 0xFFFFFFFF;
+}
+
+uint32 calculateCRC32(const byte *data, size_t size) {
+	return updateCRC32(0, data, size);
+}
+
+uint32 calculateCRC32(ReadStream &stream) {
+	ScopedArray<byte> buffer(new byte[kStreamBufferSize]);
+
+	uint32 crc = 0;
+
+	size_t bytesRead;
+	while ((bytesRead = stream.read(buffer.get(), kStreamBufferSize)) > 0)
+		crc = updateCRC32(crc, buffer.get(), bytesRead);
+
+	return crc;
+}
+
+} // End of namespace Common
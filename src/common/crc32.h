@@ -0,0 +1,53 @@
+/* Phaethon - A FLOSS resource explorer for BioWare's Aurora engine games
+ *
+ * Phaethon is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * Phaethon is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * Phaethon is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Phaethon. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  Calculating the CRC32 checksum of raw data.
+ */
+
+#ifndef COMMON_CRC32_H
+#define COMMON_CRC32_H
+
+#include "src/common/types.h"
+
+namespace Common {
+
+class ReadStream;
+
+/** Calculate the CRC32 of the data.
+ *
+ *  This is the CRC32 used by ZIP, PNG and zlib, with the polynomial
+ *  0x04C11DB7. The data is processed 8 bytes at a time or, on x86 CPUs
+ *  with carry-less multiplication (PCLMULQDQ), 64 bytes at a time.
+ */
+uint32 calculateCRC32(const byte *data, size_t size);
+/** Calculate the CRC32 of the rest of the stream. */
+uint32 calculateCRC32(ReadStream &stream);
+
+/** Continue calculating a CRC32 with more data.
+ *
+ *  A CRC32 over data split into several parts is calculated by starting
+ *  with a CRC32 of 0 and passing the result of each part into the next.
+ */
+uint32 updateCRC32(uint32 crc, const byte *data, size_t size);
+
+} // End of namespace Common
+
+#endif // COMMON_CRC32_H
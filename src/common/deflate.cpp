@@ -22,17 +22,23 @@
  *  Compress (deflate) and decompress (inflate) using zlib's DEFLATE algorithm.
  */
 
+#include <cassert>
+
 #include <zlib.h>
 
 #include <boost/scope_exit.hpp>
 
 #include "src/common/deflate.h"
 #include "src/common/error.h"
+#include "src/common/util.h"
 #include "src/common/scopedptr.h"
 #include "src/common/memreadstream.h"
 
 namespace Common {
 
+/** The largest chunk we hand to zlib at once, to fit into its 32-bit size fields. */
+static const size_t kMaxZlibChunkSize = 0x7FFFFFFF;
+
 byte *decompressDeflate(const byte *data, size_t inputSize,
                         size_t outputSize, int windowBits) {
 
@@ -93,4 +99,207 @@ SeekableReadStream *decompressDeflate(ReadStream &input, size_t inputSize,
 	return new MemoryReadStream(decompressedData, outputSize, true);
 }
 
+
+InflateReadStream::InflateReadStream(SeekableReadStream *input, size_t outputSize, int windowBits,
+                                     bool disposeInput) :
+	_input(input, disposeInput), _inputBegin(0), _inputPos(0), _inputEnd(0), _inputData(0),
+	_size(outputSize), _pos(0), _eos(false), _streamEnd(false) {
+
+	assert(input);
+
+	_inputBegin = _input->pos();
+	_inputEnd   = _input->size();
+	_inputPos   = _inputBegin;
+
+	if ((_inputBegin == kPositionInvalid) || (_inputEnd == kSizeInvalid) || (_inputBegin > _inputEnd))
+		throw Exception("Invalid input stream for inflating");
+
+	/* If the input is in memory anyway, let zlib read straight from there.
+	 * Otherwise, we need to read the compressed data in chunks. */
+	const MemoryReadStream *memInput = dynamic_cast<const MemoryReadStream *>(_input.get());
+	if (memInput)
+		_inputData = memInput->getData();
+	else
+		_inputBuffer.reset(new byte[kInputBufferSize]);
+
+	_strm.reset(new z_stream);
+
+	_strm->zalloc   = Z_NULL;
+	_strm->zfree    = Z_NULL;
+	_strm->opaque   = Z_NULL;
+	_strm->avail_in = 0;
+	_strm->next_in  = Z_NULL;
+
+	const int zResult = inflateInit2(_strm.get(), windowBits);
+	if (zResult != Z_OK) {
+		_strm.reset();
+		throw Exception("Could not initialize zlib inflate: %s (%d)", zError(zResult), zResult);
+	}
+}
+
+InflateReadStream::~InflateReadStream() {
+	if (_strm)
+		inflateEnd(_strm.get());
+}
+
+bool InflateReadStream::eos() const {
+	return _eos;
+}
+
+size_t InflateReadStream::pos() const {
+	return _pos;
+}
+
+size_t InflateReadStream::size() const {
+	return _size;
+}
+
+void InflateReadStream::reset() {
+	const int zResult = inflateReset(_strm.get());
+	if (zResult != Z_OK)
+		throw Exception("Could not reset zlib inflate: %s (%d)", zError(zResult), zResult);
+
+	_strm->avail_in = 0;
+	_strm->next_in  = Z_NULL;
+
+	_inputPos  = _inputBegin;
+	_pos       = 0;
+	_streamEnd = false;
+}
+
+void InflateReadStream::fillInput() {
+	if (_inputPos >= _inputEnd)
+		throw Exception("Failed to inflate: premature end of input data");
+
+	const size_t inputSize = MIN<size_t>(_inputEnd - _inputPos, _inputData ? kMaxZlibChunkSize : kInputBufferSize);
+
+	if (_inputData) {
+		// This ugly const cast is necessary because of the non-const zlib API. See above
+		_strm->next_in = const_cast<byte *>(_inputData + _inputPos);
+	} else {
+		if (_input->readAt(_inputPos, _inputBuffer.get(), inputSize) != inputSize)
+			throw Exception(kReadError);
+
+		_strm->next_in = _inputBuffer.get();
+	}
+
+	_strm->avail_in = inputSize;
+	_inputPos += inputSize;
+}
+
+size_t InflateReadStream::read(void *dataPtr, size_t dataSize) {
+	assert(dataPtr);
+
+	// Never decompress past the size we know
+	if ((_size != kSizeInvalid) && (dataSize > (_size - _pos))) {
+		dataSize = _size - _pos;
+		_eos = true;
+	}
+
+	byte *data = static_cast<byte *>(dataPtr);
+	size_t readSize = 0;
+
+	// Decompress in chunks that fit into zlib's 32-bit size fields
+	while ((readSize < dataSize) && !_streamEnd) {
+		const size_t chunkSize = MIN<size_t>(dataSize - readSize, kMaxZlibChunkSize);
+
+		_strm->next_out  = data + readSize;
+		_strm->avail_out = chunkSize;
+
+		while ((_strm->avail_out > 0) && !_streamEnd) {
+			if (_strm->avail_in == 0)
+				fillInput();
+
+			const int zResult = inflate(_strm.get(), Z_NO_FLUSH);
+
+			if (zResult == Z_STREAM_END) {
+				_streamEnd = true;
+				break;
+			}
+
+			if (zResult != Z_OK)
+				throw Exception("Failed to inflate: %s (%d)", zError(zResult), zResult);
+		}
+
+		readSize += chunkSize - _strm->avail_out;
+	}
+
+	_pos += readSize;
+
+	if (_streamEnd) {
+		if (_size == kSizeInvalid)
+			_size = _pos;
+		else if (_pos != _size)
+			throw Exception("Failed to inflate: output buffer not completely filled");
+
+	} else if (_pos == _size)
+		checkStreamEnd();
+
+	if (readSize < dataSize)
+		_eos = true;
+
+	return readSize;
+}
+
+void InflateReadStream::checkStreamEnd() {
+	/* We've read all the data we expected. Make sure the compressed
+	 * stream really ends here and doesn't hold any more data. */
+
+	byte extra;
+
+	_strm->next_out  = &extra;
+	_strm->avail_out = 1;
+
+	while (!_streamEnd) {
+		if ((_strm->avail_in == 0) && (_inputPos < _inputEnd))
+			fillInput();
+
+		const int zResult = inflate(_strm.get(), Z_NO_FLUSH);
+
+		if (_strm->avail_out == 0)
+			throw Exception("Failed to inflate: premature end of output buffer");
+
+		if (zResult == Z_STREAM_END)
+			_streamEnd = true;
+		else if (zResult != Z_OK)
+			throw Exception("Failed to inflate: %s (%d)", zError(zResult), zResult);
+	}
+}
+
+void InflateReadStream::skipTo(size_t newPos) {
+	byte buffer[4096];
+
+	while (_pos < newPos) {
+		const size_t skipSize = MIN<size_t>(newPos - _pos, sizeof(buffer));
+
+		if (read(buffer, skipSize) != skipSize)
+			throw Exception(kSeekError);
+	}
+}
+
+size_t InflateReadStream::seek(ptrdiff_t offset, Origin whence) {
+	const size_t oldPos = _pos;
+
+	// To seek relative to the end, we need to know where that is
+	if ((whence == kOriginEnd) && (_size == kSizeInvalid)) {
+		byte buffer[4096];
+		while (!_streamEnd)
+			read(buffer, sizeof(buffer));
+	}
+
+	const size_t newPos = evalSeek(offset, whence, _pos, 0, size());
+	if ((_size != kSizeInvalid) && (newPos > _size))
+		throw Exception(kSeekError);
+
+	if (newPos < _pos)
+		reset();
+
+	skipTo(newPos);
+
+	// Reset end-of-stream flag on a successful seek
+	_eos = false;
+
+	return oldPos;
+}
+
 } // End of namespace Common
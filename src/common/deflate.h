@@ -25,19 +25,21 @@
 #ifndef COMMON_DEFLATE_H
 #define COMMON_DEFLATE_H
 
+#include <boost/noncopyable.hpp>
+
 #include "src/common/types.h"
+#include "src/common/scopedptr.h"
+#include "src/common/disposableptr.h"
+#include "src/common/readstream.h"
+
+struct z_stream_s;
 
 namespace Common {
 
 /* TODO (should be need it):
  * - Compression
- * - Decompress dynamically, without needing to know the size
- *   of the decompressed data beforehand
  */
 
-class ReadStream;
-class SeekableReadStream;
-
 static const int kWindowBitsMax    =  15;
 static const int kWindowBitsMaxRaw = -kWindowBitsMax;
 
@@ -73,6 +75,77 @@ byte *decompressDeflate(const byte *data, size_t inputSize,
 SeekableReadStream *decompressDeflate(ReadStream &input, size_t inputSize,
                                       size_t outputSize, int windowBits);
 
+/** A stream that decompresses (inflates) DEFLATE data on the fly, while it is read.
+ *
+ *  Only a small window of the data is ever held in memory, so reading just
+ *  the start of a large compressed resource is cheap. Seeking forward
+ *  decompresses and discards the data up to the new position, while seeking
+ *  backwards restarts the decompression from the beginning.
+ *
+ *  The compressed data is read from the input stream with readAt(), starting
+ *  at the input stream's position when the InflateReadStream is created, and
+ *  up to the end of the input stream. The input stream's position itself is
+ *  never changed.
+ */
+class InflateReadStream : boost::noncopyable, public SeekableReadStream {
+public:
+	/** Create an InflateReadStream decompressing the input stream.
+	 *
+	 *  @param input         The stream with the compressed data.
+	 *  @param outputSize    The size of the decompressed data, or kSizeInvalid if unknown.
+	 *                       If known, it is an error for the data to decompress to
+	 *                       any other size.
+	 *  @param windowBits    The base two logarithm of the window size (the size of
+	 *                       the history buffer). See the zlib documentation on
+	 *                       inflateInit2() for details.
+	 *  @param disposeInput  Should the input stream be deleted together with this stream?
+	 */
+	InflateReadStream(SeekableReadStream *input, size_t outputSize, int windowBits,
+	                  bool disposeInput = true);
+	~InflateReadStream();
+
+	bool eos() const;
+
+	size_t read(void *dataPtr, size_t dataSize);
+
+	size_t pos() const;
+	size_t size() const;
+
+	size_t seek(ptrdiff_t offset, Origin whence = kOriginBegin);
+
+private:
+	/** The size of the buffer for compressed data read from non-memory streams. */
+	static const size_t kInputBufferSize = 16384;
+
+	DisposablePtr<SeekableReadStream> _input;
+
+	size_t _inputBegin; ///< Offset of the compressed data within the input stream.
+	size_t _inputPos;   ///< Offset of the next compressed data to read.
+	size_t _inputEnd;   ///< Offset of the end of the compressed data.
+
+	/** The compressed data, if the input stream is a memory stream. */
+	const byte *_inputData;
+	/** Buffer for compressed data, if the input stream isn't a memory stream. */
+	ScopedArray<byte> _inputBuffer;
+
+	ScopedPtr<z_stream_s> _strm;
+
+	size_t _size; ///< The size of the decompressed data, or kSizeInvalid if not yet known.
+	size_t _pos;  ///< The current position within the decompressed data.
+
+	bool _eos;       ///< Have we tried reading past the end of the stream?
+	bool _streamEnd; ///< Have we reached the end of the compressed data?
+
+	/** Start decompressing from the beginning again. */
+	void reset();
+	/** Make more compressed data available to zlib. */
+	void fillInput();
+	/** Decompress and discard data until we reached the new position. */
+	void skipTo(size_t newPos);
+	/** Make sure the compressed data doesn't contain more than we expected. */
+	void checkStreamEnd();
+};
+
 } // End of namespace Common
 
 #endif // COMMON_DEFLATE_H
@@ -28,11 +28,16 @@
 #include <iconv.h>
 
 #include <vector>
+#include <string>
+#include <iterator>
+#include <utility>
+
+#include <boost/noncopyable.hpp>
+#include <boost/thread/tss.hpp>
 
 #include "src/common/encoding.h"
 #include "src/common/error.h"
 #include "src/common/scopedptr.h"
-#include "src/common/singleton.h"
 #include "src/common/ustring.h"
 #include "src/common/memreadstream.h"
 #include "src/common/writestream.h"
@@ -56,22 +61,23 @@ static const size_t kTerminatorLength  [kEncodingMAX] = {
 	1, 1, 2, 2, 1, 1, 1, 1, 1, 1, 1, 1
 };
 
-/** A manager handling string encoding conversions. */
-class ConversionManager : public Singleton<ConversionManager> {
+/** The iconv contexts of one thread, handling the string encoding conversions
+ *  that we don't do ourselves.
+ *
+ *  An iconv context carries state and must not be used by several threads at
+ *  once. Each thread therefore gets its own set of contexts, which are only
+ *  opened once they are needed.
+ */
+class ConversionManager : boost::noncopyable {
 public:
 	ConversionManager() {
 		for (size_t i = 0; i < kEncodingMAX; i++) {
 			_contextFrom[i] = (iconv_t) -1;
 			_contextTo  [i] = (iconv_t) -1;
-		}
-
-		for (size_t i = 0; i < kEncodingMAX; i++)
-			if ((_contextFrom[i] = iconv_open("UTF-8", kEncodingName[i])) == ((iconv_t) -1))
-				warning("Failed to initialize %s -> UTF-8 conversion: %s", kEncodingName[i], strerror(errno));
 
-		for (size_t i = 0; i < kEncodingMAX; i++)
-			if ((_contextTo  [i] = iconv_open(kEncodingName[i], "UTF-8")) == ((iconv_t) -1))
-				warning("Failed to initialize UTF-8 -> %s conversion: %s", kEncodingName[i], strerror(errno));
+			_openedFrom[i] = false;
+			_openedTo  [i] = false;
+		}
 	}
 
 	~ConversionManager() {
@@ -89,10 +95,10 @@ public:
 			return false;
 
 		if (from == kEncodingUTF8)
-			return _contextTo[to] != ((iconv_t) -1);
+			return getContextTo(to) != ((iconv_t) -1);
 
 		if (to == kEncodingUTF8)
-			return _contextFrom[from] != ((iconv_t) -1);
+			return getContextFrom(from) != ((iconv_t) -1);
 
 		return false;
 	}
@@ -101,14 +107,14 @@ public:
 		if (((size_t) encoding) >= kEncodingMAX)
 			throw Exception("Invalid encoding %d", encoding);
 
-		return convert(_contextFrom[encoding], data, n, kEncodingGrowthFrom[encoding], 1);
+		return convert(getContextFrom(encoding), data, n, kEncodingGrowthFrom[encoding], 1);
 	}
 
 	MemoryReadStream *convert(Encoding encoding, const UString &str, bool terminate = true) {
 		if (((size_t) encoding) >= kEncodingMAX)
 			throw Exception("Invalid encoding %d", encoding);
 
-		return convert(_contextTo[encoding], str, kEncodingGrowthTo[encoding],
+		return convert(getContextTo(encoding), str, kEncodingGrowthTo[encoding],
 		               terminate ? kTerminatorLength[encoding] : 0);
 	}
 
@@ -116,6 +122,31 @@ private:
 	iconv_t _contextFrom[kEncodingMAX];
 	iconv_t _contextTo  [kEncodingMAX];
 
+	bool _openedFrom[kEncodingMAX];
+	bool _openedTo  [kEncodingMAX];
+
+	iconv_t &getContextFrom(Encoding encoding) {
+		if (!_openedFrom[encoding]) {
+			_openedFrom[encoding] = true;
+
+			if ((_contextFrom[encoding] = iconv_open("UTF-8", kEncodingName[encoding])) == ((iconv_t) -1))
+				warning("Failed to initialize %s -> UTF-8 conversion: %s", kEncodingName[encoding], strerror(errno));
+		}
+
+		return _contextFrom[encoding];
+	}
+
+	iconv_t &getContextTo(Encoding encoding) {
+		if (!_openedTo[encoding]) {
+			_openedTo[encoding] = true;
+
+			if ((_contextTo  [encoding] = iconv_open(kEncodingName[encoding], "UTF-8")) == ((iconv_t) -1))
+				warning("Failed to initialize UTF-8 -> %s conversion: %s", kEncodingName[encoding], strerror(errno));
+		}
+
+		return _contextTo[encoding];
+	}
+
 	byte *doConvert(iconv_t &ctx, byte *data, size_t nIn, size_t nOut, size_t &size) {
 		size_t inBytes  = nIn;
 		size_t outBytes = nOut;
@@ -175,13 +206,300 @@ private:
 	}
 };
 
+static boost::thread_specific_ptr<ConversionManager> conversionManager;
+
+/** Return the conversion manager of this thread. */
+static ConversionManager &getConversionManager() {
+	if (!conversionManager.get())
+		conversionManager.reset(new ConversionManager);
+
+	return *conversionManager;
 }
 
-#define ConvMan Common::ConversionManager::instance()
+#define ConvMan getConversionManager()
+
+// .--- Encodings we convert ourselves, without iconv
+
+/** The Unicode codepoints of the CP1252 characters 0x80 to 0xFF, 0 where undefined. */
+static const uint16 kCP1252Upper[128] = {
+	0x20AC, 0x0000, 0x201A, 0x0192, 0x201E, 0x2026, 0x2020, 0x2021,
+	0x02C6, 0x2030, 0x0160, 0x2039, 0x0152, 0x0000, 0x017D, 0x0000,
+	0x0000, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014,
+	0x02DC, 0x2122, 0x0161, 0x203A, 0x0153, 0x0000, 0x017E, 0x0178,
+	0x00A0, 0x00A1, 0x00A2, 0x00A3, 0x00A4, 0x00A5, 0x00A6, 0x00A7,
+	0x00A8, 0x00A9, 0x00AA, 0x00AB, 0x00AC, 0x00AD, 0x00AE, 0x00AF,
+	0x00B0, 0x00B1, 0x00B2, 0x00B3, 0x00B4, 0x00B5, 0x00B6, 0x00B7,
+	0x00B8, 0x00B9, 0x00BA, 0x00BB, 0x00BC, 0x00BD, 0x00BE, 0x00BF,
+	0x00C0, 0x00C1, 0x00C2, 0x00C3, 0x00C4, 0x00C5, 0x00C6, 0x00C7,
+	0x00C8, 0x00C9, 0x00CA, 0x00CB, 0x00CC, 0x00CD, 0x00CE, 0x00CF,
+	0x00D0, 0x00D1, 0x00D2, 0x00D3, 0x00D4, 0x00D5, 0x00D6, 0x00D7,
+	0x00D8, 0x00D9, 0x00DA, 0x00DB, 0x00DC, 0x00DD, 0x00DE, 0x00DF,
+	0x00E0, 0x00E1, 0x00E2, 0x00E3, 0x00E4, 0x00E5, 0x00E6, 0x00E7,
+	0x00E8, 0x00E9, 0x00EA, 0x00EB, 0x00EC, 0x00ED, 0x00EE, 0x00EF,
+	0x00F0, 0x00F1, 0x00F2, 0x00F3, 0x00F4, 0x00F5, 0x00F6, 0x00F7,
+	0x00F8, 0x00F9, 0x00FA, 0x00FB, 0x00FC, 0x00FD, 0x00FE, 0x00FF
+};
 
-DECLARE_SINGLETON(Common::ConversionManager)
+/** The Unicode codepoints of the Latin-9 characters 0x80 to 0xFF. */
+static const uint16 kLatin9Upper[128] = {
+	0x0080, 0x0081, 0x0082, 0x0083, 0x0084, 0x0085, 0x0086, 0x0087,
+	0x0088, 0x0089, 0x008A, 0x008B, 0x008C, 0x008D, 0x008E, 0x008F,
+	0x0090, 0x0091, 0x0092, 0x0093, 0x0094, 0x0095, 0x0096, 0x0097,
+	0x0098, 0x0099, 0x009A, 0x009B, 0x009C, 0x009D, 0x009E, 0x009F,
+	0x00A0, 0x00A1, 0x00A2, 0x00A3, 0x20AC, 0x00A5, 0x0160, 0x00A7,
+	0x0161, 0x00A9, 0x00AA, 0x00AB, 0x00AC, 0x00AD, 0x00AE, 0x00AF,
+	0x00B0, 0x00B1, 0x00B2, 0x00B3, 0x017D, 0x00B5, 0x00B6, 0x00B7,
+	0x017E, 0x00B9, 0x00BA, 0x00BB, 0x0152, 0x0153, 0x0178, 0x00BF,
+	0x00C0, 0x00C1, 0x00C2, 0x00C3, 0x00C4, 0x00C5, 0x00C6, 0x00C7,
+	0x00C8, 0x00C9, 0x00CA, 0x00CB, 0x00CC, 0x00CD, 0x00CE, 0x00CF,
+	0x00D0, 0x00D1, 0x00D2, 0x00D3, 0x00D4, 0x00D5, 0x00D6, 0x00D7,
+	0x00D8, 0x00D9, 0x00DA, 0x00DB, 0x00DC, 0x00DD, 0x00DE, 0x00DF,
+	0x00E0, 0x00E1, 0x00E2, 0x00E3, 0x00E4, 0x00E5, 0x00E6, 0x00E7,
+	0x00E8, 0x00E9, 0x00EA, 0x00EB, 0x00EC, 0x00ED, 0x00EE, 0x00EF,
+	0x00F0, 0x00F1, 0x00F2, 0x00F3, 0x00F4, 0x00F5, 0x00F6, 0x00F7,
+	0x00F8, 0x00F9, 0x00FA, 0x00FB, 0x00FC, 0x00FD, 0x00FE, 0x00FF
+};
 
-namespace Common {
+/** Is this an encoding we convert ourselves? */
+static bool isNativeEncoding(Encoding encoding) {
+	switch (encoding) {
+		case kEncodingASCII:
+		case kEncodingUTF8:
+		case kEncodingUTF16LE:
+		case kEncodingUTF16BE:
+		case kEncodingLatin9:
+		case kEncodingCP1252:
+			return true;
+
+		default:
+			break;
+	}
+
+	return false;
+}
+
+/** Return the length of the run of ASCII characters, excluding \0, at the start of the data. */
+static size_t findASCIIRun(const byte *data, size_t n) {
+	static const uint64 kOnes  = 0x0101010101010101ULL;
+	static const uint64 kHighs = 0x8080808080808080ULL;
+
+	size_t i = 0;
+
+	/* Look at 8 bytes at once. The run ends at a byte with its high bit set, or at
+	 * a \0, which is a byte that gets its high bit set when 1 is subtracted from it. */
+	for (; (i + 8) <= n; i += 8) {
+		uint64 v;
+		std::memcpy(&v, data + i, 8);
+
+		if ((v | ((v - kOnes) & ~v)) & kHighs)
+			break;
+	}
+
+	for (; i < n; i++)
+		if ((data[i] == 0) || (data[i] >= 0x80))
+			break;
+
+	return i;
+}
+
+/** Decode a single-byte encoding into UTF-8, up to the first \0. */
+static bool decodeSingleByte(std::string &result, const byte *data, size_t n, const uint16 *upper) {
+	size_t i = 0;
+	while (i < n) {
+		const size_t run = findASCIIRun(data + i, n - i);
+
+		result.append(reinterpret_cast<const char *>(data + i), run);
+		i += run;
+
+		if ((i >= n) || (data[i] == 0))
+			break;
+
+		const uint32 c = upper[data[i++] - 0x80];
+		if (c == 0)
+			return false;
+
+		utf8::unchecked::append(c, std::back_inserter(result));
+	}
+
+	return true;
+}
+
+/** Decode UTF-16 into UTF-8, up to the first \0. */
+static bool decodeUTF16(std::string &result, const byte *data, size_t n, bool bigEndian) {
+	for (size_t i = 0; i < n; i += 2) {
+		if ((i + 2) > n)
+			return false;
+
+		uint32 c = bigEndian ? READ_BE_UINT16(data + i) : READ_LE_UINT16(data + i);
+		if (c == 0)
+			break;
+
+		if ((c >= 0xDC00) && (c <= 0xDFFF))
+			return false;
+
+		// A high surrogate, which needs to be followed by a low surrogate
+		if ((c >= 0xD800) && (c <= 0xDBFF)) {
+			if ((i + 4) > n)
+				return false;
+
+			const uint32 low = bigEndian ? READ_BE_UINT16(data + i + 2) : READ_LE_UINT16(data + i + 2);
+			if ((low < 0xDC00) || (low > 0xDFFF))
+				return false;
+
+			c = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+			i += 2;
+		}
+
+		utf8::unchecked::append(c, std::back_inserter(result));
+	}
+
+	return true;
+}
+
+/** Decode a string in an encoding we convert ourselves, up to the first \0. */
+static UString decodeNative(Encoding encoding, const byte *data, size_t n) {
+	std::string result;
+	result.reserve(n);
+
+	bool valid = false;
+	switch (encoding) {
+		case kEncodingUTF16LE:
+			valid = decodeUTF16(result, data, n, false);
+			break;
+
+		case kEncodingUTF16BE:
+			valid = decodeUTF16(result, data, n, true);
+			break;
+
+		case kEncodingLatin9:
+			valid = decodeSingleByte(result, data, n, kLatin9Upper);
+			break;
+
+		case kEncodingCP1252:
+			valid = decodeSingleByte(result, data, n, kCP1252Upper);
+			break;
+
+		default:
+			throw Exception("Invalid native encoding %d", encoding);
+	}
+
+	if (!valid) {
+		warning("Invalid %s string data", kEncodingName[encoding]);
+		return "[!?!]";
+	}
+
+	return UString(std::move(result));
+}
+
+/** Encode one codepoint into a single-byte encoding. */
+static bool encodeSingleByte(byte *&output, uint32 c, const uint16 *upper) {
+	if (c < 0x80) {
+		*output++ = c;
+		return true;
+	}
+
+	for (size_t i = 0; i < 128; i++) {
+		if (upper[i] == c) {
+			*output++ = 0x80 + i;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/** Encode one codepoint into UTF-16. */
+static void encodeUTF16(byte *&output, uint32 c, bool bigEndian) {
+	uint16 units[2] = { (uint16) c, 0 };
+	size_t count = 1;
+
+	// Outside the BMP, as a surrogate pair
+	if (c >= 0x10000) {
+		units[0] = 0xD800 + ((c - 0x10000) >> 10);
+		units[1] = 0xDC00 + ((c - 0x10000) & 0x3FF);
+		count    = 2;
+	}
+
+	for (size_t i = 0; i < count; i++, output += 2) {
+		if (bigEndian)
+			WRITE_BE_UINT16(output, units[i]);
+		else
+			WRITE_LE_UINT16(output, units[i]);
+	}
+}
+
+/** Encode a string into an encoding we convert ourselves.
+ *
+ *  Returns 0 if the string contains characters the encoding can't represent.
+ */
+static MemoryReadStream *encodeNative(Encoding encoding, const UString &str, bool terminate) {
+	const byte *data = reinterpret_cast<const byte *>(str.c_str());
+	const byte *end  = data + std::strlen(str.c_str());
+
+	const size_t termSize = terminate ? kTerminatorLength[encoding] : 0;
+
+	ScopedArray<byte> output(new byte[(end - data) * kEncodingGrowthTo[encoding] + termSize]);
+	byte *out = output.get();
+
+	// These encodings agree with UTF-8 on ASCII
+	const bool asciiCompatible = (encoding == kEncodingASCII) || (encoding == kEncodingLatin9) ||
+	                             (encoding == kEncodingCP1252);
+
+	while (data < end) {
+		if (asciiCompatible) {
+			const size_t run = findASCIIRun(data, end - data);
+
+			std::memcpy(out, data, run);
+			out  += run;
+			data += run;
+
+			if (data >= end)
+				break;
+		}
+
+		const uint32 c = utf8::unchecked::next(data);
+
+		bool valid = true;
+		switch (encoding) {
+			case kEncodingASCII:
+				valid = false;
+				break;
+
+			case kEncodingUTF16LE:
+				encodeUTF16(out, c, false);
+				break;
+
+			case kEncodingUTF16BE:
+				encodeUTF16(out, c, true);
+				break;
+
+			case kEncodingLatin9:
+				valid = encodeSingleByte(out, c, kLatin9Upper);
+				break;
+
+			case kEncodingCP1252:
+				valid = encodeSingleByte(out, c, kCP1252Upper);
+				break;
+
+			default:
+				throw Exception("Invalid native encoding %d", encoding);
+		}
+
+		if (!valid) {
+			warning("Can't represent U+%04X in %s", c, kEncodingName[encoding]);
+			return 0;
+		}
+	}
+
+	for (size_t i = 0; i < termSize; i++)
+		*out++ = '\0';
+
+	const size_t size = out - output.get();
+
+	return new MemoryReadStream(output.release(), size, true);
+}
+
+// '---
 
 UString getEncodingName(Encoding encoding) {
 	if (((size_t) encoding) >= kEncodingMAX)
@@ -191,6 +509,9 @@ UString getEncodingName(Encoding encoding) {
 }
 
 bool hasSupportEncoding(Encoding encoding) {
+	if (isNativeEncoding(encoding))
+		return true;
+
 	return ConvMan.hasSupportTranscode(Common::kEncodingUTF8, encoding             ) &&
 	       ConvMan.hasSupportTranscode(encoding             , Common::kEncodingUTF8);
 }
@@ -274,6 +595,12 @@ static UString createString(std::vector<byte> &output, Encoding encoding) {
 			output.push_back('\0');
 			return UString(reinterpret_cast<const char *>(&output[0]));
 
+		case kEncodingUTF16LE:
+		case kEncodingUTF16BE:
+		case kEncodingLatin9:
+		case kEncodingCP1252:
+			return decodeNative(encoding, output.empty() ? 0 : &output[0], output.size());
+
 		default:
 			return ConvMan.convert(encoding, &output[0], output.size());
 	}
@@ -357,6 +684,9 @@ MemoryReadStream *convertString(const UString &str, Encoding encoding, bool term
 		return new MemoryReadStream(reinterpret_cast<const byte *>(str.c_str()),
 		                            std::strlen(str.c_str()) + (terminateString ? 1 : 0));
 
+	if (isNativeEncoding(encoding))
+		return encodeNative(encoding, str, terminateString);
+
 	return ConvMan.convert(encoding, str, terminateString);
 }
 
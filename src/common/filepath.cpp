@@ -70,7 +70,7 @@ size_t FilePath::getFileSize(const UString &p) {
 		return kFileInvalid;
 	}
 
-	if (size > 0x7FFFFFFF) {
+	if (size >= (uintmax_t) kFileInvalid) {
 		warning("Size of file \"%s\" too large", p.c_str());
 		return kFileInvalid;
 	}
@@ -78,6 +78,16 @@ size_t FilePath::getFileSize(const UString &p) {
 	return size;
 }
 
+uint64 FilePath::getLastModified(const UString &p) {
+	boost::system::error_code error;
+
+	const std::time_t time = boost::filesystem::last_write_time(p.c_str(), error);
+	if (error || (time < 0))
+		return 0;
+
+	return (uint64) time;
+}
+
 UString FilePath::getFile(const UString &p) {
 	path file(p.c_str());
 
@@ -347,6 +357,14 @@ bool FilePath::createDirectories(const UString &path) {
 	}
 }
 
+void FilePath::renameFile(const UString &from, const UString &to) {
+	try {
+		boost::filesystem::rename(path(from.c_str()), path(to.c_str()));
+	} catch (std::exception &se) {
+		throw Exception(se);
+	}
+}
+
 UString FilePath::escapeStringLiteral(const UString &str) {
 	const boost::regex esc("[\\^\\.\\$\\|\\(\\)\\[\\]\\*\\+\\?\\/\\\\]");
 	const std::string  rep("\\\\\\1&");
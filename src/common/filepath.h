@@ -58,6 +58,13 @@ public:
 	 */
 	static size_t getFileSize(const UString &p);
 
+	/** Return the time a file or directory was last modified.
+	 *
+	 *  @param  p The file or directory to look up.
+	 *  @return The modification time in seconds since the epoch, or 0 if unknown.
+	 */
+	static uint64 getLastModified(const UString &p);
+
 	/** Return a file name without its path.
 	 *
 	 *  Example: "/path/to/file.ext" > "file.ext"
@@ -201,6 +208,15 @@ public:
 	 */
 	static bool createDirectories(const UString &path);
 
+	/** Rename a file, replacing the target file if it exists.
+	 *
+	 *  On the same file system, the target file is replaced atomically.
+	 *
+	 *  @param from The file to rename.
+	 *  @param to The new name of the file.
+	 */
+	static void renameFile(const UString &from, const UString &to);
+
 	/** Escape a string literal for use in a regexp. */
 	static UString escapeStringLiteral(const UString &str);
 
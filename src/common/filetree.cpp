@@ -22,20 +22,42 @@
  *  A tree structure of files in directories.
  */
 
+#include <cstring>
+#include <map>
+#include <vector>
+
 #include "src/common/filetree.h"
 #include "src/common/filepath.h"
 #include "src/common/error.h"
+#include "src/common/readstream.h"
+#include "src/common/writestream.h"
+
+static const uint32 kEntryDirectory = 1;
 
 namespace Common {
 
-FileTree::Entry::Entry() {
+FileTree::Entry::Entry() : directory(false), lastModified(0) {
 }
 
-FileTree::Entry::Entry(const boost::filesystem::path &p) : name(p.filename().generic_string()), path(p) {
+FileTree::Entry::Entry(const boost::filesystem::path &p) : name(p.filename().generic_string()), path(p),
+	directory(boost::filesystem::is_directory(p)), lastModified(0) {
+}
+
+FileTree::Entry::Entry(const boost::filesystem::path &p, bool isDir) : name(p.filename().generic_string()),
+	path(p), directory(isDir), lastModified(0) {
 }
 
 bool FileTree::Entry::isDirectory() const {
-	return boost::filesystem::is_directory(path);
+	return directory;
+}
+
+bool FileTree::Entry::operator==(const Entry &right) const {
+	return (name == right.name) && (path == right.path) && (directory == right.directory) &&
+	       (lastModified == right.lastModified) && (children == right.children);
+}
+
+bool FileTree::Entry::operator!=(const Entry &right) const {
+	return !(*this == right);
 }
 
 
@@ -49,6 +71,9 @@ void FileTree::clear() {
 	_root.name.clear();
 	_root.path.clear();
 	_root.children.clear();
+
+	_root.directory    = false;
+	_root.lastModified = 0;
 }
 
 bool FileTree::isEmpty() const {
@@ -59,6 +84,14 @@ const FileTree::Entry &FileTree::getRoot() const {
 	return _root;
 }
 
+bool FileTree::operator==(const FileTree &right) const {
+	return _root == right._root;
+}
+
+bool FileTree::operator!=(const FileTree &right) const {
+	return !(*this == right);
+}
+
 void FileTree::readPath(const UString &path, int recurseDepth) {
 	return readPath(boost::filesystem::path(path.c_str()), recurseDepth);
 }
@@ -72,28 +105,79 @@ void FileTree::readPath(boost::filesystem::path path, int recurseDepth) {
 
 	path = FilePath::normalize(path.generic_string().c_str()).c_str();
 
-	_root.name = path.filename().generic_string();
-	_root.path = path;
+	_root = Entry(path);
 
 	// If we can't or shouldn't recurse, we're done
-	if (boost::filesystem::is_regular_file(path) || (recurseDepth == 0))
+	if (!_root.directory || (recurseDepth == 0))
 		return;
 
 	addPath(_root, path, (recurseDepth == -1) ? -1 : (recurseDepth - 1));
 }
 
-void FileTree::addPath(Entry &entry, const boost::filesystem::path &path, int recurseDepth) {
+void FileTree::readPath(const UString &p, int recurseDepth, const FileTree &previous) {
+	clear();
+
+	boost::filesystem::path path(p.c_str());
+
+	// The path needs to exist
+	if (!boost::filesystem::exists(path))
+		throw Exception("Path \"%s\" does not exist", path.generic_string().c_str());
+
+	path = FilePath::normalize(path.generic_string().c_str()).c_str();
+
+	_root = Entry(path);
+
+	// If we can't or shouldn't recurse, we're done
+	if (!_root.directory || (recurseDepth == 0))
+		return;
+
+	const Entry *previousRoot = (previous.getRoot().path == path) ? &previous.getRoot() : 0;
+
+	addPath(_root, path, (recurseDepth == -1) ? -1 : (recurseDepth - 1), previousRoot);
+}
+
+void FileTree::addPath(Entry &entry, const boost::filesystem::path &path, int recurseDepth,
+                       const Entry *previous) {
+
+	entry.lastModified = FilePath::getLastModified(path.generic_string().c_str());
+
 	try {
+		if (previous && previous->directory && previous->lastModified &&
+		    (previous->lastModified == entry.lastModified)) {
+
+			// The directory didn't change, so take its contents from the previous tree
+			for (std::list<Entry>::const_iterator c = previous->children.begin(); c != previous->children.end(); ++c) {
+				entry.children.push_back(Entry(c->path, c->directory));
+
+				if (c->directory && (recurseDepth != 0))
+					addPath(entry.children.back(), c->path, (recurseDepth == -1) ? -1 : (recurseDepth - 1), &*c);
+			}
+
+			return;
+		}
+
+		// Index the previous tree's subdirectories by name, so we can still reuse their contents
+		std::map<UString, const Entry *> previousChildren;
+		if (previous)
+			for (std::list<Entry>::const_iterator c = previous->children.begin(); c != previous->children.end(); ++c)
+				if (c->directory)
+					previousChildren.insert(std::make_pair(c->name, &*c));
+
 		// Iterator over the directory's contents
 		boost::filesystem::directory_iterator itEnd;
 		for (boost::filesystem::directory_iterator itDir(path); itDir != itEnd; ++itDir) {
+			const bool isDir = is_directory(itDir->status());
+
 			// Add the file/directory to the entry's children
-			entry.children.push_back(Entry(itDir->path()));
+			entry.children.push_back(Entry(itDir->path(), isDir));
 
 			// Recurse into directory until the depth limit is reached
-			if (is_directory(itDir->status()))
-				if (recurseDepth != 0)
-					addPath(entry.children.back(), itDir->path(), (recurseDepth == -1) ? -1 : (recurseDepth - 1));
+			if (isDir && (recurseDepth != 0)) {
+				std::map<UString, const Entry *>::const_iterator c = previousChildren.find(entry.children.back().name);
+
+				addPath(entry.children.back(), itDir->path(), (recurseDepth == -1) ? -1 : (recurseDepth - 1),
+				        (c != previousChildren.end()) ? c->second : 0);
+			}
 		}
 	} catch (Exception &e) {
 		e.add("Failed to read path \"%s\"", path.generic_string().c_str());
@@ -107,4 +191,76 @@ void FileTree::addPath(Entry &entry, const boost::filesystem::path &path, int re
 	}
 }
 
+void FileTree::write(WriteStream &stream) const {
+	const std::string root = _root.path.generic_string();
+
+	stream.writeUint32LE(root.size());
+	stream.write(root.c_str(), root.size());
+
+	writeEntry(stream, _root);
+}
+
+void FileTree::read(SeekableReadStream &stream) {
+	clear();
+
+	try {
+		const uint32 rootSize = stream.readUint32LE();
+		if (rootSize > (stream.size() - stream.pos()))
+			throw Exception(kReadError);
+
+		std::vector<char> root(rootSize);
+		if (stream.read(root.data(), rootSize) != rootSize)
+			throw Exception(kReadError);
+
+		const boost::filesystem::path rootPath(std::string(root.begin(), root.end()));
+
+		readEntry(stream, _root, rootPath.parent_path());
+
+		_root.path = rootPath;
+
+	} catch (Exception &e) {
+		clear();
+
+		e.add("Failed to read file tree");
+		throw;
+	}
+}
+
+void FileTree::writeEntry(WriteStream &stream, const Entry &entry) {
+	const size_t nameSize = std::strlen(entry.name.c_str());
+
+	stream.writeUint32LE(nameSize);
+	stream.write(entry.name.c_str(), nameSize);
+
+	stream.writeUint32LE(entry.directory ? kEntryDirectory : 0);
+	stream.writeUint64LE(entry.lastModified);
+
+	stream.writeUint32LE(entry.children.size());
+	for (std::list<Entry>::const_iterator c = entry.children.begin(); c != entry.children.end(); ++c)
+		writeEntry(stream, *c);
+}
+
+void FileTree::readEntry(SeekableReadStream &stream, Entry &entry, const boost::filesystem::path &parent) {
+	const uint32 nameSize = stream.readUint32LE();
+	if (nameSize > (stream.size() - stream.pos()))
+		throw Exception(kReadError);
+
+	std::vector<char> name(nameSize);
+	if (stream.read(name.data(), nameSize) != nameSize)
+		throw Exception(kReadError);
+
+	entry.name = (nameSize > 0) ? UString(name.data(), nameSize) : UString();
+	entry.path = parent / entry.name.c_str();
+
+	entry.directory    = (stream.readUint32LE() & kEntryDirectory) != 0;
+	entry.lastModified = stream.readUint64LE();
+
+	const uint32 childCount = stream.readUint32LE();
+	for (uint32 i = 0; i < childCount; i++) {
+		entry.children.push_back(Entry());
+
+		readEntry(stream, entry.children.back(), entry.path);
+	}
+}
+
 } // End of namespace Common
@@ -29,10 +29,14 @@
 
 #include <list>
 
+#include "src/common/types.h"
 #include "src/common/ustring.h"
 
 namespace Common {
 
+class SeekableReadStream;
+class WriteStream;
+
 /** A tree structure of files in directories. */
 class FileTree {
 public:
@@ -43,13 +47,23 @@ public:
 		/** The full normalized path of the file or directory. */
 		boost::filesystem::path path;
 
+		/** Is this entry a directory? */
+		bool directory;
+		/** The time a directory entry was last modified, if it was read. */
+		uint64 lastModified;
+
 		/** The files and directories inside this directory entry. */
 		std::list<Entry> children;
 
 		Entry();
 		Entry(const boost::filesystem::path &p);
+		Entry(const boost::filesystem::path &p, bool isDir);
 
 		bool isDirectory() const;
+
+		/** Are the two entries the same, including all their children? */
+		bool operator==(const Entry &right) const;
+		bool operator!=(const Entry &right) const;
 	};
 
 	FileTree();
@@ -64,6 +78,10 @@ public:
 	/** Return the root node. */
 	const Entry &getRoot() const;
 
+	/** Do the two trees contain the same files and directories? */
+	bool operator==(const FileTree &right) const;
+	bool operator!=(const FileTree &right) const;
+
 	/** Fill the tree with this path.
 	 *
 	 *  @param  p The path to read.
@@ -84,10 +102,31 @@ public:
 	 */
 	void readPath(const Common::UString &path, int recurseDepth = 0);
 
+	/** Fill the tree with this path, reusing parts of a previously read tree.
+	 *
+	 *  The contents of a directory are taken from the previous tree if the
+	 *  directory's modification time hasn't changed since, instead of reading
+	 *  the directory again. Subdirectories are still checked individually.
+	 *
+	 *  @param  p The path to read.
+	 *  @param  recurseDepth The number of levels to recurse into subdirectories.
+	 *  @param  previous A tree previously read from the same path.
+	 */
+	void readPath(const Common::UString &path, int recurseDepth, const FileTree &previous);
+
+	/** Write the tree into a stream, in a format suitable for read(). */
+	void write(WriteStream &stream) const;
+	/** Read a tree that has been written with write(). */
+	void read(SeekableReadStream &stream);
+
 private:
 	Entry _root;
 
-	void addPath(Entry &entry, const boost::filesystem::path &path, int recurseDepth);
+	void addPath(Entry &entry, const boost::filesystem::path &path, int recurseDepth,
+	             const Entry *previous = 0);
+
+	static void writeEntry(WriteStream &stream, const Entry &entry);
+	static void readEntry(SeekableReadStream &stream, Entry &entry, const boost::filesystem::path &parent);
 };
 
 } // End of namespace Common
@@ -0,0 +1,61 @@
+/* Phaethon - A FLOSS resource explorer for BioWare's Aurora engine games
+ *
+ * Phaethon is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * Phaethon is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * Phaethon is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Phaethon. If not, see <http://www.gnu.org/licenses/>.
+ */
+/** @file
+ *  A table of fixed-size entries, read from a stream in one block.
+ */
+
+#include "src/common/fixedtable.h"
+#include "src/common/memreadstream.h"
+#include "src/common/error.h"
+
+namespace Common {
+
+FixedTable::FixedTable(const SeekableReadStream &stream, size_t offset, size_t count, size_t stride) :
+	_entries(0), _count(count), _stride(stride) {
+
+	if ((_count == 0) || (_stride == 0))
+		return;
+
+	if (_count > (SIZE_MAX / _stride))
+		throw Exception("Table too large (%u * %u)", (uint)_count, (uint)_stride);
+
+	const size_t tableSize = _count * _stride;
+	if ((offset > stream.size()) || ((stream.size() - offset) < tableSize))
+		throw Exception(kReadError);
+
+	// A stream already in memory doesn't need to be copied
+	const MemoryReadStream *memStream = dynamic_cast<const MemoryReadStream *>(&stream);
+	if (memStream) {
+		_entries = memStream->getData() + offset;
+		return;
+	}
+
+	_data.reset(new byte[tableSize]);
+
+	if (stream.readAt(offset, _data.get(), tableSize) != tableSize)
+		throw Exception(kReadError);
+
+	_entries = _data.get();
+}
+
+FixedTable::~FixedTable() {
+}
+
+} // End of namespace Common
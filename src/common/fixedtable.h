@@ -0,0 +1,92 @@
+/* Phaethon - A FLOSS resource explorer for BioWare's Aurora engine games
+ *
+ * Phaethon is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * Phaethon is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * Phaethon is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Phaethon. If not, see <http://www.gnu.org/licenses/>.
+ */
+/** @file
+ *  A table of fixed-size entries, read from a stream in one block.
+ */
+
+#ifndef COMMON_FIXEDTABLE_H
+#define COMMON_FIXEDTABLE_H
+
+#include <boost/noncopyable.hpp>
+
+#include "src/common/types.h"
+#include "src/common/scopedptr.h"
+
+namespace Common {
+
+class SeekableReadStream;
+
+/** A table of fixed-size entries, read from a stream in one block.
+ *
+ *  Most archive formats store their resource lists as arrays of records of
+ *  the same size. Instead of reading such a list field by field, FixedTable
+ *  reads it as a whole, and the entries are then decoded straight out of
+ *  memory, with READ_LE_UINT32() and friends.
+ *
+ *  If the stream is a MemoryReadStream (or a MappedReadFile), the entries are
+ *  used in place, without any copying. In that case, the table is only valid
+ *  as long as the stream is.
+ *
+ *  The stream is only read with readAt(), so its position is never changed.
+ */
+class FixedTable : boost::noncopyable {
+public:
+	/** Read a table from the stream.
+	 *
+	 *  @param stream The stream to read from.
+	 *  @param offset The offset of the table within the stream.
+	 *  @param count  The number of entries in the table.
+	 *  @param stride The size of each entry, in bytes.
+	 */
+	FixedTable(const SeekableReadStream &stream, size_t offset, size_t count, size_t stride);
+	~FixedTable();
+
+	/** Return the number of entries in the table. */
+	size_t size() const;
+	/** Return the size of each entry, in bytes. */
+	size_t getStride() const;
+
+	/** Return the data of the n-th entry. */
+	const byte *operator[](size_t n) const;
+
+private:
+	ScopedArray<byte> _data; ///< Our copy of the table, if we needed one.
+
+	const byte *_entries;
+
+	size_t _count;
+	size_t _stride;
+};
+
+inline size_t FixedTable::size() const {
+	return _count;
+}
+
+inline size_t FixedTable::getStride() const {
+	return _stride;
+}
+
+inline const byte *FixedTable::operator[](size_t n) const {
+	return _entries + n * _stride;
+}
+
+} // End of namespace Common
+
+#endif // COMMON_FIXEDTABLE_H
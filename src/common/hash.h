@@ -25,11 +25,14 @@
 #ifndef COMMON_HASH_H
 #define COMMON_HASH_H
 
+#include <cstring>
+
 #include "src/common/types.h"
 #include "src/common/scopedptr.h"
 #include "src/common/ustring.h"
 #include "src/common/encoding.h"
 #include "src/common/memreadstream.h"
+#include "src/common/crc32.h"
 
 namespace Common {
 
@@ -43,32 +46,134 @@ enum HashAlgo {
 	kHashMAX         ///< For range checks.
 };
 
-// .--- djb2 hash function by Daniel J. Bernstein ---.
-static inline uint32 hashDJB2(uint32 hash, uint32 c) {
-	return ((hash << 5) + hash) + c;
+// .--- Feeding strings and data into the hash functions ---.
+
+/** Feed these bytes into the hash function. */
+template<typename T, T (*Hash)(T, uint32)>
+static inline T hashBytes(T hash, const byte *data, size_t size) {
+	for (size_t i = 0; i < size; i++)
+		hash = Hash(hash, data[i]);
+
+	return hash;
 }
 
-static inline uint32 hashStringDJB2(const UString &string) {
-	uint32 hash = 5381;
+/** Feed the code points of the string into the hash function.
+ *
+ *  Runs of ASCII characters are taken straight from the UTF-8 data, without
+ *  decoding them one by one with an iterator.
+ */
+template<typename T, T (*Hash)(T, uint32)>
+static inline T hashCodepoints(T hash, const UString &string) {
+	const char *str = string.c_str();
+
+	while (*str) {
+		const byte c = static_cast<byte>(*str);
+		if (c < 0x80) {
+			hash = Hash(hash, c);
+			str++;
+			continue;
+		}
+
+		hash = Hash(hash, utf8::unchecked::next(str));
+	}
 
-	for (UString::iterator it = string.begin(); it != string.end(); ++it)
-		hash = hashDJB2(hash, *it);
+	return hash;
+}
+
+/** Feed the code points of the string into the hash function, as UTF-16 code units. */
+template<typename T, T (*Hash)(T, uint32)>
+static inline T hashUTF16(T hash, const UString &string, bool bigEndian) {
+	const uint32 highShift = bigEndian ? 0 : 8;
+	const uint32 lowShift  = bigEndian ? 8 : 0;
+
+	const char *str = string.c_str();
+
+	while (*str) {
+		uint32 c = utf8::unchecked::next(str);
+
+		if (c >= 0x10000) {
+			c -= 0x10000;
+
+			const uint32 high = 0xD800 + (c >> 10);
+
+			hash = Hash(hash, (high >> lowShift ) & 0xFF);
+			hash = Hash(hash, (high >> highShift) & 0xFF);
+
+			c = 0xDC00 + (c & 0x3FF);
+		}
+
+		hash = Hash(hash, (c >> lowShift ) & 0xFF);
+		hash = Hash(hash, (c >> highShift) & 0xFF);
+	}
 
 	return hash;
 }
 
-static inline uint32 hashStringDJB2(const UString &string, Encoding encoding) {
-	uint32 hash = 5381;
+/** Does the string only consist of 7-bit ASCII characters? */
+static inline bool isASCIIString(const UString &string) {
+	for (const char *str = string.c_str(); *str; str++)
+		if (static_cast<byte>(*str) >= 0x80)
+			return false;
 
-	ScopedPtr<SeekableReadStream> data(convertString(string, encoding, false));
+	return true;
+}
+
+/** Feed the string, as a series of bytes in the given encoding, into the hash function.
+ *
+ *  UTF-8 and UTF-16 strings, and ASCII strings in encodings that extend
+ *  ASCII, are fed directly. Only everything else is converted first.
+ */
+template<typename T, T (*Hash)(T, uint32)>
+static inline T hashEncoded(T hash, const UString &string, Encoding encoding) {
+	switch (encoding) {
+		case kEncodingUTF8:
+			return hashBytes<T, Hash>(hash, reinterpret_cast<const byte *>(string.c_str()),
+			                          std::strlen(string.c_str()));
+
+		case kEncodingASCII:
+		case kEncodingLatin9:
+		case kEncodingCP1250:
+		case kEncodingCP1251:
+		case kEncodingCP1252:
+			if (isASCIIString(string))
+				return hashBytes<T, Hash>(hash, reinterpret_cast<const byte *>(string.c_str()),
+				                          std::strlen(string.c_str()));
+			break;
+
+		case kEncodingUTF16LE:
+			return hashUTF16<T, Hash>(hash, string, false);
+
+		case kEncodingUTF16BE:
+			return hashUTF16<T, Hash>(hash, string, true);
+
+		default:
+			break;
+	}
+
+	ScopedPtr<MemoryReadStream> data(convertString(string, encoding, false));
 	if (!data)
 		return hash;
 
-	uint32 c;
-	while ((c = data->readChar()) != ReadStream::kEOF)
-		hash = hashDJB2(hash, c);
+	return hashBytes<T, Hash>(hash, data->getData(), data->size());
+}
 
-	return hash;
+// '--- Feeding strings and data into the hash functions ---'
+
+// .--- djb2 hash function by Daniel J. Bernstein ---.
+static inline uint32 hashDJB2(uint32 hash, uint32 c) {
+	return ((hash << 5) + hash) + c;
+}
+
+static inline uint32 hashStringDJB2(const UString &string) {
+	return hashCodepoints<uint32, hashDJB2>(5381, string);
+}
+
+static inline uint32 hashStringDJB2(const UString &string, Encoding encoding) {
+	return hashEncoded<uint32, hashDJB2>(5381, string, encoding);
+}
+
+static inline uint32 hashDataDJB2(const byte *data, size_t size) {
+	return hashBytes<uint32, hashDJB2>(5381, data, size);
 }
 // '--- djb2 hash function by Daniel J. Bernstein ---'
 
@@ -78,26 +183,15 @@ static inline uint32 hashFNV32(uint32 hash, uint32 c) {
 }
 
 static inline uint32 hashStringFNV32(const UString &string) {
-	uint32 hash = 0x811C9DC5;
-
-	for (UString::iterator it = string.begin(); it != string.end(); ++it)
-		hash = hashFNV32(hash, *it);
-
-	return hash;
+	return hashCodepoints<uint32, hashFNV32>(0x811C9DC5, string);
 }
 
 static inline uint32 hashStringFNV32(const UString &string, Encoding encoding) {
-	uint32 hash = 0x811C9DC5;
-
-	ScopedPtr<SeekableReadStream> data(convertString(string, encoding, false));
-	if (!data)
-		return hash;
-
-	uint32 c;
-	while ((c = data->readChar()) != ReadStream::kEOF)
-		hash = hashFNV32(hash, c);
+	return hashEncoded<uint32, hashFNV32>(0x811C9DC5, string, encoding);
+}
 
-	return hash;
+static inline uint32 hashDataFNV32(const byte *data, size_t size) {
+	return hashBytes<uint32, hashFNV32>(0x811C9DC5, data, size);
 }
 // '--- 32bit Fowler-Noll-Vo hash by Glenn Fowler, Landon Curt Noll and Phong Vo ---'
 
@@ -107,26 +201,15 @@ static inline uint64 hashFNV64(uint64 hash, uint32 c) {
 }
 
 static inline uint64 hashStringFNV64(const UString &string) {
-	uint64 hash = 0xCBF29CE484222325LL;
-
-	for (UString::iterator it = string.begin(); it != string.end(); ++it)
-		hash = hashFNV64(hash, *it);
-
-	return hash;
+	return hashCodepoints<uint64, hashFNV64>(0xCBF29CE484222325LL, string);
 }
 
 static inline uint64 hashStringFNV64(const UString &string, Encoding encoding) {
-	uint64 hash = 0xCBF29CE484222325LL;
-
-	ScopedPtr<SeekableReadStream> data(convertString(string, encoding, false));
-	if (!data)
-		return hash;
-
-	uint32 c;
-	while ((c = data->readChar()) != ReadStream::kEOF)
-		hash = hashFNV64(hash, c);
+	return hashEncoded<uint64, hashFNV64>(0xCBF29CE484222325LL, string, encoding);
+}
 
-	return hash;
+static inline uint64 hashDataFNV64(const byte *data, size_t size) {
+	return hashBytes<uint64, hashFNV64>(0xCBF29CE484222325LL, data, size);
 }
 // '--- 64bit Fowler-Noll-Vo hash by Glenn Fowler, Landon Curt Noll and Phong Vo ---'
 
@@ -191,26 +274,15 @@ static inline uint32 hashCRC32(uint32 hash, uint32 c) {
 }
 
 static inline uint32 hashStringCRC32(const UString &string) {
-	uint32 hash = 0xFFFFFFFF;
-
-	for (UString::iterator it = string.begin(); it != string.end(); ++it)
-		hash = hashCRC32(hash, *it);
-
-	return hash ^ 0xFFFFFFFF;
+	return hashCodepoints<uint32, hashCRC32>(0xFFFFFFFF, string) ^ 0xFFFFFFFF;
 }
 
 static inline uint32 hashStringCRC32(const UString &string, Encoding encoding) {
-	uint32 hash = 0xFFFFFFFF;
-
-	ScopedPtr<SeekableReadStream> data(convertString(string, encoding, false));
-	if (!data)
-		return hash;
-
-	uint32 c;
-	while ((c = data->readChar()) != ReadStream::kEOF)
-		hash = hashCRC32(hash, c);
+	return hashEncoded<uint32, hashCRC32>(0xFFFFFFFF, string, encoding) ^ 0xFFFFFFFF;
+}
 
-	return hash ^ 0xFFFFFFFF;
+static inline uint32 hashDataCRC32(const byte *data, size_t size) {
+	return calculateCRC32(data, size);
 }
 // '--- CRC32, based on the implementation by Gary S. Brown ---'
 
@@ -258,6 +330,28 @@ static inline uint64 hashString(const UString &string, HashAlgo algo, Encoding e
 	return 0;
 }
 
+/** Hash the raw data with the given algorithm. */
+static inline uint64 hashData(const byte *data, size_t size, HashAlgo algo) {
+	switch (algo) {
+		case kHashDJB2:
+			return hashDataDJB2(data, size);
+
+		case kHashFNV32:
+			return hashDataFNV32(data, size);
+
+		case kHashFNV64:
+			return hashDataFNV64(data, size);
+
+		case kHashCRC32:
+			return hashDataCRC32(data, size);
+
+		default:
+			break;
+	}
+
+	return 0;
+}
+
 static inline UString formatHash(uint64 hash) {
 	return UString::format("0x%04X%04X%04X%04X",
 			(uint) ((hash >> 48) & 0xFFFF),
@@ -26,11 +26,18 @@
 #include "src/common/types.h"
 #include <lzma.h>
 
+#include <cassert>
+#include <cstring>
+
+#include <vector>
+
 #include <boost/scope_exit.hpp>
+#include <boost/thread/tss.hpp>
 
 #include "src/common/lzma.h"
 #include "src/common/scopedptr.h"
 #include "src/common/error.h"
+#include "src/common/util.h"
 #include "src/common/memreadstream.h"
 
 namespace Common {
@@ -62,47 +69,163 @@ static lzma_allocator kLZMAAllocator = {
 	&lzmaAlloc, &lzmaFree, 0
 };
 
-byte *decompressLZMA1(const byte *data, size_t inputSize, size_t outputSize) {
-	lzma_filter filters[2] = {
-		{ LZMA_FILTER_LZMA1, 0 },
-		{ LZMA_VLI_UNKNOWN , 0 }
-	};
+/** Return the size of the LZMA1 properties in front of the compressed data. */
+static size_t getLZMA1PropertiesSize() {
+	lzma_filter filter = { LZMA_FILTER_LZMA1, 0 };
 
-	if (!lzma_filter_decoder_is_supported(filters[0].id))
+	if (!lzma_filter_decoder_is_supported(filter.id))
 		throw Exception("LZMA1 compression not supported");
 
 	uint32 propsSize;
-	if (lzma_properties_size(&propsSize, &filters[0]) != LZMA_OK)
+	if (lzma_properties_size(&propsSize, &filter) != LZMA_OK)
 		throw Exception("Can't get LZMA1 properties size");
 
-	if (propsSize > inputSize)
-		throw Exception("LZMA1 properties size larger than input data");
+	return propsSize;
+}
 
-	if (lzma_properties_decode(&filters[0], &kLZMAAllocator, data, propsSize) != LZMA_OK)
-		throw Exception("Failed to decode LZMA1 properties");
+/** A raw LZMA1 decoder that can be reused for several compressed streams.
+ *
+ *  liblzma reuses the memory of an already initialized decoder, most
+ *  importantly the dictionary, when it's initialized again with compatible
+ *  options. Restarting the decoder is therefore much cheaper than creating
+ *  a new one.
+ */
+struct LZMADecoder : boost::noncopyable {
+	lzma_stream strm;
 
-	data      += propsSize;
-	inputSize -= propsSize;
+	/** The properties we decoded last, to avoid decoding them again. */
+	std::vector<byte> properties;
+	lzma_options_lzma options;
+
+	/** The dictionary size we used last. */
+	uint32 dictSize;
+
+	LZMADecoder() : dictSize(0) {
+		const lzma_stream init = LZMA_STREAM_INIT;
+		strm = init;
+
+		std::memset(&options, 0, sizeof(options));
+	}
 
-	lzma_stream strm = LZMA_STREAM_INIT;
-	BOOST_SCOPE_EXIT( (&strm) (&filters) ) {
-		kLZMAAllocator.free(0, filters[0].options);
+	~LZMADecoder() {
 		lzma_end(&strm);
+	}
+
+	/** (Re)start decoding data compressed with these LZMA1 properties.
+	 *
+	 *  If the size of the decompressed data is known, the dictionary does
+	 *  not need to be any larger than that.
+	 */
+	void start(const byte *props, size_t propsSize, size_t outputSize) {
+		if ((properties.size() != propsSize) || (std::memcmp(&properties[0], props, propsSize) != 0)) {
+			properties.clear();
+
+			lzma_filter filter = { LZMA_FILTER_LZMA1, 0 };
+			if (lzma_properties_decode(&filter, &kLZMAAllocator, props, propsSize) != LZMA_OK)
+				throw Exception("Failed to decode LZMA1 properties");
+
+			options = *static_cast<lzma_options_lzma *>(filter.options);
+			kLZMAAllocator.free(0, filter.options);
+
+			properties.assign(props, props + propsSize);
+		}
+
+		/* Shrink the dictionary to the size of the output. But stick to the size
+		 * we used last, if large enough, so that liblzma can keep its buffer. */
+		uint32 neededSize = options.dict_size;
+		if (outputSize < neededSize)
+			neededSize = MAX<uint32>(outputSize, LZMA_DICT_SIZE_MIN);
+
+		lzma_options_lzma currentOptions = options;
+		currentOptions.dict_size = ((dictSize >= neededSize) && (dictSize <= options.dict_size)) ? dictSize : neededSize;
+
+		lzma_filter filters[2] = {
+			{ LZMA_FILTER_LZMA1, &currentOptions },
+			{ LZMA_VLI_UNKNOWN , 0 }
+		};
+
+		const lzma_ret lzmaRet = lzma_raw_decoder(&strm, filters);
+		if (lzmaRet != LZMA_OK)
+			throw Exception("Failed to create raw LZMA1 decoder: %d", (int) lzmaRet);
+
+		dictSize = currentOptions.dict_size;
+
+		strm.next_in   = 0;
+		strm.avail_in  = 0;
+		strm.next_out  = 0;
+		strm.avail_out = 0;
+	}
+};
+
+/** The decoders a thread keeps around for later. */
+struct LZMADecoderCache : boost::noncopyable {
+	/** The maximum number of idle decoders kept by a thread. */
+	static const size_t kMaxDecoders = 4;
+
+	std::vector<LZMADecoder *> decoders;
+
+	~LZMADecoderCache() {
+		for (std::vector<LZMADecoder *>::iterator d = decoders.begin(); d != decoders.end(); ++d)
+			delete *d;
+	}
+};
+
+static boost::thread_specific_ptr<LZMADecoderCache> lzmaDecoderCache;
+
+/** Take an idle decoder from this thread's cache, or create a new one. */
+static LZMADecoder *acquireLZMADecoder() {
+	LZMADecoderCache *cache = lzmaDecoderCache.get();
+	if (!cache || cache->decoders.empty())
+		return new LZMADecoder;
+
+	LZMADecoder *decoder = cache->decoders.back();
+	cache->decoders.pop_back();
+
+	return decoder;
+}
+
+/** Give a decoder back into this thread's cache. */
+static void releaseLZMADecoder(LZMADecoder *decoder) {
+	if (!decoder)
+		return;
+
+	if (!lzmaDecoderCache.get())
+		lzmaDecoderCache.reset(new LZMADecoderCache);
+
+	LZMADecoderCache &cache = *lzmaDecoderCache;
+	if (cache.decoders.size() >= LZMADecoderCache::kMaxDecoders) {
+		delete decoder;
+		return;
+	}
+
+	cache.decoders.push_back(decoder);
+}
+
+byte *decompressLZMA1(const byte *data, size_t inputSize, size_t outputSize) {
+	const size_t propsSize = getLZMA1PropertiesSize();
+	if (propsSize > inputSize)
+		throw Exception("LZMA1 properties size larger than input data");
+
+	LZMADecoder *decoder = acquireLZMADecoder();
+	BOOST_SCOPE_EXIT( (&decoder) ) {
+		releaseLZMADecoder(decoder);
 	} BOOST_SCOPE_EXIT_END
 
-	lzma_ret lzmaRet = LZMA_OK;
+	decoder->start(data, propsSize, outputSize);
 
-	if ((lzmaRet = lzma_raw_decoder(&strm, filters)) != LZMA_OK)
-		throw Exception("Failed to create raw LZMA1 decoder: %d", (int) lzmaRet);
+	data      += propsSize;
+	inputSize -= propsSize;
 
 	ScopedArray<byte> outputData(new byte[outputSize]);
 
+	lzma_stream &strm = decoder->strm;
+
 	strm.next_in   = data;
 	strm.avail_in  = inputSize;
 	strm.next_out  = outputData.get();
 	strm.avail_out = outputSize;
 
-	lzmaRet = lzma_code(&strm, LZMA_FINISH);
+	const lzma_ret lzmaRet = lzma_code(&strm, LZMA_FINISH);
 
 	if ((lzmaRet != LZMA_STREAM_END) || (strm.avail_out != 0)) {
 		if (lzmaRet == LZMA_OK)
@@ -127,4 +250,198 @@ SeekableReadStream *decompressLZMA1(ReadStream &input, size_t inputSize, size_t
 	return new MemoryReadStream(outputData, outputSize, true);
 }
 
+
+LZMAReadStream::LZMAReadStream(SeekableReadStream *input, size_t outputSize, bool disposeInput) :
+	_input(input, disposeInput), _inputBegin(0), _inputPos(0), _inputEnd(0), _inputData(0),
+	_propertiesSize(0), _decoder(0), _size(outputSize), _pos(0), _eos(false), _streamEnd(false) {
+
+	assert(input);
+
+	_inputBegin = _input->pos();
+	_inputEnd   = _input->size();
+
+	if ((_inputBegin == kPositionInvalid) || (_inputEnd == kSizeInvalid) || (_inputBegin > _inputEnd))
+		throw Exception("Invalid input stream for LZMA1 decompression");
+
+	_propertiesSize = getLZMA1PropertiesSize();
+	if (_propertiesSize > (_inputEnd - _inputBegin))
+		throw Exception("LZMA1 properties size larger than input data");
+
+	_properties.reset(new byte[_propertiesSize]);
+	if (_input->readAt(_inputBegin, _properties.get(), _propertiesSize) != _propertiesSize)
+		throw Exception(kReadError);
+
+	_inputBegin += _propertiesSize;
+
+	/* If the input is in memory anyway, let liblzma read straight from there.
+	 * Otherwise, we need to read the compressed data in chunks. */
+	const MemoryReadStream *memInput = dynamic_cast<const MemoryReadStream *>(_input.get());
+	if (memInput)
+		_inputData = memInput->getData();
+	else
+		_inputBuffer.reset(new byte[kInputBufferSize]);
+
+	_decoder = acquireLZMADecoder();
+
+	try {
+		reset();
+	} catch (...) {
+		releaseLZMADecoder(_decoder);
+		throw;
+	}
+}
+
+LZMAReadStream::~LZMAReadStream() {
+	releaseLZMADecoder(_decoder);
+}
+
+bool LZMAReadStream::eos() const {
+	return _eos;
+}
+
+size_t LZMAReadStream::pos() const {
+	return _pos;
+}
+
+size_t LZMAReadStream::size() const {
+	return _size;
+}
+
+void LZMAReadStream::reset() {
+	_decoder->start(_properties.get(), _propertiesSize, _size);
+
+	_inputPos  = _inputBegin;
+	_pos       = 0;
+	_streamEnd = false;
+}
+
+void LZMAReadStream::fillInput() {
+	const size_t inputSize = MIN<size_t>(_inputEnd - _inputPos, _inputData ? SIZE_MAX : kInputBufferSize);
+
+	if (_inputData) {
+		_decoder->strm.next_in = _inputData + _inputPos;
+	} else {
+		if (_input->readAt(_inputPos, _inputBuffer.get(), inputSize) != inputSize)
+			throw Exception(kReadError);
+
+		_decoder->strm.next_in = _inputBuffer.get();
+	}
+
+	_decoder->strm.avail_in = inputSize;
+	_inputPos += inputSize;
+}
+
+bool LZMAReadStream::decode() {
+	lzma_stream &strm = _decoder->strm;
+
+	if ((strm.avail_in == 0) && (_inputPos < _inputEnd))
+		fillInput();
+
+	// Once all compressed data was handed over, there's nothing more to wait for
+	const lzma_action action = (_inputPos < _inputEnd) ? LZMA_RUN : LZMA_FINISH;
+
+	const lzma_ret lzmaRet = lzma_code(&strm, action);
+
+	if (lzmaRet == LZMA_STREAM_END)
+		return true;
+
+	if (lzmaRet == LZMA_BUF_ERROR)
+		throw Exception("Failed to uncompress LZMA1 data: premature end of input data");
+
+	if (lzmaRet != LZMA_OK)
+		throw Exception("Failed to uncompress LZMA1 data: %d", (int) lzmaRet);
+
+	return false;
+}
+
+size_t LZMAReadStream::read(void *dataPtr, size_t dataSize) {
+	assert(dataPtr);
+
+	// Never decompress past the size we know
+	if ((_size != kSizeInvalid) && (dataSize > (_size - _pos))) {
+		dataSize = _size - _pos;
+		_eos = true;
+	}
+
+	lzma_stream &strm = _decoder->strm;
+
+	strm.next_out  = static_cast<byte *>(dataPtr);
+	strm.avail_out = dataSize;
+
+	while ((strm.avail_out > 0) && !_streamEnd)
+		_streamEnd = decode();
+
+	const size_t readSize = dataSize - strm.avail_out;
+	_pos += readSize;
+
+	if (_streamEnd) {
+		if (_size == kSizeInvalid)
+			_size = _pos;
+		else if (_pos != _size)
+			throw Exception("Failed to uncompress LZMA1 data: output buffer not completely filled");
+
+	} else if (_pos == _size)
+		checkStreamEnd();
+
+	if (readSize < dataSize)
+		_eos = true;
+
+	return readSize;
+}
+
+void LZMAReadStream::checkStreamEnd() {
+	/* We've read all the data we expected. Make sure the compressed
+	 * stream really ends here and doesn't hold any more data. */
+
+	byte extra;
+
+	lzma_stream &strm = _decoder->strm;
+
+	strm.next_out  = &extra;
+	strm.avail_out = 1;
+
+	while (!_streamEnd) {
+		_streamEnd = decode();
+
+		if (strm.avail_out == 0)
+			throw Exception("Failed to uncompress LZMA1 data: premature end of output buffer");
+	}
+}
+
+void LZMAReadStream::skipTo(size_t newPos) {
+	byte buffer[4096];
+
+	while (_pos < newPos) {
+		const size_t skipSize = MIN<size_t>(newPos - _pos, sizeof(buffer));
+
+		if (read(buffer, skipSize) != skipSize)
+			throw Exception(kSeekError);
+	}
+}
+
+size_t LZMAReadStream::seek(ptrdiff_t offset, Origin whence) {
+	const size_t oldPos = _pos;
+
+	// To seek relative to the end, we need to know where that is
+	if ((whence == kOriginEnd) && (_size == kSizeInvalid)) {
+		byte buffer[4096];
+		while (!_streamEnd)
+			read(buffer, sizeof(buffer));
+	}
+
+	const size_t newPos = evalSeek(offset, whence, _pos, 0, size());
+	if ((_size != kSizeInvalid) && (newPos > _size))
+		throw Exception(kSeekError);
+
+	if (newPos < _pos)
+		reset();
+
+	skipTo(newPos);
+
+	// Reset end-of-stream flag on a successful seek
+	_eos = false;
+
+	return oldPos;
+}
+
 } // End of namespace Common
@@ -25,12 +25,16 @@
 #ifndef COMMON_LZMA_H
 #define COMMON_LZMA_H
 
+#include <boost/noncopyable.hpp>
+
 #include "src/common/types.h"
+#include "src/common/scopedptr.h"
+#include "src/common/disposableptr.h"
+#include "src/common/readstream.h"
 
 namespace Common {
 
-class ReadStream;
-class SeekableReadStream;
+struct LZMADecoder;
 
 /** Decompress using the LZMA1 algorithm.
  *
@@ -56,6 +60,83 @@ byte *decompressLZMA1(const byte *data, size_t inputSize, size_t outputSize);
  */
 SeekableReadStream *decompressLZMA1(ReadStream &input, size_t inputSize, size_t outputSize);
 
+/** A stream that decompresses raw LZMA1 data on the fly, while it is read.
+ *
+ *  The compressed data starts with the LZMA1 properties, like the data
+ *  decompressLZMA1() takes. Only the decoder's dictionary, which is never
+ *  larger than the decompressed data, is held in memory. Seeking forward
+ *  decompresses and discards the data up to the new position, while
+ *  seeking backwards restarts the decompression from the beginning.
+ *
+ *  The decoders are kept around by each thread once a stream is done with
+ *  them, and reset for the next stream instead of being created anew.
+ *
+ *  The compressed data is read from the input stream with readAt(), starting
+ *  at the input stream's position when the LZMAReadStream is created, and
+ *  up to the end of the input stream. The input stream's position itself is
+ *  never changed.
+ */
+class LZMAReadStream : boost::noncopyable, public SeekableReadStream {
+public:
+	/** Create an LZMAReadStream decompressing the input stream.
+	 *
+	 *  @param input         The stream with the compressed data.
+	 *  @param outputSize    The size of the decompressed data, or kSizeInvalid if unknown.
+	 *                       If known, it is an error for the data to decompress to
+	 *                       any other size.
+	 *  @param disposeInput  Should the input stream be deleted together with this stream?
+	 */
+	LZMAReadStream(SeekableReadStream *input, size_t outputSize, bool disposeInput = true);
+	~LZMAReadStream();
+
+	bool eos() const;
+
+	size_t read(void *dataPtr, size_t dataSize);
+
+	size_t pos() const;
+	size_t size() const;
+
+	size_t seek(ptrdiff_t offset, Origin whence = kOriginBegin);
+
+private:
+	/** The size of the buffer for compressed data read from non-memory streams. */
+	static const size_t kInputBufferSize = 16384;
+
+	DisposablePtr<SeekableReadStream> _input;
+
+	size_t _inputBegin; ///< Offset of the compressed data within the input stream.
+	size_t _inputPos;   ///< Offset of the next compressed data to read.
+	size_t _inputEnd;   ///< Offset of the end of the compressed data.
+
+	/** The compressed data, if the input stream is a memory stream. */
+	const byte *_inputData;
+	/** Buffer for compressed data, if the input stream isn't a memory stream. */
+	ScopedArray<byte> _inputBuffer;
+
+	/** The LZMA1 properties in front of the compressed data. */
+	ScopedArray<byte> _properties;
+	size_t _propertiesSize;
+
+	LZMADecoder *_decoder;
+
+	size_t _size; ///< The size of the decompressed data, or kSizeInvalid if not yet known.
+	size_t _pos;  ///< The current position within the decompressed data.
+
+	bool _eos;       ///< Have we tried reading past the end of the stream?
+	bool _streamEnd; ///< Have we reached the end of the compressed data?
+
+	/** Start decompressing from the beginning again. */
+	void reset();
+	/** Make more compressed data available to liblzma. */
+	void fillInput();
+	/** Decompress and discard data until we reached the new position. */
+	void skipTo(size_t newPos);
+	/** Make sure the compressed data doesn't contain more than we expected. */
+	void checkStreamEnd();
+	/** Run the decoder once. Return true if the end of the compressed data was reached. */
+	bool decode();
+};
+
 } // End of namespace Common
 
 #endif // COMMON_LZMA_H
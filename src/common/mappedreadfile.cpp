@@ -0,0 +1,158 @@
+/* Phaethon - A FLOSS resource explorer for BioWare's Aurora engine games
+ *
+ * Phaethon is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * Phaethon is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * Phaethon is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Phaethon. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  Implementing the stream reading interfaces for memory-mapped files.
+ */
+
+#include "src/common/system.h"
+
+#if defined(WIN32)
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#else
+	#include <sys/types.h>
+	#include <sys/stat.h>
+	#include <sys/mman.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+#include <boost/filesystem/path.hpp>
+
+#include "src/common/mappedreadfile.h"
+#include "src/common/readfile.h"
+#include "src/common/error.h"
+#include "src/common/ustring.h"
+
+namespace Common {
+
+// .--- FileMapping ---.
+#if defined(WIN32)
+
+FileMapping::FileMapping(const UString &fileName) : _data(0), _size(0) {
+	HANDLE file = CreateFileW(boost::filesystem::path(fileName.c_str()).c_str(), GENERIC_READ,
+	                          FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+	if (file == INVALID_HANDLE_VALUE)
+		throw Exception("Can't open file \"%s\"", fileName.c_str());
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || ((uint64) fileSize.QuadPart > (uint64) SIZE_MAX)) {
+		CloseHandle(file);
+		throw Exception("Can't map file \"%s\"", fileName.c_str());
+	}
+
+	_size = (size_t) fileSize.QuadPart;
+
+	// Empty files can't be mapped, but they don't need to be either
+	if (_size == 0) {
+		CloseHandle(file);
+		return;
+	}
+
+	HANDLE mapping = CreateFileMappingW(file, 0, PAGE_READONLY, 0, 0, 0);
+	CloseHandle(file);
+
+	if (!mapping)
+		throw Exception("Can't map file \"%s\"", fileName.c_str());
+
+	// The view keeps the mapping and the file alive until it's unmapped
+	_data = static_cast<const byte *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	CloseHandle(mapping);
+
+	if (!_data)
+		throw Exception("Can't map file \"%s\"", fileName.c_str());
+}
+
+FileMapping::~FileMapping() {
+	if (_data)
+		UnmapViewOfFile(_data);
+}
+
+#else
+
+FileMapping::FileMapping(const UString &fileName) : _data(0), _size(0) {
+	int file = ::open(boost::filesystem::path(fileName.c_str()).c_str(), O_RDONLY);
+	if (file < 0)
+		throw Exception("Can't open file \"%s\"", fileName.c_str());
+
+	struct stat fileStat;
+	if ((fstat(file, &fileStat) != 0) || !S_ISREG(fileStat.st_mode) ||
+	    ((uint64) fileStat.st_size > (uint64) SIZE_MAX)) {
+
+		::close(file);
+		throw Exception("Can't map file \"%s\"", fileName.c_str());
+	}
+
+	_size = (size_t) fileStat.st_size;
+
+	// Empty files can't be mapped, but they don't need to be either
+	if (_size == 0) {
+		::close(file);
+		return;
+	}
+
+	// The mapping keeps the file alive until it's unmapped
+	void *data = mmap(0, _size, PROT_READ, MAP_PRIVATE, file, 0);
+	::close(file);
+
+	if (data == MAP_FAILED)
+		throw Exception("Can't map file \"%s\"", fileName.c_str());
+
+	_data = static_cast<const byte *>(data);
+}
+
+FileMapping::~FileMapping() {
+	if (_data)
+		munmap(const_cast<byte *>(_data), _size);
+}
+
+#endif
+
+const byte *FileMapping::getMappedData() const {
+	return _data;
+}
+
+size_t FileMapping::getMappedSize() const {
+	return _size;
+}
+// '--- FileMapping ---'
+
+
+MappedReadFile::MappedReadFile(const UString &fileName) : FileMapping(fileName),
+	MemoryReadStream(getMappedData(), getMappedSize()) {
+
+}
+
+MappedReadFile::~MappedReadFile() {
+}
+
+
+SeekableReadStream *openReadFile(const UString &fileName) {
+	try {
+		return new MappedReadFile(fileName);
+	} catch (Exception &) {
+		// Mapping the file failed, so try to read it normally instead
+	}
+
+	return new ReadFile(fileName);
+}
+
+} // End of namespace Common
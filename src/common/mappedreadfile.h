@@ -0,0 +1,87 @@
+/* Phaethon - A FLOSS resource explorer for BioWare's Aurora engine games
+ *
+ * Phaethon is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * Phaethon is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * Phaethon is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Phaethon. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  Implementing the stream reading interfaces for memory-mapped files.
+ */
+
+#ifndef COMMON_MAPPEDREADFILE_H
+#define COMMON_MAPPEDREADFILE_H
+
+#include "src/common/types.h"
+#include "src/common/memreadstream.h"
+
+namespace Common {
+
+class UString;
+
+/** A read-only memory mapping of a whole file. */
+class FileMapping {
+public:
+	/** Map the file with the given fileName into memory.
+	 *
+	 *  Throws an Exception if the file can't be opened or mapped.
+	 */
+	FileMapping(const UString &fileName);
+	~FileMapping();
+
+	/** Return the mapped data. */
+	const byte *getMappedData() const;
+	/** Return the size of the mapped data. */
+	size_t getMappedSize() const;
+
+private:
+	const byte *_data; ///< The mapped data, or 0 for an empty file.
+	size_t      _size; ///< The size of the mapped data.
+
+	FileMapping(const FileMapping &);
+	FileMapping &operator=(const FileMapping &);
+};
+
+/** A file reading class that maps the whole file into memory.
+ *
+ *  Since the file's contents are directly available in memory, reading
+ *  from a MappedReadFile is just a memcpy() out of the mapping, without
+ *  any system calls. Moreover, being a MemoryReadStream, createMemoryView()
+ *  can create sub streams of a MappedReadFile that directly reference the
+ *  mapped memory, without copying and without seeking the MappedReadFile.
+ */
+class MappedReadFile : private FileMapping, public MemoryReadStream {
+public:
+	/** Open and map the file with the given fileName.
+	 *
+	 *  Throws an Exception if the file can't be opened or mapped.
+	 */
+	MappedReadFile(const UString &fileName);
+	~MappedReadFile();
+};
+
+/** Open a file for reading.
+ *
+ *  If possible, the file is memory-mapped into a MappedReadFile. If that
+ *  fails, fall back to a normal ReadFile instead.
+ *
+ *  Throws an Exception if the file can't be opened at all.
+ */
+SeekableReadStream *openReadFile(const UString &fileName);
+
+} // End of namespace Common
+
+#endif // COMMON_MAPPEDREADFILE_H
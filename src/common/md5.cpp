@@ -22,8 +22,11 @@
  *  Hashing/digesting using the MD5 algorithm.
  */
 
+#include <cassert>
 #include <cstring>
 
+#include "src/common/util.h"
+#include "src/common/error.h"
 #include "src/common/md5.h"
 #include "src/common/ustring.h"
 #include "src/common/readstream.h"
@@ -235,12 +238,18 @@ static const byte *md5Body(MD5Context &ctx, const byte *data, size_t size) {
 	return ptr;
 }
 
-static void md5Update(MD5Context &ctx, const byte *data, size_t size) {
+static uint32 md5Count(MD5Context &ctx, size_t size) {
 	uint32 saved_lo = ctx.lo;
 	if ((ctx.lo = (saved_lo + size) & 0x1FFFFFFF) < saved_lo)
 		ctx.hi++;
 	ctx.hi += size >> 29;
 
+	return saved_lo;
+}
+
+static void md5Update(MD5Context &ctx, const byte *data, size_t size) {
+	uint32 saved_lo = md5Count(ctx, size);
+
 	size_t used = saved_lo & 0x3F;
 
 	if (used) {
@@ -310,21 +319,144 @@ static void md5Final(byte *result, MD5Context &ctx) {
 	result[14] = ctx.d >> 16;
 	result[15] = ctx.d >> 24;
 }
-// '--- MD5, based on the implementation by Alexander Peslyak ---'
 
+/** The number of arrays hashed at the same time by md5BodyInterleaved(). */
+static const size_t kMD5Lanes = 4;
 
-void hashMD5(ReadStream &stream, std::vector<byte> &digest) {
-	MD5Context ctx;
+/*
+ * The MD5 transformation for all four rounds, on all lanes at once.
+ */
+#define STEPS(f, a, b, c, d, n, t, s) \
+	for (size_t l = 0; l < kMD5Lanes; l++) { \
+		STEP(f, a[l], b[l], c[l], d[l], x[l][(n)], t, s) \
+	}
 
-	byte buf[4096];
-	while (!stream.eos()) {
-		size_t bufRead = stream.read(buf, 4096);
+/*
+ * This processes the same number of 64-byte data blocks in each of the
+ * lanes, interleaving the steps of all lanes. Like md5Body(), it does NOT
+ * update the bit counters.
+ */
+static void md5BodyInterleaved(MD5Context *ctx[kMD5Lanes], const byte *data[kMD5Lanes], size_t blocks) {
+	uint32 a[kMD5Lanes], b[kMD5Lanes], c[kMD5Lanes], d[kMD5Lanes];
+	uint32 x[kMD5Lanes][16];
+
+	for (size_t l = 0; l < kMD5Lanes; l++) {
+		a[l] = ctx[l]->a;
+		b[l] = ctx[l]->b;
+		c[l] = ctx[l]->c;
+		d[l] = ctx[l]->d;
+	}
+
+	for (; blocks > 0; blocks--) {
+		uint32 saved_a[kMD5Lanes], saved_b[kMD5Lanes], saved_c[kMD5Lanes], saved_d[kMD5Lanes];
+
+		for (size_t l = 0; l < kMD5Lanes; l++) {
+			for (size_t n = 0; n < 16; n++)
+				x[l][n] = READ_LE_UINT32(data[l] + n * 4);
+
+			data[l] += 64;
+
+			saved_a[l] = a[l];
+			saved_b[l] = b[l];
+			saved_c[l] = c[l];
+			saved_d[l] = d[l];
+		}
+
+/* Round 1 */
+		STEPS(F, a, b, c, d, 0, 0xD76AA478, 7)
+		STEPS(F, d, a, b, c, 1, 0xE8C7B756, 12)
+		STEPS(F, c, d, a, b, 2, 0x242070DB, 17)
+		STEPS(F, b, c, d, a, 3, 0xC1BDCEEE, 22)
+		STEPS(F, a, b, c, d, 4, 0xF57C0FAF, 7)
+		STEPS(F, d, a, b, c, 5, 0x4787C62A, 12)
+		STEPS(F, c, d, a, b, 6, 0xA8304613, 17)
+		STEPS(F, b, c, d, a, 7, 0xFD469501, 22)
+		STEPS(F, a, b, c, d, 8, 0x698098D8, 7)
+		STEPS(F, d, a, b, c, 9, 0x8B44F7AF, 12)
+		STEPS(F, c, d, a, b, 10, 0xFFFF5BB1, 17)
+		STEPS(F, b, c, d, a, 11, 0x895CD7BE, 22)
+		STEPS(F, a, b, c, d, 12, 0x6B901122, 7)
+		STEPS(F, d, a, b, c, 13, 0xFD987193, 12)
+		STEPS(F, c, d, a, b, 14, 0xA679438E, 17)
+		STEPS(F, b, c, d, a, 15, 0x49B40821, 22)
+
+/* Round 2 */
+		STEPS(G, a, b, c, d, 1, 0xF61E2562, 5)
+		STEPS(G, d, a, b, c, 6, 0xC040B340, 9)
+		STEPS(G, c, d, a, b, 11, 0x265E5A51, 14)
+		STEPS(G, b, c, d, a, 0, 0xE9B6C7AA, 20)
+		STEPS(G, a, b, c, d, 5, 0xD62F105D, 5)
+		STEPS(G, d, a, b, c, 10, 0x02441453, 9)
+		STEPS(G, c, d, a, b, 15, 0xD8A1E681, 14)
+		STEPS(G, b, c, d, a, 4, 0xE7D3FBC8, 20)
+		STEPS(G, a, b, c, d, 9, 0x21E1CDE6, 5)
+		STEPS(G, d, a, b, c, 14, 0xC33707D6, 9)
+		STEPS(G, c, d, a, b, 3, 0xF4D50D87, 14)
+		STEPS(G, b, c, d, a, 8, 0x455A14ED, 20)
+		STEPS(G, a, b, c, d, 13, 0xA9E3E905, 5)
+		STEPS(G, d, a, b, c, 2, 0xFCEFA3F8, 9)
+		STEPS(G, c, d, a, b, 7, 0x676F02D9, 14)
+		STEPS(G, b, c, d, a, 12, 0x8D2A4C8A, 20)
+
+/* Round 3 */
+		STEPS(H, a, b, c, d, 5, 0xFFFA3942, 4)
+		STEPS(H2, d, a, b, c, 8, 0x8771F681, 11)
+		STEPS(H, c, d, a, b, 11, 0x6D9D6122, 16)
+		STEPS(H2, b, c, d, a, 14, 0xFDE5380C, 23)
+		STEPS(H, a, b, c, d, 1, 0xA4BEEA44, 4)
+		STEPS(H2, d, a, b, c, 4, 0x4BDECFA9, 11)
+		STEPS(H, c, d, a, b, 7, 0xF6BB4B60, 16)
+		STEPS(H2, b, c, d, a, 10, 0xBEBFBC70, 23)
+		STEPS(H, a, b, c, d, 13, 0x289B7EC6, 4)
+		STEPS(H2, d, a, b, c, 0, 0xEAA127FA, 11)
+		STEPS(H, c, d, a, b, 3, 0xD4EF3085, 16)
+		STEPS(H2, b, c, d, a, 6, 0x04881D05, 23)
+		STEPS(H, a, b, c, d, 9, 0xD9D4D039, 4)
+		STEPS(H2, d, a, b, c, 12, 0xE6DB99E5, 11)
+		STEPS(H, c, d, a, b, 15, 0x1FA27CF8, 16)
+		STEPS(H2, b, c, d, a, 2, 0xC4AC5665, 23)
 
-		md5Update(ctx, buf, bufRead);
+/* Round 4 */
+		STEPS(I, a, b, c, d, 0, 0xF4292244, 6)
+		STEPS(I, d, a, b, c, 7, 0x432AFF97, 10)
+		STEPS(I, c, d, a, b, 14, 0xAB9423A7, 15)
+		STEPS(I, b, c, d, a, 5, 0xFC93A039, 21)
+		STEPS(I, a, b, c, d, 12, 0x655B59C3, 6)
+		STEPS(I, d, a, b, c, 3, 0x8F0CCC92, 10)
+		STEPS(I, c, d, a, b, 10, 0xFFEFF47D, 15)
+		STEPS(I, b, c, d, a, 1, 0x85845DD1, 21)
+		STEPS(I, a, b, c, d, 8, 0x6FA87E4F, 6)
+		STEPS(I, d, a, b, c, 15, 0xFE2CE6E0, 10)
+		STEPS(I, c, d, a, b, 6, 0xA3014314, 15)
+		STEPS(I, b, c, d, a, 13, 0x4E0811A1, 21)
+		STEPS(I, a, b, c, d, 4, 0xF7537E82, 6)
+		STEPS(I, d, a, b, c, 11, 0xBD3AF235, 10)
+		STEPS(I, c, d, a, b, 2, 0x2AD7D2BB, 15)
+		STEPS(I, b, c, d, a, 9, 0xEB86D391, 21)
+
+		for (size_t l = 0; l < kMD5Lanes; l++) {
+			a[l] += saved_a[l];
+			b[l] += saved_b[l];
+			c[l] += saved_c[l];
+			d[l] += saved_d[l];
+		}
 	}
 
-	digest.resize(kMD5Length);
-	md5Final(&digest[0], ctx);
+	for (size_t l = 0; l < kMD5Lanes; l++) {
+		ctx[l]->a = a[l];
+		ctx[l]->b = b[l];
+		ctx[l]->c = c[l];
+		ctx[l]->d = d[l];
+	}
+}
+// '--- MD5, based on the implementation by Alexander Peslyak ---'
+
+
+void hashMD5(ReadStream &stream, std::vector<byte> &digest) {
+	MD5Hasher hasher;
+
+	hasher.update(stream);
+	hasher.finish(digest);
 }
 
 void hashMD5(const byte *data, size_t dataLength, std::vector<byte> &digest) {
@@ -345,6 +477,105 @@ void hashMD5(const std::vector<byte> &data, std::vector<byte> &digest) {
 }
 
 
+/** An array of data hashed by the multi-buffer MD5. */
+struct MD5Job {
+	MD5Context ctx;
+
+	const byte *data;
+	size_t size;
+
+	size_t blocks; ///< The number of whole 64-byte blocks not yet hashed.
+
+	std::vector<byte> *digest;
+
+	MD5Job(const byte *d, size_t s, std::vector<byte> &dg) : data(d), size(s), blocks(s / 64), digest(&dg) {
+		md5Count(ctx, blocks * 64);
+	}
+
+	/** Hash the remaining whole blocks on their own. */
+	void hashBlocks() {
+		if (blocks == 0)
+			return;
+
+		data   = md5Body(ctx, data, blocks * 64);
+		blocks = 0;
+	}
+
+	/** Hash the rest of the data, which doesn't fill a whole block, and finish the digest. */
+	void finish() {
+		assert(blocks == 0);
+
+		md5Update(ctx, data, size % 64);
+
+		digest->resize(kMD5Length);
+		md5Final(&(*digest)[0], ctx);
+	}
+};
+
+void hashMD5(const std::vector<const byte *> &data, const std::vector<size_t> &dataLength,
+             std::vector< std::vector<byte> > &digests) {
+
+	if (data.size() != dataLength.size())
+		throw Exception("MD5 data and length count mismatch (%u vs %u)",
+		                (uint) data.size(), (uint) dataLength.size());
+
+	digests.resize(data.size());
+
+	std::vector<MD5Job> jobs;
+	jobs.reserve(data.size());
+
+	for (size_t i = 0; i < data.size(); i++)
+		jobs.push_back(MD5Job(data[i], dataLength[i], digests[i]));
+
+	/* Fill all lanes with jobs and hash them interleaved, until some of them
+	 * run out of whole blocks. Then finish those jobs and fill their lanes
+	 * with the next ones. */
+
+	MD5Job *lanes[kMD5Lanes];
+	size_t laneCount = 0;
+
+	for (std::vector<MD5Job>::iterator job = jobs.begin(); job != jobs.end(); ++job) {
+		if (job->blocks == 0) {
+			job->finish();
+			continue;
+		}
+
+		lanes[laneCount++] = &*job;
+		if (laneCount < kMD5Lanes)
+			continue;
+
+		size_t blocks = SIZE_MAX;
+		for (size_t l = 0; l < kMD5Lanes; l++)
+			blocks = MIN(blocks, lanes[l]->blocks);
+
+		MD5Context *ctx[kMD5Lanes];
+		const byte *laneData[kMD5Lanes];
+		for (size_t l = 0; l < kMD5Lanes; l++) {
+			ctx     [l] = &lanes[l]->ctx;
+			laneData[l] = lanes[l]->data;
+		}
+
+		md5BodyInterleaved(ctx, laneData, blocks);
+
+		laneCount = 0;
+		for (size_t l = 0; l < kMD5Lanes; l++) {
+			lanes[l]->data   += blocks * 64;
+			lanes[l]->blocks -= blocks;
+
+			if (lanes[l]->blocks == 0)
+				lanes[l]->finish();
+			else
+				lanes[laneCount++] = lanes[l];
+		}
+	}
+
+	// Not enough jobs left to fill all lanes, so hash the remaining ones on their own
+	for (size_t l = 0; l < laneCount; l++) {
+		lanes[l]->hashBlocks();
+		lanes[l]->finish();
+	}
+}
+
 bool compareMD5Digest(ReadStream &stream, const std::vector<byte> &digest) {
 	if (digest.size() != kMD5Length)
 		return false;
@@ -373,4 +604,57 @@ bool compareMD5Digest(const std::vector<byte> &data, const std::vector<byte> &di
 	return compareMD5Digest(&data[0], data.size(), digest);
 }
 
+
+
+MD5Hasher::MD5Hasher() : _ctx(new MD5Context), _buffer(new byte[kBufferSize]), _bufferFill(0) {
+}
+
+MD5Hasher::~MD5Hasher() {
+}
+
+void MD5Hasher::flush() {
+	md5Update(*_ctx, _buffer.get(), _bufferFill);
+
+	_bufferFill = 0;
+}
+
+void MD5Hasher::update(const byte *data, size_t dataLength) {
+	// Collect small pieces of data in the buffer
+	if ((_bufferFill + dataLength) <= kBufferSize) {
+		std::memcpy(_buffer.get() + _bufferFill, data, dataLength);
+		_bufferFill += dataLength;
+
+		return;
+	}
+
+	// Large pieces are hashed directly, without copying
+	flush();
+	md5Update(*_ctx, data, dataLength);
+}
+
+void MD5Hasher::update(ReadStream &stream) {
+	// Read right into the buffer
+	while (!stream.eos()) {
+		if (_bufferFill == kBufferSize)
+			flush();
+
+		_bufferFill += stream.read(_buffer.get() + _bufferFill, kBufferSize - _bufferFill);
+	}
+}
+
+void MD5Hasher::finish(std::vector<byte> &digest) {
+	flush();
+
+	digest.resize(kMD5Length);
+	md5Final(&digest[0], *_ctx);
+
+	reset();
+}
+
+void MD5Hasher::reset() {
+	*_ctx = MD5Context();
+
+	_bufferFill = 0;
+}
+
 } // End of namespace Common
@@ -27,13 +27,18 @@
 
 #include <vector>
 
+#include <boost/noncopyable.hpp>
+
 #include "src/common/types.h"
+#include "src/common/scopedptr.h"
 
 namespace Common {
 
 class UString;
 class ReadStream;
 
+struct MD5Context;
+
 /** The length of an MD5 digest in bytes. */
 static const size_t kMD5Length = 16;
 
@@ -46,6 +51,19 @@ void hashMD5(const UString &string, std::vector<byte> &digest);
 /** Hash the array of data into an MD5 digest of 16 bytes. */
 void hashMD5(const std::vector<byte> &data, std::vector<byte> &digest);
 
+/** Hash several independent arrays of data into one MD5 digest each.
+ *
+ *  Several of the arrays are hashed at the same time, interleaved, which
+ *  is faster than hashing them one after the other. This is meant for
+ *  hashing many resources at once.
+ *
+ *  @param data       The arrays of data to hash.
+ *  @param dataLength The lengths of the arrays.
+ *  @param digests    The digests of the arrays, in the same order.
+ */
+void hashMD5(const std::vector<const byte *> &data, const std::vector<size_t> &dataLength,
+             std::vector< std::vector<byte> > &digests);
+
 /** Hash the stream and compare the digests, returning true if they match. */
 bool compareMD5Digest(ReadStream &stream, const std::vector<byte> &digest);
 /** Hash the array of data and compare the digests, returning true if they match. */
@@ -55,6 +73,41 @@ bool compareMD5Digest(const UString &string, const std::vector<byte> &digest);
 /** Hash the array of data and compare the digests, returning true if they match. */
 bool compareMD5Digest(const std::vector<byte> &data, const std::vector<byte> &digest);
 
+/** Hash data into an MD5 digest incrementally, piece by piece.
+ *
+ *  Small pieces of data are collected in a large internal buffer before
+ *  they are hashed, so feeding the hasher byte by byte is not a problem.
+ */
+class MD5Hasher : boost::noncopyable {
+public:
+	MD5Hasher();
+	~MD5Hasher();
+
+	/** Add this data to the hash. */
+	void update(const byte *data, size_t dataLength);
+	/** Add the rest of the stream to the hash. */
+	void update(ReadStream &stream);
+
+	/** Finish the hash, writing the MD5 digest of 16 bytes.
+	 *
+	 *  Afterwards, the hasher is reset and can be used for new data.
+	 */
+	void finish(std::vector<byte> &digest);
+
+	/** Throw away all data added so far. */
+	void reset();
+
+private:
+	static const size_t kBufferSize = 65536;
+
+	ScopedPtr<MD5Context> _ctx;
+
+	ScopedArray<byte> _buffer;
+	size_t _bufferFill;
+
+	void flush();
+};
+
 } // End of namespace Common
 
 #endif // COMMON_MD5_H
@@ -89,6 +89,18 @@ size_t MemoryReadStream::seek(ptrdiff_t offset, Origin whence) {
 	return oldPos;
 }
 
+size_t MemoryReadStream::readAt(size_t offset, void *dataPtr, size_t dataSize) const {
+	assert(dataPtr);
+
+	if (offset >= _size)
+		return 0;
+
+	dataSize = MIN(dataSize, _size - offset);
+	std::memcpy(dataPtr, _ptrOrig.get() + offset, dataSize);
+
+	return dataSize;
+}
+
 bool MemoryReadStream::eos() const {
 	return _eos;
 }
@@ -115,4 +127,16 @@ MemoryReadStreamEndian::MemoryReadStreamEndian(const byte *dataPtr, size_t dataS
 MemoryReadStreamEndian::~MemoryReadStreamEndian() {
 }
 
+
+MemoryReadStream *createMemoryView(SeekableReadStream &stream, size_t begin, size_t end) {
+	const MemoryReadStream *memStream = dynamic_cast<const MemoryReadStream *>(&stream);
+	if (!memStream)
+		return 0;
+
+	if ((begin > end) || (end > memStream->size()))
+		throw Exception(kSeekError);
+
+	return new MemoryReadStream(memStream->getData() + begin, end - begin);
+}
+
 } // End of namespace Common
@@ -100,6 +100,8 @@ public:
 
 	size_t seek(ptrdiff_t offset, Origin whence = kOriginBegin);
 
+	size_t readAt(size_t offset, void *dataPtr, size_t dataSize) const;
+
 	const byte *getData() const;
 
 private:
@@ -159,6 +161,18 @@ public:
 	}
 };
 
+/** Create a view onto a part of a memory-backed stream, without copying.
+ *
+ *  If the stream is a MemoryReadStream (or a class derived from it, like
+ *  MappedReadFile), return a new MemoryReadStream directly referencing the
+ *  stream's data between begin and end. The position of the parent stream
+ *  is not touched, and the view is only valid as long as the parent stream
+ *  exists.
+ *
+ *  If the stream is not backed by memory, return 0.
+ */
+MemoryReadStream *createMemoryView(SeekableReadStream &stream, size_t begin, size_t end);
+
 } // End of namespace Common
 
 #endif // COMMON_MEMREADSTREAM_H
@@ -22,6 +22,13 @@
  *  Implementing the stream reading interfaces for files.
  */
 
+#include "src/common/system.h"
+
+#if !defined(WIN32)
+	#include <unistd.h>
+	#include <errno.h>
+#endif
+
 #include <cassert>
 
 #include "src/common/readfile.h"
@@ -43,16 +50,36 @@ ReadFile::~ReadFile() {
 	close();
 }
 
-static long getInitialSize(std::FILE *handle) {
+/* std::fseek() and std::ftell() take a long, which is only 32 bits wide on
+ * Windows and on 32-bit systems. We use the 64-bit variants instead, so that
+ * we can handle files larger than 2GB. */
+
+static int seekFile(std::FILE *handle, int64 offset, int whence) {
+#if defined(WIN32)
+	return _fseeki64(handle, offset, whence);
+#else
+	return fseeko(handle, (off_t) offset, whence);
+#endif
+}
+
+static int64 tellFile(std::FILE *handle) {
+#if defined(WIN32)
+	return _ftelli64(handle);
+#else
+	return (int64) ftello(handle);
+#endif
+}
+
+static int64 getInitialSize(std::FILE *handle) {
 	if (!handle)
 		return -1;
 
-	if (std::fseek(handle, 0, SEEK_END) != 0)
+	if (seekFile(handle, 0, SEEK_END) != 0)
 		return -1;
 
-	long fileSize = std::ftell(handle);
+	int64 fileSize = tellFile(handle);
 
-	if (std::fseek(handle, 0, SEEK_SET) != 0)
+	if (seekFile(handle, 0, SEEK_SET) != 0)
 		return -1;
 
 	return fileSize;
@@ -61,7 +88,7 @@ static long getInitialSize(std::FILE *handle) {
 bool ReadFile::open(const UString &fileName) {
 	close();
 
-	long fileSize = -1;
+	int64 fileSize = -1;
 	if (!(_handle  = Platform::openFile(fileName, Platform::kFileModeRead)) ||
 	    ((fileSize = getInitialSize(_handle)) < 0)) {
 
@@ -69,7 +96,8 @@ bool ReadFile::open(const UString &fileName) {
 		return false;
 	}
 
-	if ((uint64)((unsigned long)fileSize) > (uint64)0x7FFFFFFFULL) {
+	// Positions within the stream still have to fit, which limits 32-bit systems to 4GB
+	if ((uint64) fileSize >= (uint64) SIZE_MAX) {
 		warning("ReadFile \"%s\" is too big", fileName.c_str());
 
 		close();
@@ -104,7 +132,7 @@ size_t ReadFile::pos() const {
 	if (!_handle)
 		return kPositionInvalid;
 
-	return (size_t)std::ftell(_handle);
+	return (size_t)tellFile(_handle);
 }
 
 size_t ReadFile::size() const {
@@ -121,11 +149,11 @@ size_t ReadFile::seek(ptrdiff_t offset, Origin whence) {
 
 	size_t oldPos = pos();
 
-	if (std::fseek(_handle, offset, kSeekToWhence[whence]) != 0)
+	if (seekFile(_handle, offset, kSeekToWhence[whence]) != 0)
 		throw Exception(kSeekError);
 
-	long p = std::ftell(_handle);
-	if ((p < 0) || ((size_t)p > _size))
+	const int64 p = tellFile(_handle);
+	if ((p < 0) || ((uint64)p > _size))
 		throw Exception(kSeekError);
 
 	return oldPos;
@@ -139,4 +167,49 @@ size_t ReadFile::read(void *dataPtr, size_t dataSize) {
 	return std::fread(dataPtr, 1, dataSize, _handle);
 }
 
+#if defined(WIN32)
+
+size_t ReadFile::readAt(size_t offset, void *dataPtr, size_t dataSize) const {
+	/* There's no positional read that's safe to mix with stdio on Windows,
+	 * so we use the locked, seeking default implementation here. */
+
+	return SeekableReadStream::readAt(offset, dataPtr, dataSize);
+}
+
+#else
+
+size_t ReadFile::readAt(size_t offset, void *dataPtr, size_t dataSize) const {
+	if (!_handle)
+		return 0;
+
+	assert(dataPtr);
+
+	/* The file is only ever read, so reading directly from the file
+	 * descriptor, bypassing stdio's buffer, doesn't break anything. */
+
+	const int fd = fileno(_handle);
+
+	byte *data = static_cast<byte *>(dataPtr);
+	size_t readSize = 0;
+
+	while (readSize < dataSize) {
+		const ssize_t n = pread(fd, data + readSize, dataSize - readSize, (off_t) (offset + readSize));
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+
+			throw Exception(kReadError);
+		}
+
+		if (n == 0)
+			break;
+
+		readSize += n;
+	}
+
+	return readSize;
+}
+
+#endif
+
 } // End of namespace Common
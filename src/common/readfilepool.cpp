@@ -0,0 +1,142 @@
+/* Phaethon - A FLOSS resource explorer for BioWare's Aurora engine games
+ *
+ * Phaethon is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * Phaethon is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * Phaethon is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Phaethon. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  A bounded pool of open files, and streams reading through it.
+ */
+
+#include "src/common/readfilepool.h"
+#include "src/common/readfile.h"
+#include "src/common/error.h"
+#include "src/common/util.h"
+
+namespace Common {
+
+const size_t ReadFilePool::kDefaultMaxOpenFiles;
+
+ReadFilePool::ReadFilePool(size_t maxOpenFiles) : _maxOpenFiles(MAX<size_t>(maxOpenFiles, 1)) {
+}
+
+ReadFilePool::~ReadFilePool() {
+}
+
+size_t ReadFilePool::getMaxOpenFiles() const {
+	return _maxOpenFiles;
+}
+
+size_t ReadFilePool::getOpenFileCount() const {
+	StackLock lock(_mutex);
+
+	return _handles.size();
+}
+
+boost::shared_ptr<ReadFile> ReadFilePool::getFile(const UString &fileName) {
+	StackLock lock(_mutex);
+
+	HandleMap::iterator h = _handleMap.find(fileName);
+	if (h != _handleMap.end()) {
+		// Move the handle to the front of the list, marking it as most recently used
+		_handles.splice(_handles.begin(), _handles, h->second);
+
+		return h->second->file;
+	}
+
+	boost::shared_ptr<ReadFile> file(new ReadFile);
+	if (!file->open(fileName))
+		throw Exception("Can't open file \"%s\"", fileName.c_str());
+
+	while (_handles.size() >= _maxOpenFiles) {
+		_handleMap.erase(_handles.back().fileName);
+		_handles.pop_back();
+	}
+
+	_handles.push_front(Handle());
+	_handles.front().fileName = fileName;
+	_handles.front().file     = file;
+
+	_handleMap.insert(std::make_pair(fileName, _handles.begin()));
+
+	return file;
+}
+
+void ReadFilePool::clear() {
+	StackLock lock(_mutex);
+
+	_handleMap.clear();
+	_handles.clear();
+}
+
+
+PooledReadFile::PooledReadFile(ReadFilePool &pool, const UString &fileName) :
+	_pool(&pool), _fileName(fileName), _size(0), _pos(0), _eos(false) {
+
+	_size = _pool->getFile(_fileName)->size();
+}
+
+PooledReadFile::~PooledReadFile() {
+}
+
+bool PooledReadFile::eos() const {
+	return _eos;
+}
+
+size_t PooledReadFile::pos() const {
+	return _pos;
+}
+
+size_t PooledReadFile::size() const {
+	return _size;
+}
+
+size_t PooledReadFile::seek(ptrdiff_t offset, Origin whence) {
+	const size_t oldPos = _pos;
+	const size_t newPos = evalSeek(offset, whence, _pos, 0, _size);
+	if (newPos > _size)
+		throw Exception(kSeekError);
+
+	_pos = newPos;
+
+	_eos = false; // reset eos on successful seek
+
+	return oldPos;
+}
+
+size_t PooledReadFile::read(void *dataPtr, size_t dataSize) {
+	const size_t readSize = readAt(_pos, dataPtr, dataSize);
+	if (readSize != dataSize)
+		_eos = true;
+
+	_pos += readSize;
+
+	return readSize;
+}
+
+size_t PooledReadFile::readAt(size_t offset, void *dataPtr, size_t dataSize) const {
+	if (offset >= _size)
+		return 0;
+
+	dataSize = MIN(dataSize, _size - offset);
+	if (dataSize == 0)
+		return 0;
+
+	return _pool->getFile(_fileName)->readAt(offset, dataPtr, dataSize);
+}
+
+} // End of namespace Common
@@ -0,0 +1,128 @@
+/* Phaethon - A FLOSS resource explorer for BioWare's Aurora engine games
+ *
+ * Phaethon is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * Phaethon is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * Phaethon is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Phaethon. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  A bounded pool of open files, and streams reading through it.
+ */
+
+#ifndef COMMON_READFILEPOOL_H
+#define COMMON_READFILEPOOL_H
+
+#include <list>
+#include <map>
+
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "src/common/types.h"
+#include "src/common/ustring.h"
+#include "src/common/mutex.h"
+#include "src/common/readstream.h"
+
+namespace Common {
+
+class ReadFile;
+
+/** A bounded pool of open files.
+ *
+ *  At most a fixed number of files are kept open. When another file has
+ *  to be opened, the least recently used one is closed. Files still being
+ *  read from when they are closed stay open until that read finishes, so
+ *  the limit can be exceeded by the number of concurrent reads.
+ *
+ *  All methods are thread-safe.
+ */
+class ReadFilePool : boost::noncopyable {
+public:
+	/** The default maximum number of open files. */
+	static const size_t kDefaultMaxOpenFiles = 32;
+
+	ReadFilePool(size_t maxOpenFiles = kDefaultMaxOpenFiles);
+	~ReadFilePool();
+
+	/** Return the maximum number of open files. */
+	size_t getMaxOpenFiles() const;
+
+	/** Return the number of files currently kept open. */
+	size_t getOpenFileCount() const;
+
+	/** Return the file, opening it if necessary.
+	 *
+	 *  Throws an exception if the file can't be opened.
+	 */
+	boost::shared_ptr<ReadFile> getFile(const UString &fileName);
+
+	/** Close all files not currently being read from. */
+	void clear();
+
+private:
+	/** An open file. */
+	struct Handle {
+		UString fileName;
+
+		boost::shared_ptr<ReadFile> file;
+	};
+
+	/** All open files, most recently used first. */
+	typedef std::list<Handle> HandleList;
+	typedef std::map<UString, HandleList::iterator> HandleMap;
+
+	size_t _maxOpenFiles;
+
+	HandleList _handles;
+	HandleMap  _handleMap;
+
+	mutable Mutex _mutex;
+};
+
+/** A stream reading a file through a ReadFilePool.
+ *
+ *  The file is opened only while it's being read from, and transparently
+ *  reopened if the pool closed it in the meantime. The pool needs to
+ *  outlive all its streams.
+ */
+class PooledReadFile : boost::noncopyable, public SeekableReadStream {
+public:
+	PooledReadFile(ReadFilePool &pool, const UString &fileName);
+	~PooledReadFile();
+
+	bool eos() const;
+
+	size_t pos() const;
+	size_t size() const;
+
+	size_t seek(ptrdiff_t offset, Origin whence = kOriginBegin);
+	size_t read(void *dataPtr, size_t dataSize);
+
+	size_t readAt(size_t offset, void *dataPtr, size_t dataSize) const;
+
+private:
+	ReadFilePool *_pool;
+	UString _fileName;
+
+	size_t _size;
+	size_t _pos;
+
+	bool _eos;
+};
+
+} // End of namespace Common
+
+#endif // COMMON_READFILEPOOL_H
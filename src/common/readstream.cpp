@@ -53,10 +53,13 @@
 #include "src/common/memreadstream.h"
 #include "src/common/error.h"
 #include "src/common/scopedptr.h"
+#include "src/common/mutex.h"
 
 namespace Common {
 
 const uint32 ReadStream::kEOF;
+const size_t ReadStream::kSizeInvalid;
+const size_t ReadStream::kPositionInvalid;
 
 ReadStream::ReadStream() {
 }
@@ -80,6 +83,34 @@ SeekableReadStream::SeekableReadStream() {
 SeekableReadStream::~SeekableReadStream() {
 }
 
+/** Lock for the default, seeking implementation of readAt(). */
+static Mutex readAtMutex;
+
+size_t SeekableReadStream::readAt(size_t offset, void *dataPtr, size_t dataSize) const {
+	StackLock lock(readAtMutex);
+
+	SeekableReadStream &stream = const_cast<SeekableReadStream &>(*this);
+
+	const size_t oldPos = stream.pos();
+
+	stream.seek(offset);
+	const size_t readSize = stream.read(dataPtr, dataSize);
+
+	// This also clears the end-of-file indicator we might have set
+	stream.seek(oldPos);
+
+	return readSize;
+}
+
+MemoryReadStream *SeekableReadStream::readStreamAt(size_t offset, size_t dataSize) const {
+	ScopedArray<byte> buf(new byte[dataSize]);
+
+	if (readAt(offset, buf.get(), dataSize) != dataSize)
+		throw Exception(kReadError);
+
+	return new MemoryReadStream(buf.release(), dataSize, true);
+}
+
 size_t SeekableReadStream::evalSeek(ptrdiff_t offset, Origin whence, size_t pos, size_t begin, size_t size) {
 	switch (whence) {
 		case kOriginEnd:
@@ -128,15 +159,41 @@ SeekableSubReadStream::SeekableSubReadStream(SeekableReadStream *parentStream, s
                                              size_t end, bool disposeParentStream) :
 	SubReadStream(parentStream, end, disposeParentStream), _parentStream(parentStream), _begin(begin) {
 
-	assert(_begin <= _end);
+	if ((_begin > _end) || (_begin > _parentStream->size()))
+		throw Exception(kSeekError);
 
 	_pos = begin;
-	_parentStream->seek(_pos);
 }
 
 SeekableSubReadStream::~SeekableSubReadStream() {
 }
 
+bool SeekableSubReadStream::eos() const {
+	return _eos;
+}
+
+size_t SeekableSubReadStream::read(void *dataPtr, size_t dataSize) {
+	if (dataSize > (size_t)(_end - _pos)) {
+		dataSize = _end - _pos;
+		_eos = true;
+	}
+
+	const size_t readSize = _parentStream->readAt(_pos, dataPtr, dataSize);
+	if (readSize != dataSize)
+		_eos = true;
+
+	_pos += readSize;
+
+	return readSize;
+}
+
+size_t SeekableSubReadStream::readAt(size_t offset, void *dataPtr, size_t dataSize) const {
+	if (offset >= size())
+		return 0;
+
+	return _parentStream->readAt(_begin + offset, dataPtr, MIN(dataSize, size() - offset));
+}
+
 size_t SeekableSubReadStream::pos() const {
 	return _pos - _begin;
 }
@@ -156,7 +213,6 @@ size_t SeekableSubReadStream::seek(ptrdiff_t offset, Origin whence) {
 
 	_pos = newPos;
 
-	_parentStream->seek(_pos);
 	_eos = false; // reset eos on successful seek
 
 	return oldPos;
@@ -318,6 +318,32 @@ public:
 		return seek(offset, kOriginCurrent);
 	}
 
+	/** Read data from a specific position within the stream, similar to pread().
+	 *
+	 *  Unlike a seek() followed by a read(), readAt() does not change the
+	 *  current position or the end-of-file indicator of the stream. Streams
+	 *  overriding this method make readAt() safe to call concurrently from
+	 *  several threads, as long as nobody changes the stream otherwise.
+	 *
+	 *  The default implementation seeks, reads and then restores the old
+	 *  position, under a lock shared by all streams. It is only safe against
+	 *  concurrent readAt() calls, not against concurrent read() calls.
+	 *
+	 *  @param  offset the position within the stream to read from.
+	 *  @param  dataPtr pointer to a buffer into which the data is read.
+	 *  @param  dataSize number of bytes to be read.
+	 *  @return the number of bytes which were actually read.
+	 */
+	virtual size_t readAt(size_t offset, void *dataPtr, size_t dataSize) const;
+
+	/** Read the specified amount of data from a specific position into a
+	 *  new[]'ed buffer, which then is wrapped into a MemoryReadStream.
+	 *
+	 *  Like readAt(), this does not change the current position of the stream.
+	 *  When reading fails, a kReadError exception is thrown.
+	 */
+	MemoryReadStream *readStreamAt(size_t offset, size_t dataSize) const;
+
 	/** Evaluate the seek offset relative to whence into a position from the beginning. */
 	static size_t evalSeek(ptrdiff_t offset, Origin whence, size_t pos, size_t begin, size_t size);
 };
@@ -351,10 +377,10 @@ protected:
 
 /** SeekableSubReadStream provides access to a SeekableReadStream restricted to
  *  the range [begin, end).
- *  The same caveats apply to SeekableSubReadStream as do to SeekableReadStream.
  *
- *  Manipulating the parent stream directly /will/ mess up a substream.
- *  @see SubReadStream
+ *  Unlike SubReadStream, SeekableSubReadStream reads its data with readAt(),
+ *  so it never changes the position of the parent stream, and several
+ *  substreams of the same parent stream don't step on each others toes.
  */
 class SeekableSubReadStream : public SubReadStream, public SeekableReadStream {
 public:
@@ -362,11 +388,17 @@ public:
 	                      bool disposeParentStream = false);
 	~SeekableSubReadStream();
 
+	bool eos() const;
+
+	size_t read(void *dataPtr, size_t dataSize);
+
 	size_t pos() const;
 	size_t size() const;
 
 	size_t seek(ptrdiff_t offset, Origin whence = kOriginBegin);
 
+	size_t readAt(size_t offset, void *dataPtr, size_t dataSize) const;
+
 protected:
 	SeekableReadStream *_parentStream;
 
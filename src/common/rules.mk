@@ -40,6 +40,8 @@ src_common_libcommon_la_SOURCES += \
     src/common/platform.h \
     src/common/readstream.h \
     src/common/memreadstream.h \
+    src/common/bufferedreadstream.h \
+    src/common/fixedtable.h \
     src/common/writestream.h \
     src/common/memwritestream.h \
     src/common/maths.h \
@@ -48,10 +50,13 @@ src_common_libcommon_la_SOURCES += \
     src/common/ustring.h \
     src/common/hash.h \
     src/common/md5.h \
+    src/common/crc32.h \
     src/common/blowfish.h \
     src/common/deflate.h \
     src/common/lzma.h \
     src/common/readfile.h \
+    src/common/mappedreadfile.h \
+    src/common/readfilepool.h \
     src/common/writefile.h \
     src/common/filepath.h \
     src/common/filelist.h \
@@ -75,16 +80,21 @@ src_common_libcommon_la_SOURCES += \
     src/common/platform.cpp \
     src/common/readstream.cpp \
     src/common/memreadstream.cpp \
+    src/common/bufferedreadstream.cpp \
+    src/common/fixedtable.cpp \
     src/common/writestream.cpp \
     src/common/memwritestream.cpp \
     src/common/maths.cpp \
     src/common/md5.cpp \
+    src/common/crc32.cpp \
     src/common/blowfish.cpp \
     src/common/deflate.cpp \
     src/common/lzma.cpp \
     src/common/error.cpp \
     src/common/ustring.cpp \
     src/common/readfile.cpp \
+    src/common/mappedreadfile.cpp \
+    src/common/readfilepool.cpp \
     src/common/writefile.cpp \
     src/common/filepath.cpp \
     src/common/filelist.cpp \
@@ -28,6 +28,8 @@
 #include <cstdlib>
 #include <cstdio>
 
+#include <vector>
+
 #include "src/common/system.h"
 #include "src/common/strutil.h"
 #include "src/common/util.h"
@@ -353,4 +355,50 @@ template UString composeString<unsigned long     >(unsigned long      value);
 template UString composeString<  signed long long>(  signed long long value);
 template UString composeString<unsigned long long>(unsigned long long value);
 
+static void getCodepoints(const UString &str, bool lower, std::vector<uint32> &codepoints) {
+	codepoints.clear();
+
+	for (UString::iterator c = str.begin(); c != str.end(); ++c)
+		codepoints.push_back(lower ? UString::toLower(*c) : *c);
+}
+
+bool matchGlob(const UString &str, const UString &glob, bool caseInsensitive) {
+	std::vector<uint32> s, g;
+	getCodepoints(str , caseInsensitive, s);
+	getCodepoints(glob, caseInsensitive, g);
+
+	/* Greedy matching with backtracking to the last star. Since a later
+	 * star can match everything an earlier one could, backtracking to
+	 * only the last one is enough. */
+
+	size_t sPos = 0, gPos = 0;
+	size_t starPos = SIZE_MAX, starMatch = 0;
+
+	while (sPos < s.size()) {
+		if ((gPos < g.size()) && (g[gPos] == '*')) {
+			starPos   = gPos++;
+			starMatch = sPos;
+			continue;
+		}
+
+		if ((gPos < g.size()) && ((g[gPos] == '?') || (g[gPos] == s[sPos]))) {
+			sPos++;
+			gPos++;
+			continue;
+		}
+
+		if (starPos == SIZE_MAX)
+			return false;
+
+		// Let the last star swallow one more character and try again
+		gPos = starPos + 1;
+		sPos = ++starMatch;
+	}
+
+	while ((gPos < g.size()) && (g[gPos] == '*'))
+		gPos++;
+
+	return gPos == g.size();
+}
+
 } // End of namespace Common
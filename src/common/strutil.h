@@ -57,6 +57,14 @@ template<typename T> void parseString(const UString &str, T &value, bool allowEm
 /** Convert any POD integer, float/double or bool type into a string. */
 template<typename T> UString composeString(T value);
 
+/** Match a string against a shell-style wildcard pattern.
+ *
+ *  A '*' in the pattern matches any sequence of characters, including the
+ *  empty one, and a '?' matches any single character. All other characters
+ *  only match themselves.
+ */
+bool matchGlob(const UString &str, const UString &glob, bool caseInsensitive = false);
+
 } // End of namespace Common
 
 #endif // COMMON_STRUTIL_H
@@ -26,6 +26,9 @@
 #include <cstdio>
 #include <cctype>
 
+#include <algorithm>
+#include <utility>
+
 #include "src/common/ustring.h"
 #include "src/common/error.h"
 #include "src/common/util.h"
@@ -35,20 +38,28 @@ namespace Common {
 UString::UString() : _size(0) {
 }
 
-UString::UString(const UString &str) {
-	*this = str;
+UString::UString(const UString &str) : _string(str._string), _size(str._size) {
+}
+
+UString::UString(UString &&str) noexcept : _string(std::move(str._string)), _size(str._size) {
+	str._string.clear();
+	str._size = 0;
 }
 
-UString::UString(const std::string &str) {
-	*this = str;
+UString::UString(const std::string &str) : _string(str) {
+	recalculateSize();
 }
 
-UString::UString(const char *str) {
-	*this = str;
+UString::UString(std::string &&str) : _string(std::move(str)) {
+	recalculateSize();
 }
 
-UString::UString(const char *str, size_t n) {
-	*this = std::string(str, n);
+UString::UString(const char *str) : _string(str) {
+	recalculateSize();
+}
+
+UString::UString(const char *str, size_t n) : _string(str, n) {
+	recalculateSize();
 }
 
 UString::UString(uint32 c, size_t n) : _size(0) {
@@ -57,8 +68,18 @@ UString::UString(uint32 c, size_t n) : _size(0) {
 }
 
 UString::UString(iterator sBegin, iterator sEnd) : _size(0) {
-	for (; (sBegin != sEnd) && *sBegin; ++sBegin)
-		*this += *sBegin;
+	/* The iterators walk over valid UTF-8 data, so the bytes between them can
+	 * be copied in one go. Like a \0 character, a \0 byte ends the string. */
+	std::string::const_iterator begin = sBegin.base();
+	std::string::const_iterator end   = std::find(begin, sEnd.base(), '\0');
+
+	_string.assign(begin, end);
+
+	recalculateSize();
+}
+
+UString::UString(const UStringView &view) : _string(view.data(), view.size()) {
+	recalculateSize();
 }
 
 UString::~UString() {
@@ -71,6 +92,16 @@ UString &UString::operator=(const UString &str) {
 	return *this;
 }
 
+UString &UString::operator=(UString &&str) noexcept {
+	_string = std::move(str._string);
+	_size   = str._size;
+
+	str._string.clear();
+	str._size = 0;
+
+	return *this;
+}
+
 UString &UString::operator=(const std::string &str) {
 	_string = str;
 
@@ -79,8 +110,18 @@ UString &UString::operator=(const std::string &str) {
 	return *this;
 }
 
+UString &UString::operator=(std::string &&str) {
+	_string = std::move(str);
+
+	recalculateSize();
+
+	return *this;
+}
+
 UString &UString::operator=(const char *str) {
-	*this = std::string(str);
+	_string = str;
+
+	recalculateSize();
 
 	return *this;
 }
@@ -748,15 +789,39 @@ size_t UString::split(const UString &text, uint32 delim, std::vector<UString> &t
 }
 
 void UString::recalculateSize() {
+	// Pure ASCII, which most strings are, has one character per byte and is always valid
+	const byte *data = reinterpret_cast<const byte *>(_string.c_str());
+	const size_t length = _string.size();
+
+	size_t i = 0;
+	while ((i < length) && (data[i] < 0x80))
+		i++;
+
+	if (i == length) {
+		_size = length;
+		return;
+	}
+
 	try {
-		// Calculate the "distance" in characters from the beginning and end
-		_size = utf8::distance(_string.begin(), _string.end());
+		// Calculate the "distance" in characters from the end of the ASCII prefix to the end
+		_size = i + utf8::distance(_string.begin() + i, _string.end());
 	} catch (const std::exception &se) {
 		Exception e(se);
 		throw e;
 	}
 }
 
+bool UStringView::equalsIgnoreCase(const UStringView &view) const {
+	if (_size != view._size)
+		return false;
+
+	for (size_t i = 0; i < _size; i++)
+		if (toLowerASCII(_data[i]) != toLowerASCII(view._data[i]))
+			return false;
+
+	return true;
+}
+
 // NOTE: If we ever need uppercase<->lowercase mappings for non-ASCII
 //       characters: http://www.unicode.org/reports/tr21/tr21-5.html
 
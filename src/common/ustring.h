@@ -25,6 +25,7 @@
 #ifndef COMMON_USTRING_H
 #define COMMON_USTRING_H
 
+#include <cstring>
 #include <string>
 #include <sstream>
 #include <vector>
@@ -38,6 +39,8 @@
 
 namespace Common {
 
+class UStringView;
+
 /** A class holding an UTF-8 string.
  *
  *  WARNING:
@@ -67,8 +70,12 @@ public:
 	UString();
 	/** Copy constructor. */
 	UString(const UString &str);
+	/** Move constructor. */
+	UString(UString &&str) noexcept;
 	/** Construct UString from an UTF-8 string. */
 	UString(const std::string &str);
+	/** Construct UString from an UTF-8 string, taking over its data. */
+	UString(std::string &&str);
 	/** Construct UString from an UTF-8 string. */
 	UString(const char *str);
 	/** Construct UString from the first n bytes of an UTF-8 string. */
@@ -77,10 +84,14 @@ public:
 	explicit UString(uint32 c, size_t n = 1);
 	/** Construct UString by copying the characters between [sBegin,sEnd). */
 	UString(iterator sBegin, iterator sEnd);
+	/** Construct UString by copying the viewed string. */
+	explicit UString(const UStringView &view);
 	~UString();
 
 	UString &operator=(const UString &str);
+	UString &operator=(UString &&str) noexcept;
 	UString &operator=(const std::string &str);
+	UString &operator=(std::string &&str);
 	UString &operator=(const char *str);
 
 	bool operator==(const UString &str) const;
@@ -203,8 +214,117 @@ private:
 	size_t _size;
 
 	void recalculateSize();
+
+	friend class UStringView;
+};
+
+/** A non-owning, read-only view onto UTF-8 string data.
+ *
+ *  A UStringView neither copies nor owns the data it looks at, so creating
+ *  one never allocates. This makes it useful for looking things up without
+ *  first having to construct a UString. The viewed data has to stay valid and
+ *  unchanged for as long as the view is used.
+ *
+ *  Unlike UString::size(), which counts characters, size() returns the length
+ *  of the viewed data in bytes. The data is not necessarily \0-terminated.
+ */
+class UStringView {
+public:
+	/** Construct an empty view. */
+	UStringView();
+	/** View a \0-terminated UTF-8 string. */
+	UStringView(const char *str);
+	/** View the first n bytes of an UTF-8 string. */
+	UStringView(const char *str, size_t n);
+	/** View an UTF-8 string. */
+	UStringView(const std::string &str);
+	/** View an UString. */
+	UStringView(const UString &str);
+
+	/** Return the viewed data. */
+	const char *data() const;
+	/** Return the length of the viewed data, in bytes. */
+	size_t size() const;
+	/** Is the view empty? */
+	bool empty() const;
+
+	const char *begin() const;
+	const char *end() const;
+
+	bool operator==(const UStringView &view) const;
+	bool operator!=(const UStringView &view) const;
+
+	bool equals(const UStringView &view) const;
+	/** Compare the viewed strings, ignoring the case of ASCII characters like UString does. */
+	bool equalsIgnoreCase(const UStringView &view) const;
+
+	/** Lowercase a byte of UTF-8 data, if it's an ASCII character, and leave all other bytes alone.
+	 *
+	 *  Since all bytes of a multi-byte UTF-8 sequence have their high bit
+	 *  set, this is the bytewise equivalent of UString::toLower().
+	 */
+	static char toLowerASCII(char c);
+
+private:
+	const char *_data;
+	size_t _size;
 };
 
+inline UStringView::UStringView() : _data(""), _size(0) {
+}
+
+inline UStringView::UStringView(const char *str) : _data(str), _size(std::strlen(str)) {
+}
+
+inline UStringView::UStringView(const char *str, size_t n) : _data(str), _size(n) {
+}
+
+inline UStringView::UStringView(const std::string &str) : _data(str.c_str()), _size(str.size()) {
+}
+
+inline UStringView::UStringView(const UString &str) : _data(str._string.c_str()), _size(str._string.size()) {
+}
+
+inline const char *UStringView::data() const {
+	return _data;
+}
+
+inline size_t UStringView::size() const {
+	return _size;
+}
+
+inline bool UStringView::empty() const {
+	return _size == 0;
+}
+
+inline const char *UStringView::begin() const {
+	return _data;
+}
+
+inline const char *UStringView::end() const {
+	return _data + _size;
+}
+
+inline bool UStringView::operator==(const UStringView &view) const {
+	return equals(view);
+}
+
+inline bool UStringView::operator!=(const UStringView &view) const {
+	return !equals(view);
+}
+
+inline bool UStringView::equals(const UStringView &view) const {
+	return (_size == view._size) && (std::memcmp(_data, view._data, _size) == 0);
+}
+
+inline char UStringView::toLowerASCII(char c) {
+	return ((c >= 'A') && (c <= 'Z')) ? (c - 'A' + 'a') : c;
+}
+
+static inline std::ostream &operator<<(std::ostream &stream, const UStringView &view) {
+	return stream.write(view.data(), view.size());
+}
+
 
 // Right-binding concatenation operators
 static inline UString operator+(const std::string &left, const UString &right) {
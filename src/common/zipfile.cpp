@@ -23,16 +23,33 @@
  */
 
 #include <cassert>
+#include <vector>
 
 #include "src/common/zipfile.h"
 #include "src/common/error.h"
 #include "src/common/util.h"
+#include "src/common/strutil.h"
 #include "src/common/encoding.h"
 #include "src/common/memreadstream.h"
 #include "src/common/deflate.h"
+#include "src/common/crc32.h"
 
 namespace Common {
 
+static const uint32 kLocalFileHeaderID      = 0x04034B50;
+static const uint32 kCentralDirEntryID      = 0x02014B50;
+static const uint32 kCentralDirEndID        = 0x06054B50;
+static const uint32 kZIP64CentralDirEndID   = 0x06064B50;
+static const uint32 kZIP64LocatorID         = 0x07064B50;
+
+static const size_t kLocalFileHeaderSize    = 30;
+static const size_t kCentralDirEntrySize    = 46;
+static const size_t kCentralDirEndSize      = 22;
+static const size_t kZIP64CentralDirEndSize = 56;
+static const size_t kZIP64LocatorSize       = 20;
+
+static const uint16 kZIP64ExtraID = 0x0001;
+
 ZipFile::ZipFile(SeekableReadStream *zip) : _zip(zip) {
 	assert(_zip);
 
@@ -43,76 +60,245 @@ ZipFile::~ZipFile() {
 }
 
 void ZipFile::load(SeekableReadStream &zip) {
-	size_t endPos = findCentralDirectoryEnd(zip);
-	if (endPos == 0)
+	uint64 dirOffset, dirSize, dirCount;
+	findCentralDirectory(zip, dirOffset, dirSize, dirCount);
+
+	if ((dirOffset > zip.size()) || (dirSize > (zip.size() - dirOffset)))
+		throw Exception("Invalid ZIP central directory (%s+%s, %s)", composeString(dirOffset).c_str(),
+		                composeString(dirSize).c_str(), composeString(zip.size()).c_str());
+
+	// Every entry takes up at least its fixed-size part
+	if (dirCount > (dirSize / kCentralDirEntrySize))
+		throw Exception("Invalid ZIP central directory entry count %s", composeString(dirCount).c_str());
+
+	std::vector<byte> directory(dirSize);
+	if ((dirSize > 0) && (zip.readAt(dirOffset, &directory[0], dirSize) != dirSize))
+		throw Exception(kReadError);
+
+	readCentralDirectory(directory.empty() ? 0 : &directory[0], directory.size(), dirCount);
+}
+
+void ZipFile::findCentralDirectory(SeekableReadStream &zip, uint64 &offset, uint64 &size, uint64 &count) {
+	/* The end of central directory record sits at the very end of the ZIP,
+	 * followed only by a comment of up to 65535 bytes. We read all of that
+	 * in one go and look for the record within. */
+
+	const size_t zipSize  = zip.size();
+	const size_t tailSize = MIN<size_t>(zipSize, kCentralDirEndSize + 0xFFFF);
+	const size_t tailPos  = zipSize - tailSize;
+
+	if (tailSize < kCentralDirEndSize)
 		throw Exception("End of central directory record not found");
 
-	zip.seek(endPos);
+	std::vector<byte> tail(tailSize);
+	if (zip.readAt(tailPos, &tail[0], tailSize) != tailSize)
+		throw Exception(kReadError);
 
-	zip.skip(4); // Header, already checked
+	const byte *end = 0;
+	for (size_t i = tailSize - kCentralDirEndSize + 1; i-- > 0; ) {
+		if (READ_LE_UINT32(&tail[i]) != kCentralDirEndID)
+			continue;
 
-	uint16 curDisk        = zip.readUint16LE();
-	uint16 centralDirDisk = zip.readUint16LE();
+		// The comment has to fit into the rest of the file
+		if ((i + kCentralDirEndSize + READ_LE_UINT16(&tail[i + 20])) > tailSize)
+			continue;
 
-	uint16 curDiskDirs = zip.readUint16LE();
-	uint16 totalDirs   = zip.readUint16LE();
+		end = &tail[i];
+		break;
+	}
+
+	if (!end)
+		throw Exception("End of central directory record not found");
+
+	const uint16 curDisk        = READ_LE_UINT16(end +  4);
+	const uint16 centralDirDisk = READ_LE_UINT16(end +  6);
+	const uint16 curDiskDirs    = READ_LE_UINT16(end +  8);
+	const uint16 totalDirs      = READ_LE_UINT16(end + 10);
+	const uint32 centralDirSize = READ_LE_UINT32(end + 12);
+	const uint32 centralDirPos  = READ_LE_UINT32(end + 16);
+
+	const uint64 endPos = tailPos + (end - &tail[0]);
+
+	// Fields that don't fit are moved into the ZIP64 end of central directory record
+	if ((totalDirs == 0xFFFF) || (curDiskDirs == 0xFFFF) ||
+	    (centralDirSize == 0xFFFFFFFF) || (centralDirPos == 0xFFFFFFFF)) {
+
+		if (hasZIP64Locator(zip, endPos)) {
+			readZIP64CentralDirectoryEnd(zip, endPos - kZIP64LocatorSize, offset, size, count);
+			return;
+		}
+
+		/* Without a ZIP64 locator, these might still be the real values, for example
+		 * in a ZIP with exactly 65535 files. Only if the central directory can't fit
+		 * in front of the end record, the ZIP64 records have to be there. */
+		if (((uint64) centralDirPos + centralDirSize) > endPos)
+			throw Exception("ZIP64 end of central directory locator not found");
+	}
 
 	if ((curDisk != 0) || (curDisk != centralDirDisk) || (curDiskDirs != totalDirs))
 		throw Exception("Unsupported multi-disk ZIP file");
 
-	zip.skip(4); // Size of central directory
+	offset = centralDirPos;
+	size   = centralDirSize;
+	count  = totalDirs;
+}
+
+bool ZipFile::hasZIP64Locator(SeekableReadStream &zip, uint64 endPos) {
+	if (endPos < kZIP64LocatorSize)
+		return false;
+
+	byte id[4];
+	if (zip.readAt(endPos - kZIP64LocatorSize, id, sizeof(id)) != sizeof(id))
+		throw Exception(kReadError);
+
+	return READ_LE_UINT32(id) == kZIP64LocatorID;
+}
+
+void ZipFile::readZIP64CentralDirectoryEnd(SeekableReadStream &zip, uint64 locatorPos,
+                                           uint64 &offset, uint64 &size, uint64 &count) {
+
+	byte locator[kZIP64LocatorSize];
+	if (zip.readAt(locatorPos, locator, sizeof(locator)) != sizeof(locator))
+		throw Exception(kReadError);
+
+	if (READ_LE_UINT32(locator) != kZIP64LocatorID)
+		throw Exception("ZIP64 end of central directory locator not found");
+
+	if ((READ_LE_UINT32(locator + 4) != 0) || (READ_LE_UINT32(locator + 16) > 1))
+		throw Exception("Unsupported multi-disk ZIP file");
+
+	const uint64 endPos = READ_LE_UINT64(locator + 8);
+	if ((endPos > locatorPos) || ((locatorPos - endPos) < kZIP64CentralDirEndSize))
+		throw Exception("Invalid ZIP64 end of central directory offset %s", composeString(endPos).c_str());
 
-	uint32 centralDirPos = zip.readUint32LE();
-	zip.seek(centralDirPos);
+	byte end[kZIP64CentralDirEndSize];
+	if (zip.readAt(endPos, end, sizeof(end)) != sizeof(end))
+		throw Exception(kReadError);
 
-	uint32 tag = zip.readUint32LE();
-	if (tag != 0x02014B50)
+	const uint32 tag = READ_LE_UINT32(end);
+	if (tag != kZIP64CentralDirEndID)
 		throw Exception("Unknown ZIP record %08X", tag);
 
-	_iFiles.reserve(totalDirs);
-	while (tag == 0x02014B50) {
-		 File  file;
-		IFile iFile;
+	const uint32 curDisk        = READ_LE_UINT32(end + 16);
+	const uint32 centralDirDisk = READ_LE_UINT32(end + 20);
+	const uint64 curDiskDirs    = READ_LE_UINT64(end + 24);
+	const uint64 totalDirs      = READ_LE_UINT64(end + 32);
 
-		zip.skip(20);
+	if ((curDisk != 0) || (curDisk != centralDirDisk) || (curDiskDirs != totalDirs))
+		throw Exception("Unsupported multi-disk ZIP file");
+
+	size   = READ_LE_UINT64(end + 40);
+	offset = READ_LE_UINT64(end + 48);
+	count  = totalDirs;
+}
+
+void ZipFile::readCentralDirectory(const byte *data, size_t size, uint64 count) {
+	_iFiles.reserve(count);
+
+	size_t pos = 0;
+	for (uint64 i = 0; i < count; i++) {
+		if ((size - pos) < kCentralDirEntrySize)
+			throw Exception(kReadError);
+
+		const byte *entry = data + pos;
+
+		const uint32 tag = READ_LE_UINT32(entry);
+		if (tag != kCentralDirEntryID)
+			throw Exception("Unknown ZIP record %08X", tag);
+
+		IFile iFile;
 
-		iFile.size = zip.readUint32LE();
+		iFile.method   = READ_LE_UINT16(entry + 10);
+		iFile.crc      = READ_LE_UINT32(entry + 16);
+		iFile.compSize = READ_LE_UINT32(entry + 20);
+		iFile.size     = READ_LE_UINT32(entry + 24);
+		iFile.offset   = READ_LE_UINT32(entry + 42);
 
-		uint16 nameLength    = zip.readUint16LE();
-		uint16 extraLength   = zip.readUint16LE();
-		uint16 commentLength = zip.readUint16LE();
-		uint16 diskNum       = zip.readUint16LE();
+		const uint16 nameLength    = READ_LE_UINT16(entry + 28);
+		const uint16 extraLength   = READ_LE_UINT16(entry + 30);
+		const uint16 commentLength = READ_LE_UINT16(entry + 32);
+		const uint16 diskNum       = READ_LE_UINT16(entry + 34);
 
-		if (diskNum != 0)
+		if ((diskNum != 0) && (diskNum != 0xFFFF))
 			throw Exception("Unsupported multi-disk ZIP file");
 
-		zip.skip(6); // File attributes
+		const size_t entrySize = kCentralDirEntrySize + nameLength + extraLength + commentLength;
+		if ((size - pos) < entrySize)
+			throw Exception(kReadError);
 
-		iFile.offset = zip.readUint32LE();
+		const byte *name  = entry + kCentralDirEntrySize;
+		const byte *extra = name  + nameLength;
 
-		file.name = readStringFixed(zip, kEncodingASCII, nameLength).toLower();
+		// Values that don't fit into 32 bits are stored in the ZIP64 extra field
+		const bool needSize     = iFile.size     == 0xFFFFFFFF;
+		const bool needCompSize = iFile.compSize == 0xFFFFFFFF;
+		const bool needOffset   = iFile.offset   == 0xFFFFFFFF;
 
-		zip.skip(extraLength);
-		zip.skip(commentLength);
+		if (needSize || needCompSize || needOffset)
+			readZIP64Extra(extra, extraLength, iFile, needSize, needCompSize, needOffset);
 
-		tag = zip.readUint32LE();
-		if ((tag != 0x02014B50) && (tag != 0x06054B50))
-			throw Exception("Unknown ZIP record %08X", tag);
+		pos += entrySize;
 
 		// Ignore empty file names
-		if (!file.name.empty()) {
-			// HACK: Skip any filename with a trailing slash because it's
-			// a directory. The proper solution would be to interpret the
-			// file attributes.
+		if (nameLength == 0)
+			continue;
+
+		// HACK: Skip any filename with a trailing slash because it's
+		// a directory. The proper solution would be to interpret the
+		// file attributes.
+		if (name[nameLength - 1] == '/')
+			continue;
+
+		File file;
+
+		file.name  = readString(name, nameLength, kEncodingASCII).toLower();
+		file.index = _iFiles.size();
+
+		_files.push_back(file);
+		_iFiles.push_back(iFile);
+	}
+}
+
+void ZipFile::readZIP64Extra(const byte *extra, size_t extraSize, IFile &file, bool needSize,
+                             bool needCompSize, bool needOffset) {
+
+	while (extraSize >= 4) {
+		const uint16 id        = READ_LE_UINT16(extra);
+		const uint16 fieldSize = READ_LE_UINT16(extra + 2);
+
+		extra     += 4;
+		extraSize -= 4;
+
+		if (fieldSize > extraSize)
+			break;
+
+		if (id == kZIP64ExtraID) {
+			// Only the values marked as overflowing are present, in this order
+			const size_t neededSize = (needSize ? 8 : 0) + (needCompSize ? 8 : 0) + (needOffset ? 8 : 0);
+			if (fieldSize < neededSize)
+				throw Exception("Invalid ZIP64 extra field size %u", fieldSize);
 
-			if (*(--file.name.end()) != '/') {
-				file.index = _iFiles.size();
+			const byte *value = extra;
 
-				_files.push_back(file);
-				_iFiles.push_back(iFile);
+			if (needSize) {
+				file.size = READ_LE_UINT64(value);
+				value += 8;
+			}
+			if (needCompSize) {
+				file.compSize = READ_LE_UINT64(value);
+				value += 8;
 			}
+			if (needOffset)
+				file.offset = READ_LE_UINT64(value);
+
+			return;
 		}
+
+		extra     += fieldSize;
+		extraSize -= fieldSize;
 	}
+
+	throw Exception("ZIP64 extra field not found");
 }
 
 const ZipFile::FileList &ZipFile::getFiles() const {
@@ -121,105 +307,80 @@ const ZipFile::FileList &ZipFile::getFiles() const {
 
 const ZipFile::IFile &ZipFile::getIFile(uint32 index) const {
 	if (index >= _iFiles.size())
-		throw Exception("File index out of range (%u/%u)", index, (uint)_iFiles.size());
+		throw Exception("File index out of range (%u/%s)", index, composeString(_iFiles.size()).c_str());
 
 	return _iFiles[index];
 }
 
-void ZipFile::getFileProperties(SeekableReadStream &zip, const IFile &file,
-		uint16 &compMethod, uint32 &compSize, uint32 &realSize) const {
+size_t ZipFile::getDataOffset(const SeekableReadStream &zip, const IFile &file) const {
+	/* The sizes and compression method come from the central directory. The local
+	 * header only tells us how far its variable-length fields push back the data. */
 
-	zip.seek(file.offset);
+	byte header[kLocalFileHeaderSize];
+	if (zip.readAt(file.offset, header, sizeof(header)) != sizeof(header))
+		throw Exception(kReadError);
 
-	uint32 tag = zip.readUint32LE();
-	if (tag != 0x04034B50)
+	const uint32 tag = READ_LE_UINT32(header);
+	if (tag != kLocalFileHeaderID)
 		throw Exception("Unknown ZIP record %08X", tag);
 
-	zip.skip(4);
+	const uint16 nameLength  = READ_LE_UINT16(header + 26);
+	const uint16 extraLength = READ_LE_UINT16(header + 28);
 
-	compMethod = zip.readUint16LE();
+	const uint64 dataOffset = file.offset + sizeof(header) + nameLength + extraLength;
+	if ((dataOffset > zip.size()) || (file.compSize > (zip.size() - dataOffset)))
+		throw Exception("Invalid ZIP file data (%s+%s, %s)", composeString(dataOffset).c_str(),
+		                composeString(file.compSize).c_str(), composeString(zip.size()).c_str());
 
-	zip.skip(8);
-
-	compSize = zip.readUint32LE();
-	realSize = zip.readUint32LE();
-
-	uint16 nameLength  = zip.readUint16LE();
-	uint16 extraLength = zip.readUint16LE();
-
-	zip.skip(nameLength);
-	zip.skip(extraLength);
+	return dataOffset;
 }
 
 size_t ZipFile::getFileSize(uint32 index) const {
 	return getIFile(index).size;
 }
 
+size_t ZipFile::getFileOffset(uint32 index) const {
+	return getIFile(index).offset;
+}
+
 SeekableReadStream *ZipFile::getFile(uint32 index, bool tryNoCopy) const {
 	const IFile &file = getIFile(index);
 
-	uint16 compMethod;
-	uint32 compSize;
-	uint32 realSize;
+	const size_t dataOffset = getDataOffset(*_zip, file);
+	const size_t compSize   = file.compSize;
 
-	getFileProperties(*_zip, file, compMethod, compSize, realSize);
+	if (tryNoCopy && (file.method == 0)) {
+		SeekableReadStream *view = createMemoryView(*_zip, dataOffset, dataOffset + compSize);
+		if (view)
+			return view;
 
-	if (tryNoCopy && (compMethod == 0))
-		return new SeekableSubReadStream(_zip.get(), _zip->pos(), _zip->pos() + compSize);
+		return new SeekableSubReadStream(_zip.get(), dataOffset, dataOffset + compSize);
+	}
+
+	return decompressFile(_zip->readStreamAt(dataOffset, compSize), file.method, file.size);
+}
+
+bool ZipFile::verifyFile(uint32 index) const {
+	const IFile &file = getIFile(index);
+
+	ScopedPtr<SeekableReadStream> stream(getFile(index, true));
 
-	return decompressFile(*_zip, compMethod, compSize, realSize);
+	return calculateCRC32(*stream) == file.crc;
 }
 
-SeekableReadStream *ZipFile::decompressFile(SeekableReadStream &zip, uint32 method,
-		uint32 compSize, uint32 realSize) {
+SeekableReadStream *ZipFile::decompressFile(MemoryReadStream *packedStream, uint32 method, size_t realSize) {
+	ScopedPtr<MemoryReadStream> stream(packedStream);
 
 	if (method == 0) {
 		// Uncompressed
 
-		return zip.readStream(compSize);
+		return stream.release();
 	}
 
 	if (method != 8)
 		throw Exception("Unhandled Zip compression %d", method);
 
-	return decompressDeflate(zip, compSize, realSize, kWindowBitsMaxRaw);
-}
-
-#define BUFREADCOMMENT (0x400)
-size_t ZipFile::findCentralDirectoryEnd(SeekableReadStream &zip) {
-	const size_t uSizeFile = zip.size();
-	const size_t uMaxBack  = MIN<size_t>(0xFFFF, uSizeFile); // Maximum size of global comment
-
-	byte buf[BUFREADCOMMENT + 4];
-
-	size_t uPosFound = 0;
-	size_t uBackRead = 4;
-	while ((uPosFound == 0) && (uBackRead < uMaxBack)) {
-		uBackRead = MIN<size_t>(uMaxBack, uBackRead + BUFREADCOMMENT);
-
-		const size_t uReadPos  = uSizeFile - uBackRead;
-		const size_t uReadSize = MIN<size_t>(BUFREADCOMMENT + 4, uSizeFile - uReadPos);
-
-		try {
-			zip.seek(uReadPos);
-		} catch (...) {
-			return 0;
-		}
-
-		if (zip.read(buf, uReadSize) != uReadSize) {
-			uPosFound = 0;
-			break;
-		}
-
-		for (size_t i = (uReadSize - 3); i-- > 0; )
-			if (READ_LE_UINT32(buf + i) == 0x06054B50) {
-				uPosFound = uReadPos + i;
-				break;
-			}
-
-	}
-
-	return uPosFound;
+	return new InflateReadStream(stream.release(), realSize, kWindowBitsMaxRaw);
 }
 
 } // End of namespace Common
@@ -37,8 +37,14 @@
 namespace Common {
 
 class SeekableReadStream;
+class MemoryReadStream;
 
-/** A class encapsulating ZIP file access. */
+/** A class encapsulating ZIP file access.
+ *
+ *  The central directory is read in one go and parsed from memory.
+ *  ZIP64 archives, with offsets and sizes beyond 4GB or more than
+ *  65535 files, are supported as well.
+ */
 class ZipFile : boost::noncopyable {
 public:
 	/** A file. */
@@ -58,14 +64,23 @@ public:
 	/** Return the size of a file. */
 	size_t getFileSize(uint32 index) const;
 
+	/** Return the offset of the file's local header within the ZIP. */
+	size_t getFileOffset(uint32 index) const;
+
 	/** Return a stream of the file's contents. */
 	SeekableReadStream *getFile(uint32 index, bool tryNoCopy = false) const;
 
+	/** Check that the file's contents match the CRC32 stored in the ZIP. */
+	bool verifyFile(uint32 index) const;
+
 private:
 	/** Internal file information. */
 	struct IFile {
-		uint32 offset; ///< The offset of the file within the ZIP.
-		uint32 size;   ///< The file's size.
+		uint64 offset;   ///< The offset of the file's local header within the ZIP.
+		uint64 size;     ///< The file's size.
+		uint64 compSize; ///< The file's compressed size.
+		uint32 crc;      ///< The CRC32 of the file's contents.
+		uint16 method;   ///< The compression method.
 	};
 
 	typedef std::vector<IFile> IFileList;
@@ -79,14 +94,26 @@ private:
 	IFileList _iFiles;
 
 	void load(SeekableReadStream &zip);
-	size_t findCentralDirectoryEnd(SeekableReadStream &zip);
 
-	static SeekableReadStream *decompressFile(SeekableReadStream &zip, uint32 method,
-			uint32 compSize, uint32 realSize);
+	/** Find the central directory, through the (ZIP64) end of central directory record. */
+	static void findCentralDirectory(SeekableReadStream &zip, uint64 &offset, uint64 &size, uint64 &count);
+	/** Is there a ZIP64 end of central directory locator in front of the end record at this position? */
+	static bool hasZIP64Locator(SeekableReadStream &zip, uint64 endPos);
+	/** Read the location of the central directory from the ZIP64 end of central directory record. */
+	static void readZIP64CentralDirectoryEnd(SeekableReadStream &zip, uint64 locatorPos,
+	                                         uint64 &offset, uint64 &size, uint64 &count);
+
+	/** Parse the central directory, read into memory. */
+	void readCentralDirectory(const byte *data, size_t size, uint64 count);
+	/** Read the 64-bit values from a central directory entry's ZIP64 extra field. */
+	static void readZIP64Extra(const byte *extra, size_t extraSize, IFile &file, bool needSize,
+	                           bool needCompSize, bool needOffset);
+
+	static SeekableReadStream *decompressFile(MemoryReadStream *packedStream, uint32 method, size_t realSize);
 
 	const IFile &getIFile(uint32 index) const;
-	void getFileProperties(SeekableReadStream &zip, const IFile &file,
-			uint16 &compMethod, uint32 &compSize, uint32 &realSize) const;
+	/** Return the offset of the file's data, right after its local header. */
+	size_t getDataOffset(const SeekableReadStream &zip, const IFile &file) const;
 };
 
 } // End of namespace Common
@@ -22,8 +22,6 @@
  *  Phaethon's main window.
  */
 
-#include <deque>
-
 #include <QAction>
 #include <QApplication>
 #include <QMenuBar>
@@ -60,6 +58,7 @@
 
 #include "src/sound/sound.h"
 #include "src/sound/audiostream.h"
+#include "src/sound/dumpwav.h"
 
 #include "src/version/version.h"
 
@@ -224,6 +223,8 @@ MainWindow::MainWindow(QWidget *parent, const char *title, const QSize &size, co
 }
 
 MainWindow::~MainWindow() {
+	saveIndexCache();
+
 	if (!_panelPreviewEmpty->parent())
 		delete _panelPreviewEmpty;
 
@@ -287,7 +288,13 @@ void MainWindow::open(const QString &path) {
 	_status.push("Populating resource tree...");
 
 	try {
-		_files.readPath(Common::UString(path.toStdString()), -1);
+		const Common::UString rootPath(path.toStdString());
+
+		// Reuse what we know about this path from the last time it was opened
+		_indexCache.reset(new Aurora::IndexCache(Aurora::IndexCache::getDefaultCacheFile(rootPath)));
+		_indexCache->load();
+
+		_indexCache->readPath(_files, rootPath, -1);
 	} catch (Common::Exception &e) {
 		_status.pop();
 
@@ -328,6 +335,9 @@ void MainWindow::close() {
 	_treeModel.reset(nullptr);
 	_currentItem = nullptr;
 
+	saveIndexCache();
+	_indexCache.reset();
+
 	_rootPath = "";
 
 	_actionClose->setEnabled(false);
@@ -335,6 +345,17 @@ void MainWindow::close() {
 	_status.pop();
 }
 
+void MainWindow::saveIndexCache() {
+	if (!_indexCache)
+		return;
+
+	try {
+		_indexCache->save();
+	} catch (Common::Exception &e) {
+		Common::printException(e, "WARNING: ");
+	}
+}
+
 void MainWindow::statusPush(const QString &text) {
 	_status.push(text);
 }
@@ -413,16 +434,6 @@ void MainWindow::exportTGA() {
 	}
 }
 
-struct SoundBuffer {
-	static const size_t kBufferSize = 4096;
-
-	int16 buffer[kBufferSize];
-	int samples;
-
-	SoundBuffer() : samples(0) {
-	}
-};
-
 void MainWindow::exportBMUMP3Impl(Common::SeekableReadStream &bmu, Common::WriteStream &mp3) {
 	if ((bmu.size() <= 8) ||
 		(bmu.readUint32BE() != MKTAG('B', 'M', 'U', ' ')) ||
@@ -467,69 +478,6 @@ void MainWindow::exportBMUMP3() {
 	}
 }
 
-uint64 getSoundLength(Sound::AudioStream *sound) {
-	Sound::RewindableAudioStream *rewSound = dynamic_cast<Sound::RewindableAudioStream *>(sound);
-	if (!rewSound)
-		return Sound::RewindableAudioStream::kInvalidLength;
-
-	return rewSound->getLength();
-}
-
-void MainWindow::exportWAVImpl(Sound::AudioStream *sound, Common::WriteStream &wav) {
-	assert(sound);
-
-	const uint16 channels = sound->getChannels();
-	const uint32 rate     = sound->getRate();
-
-	std::deque<SoundBuffer> buffers;
-
-	uint64 length = getSoundLength(sound);
-	if (length != Sound::RewindableAudioStream::kInvalidLength)
-		buffers.resize((length / (SoundBuffer::kBufferSize / channels)) + 1);
-
-	uint32 samples = 0;
-	std::deque<SoundBuffer>::iterator buffer = buffers.begin();
-	while (!sound->endOfStream()) {
-		if (buffer == buffers.end()) {
-			buffers.push_back(SoundBuffer());
-			buffer = --buffers.end();
-		}
-
-		buffer->samples = sound->readBuffer(buffer->buffer, SoundBuffer::kBufferSize);
-
-		if (buffer->samples > 0)
-			samples += buffer->samples;
-
-		++buffer;
-	}
-
-	samples /= channels;
-
-	const uint32 dataSize   = samples * channels * 2;
-	const uint32 byteRate   = rate * channels * 2;
-	const uint16 blockAlign = channels * 2;
-
-	wav.writeUint32BE(MKTAG('R', 'I', 'F', 'F'));
-	wav.writeUint32LE(36 + dataSize);
-	wav.writeUint32BE(MKTAG('W', 'A', 'V', 'E'));
-
-	wav.writeUint32BE(MKTAG('f', 'm', 't', ' '));
-	wav.writeUint32LE(16);
-	wav.writeUint16LE(1);
-	wav.writeUint16LE(channels);
-	wav.writeUint32LE(rate);
-	wav.writeUint32LE(byteRate);
-	wav.writeUint16LE(blockAlign);
-	wav.writeUint16LE(16);
-
-	wav.writeUint32BE(MKTAG('d', 'a', 't', 'a'));
-	wav.writeUint32LE(dataSize);
-
-	for (std::deque<SoundBuffer>::const_iterator b = buffers.begin(); b != buffers.end(); ++b)
-		for (int i = 0; i < b->samples; i++)
-			wav.writeUint16LE(b->buffer[i]);
-}
-
 void MainWindow::exportWAV() {
 	if (!_currentItem)
 		return;
@@ -556,7 +504,7 @@ void MainWindow::exportWAV() {
 
 		Common::WriteFile file(fileName.toStdString());
 
-		exportWAVImpl(sound.get(), file);
+		Sound::dumpWAV(*sound, file);
 		file.flush();
 
 	} catch (Common::Exception &e) {
@@ -31,6 +31,8 @@
 #include "src/common/filetree.h"
 #include "src/common/scopedptr.h"
 
+#include "src/aurora/indexcache.h"
+
 #include "src/gui/resourcetree.h"
 #include "src/gui/proxymodel.h"
 #include "src/gui/statusbar.h"
@@ -98,13 +100,14 @@ private:
 
 	void close();
 
+	void saveIndexCache();
+
 	void statusPush(const QString &text);
 	void statusPop();
 
 	void resourceSelect(const QItemSelection &selected, const QItemSelection &deselected);
 
 	void exportBMUMP3Impl(Common::SeekableReadStream &bmu, Common::WriteStream &mp3);
-	void exportWAVImpl(Sound::AudioStream *sound, Common::WriteStream &wav);
 
 	void showPreviewPanel(QFrame *panel);
 	void showPreviewPanel();
@@ -132,6 +135,7 @@ private:
 	QTextEdit *_log;
 
 	Common::FileTree _files;
+	Common::ScopedPtr<Aurora::IndexCache> _indexCache;
 	Common::ScopedPtr<ResourceTree> _treeModel;
 	Common::ScopedPtr<ProxyModel> _proxyModel;
 	QString _rootPath;
@@ -34,15 +34,16 @@
 
 #include "verdigris/wobjectimpl.h"
 
-#include "src/aurora/biffile.h"
-#include "src/aurora/bzffile.h"
 #include "src/aurora/erffile.h"
 #include "src/aurora/keyfile.h"
+#include "src/aurora/keydatafileresolver.h"
 #include "src/aurora/rimfile.h"
 #include "src/aurora/zipfile.h"
+#include "src/aurora/resourcecache.h"
+#include "src/aurora/namedictionary.h"
 
 #include "src/common/filepath.h"
-#include "src/common/readfile.h"
+#include "src/common/mappedreadfile.h"
 #include "src/common/system.h"
 
 #include "src/gui/mainwindow.h"
@@ -79,8 +80,12 @@ void ResourceTree::populate(const Common::FileTree::Entry &entry, ResourceTreeIt
 }
 
 ResourceTree::~ResourceTree() {
+	// Drop the cached resources of the archives we're about to close
+	for (ArchiveMap::const_iterator a = _archives.begin(); a != _archives.end(); ++a)
+		ResCache.remove(*a->second);
+
 	_archives.clear();
-	_keyDataFiles.clear();
+	_keyDataFiles.reset();
 }
 
 ResourceTreeItem *ResourceTree::itemFromIndex(const QModelIndex &index) const {
@@ -206,10 +211,12 @@ bool ResourceTree::hasChildren(const QModelIndex &index) const {
 void ResourceTree::insertItemsFromArchive(Archive &archive, const QModelIndex &parentIndex) {
 	QList<ResourceTreeItem *> items;
 
-	auto resources = archive.data->getResources();
-	for (auto r = resources.begin(); r != resources.end(); ++r)
+	const Aurora::ResourceTable &resources = archive.data->getResourceTable();
+
+	items.reserve(resources.size());
+	for (size_t i = 0; i < resources.size(); i++)
 	{
-		items.push_back(new ResourceTreeItem(archive.data, *r));
+		items.push_back(new ResourceTreeItem(archive.data, resources, i));
 	}
 
 	insertItems(0, items, parentIndex);
@@ -233,87 +240,53 @@ Aurora::Archive *ResourceTree::getArchive(const QString &path) {
 	if (a != _archives.end())
 		return a->second;
 
+	const Common::UString archivePath(path.toStdString());
+
 	Aurora::Archive *arch = 0;
-	switch (TypeMan.getFileType(path.toStdString().c_str())) {
-		case Aurora::kFileTypeZIP:
-			arch = new Aurora::ZIPFile(new Common::ReadFile(path.toStdString().c_str()));
-			break;
-
-		case Aurora::kFileTypeERF:
-		case Aurora::kFileTypeMOD:
-		case Aurora::kFileTypeNWM:
-		case Aurora::kFileTypeSAV:
-		case Aurora::kFileTypeHAK:
-			arch = new Aurora::ERFFile(new Common::ReadFile(path.toStdString().c_str()));
-			break;
-
-		case Aurora::kFileTypeRIM:
-			arch = new Aurora::RIMFile(new Common::ReadFile(path.toStdString().c_str()));
-			break;
-
-		case Aurora::kFileTypeKEY: {
-			Aurora::KEYFile *key = new Aurora::KEYFile(new Common::ReadFile(path.toStdString().c_str()));
-			loadKEYDataFiles(*key);
-
-			arch = key;
-			break;
-		}
+	if (_mainWindow->_indexCache)
+		arch = _mainWindow->_indexCache->openArchive(archivePath, getKEYDataFileResolver());
+	else
+		arch = Aurora::IndexCache::openArchiveFile(archivePath, getKEYDataFileResolver());
 
-		default:
-			throw Common::Exception("Invalid archive file \"%s\"", path.toStdString().c_str());
-	}
+	if (arch->getNameHashAlgo() != Common::kHashNone)
+		arch->recoverNames(getNameDictionary());
+
+	// The KEY data files are only loaded on demand, but warn about missing ones right away
+	const Aurora::KEYFile *key = dynamic_cast<const Aurora::KEYFile *>(arch);
+	if (key)
+		checkKEYDataFiles(*key);
 
 	_archives.insert(std::make_pair(path.toStdString().c_str(), arch));
 	return arch;
 }
 
-#define USTR(x) (Common::UString((x).toStdString()))
-
-Aurora::KEYDataFile *ResourceTree::getKEYDataFile(const QString &file) {
-	KEYDataFileMap::iterator d = _keyDataFiles.find(file);
-	if (d != _keyDataFiles.end())
-		return d->second;
-
-	Common::UString path = Common::FilePath::normalize(USTR(_root->childAt(0)->getPath() + "/" + file));
-	if (path.empty())
-		throw Common::Exception("No such file or directory \"%s\"", (_root->getPath() + "/" + file).toStdString().c_str());
-
-	Aurora::FileType type = TypeMan.getFileType(file.toStdString().c_str());
-
-	Aurora::KEYDataFile *dataFile = 0;
-	switch (type) {
-		case Aurora::kFileTypeBIF:
-			dataFile = new Aurora::BIFFile(new Common::ReadFile(path));
-			break;
+Aurora::KEYDataFileResolver *ResourceTree::getKEYDataFileResolver() {
+	if (!_keyDataFiles)
+		_keyDataFiles.reset(new Aurora::KEYDataFileResolver(Common::UString(_root->childAt(0)->getPath().toStdString())));
 
-		case Aurora::kFileTypeBZF:
-			dataFile = new Aurora::BZFFile(new Common::ReadFile(path));
-			break;
-
-		default:
-			throw Common::Exception("Unknown KEY data file type %d\n", type);
-	}
-
-	_keyDataFiles.insert(std::make_pair(file, dataFile));
-	return dataFile;
+	return _keyDataFiles.get();
 }
 
-void ResourceTree::loadKEYDataFiles(Aurora::KEYFile &key) {
-	const std::vector<Common::UString> dataFiles = key.getDataFileList();
+void ResourceTree::checkKEYDataFiles(const Aurora::KEYFile &key) {
+	const std::vector<Common::UString> &dataFiles = key.getDataFileList();
+
 	for (size_t i = 0; i < dataFiles.size(); i++) {
 		try {
-			_mainWindow->statusPush(tr("Loading data file") + QString::fromUtf8(dataFiles[i].c_str()) + "...");
-
-			Aurora::KEYDataFile *dataFile = getKEYDataFile(QString::fromUtf8(dataFiles[i].c_str()));
-			key.addDataFile(i, dataFile);
-
-			_mainWindow->statusPop();
+			getKEYDataFileResolver()->findDataFile(dataFiles[i]);
 		} catch (Common::Exception &e) {
 			e.add("Failed to load KEY data file \"%s\"", dataFiles[i].c_str());
-			_mainWindow->statusPop();
 			Common::printException(e, "WARNING: ");
 		}
 	}
 }
 
+const Aurora::NameDictionary &ResourceTree::getNameDictionary() {
+	if (!_nameDictionary) {
+		_nameDictionary.reset(new Aurora::NameDictionary);
+		_nameDictionary->load(Aurora::NameDictionary::getDefaultDictionaryFile());
+	}
+
+	return *_nameDictionary;
+}
+
 } // End of namespace GUI
@@ -52,7 +52,8 @@ namespace Images {
 
 namespace Aurora {
 	class KEYFile;
-	class KEYDataFile;
+	class KEYDataFileResolver;
+	class NameDictionary;
 }
 
 namespace GUI {
@@ -74,9 +75,10 @@ public:
 	void insertItemsFromArchive(Archive &archive, const QModelIndex &parentIndex);
 	void insertItems(size_t position, QList<ResourceTreeItem *> &items, const QModelIndex &parentIndex);
 
-	Aurora::Archive     *getArchive(const QString &path);
-	Aurora::KEYDataFile *getKEYDataFile(const QString &file);
-	void                loadKEYDataFiles(Aurora::KEYFile &key);
+	Aurora::Archive             *getArchive(const QString &path);
+	Aurora::KEYDataFileResolver *getKEYDataFileResolver();
+	void                         checkKEYDataFiles(const Aurora::KEYFile &key);
+	const Aurora::NameDictionary &getNameDictionary();
 
 	/** Return the item in the tree structure that corresponds to the given index. */
 	ResourceTreeItem *itemFromIndex(const QModelIndex &index) const;
@@ -116,11 +118,15 @@ private:
 
 	Common::ScopedPtr<QFileIconProvider> _iconProvider;
 
-	typedef Common::PtrMap<QString, Aurora::Archive>     ArchiveMap;
-	typedef Common::PtrMap<QString, Aurora::KEYDataFile> KEYDataFileMap;
+	typedef Common::PtrMap<QString, Aurora::Archive> ArchiveMap;
 
 	ArchiveMap _archives;
-	KEYDataFileMap _keyDataFiles;
+
+	/** Finds and loads KEY data files on demand, shared by all KEY files. */
+	Common::ScopedPtr<Aurora::KEYDataFileResolver> _keyDataFiles;
+
+	/** Recovers the names of resources in archives that only store name hashes. Loaded on demand. */
+	Common::ScopedPtr<Aurora::NameDictionary> _nameDictionary;
 };
 
 } // End of namespace GUI
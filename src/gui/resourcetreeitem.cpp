@@ -23,7 +23,11 @@
  */
 
 #include "src/common/filepath.h"
-#include "src/common/readfile.h"
+#include "src/common/mappedreadfile.h"
+
+#include "src/aurora/resourcecache.h"
+
+#include "src/images/loader.h"
 
 #include "src/gui/resourcetreeitem.h"
 
@@ -39,9 +43,9 @@ ResourceTreeItem::ResourceTreeItem(const Common::FileTree::Entry &entry) :
 	_archive.addedMembers = false;
 	_archive.index = 0xFFFFFFFF;
 
+	// Only look up the file size once it's needed
+	_triedSize = _source != kSourceFile;
 	_size = Common::kFileInvalid;
-	if (_source == kSourceFile)
-		_size = Common::FilePath::getFileSize(entry.path.generic_string().c_str());
 
 	if (_source == kSourceDirectory)
 		_fileType = Aurora::kFileTypeNone;
@@ -57,31 +61,30 @@ ResourceTreeItem::ResourceTreeItem(const Common::FileTree::Entry &entry) :
 	_duration = Sound::RewindableAudioStream::kInvalidLength;
 }
 
-ResourceTreeItem::ResourceTreeItem(Aurora::Archive *archive, const Aurora::Archive::Resource &resource) :
-	_parent(0), _name(QString::fromUtf8(TypeMan.setFileType(resource.name, resource.type).c_str())),
-	_source(kSourceArchiveFile) {
+ResourceTreeItem::ResourceTreeItem(Aurora::Archive *archive, const Aurora::ResourceTable &resources, size_t n) :
+	_parent(0), _source(kSourceArchiveFile) {
+
+	// Detect the types from the full name right away, instead of converting _name back
+	const Common::UString name = TypeMan.setFileType(resources.getNameString(n), resources.getType(n));
+
+	_name = QString::fromUtf8(name.c_str());
 
 	_archive.data = archive;
 	_archive.addedMembers = false;
-	_archive.index = resource.index;
+	_archive.index = resources.getIndex(n);
 
-	_size = archive->getResourceSize(resource.index);
+	// Querying the size might need to load a KEY data file, so wait until it's needed
+	_triedSize = false;
+	_size = Common::kFileInvalid;
 
-	if (_source == kSourceDirectory)
-		_fileType = Aurora::kFileTypeNone;
-	else
-		_fileType = TypeMan.getFileType(_name.toStdString());
-
-	if (_source == kSourceDirectory)
-		_resourceType = Aurora::kResourceNone;
-	else
-		_resourceType = TypeMan.getResourceType(_name.toStdString());
+	_fileType     = TypeMan.getFileType(name);
+	_resourceType = TypeMan.getResourceType(name);
 
 	_triedDuration = getResourceType() != Aurora::kResourceSound;
 	_duration = Sound::RewindableAudioStream::kInvalidLength;
 }
 
-ResourceTreeItem::ResourceTreeItem(const QString &data) : _parent(0), _name(data), _size(0),
+ResourceTreeItem::ResourceTreeItem(const QString &data) : _parent(0), _name(data), _triedSize(true), _size(0),
 	_triedDuration(0), _duration(0), _source(kSourceNone),
 	_fileType(Aurora::kFileTypeNone), _resourceType(Aurora::kResourceNone) {
 
@@ -150,6 +153,20 @@ const QString &ResourceTreeItem::getPath() const {
 }
 
 qint64 ResourceTreeItem::getSize() const {
+	if (_triedSize)
+		return _size;
+
+	_triedSize = true;
+
+	if (_source == kSourceFile) {
+		_size = Common::FilePath::getFileSize(_path.toStdString().c_str());
+		return _size;
+	}
+
+	const uint64 size = _archive.data ? _archive.data->getResourceSize(_archive.index) : 0xFFFFFFFFFFFFFFFFULL;
+	if (size != 0xFFFFFFFFFFFFFFFFULL)
+		_size = size;
+
 	return _size;
 }
 
@@ -172,13 +189,13 @@ Common::SeekableReadStream *ResourceTreeItem::getResourceData() const {
 				throw Common::Exception("Can't get file data of a directory");
 
 			case kSourceFile:
-				return new Common::ReadFile(_path.toStdString().c_str());
+				return Common::openReadFile(_path.toStdString().c_str());
 
 			case kSourceArchiveFile:
 				if (!_archive.data)
 					throw Common::Exception("No archive opened");
 
-				return _archive.data->getResource(_archive.index);
+				return ResCache.getResource(*_archive.data, _archive.index);
 			default:
 				throw Common::Exception("kSourceArchive is not handled by getResourceData");
 		}
@@ -199,7 +216,7 @@ Images::Decoder *ResourceTreeItem::getImage() const {
 
 	Images::Decoder *img = 0;
 	try {
-		img = getImage(*res, _fileType);
+		img = Images::loadImage(*res, _fileType);
 	} catch (Common::Exception &e) {
 		e.add("Failed to get image from \"%s\"", getName().toStdString().c_str());
 		throw;
@@ -208,56 +225,6 @@ Images::Decoder *ResourceTreeItem::getImage() const {
 	return img;
 }
 
-Images::Decoder *ResourceTreeItem::getImage(Common::SeekableReadStream &res, Aurora::FileType type) const {
-	Images::Decoder *img = 0;
-	switch (type) {
-		case Aurora::kFileTypeDDS:
-			img = new Images::DDS(res);
-			break;
-
-		case Aurora::kFileTypeTPC:
-			img = new Images::TPC(res);
-			break;
-
-		// TXB may be actually TPC
-		case Aurora::kFileTypeTXB:
-		case Aurora::kFileTypeTXB2:
-			try {
-				img = new Images::TXB(res);
-			} catch (Common::Exception &e1) {
-
-				try {
-					res.seek(0);
-					img = new Images::TPC(res);
-
-				} catch (Common::Exception &e2) {
-					e1.add(e2);
-
-					throw e1;
-				}
-			}
-			break;
-
-		case Aurora::kFileTypeTGA:
-			img = new Images::TGA(res);
-			break;
-
-		case Aurora::kFileTypeSBM:
-			img = new Images::SBM(res);
-			break;
-
-		case Aurora::kFileTypeCUR:
-		case Aurora::kFileTypeCURS:
-			img = new Images::WinIconImage(res);
-			break;
-
-		default:
-			throw Common::Exception("Unsupported image type %d", type);
-	}
-
-	return img;
-}
-
 Archive &ResourceTreeItem::getArchive() {
 	return _archive;
 }
@@ -63,8 +63,8 @@ public:
 	/** Filesystem item constructor. */
 	ResourceTreeItem(const Common::FileTree::Entry &entry);
 
-	/** Archive item constructor */
-	ResourceTreeItem(Aurora::Archive *archive, const Aurora::Archive::Resource &resource);
+	/** Archive item constructor, for the n-th resource in the archive's resource table. */
+	ResourceTreeItem(Aurora::Archive *archive, const Aurora::ResourceTable &resources, size_t n);
 
 	/** Root item constructor. */
 	ResourceTreeItem(const QString &data);
@@ -107,7 +107,6 @@ public:
 	Archive                    &getArchive();
 	Common::SeekableReadStream *getResourceData() const;
 	Images::Decoder            *getImage() const;
-	Images::Decoder            *getImage(Common::SeekableReadStream &res, Aurora::FileType type) const;
 	Sound::AudioStream         *getAudioStream() const;
 	uint64                      getSoundDuration() const;
 
@@ -117,7 +116,9 @@ private:
 	QString _name; ///< The filename. This is what the tree view displays.
 
 	QString _path;
-	qint64 _size;
+
+	mutable bool _triedSize;
+	mutable qint64 _size;
 
 	mutable bool _triedDuration;
 	mutable uint64 _duration;
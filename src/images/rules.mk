@@ -28,6 +28,7 @@ src_images_libimages_la_SOURCES += \
     src/images/s3tc.h \
     src/images/decoder.h \
     src/images/dumptga.h \
+    src/images/loader.h \
     src/images/winiconimage.h \
     src/images/tga.h \
     src/images/dds.h \
@@ -46,4 +47,5 @@ src_images_libimages_la_SOURCES += \
     src/images/tpc.cpp \
     src/images/txb.cpp \
     src/images/sbm.cpp \
+    src/images/loader.cpp \
     $(EMPTY)
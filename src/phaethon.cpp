@@ -44,6 +44,7 @@
 #include "src/sound/sound.h"
 
 #include "src/cline.h"
+#include "src/batch.h"
 
 void initPlatform();
 
@@ -73,6 +74,27 @@ int main(int argc, char **argv) {
 				openGamePath(job.path);
 				break;
 
+			// Archive operations don't need the GUI or the sound system
+			case kOperationList:
+				listArchive(job);
+				break;
+
+			case kOperationExtract:
+				extractArchive(job);
+				break;
+
+			case kOperationConvert:
+				convertArchive(job);
+				break;
+
+			case kOperationDuplicates:
+				findDuplicates(job);
+				break;
+
+			case kOperationNames:
+				collectNames(job);
+				break;
+
 			case kOperationInvalid:
 			default:
 				std::printf("%s\n", createHelpText(args[0]).c_str());
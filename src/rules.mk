@@ -28,10 +28,12 @@ src_phaethon_SOURCES =
 
 src_phaethon_SOURCES += \
     src/cline.h \
+    src/batch.h \
     $(EMPTY)
 
 src_phaethon_SOURCES += \
     src/cline.cpp \
+    src/batch.cpp \
     src/phaethon.cpp \
     $(EMPTY)
 
@@ -0,0 +1,107 @@
+/* Phaethon - A FLOSS resource explorer for BioWare's Aurora engine games
+ *
+ * Phaethon is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * Phaethon is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * Phaethon is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Phaethon. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  A simple PCM WAV sound dumper.
+ */
+
+#include <deque>
+
+#include "src/common/types.h"
+#include "src/common/endianness.h"
+#include "src/common/writestream.h"
+
+#include "src/sound/dumpwav.h"
+#include "src/sound/audiostream.h"
+
+namespace Sound {
+
+struct SoundBuffer {
+	static const size_t kBufferSize = 4096;
+
+	int16 buffer[kBufferSize];
+	int samples;
+
+	SoundBuffer() : samples(0) {
+	}
+};
+
+static uint64 getSoundLength(AudioStream &sound) {
+	RewindableAudioStream *rewSound = dynamic_cast<RewindableAudioStream *>(&sound);
+	if (!rewSound)
+		return RewindableAudioStream::kInvalidLength;
+
+	return rewSound->getLength();
+}
+
+void dumpWAV(AudioStream &sound, Common::WriteStream &wav) {
+	const uint16 channels = sound.getChannels();
+	const uint32 rate     = sound.getRate();
+
+	std::deque<SoundBuffer> buffers;
+
+	uint64 length = getSoundLength(sound);
+	if (length != RewindableAudioStream::kInvalidLength)
+		buffers.resize((length / (SoundBuffer::kBufferSize / channels)) + 1);
+
+	uint32 samples = 0;
+	std::deque<SoundBuffer>::iterator buffer = buffers.begin();
+	while (!sound.endOfStream()) {
+		if (buffer == buffers.end()) {
+			buffers.push_back(SoundBuffer());
+			buffer = --buffers.end();
+		}
+
+		buffer->samples = sound.readBuffer(buffer->buffer, SoundBuffer::kBufferSize);
+
+		if (buffer->samples > 0)
+			samples += buffer->samples;
+
+		++buffer;
+	}
+
+	samples /= channels;
+
+	const uint32 dataSize   = samples * channels * 2;
+	const uint32 byteRate   = rate * channels * 2;
+	const uint16 blockAlign = channels * 2;
+
+	wav.writeUint32BE(MKTAG('R', 'I', 'F', 'F'));
+	wav.writeUint32LE(36 + dataSize);
+	wav.writeUint32BE(MKTAG('W', 'A', 'V', 'E'));
+
+	wav.writeUint32BE(MKTAG('f', 'm', 't', ' '));
+	wav.writeUint32LE(16);
+	wav.writeUint16LE(1);
+	wav.writeUint16LE(channels);
+	wav.writeUint32LE(rate);
+	wav.writeUint32LE(byteRate);
+	wav.writeUint16LE(blockAlign);
+	wav.writeUint16LE(16);
+
+	wav.writeUint32BE(MKTAG('d', 'a', 't', 'a'));
+	wav.writeUint32LE(dataSize);
+
+	for (std::deque<SoundBuffer>::const_iterator b = buffers.begin(); b != buffers.end(); ++b)
+		for (int i = 0; i < b->samples; i++)
+			wav.writeUint16LE(b->buffer[i]);
+}
+
+} // End of namespace Sound
@@ -0,0 +1,132 @@
+/* Phaethon - A FLOSS resource explorer for BioWare's Aurora engine games
+ *
+ * Phaethon is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * Phaethon is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * Phaethon is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Phaethon. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  Unit tests for our archive bulk extractor.
+ */
+
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include "gtest/gtest.h"
+
+#include "src/common/error.h"
+#include "src/common/memreadstream.h"
+
+#include "src/aurora/rimfile.h"
+#include "src/aurora/archiveextractor.h"
+
+#include "tests/aurora/archivetest.h"
+
+class ArchiveExtractor : public TemporaryPathTest {
+};
+
+GTEST_TEST_F(ArchiveExtractor, extractAll) {
+	std::vector< std::vector<byte> > files;
+	createFiles(files, 48);
+
+	std::vector<byte> data;
+	createRIM(data, files);
+
+	const Aurora::RIMFile rim(new Common::MemoryReadStream(&data[0], data.size()));
+
+	Aurora::ArchiveExtractor extractor(rim, 4);
+	ASSERT_EQ(extractor.extractAll(_directory.generic_string()), files.size());
+
+	EXPECT_TRUE(extractor.getFailures().empty());
+
+	for (size_t i = 0; i < files.size(); i++) {
+		const boost::filesystem::path path = _directory / Common::UString::format("file%u.txt", (uint)i).c_str();
+		ASSERT_TRUE(boost::filesystem::is_regular_file(path)) << "At index " << i;
+
+		EXPECT_EQ(readFile(path), files[i]) << "At index " << i;
+	}
+}
+
+GTEST_TEST_F(ArchiveExtractor, extractSingleThreaded) {
+	std::vector< std::vector<byte> > files;
+	createFiles(files, 8);
+
+	std::vector<byte> data;
+	createRIM(data, files);
+
+	const Aurora::RIMFile rim(new Common::MemoryReadStream(&data[0], data.size()));
+
+	Aurora::ArchiveExtractor extractor(rim, 1);
+	ASSERT_EQ(extractor.extractAll(_directory.generic_string()), files.size());
+
+	for (size_t i = 0; i < files.size(); i++) {
+		const boost::filesystem::path path = _directory / Common::UString::format("file%u.txt", (uint)i).c_str();
+
+		EXPECT_EQ(readFile(path), files[i]) << "At index " << i;
+	}
+}
+
+GTEST_TEST_F(ArchiveExtractor, extractSelection) {
+	std::vector< std::vector<byte> > files;
+	createFiles(files, 8);
+
+	std::vector<byte> data;
+	createRIM(data, files);
+
+	const Aurora::RIMFile rim(new Common::MemoryReadStream(&data[0], data.size()));
+
+	std::vector<uint32> indices;
+	indices.push_back(1);
+	indices.push_back(5);
+	indices.push_back(23);
+
+	Aurora::ArchiveExtractor extractor(rim, 2);
+	ASSERT_EQ(extractor.extract(indices, _directory.generic_string()), 2);
+
+	EXPECT_EQ(readFile(_directory / "file1.txt"), files[1]);
+	EXPECT_EQ(readFile(_directory / "file5.txt"), files[5]);
+
+	EXPECT_FALSE(boost::filesystem::exists(_directory / "file0.txt"));
+
+	ASSERT_EQ(extractor.getFailures().size(), 1);
+	EXPECT_EQ(extractor.getFailures()[0].index, 23);
+}
+
+GTEST_TEST_F(ArchiveExtractor, extractDuplicateNames) {
+	std::vector<Common::UString> names;
+	names.push_back("foo");
+	names.push_back("bar");
+	names.push_back("foo");
+
+	std::vector< std::vector<byte> > files;
+	createFiles(files, names.size());
+
+	std::vector<byte> data;
+	createRIM(data, files, names);
+
+	const Aurora::RIMFile rim(new Common::MemoryReadStream(&data[0], data.size()));
+
+	Aurora::ArchiveExtractor extractor(rim, 2);
+	ASSERT_EQ(extractor.extractAll(_directory.generic_string()), 2);
+
+	// The second "foo" would overwrite the first one
+	ASSERT_EQ(extractor.getFailures().size(), 1);
+	EXPECT_EQ(extractor.getFailures()[0].index, 2);
+
+	EXPECT_EQ(readFile(_directory / "foo.txt"), files[0]);
+	EXPECT_EQ(readFile(_directory / "bar.txt"), files[1]);
+}
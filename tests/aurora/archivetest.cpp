@@ -0,0 +1,166 @@
+/* Phaethon - A FLOSS resource explorer for BioWare's Aurora engine games
+ *
+ * Phaethon is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * Phaethon is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * Phaethon is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Phaethon. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  Utility unit test functions for creating archives and temporary files.
+ */
+
+#include <cstring>
+
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+
+#include "src/common/endianness.h"
+#include "src/common/platform.h"
+
+#include "src/aurora/types.h"
+
+#include "tests/aurora/archivetest.h"
+
+void createFiles(std::vector< std::vector<byte> > &files, uint32 count) {
+	files.resize(count);
+
+	for (uint32 i = 0; i < count; i++) {
+		files[i].resize(i * 11 + 1);
+		for (size_t j = 0; j < files[i].size(); j++)
+			files[i][j] = (byte) (i * 5 + j);
+	}
+}
+
+void createRIM(std::vector<byte> &rim, const std::vector< std::vector<byte> > &files,
+               const std::vector<Common::UString> &names) {
+
+	const uint32 count = files.size();
+
+	rim.resize(20 + count * 32);
+
+	std::memcpy(&rim[0], "RIM V1.0", 8);
+	WRITE_LE_UINT32(&rim[ 8], 0);
+	WRITE_LE_UINT32(&rim[12], count);
+	WRITE_LE_UINT32(&rim[16], 20);
+
+	for (uint32 i = 0; i < count; i++) {
+		const uint32 n = count - 1 - i;
+
+		byte *entry = &rim[20 + n * 32];
+		std::memset(entry, 0, 32);
+
+		std::memcpy(entry, names[n].c_str(), std::strlen(names[n].c_str()));
+
+		WRITE_LE_UINT16(entry + 16, Aurora::kFileTypeTXT);
+		WRITE_LE_UINT32(entry + 20, n);
+		WRITE_LE_UINT32(entry + 24, rim.size());
+		WRITE_LE_UINT32(entry + 28, files[n].size());
+
+		rim.insert(rim.end(), files[n].begin(), files[n].end());
+	}
+}
+
+void createRIM(std::vector<byte> &rim, const std::vector< std::vector<byte> > &files) {
+	std::vector<Common::UString> names;
+	for (uint32 i = 0; i < files.size(); i++)
+		names.push_back(Common::UString::format("file%u", i));
+
+	createRIM(rim, files, names);
+}
+
+void createBIF(std::vector<byte> &bif, const std::vector< std::vector<byte> > &files) {
+	const uint32 count = files.size();
+
+	bif.resize(20 + count * 16);
+
+	std::memcpy(&bif[0], "BIFFV1  ", 8);
+	WRITE_LE_UINT32(&bif[ 8], count);
+	WRITE_LE_UINT32(&bif[12], 0);
+	WRITE_LE_UINT32(&bif[16], 20);
+
+	for (uint32 i = 0; i < count; i++) {
+		byte *entry = &bif[20 + i * 16];
+
+		WRITE_LE_UINT32(entry +  0, i);
+		WRITE_LE_UINT32(entry +  4, bif.size());
+		WRITE_LE_UINT32(entry +  8, files[i].size());
+		WRITE_LE_UINT32(entry + 12, Aurora::kFileTypeTXT);
+
+		bif.insert(bif.end(), files[i].begin(), files[i].end());
+	}
+}
+
+void createKEY(std::vector<byte> &key, const Common::UString &bifName, uint32 count) {
+	const uint32 nameSize = std::strlen(bifName.c_str());
+
+	const uint32 offFileTable = 64;
+	const uint32 offResTable  = offFileTable + 12 + nameSize;
+
+	key.resize(offResTable + count * 22, 0);
+
+	std::memcpy(&key[0], "KEY V1  ", 8);
+	WRITE_LE_UINT32(&key[ 8], 1);
+	WRITE_LE_UINT32(&key[12], count);
+	WRITE_LE_UINT32(&key[16], offFileTable);
+	WRITE_LE_UINT32(&key[20], offResTable);
+
+	WRITE_LE_UINT32(&key[offFileTable + 4], offFileTable + 12);
+	WRITE_LE_UINT16(&key[offFileTable + 8], nameSize);
+	std::memcpy(&key[offFileTable + 12], bifName.c_str(), nameSize);
+
+	for (uint32 i = 0; i < count; i++) {
+		byte *entry = &key[offResTable + i * 22];
+
+		const Common::UString name = Common::UString::format("file%u", i);
+		std::memcpy(entry, name.c_str(), std::strlen(name.c_str()));
+
+		WRITE_LE_UINT16(entry + 16, Aurora::kFileTypeTXT);
+		WRITE_LE_UINT32(entry + 18, i);
+	}
+}
+
+void writeFile(const boost::filesystem::path &path, const std::vector<byte> &data) {
+	boost::filesystem::ofstream file(path, std::ofstream::binary);
+
+	if (!data.empty())
+		file.write(reinterpret_cast<const char *>(&data[0]), data.size());
+
+	file.close();
+}
+
+std::vector<byte> readFile(const boost::filesystem::path &path) {
+	boost::filesystem::ifstream file(path, std::ifstream::binary);
+
+	return std::vector<byte>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+void TemporaryPathTest::SetUp() {
+	Common::Platform::init();
+
+	const boost::filesystem::path tmpPath = boost::filesystem::temp_directory_path();
+
+	_directory = tmpPath / boost::filesystem::unique_path("%%%%_%%%%_%%%%_%%%%.xoreos");
+	_tempFile  = tmpPath / boost::filesystem::unique_path("%%%%_%%%%_%%%%_%%%%.xoreos");
+
+	boost::filesystem::create_directories(_directory);
+}
+
+void TemporaryPathTest::TearDown() {
+	if (!_directory.empty())
+		boost::filesystem::remove_all(_directory);
+	if (!_tempFile.empty())
+		boost::filesystem::remove(_tempFile);
+}
@@ -0,0 +1,74 @@
+/* Phaethon - A FLOSS resource explorer for BioWare's Aurora engine games
+ *
+ * Phaethon is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * Phaethon is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * Phaethon is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Phaethon. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  Utility unit test functions for creating archives and temporary files.
+ */
+
+#ifndef TESTS_AURORA_ARCHIVETEST_H
+#define TESTS_AURORA_ARCHIVETEST_H
+
+#include <vector>
+
+#include <boost/filesystem/path.hpp>
+
+#include "gtest/gtest.h"
+
+#include "src/common/types.h"
+#include "src/common/ustring.h"
+
+/** Create the contents of this many files, of varying sizes. */
+void createFiles(std::vector< std::vector<byte> > &files, uint32 count);
+
+/** Create a RIM containing these files as TXT resources with these names.
+ *
+ *  The data is written in reverse order of the resource list, so that
+ *  the order of the resource offsets differs from the index order.
+ */
+void createRIM(std::vector<byte> &rim, const std::vector< std::vector<byte> > &files,
+               const std::vector<Common::UString> &names);
+/** Create a RIM containing these files as TXT resources, named "file0", "file1", ... */
+void createRIM(std::vector<byte> &rim, const std::vector< std::vector<byte> > &files);
+
+/** Create a BIF V1 containing these files as TXT resources. */
+void createBIF(std::vector<byte> &bif, const std::vector< std::vector<byte> > &files);
+/** Create a KEY V1 indexing this many TXT resources, named "file0", "file1", ..., in one BIF. */
+void createKEY(std::vector<byte> &key, const Common::UString &bifName, uint32 count);
+
+/** Write the data into a file on disk. */
+void writeFile(const boost::filesystem::path &path, const std::vector<byte> &data);
+/** Read the whole contents of a file on disk. */
+std::vector<byte> readFile(const boost::filesystem::path &path);
+
+/** A test fixture providing a temporary directory and file path.
+ *
+ *  The directory is created before each test, the file is not. Both
+ *  are removed again after each test.
+ */
+class TemporaryPathTest : public ::testing::Test {
+protected:
+	boost::filesystem::path _directory; ///< The temporary directory.
+	boost::filesystem::path _tempFile;  ///< The temporary file path.
+
+	void SetUp();
+	void TearDown();
+};
+
+#endif // TESTS_AURORA_ARCHIVETEST_H
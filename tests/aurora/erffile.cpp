@@ -31,6 +31,7 @@
 #include "src/aurora/locstring.h"
 #include "src/aurora/language.h"
 #include "src/aurora/erffile.h"
+#include "src/aurora/namedictionary.h"
 
 /** Utility class to hold an ERF password by copying from a static array. */
 class PasswordStore : public std::vector<byte> {
@@ -198,6 +199,15 @@ GTEST_TEST(ERFFile10, findResourceName) {
 	EXPECT_EQ(erf.findResource("nope"      , Aurora::kFileTypeBMP), 0xFFFFFFFF);
 }
 
+GTEST_TEST(ERFFile10, findResourceNameIgnoreCase) {
+	const Aurora::ERFFile erf(new Common::MemoryReadStream(kERFFile10));
+
+	EXPECT_EQ(erf.findResource("Ozymandias", Aurora::kFileTypeTXT), 0);
+	EXPECT_EQ(erf.findResource("OZYMANDIAS", Aurora::kFileTypeTXT), 0);
+
+	EXPECT_EQ(erf.findResource("OZYMANDIAS", Aurora::kFileTypeBMP), 0xFFFFFFFF);
+}
+
 GTEST_TEST(ERFFile10, getResource) {
 	const Aurora::ERFFile erf(new Common::MemoryReadStream(kERFFile10));
 
@@ -1504,6 +1514,21 @@ GTEST_TEST(ERFFile22Blowfish, getResource) {
 	delete file;
 }
 
+GTEST_TEST(ERFFile22Blowfish, getResourceNoCopy) {
+	PasswordStore password(kERF22BPassword);
+	const Aurora::ERFFile erf(new Common::MemoryReadStream(kERFFile22B), password);
+
+	Common::SeekableReadStream *file = erf.getResource(0, true);
+	ASSERT_NE(file, static_cast<Common::SeekableReadStream *>(0));
+
+	ASSERT_EQ(file->size(), strlen(kFileData));
+
+	for (size_t i = 0; i < strlen(kFileData); i++)
+		EXPECT_EQ(file->readByte(), kFileData[i]) << "At index " << i;
+
+	delete file;
+}
+
 // --- ERF V2.2 (Blowfish + raw DEFLATE) ---
 
 // Percy Bysshe Shelley's "Ozymandias", within an ERF V2.2 (Blowfish + raw DEFLATE) file
@@ -1649,6 +1674,21 @@ GTEST_TEST(ERFFile22BlowfishDeflateRaw, getResource) {
 	delete file;
 }
 
+GTEST_TEST(ERFFile22BlowfishDeflateRaw, getResourceNoCopy) {
+	PasswordStore password(kERF22BDRPassword);
+	const Aurora::ERFFile erf(new Common::MemoryReadStream(kERFFile22BDR), password);
+
+	Common::SeekableReadStream *file = erf.getResource(0, true);
+	ASSERT_NE(file, static_cast<Common::SeekableReadStream *>(0));
+
+	ASSERT_EQ(file->size(), strlen(kFileData));
+
+	for (size_t i = 0; i < strlen(kFileData); i++)
+		EXPECT_EQ(file->readByte(), kFileData[i]) << "At index " << i;
+
+	delete file;
+}
+
 // --- ERF V3.0 (plain) ---
 
 // Percy Bysshe Shelley's "Ozymandias", within an ERF V3.0 (plain) file
@@ -1931,6 +1971,29 @@ GTEST_TEST(ERFFile30NoFilenames, findResourceName) {
 	EXPECT_EQ(erf.findResource("nope"      , Aurora::kFileTypeBMP), 0xFFFFFFFF);
 }
 
+GTEST_TEST(ERFFile30NoFilenames, recoverNames) {
+	Aurora::ERFFile erf(new Common::MemoryReadStream(kERFFile30NoFilenames));
+
+	// Looking up a resource builds the lookup index, which has to be rebuilt after the recovery
+	EXPECT_EQ(erf.findResource("ozymandias", Aurora::kFileTypeTXT), 0xFFFFFFFF);
+
+	Aurora::NameDictionary dictionary;
+	dictionary.add("Ozymandias.txt");
+	dictionary.add("shelley.txt");
+
+	EXPECT_EQ(erf.recoverNames(dictionary), 1);
+	EXPECT_EQ(erf.recoverNames(dictionary), 0);
+
+	const Aurora::ResourceTable &resources = erf.getResourceTable();
+	ASSERT_EQ(resources.size(), 1);
+
+	EXPECT_STREQ(resources.getNameData(0), "Ozymandias");
+	EXPECT_EQ(resources.getType(0), Aurora::kFileTypeTXT);
+
+	EXPECT_EQ(erf.findResource("ozymandias", Aurora::kFileTypeTXT), 0);
+	EXPECT_STREQ(erf.getResources().begin()->name.c_str(), "Ozymandias");
+}
+
 GTEST_TEST(ERFFile30NoFilenames, getResource) {
 	const Aurora::ERFFile erf(new Common::MemoryReadStream(kERFFile30NoFilenames));
 
@@ -2517,3 +2580,18 @@ GTEST_TEST(ERFFile30BlowfishDeflateRaw, getResource) {
 
 	delete file;
 }
+
+GTEST_TEST(ERFFile30BlowfishDeflateRaw, getResourceNoCopy) {
+	PasswordStore password(kERF30BDRPassword);
+	const Aurora::ERFFile erf(new Common::MemoryReadStream(kERFFile30BDR), password);
+
+	Common::SeekableReadStream *file = erf.getResource(0, true);
+	ASSERT_NE(file, static_cast<Common::SeekableReadStream *>(0));
+
+	ASSERT_EQ(file->size(), strlen(kFileData));
+
+	for (size_t i = 0; i < strlen(kFileData); i++)
+		EXPECT_EQ(file->readByte(), kFileData[i]) << "At index " << i;
+
+	delete file;
+}
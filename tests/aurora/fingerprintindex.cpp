@@ -0,0 +1,224 @@
+/* Phaethon - A FLOSS resource explorer for BioWare's Aurora engine games
+ *
+ * Phaethon is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * Phaethon is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * Phaethon is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Phaethon. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  Unit tests for our resource fingerprint index.
+ */
+
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include "gtest/gtest.h"
+
+#include "src/common/error.h"
+
+#include "src/aurora/fingerprintindex.h"
+
+#include "tests/aurora/archivetest.h"
+
+class FingerprintIndex : public TemporaryPathTest {
+protected:
+	std::vector< std::vector<byte> > _files;
+
+	void SetUp() {
+		TemporaryPathTest::SetUp();
+
+		boost::filesystem::create_directories(_directory / "data");
+
+		/* Two RIMs with the same 4 resources, except for file1, which differs.
+		 * On top of that, a loose copy of file2. */
+
+		createFiles(_files, 4);
+
+		std::vector<byte> rim;
+		createRIM(rim, _files);
+		writeFile(_directory / "data" / "a.rim", rim);
+
+		std::vector< std::vector<byte> > files = _files;
+		files[1][0] ^= 0xFF;
+
+		createRIM(rim, files);
+		writeFile(_directory / "data" / "b.rim", rim);
+
+		writeFile(_directory / "file2.txt", _files[2]);
+	}
+};
+
+GTEST_TEST_F(FingerprintIndex, loadMissing) {
+	Aurora::FingerprintIndex index(_tempFile.generic_string());
+
+	EXPECT_FALSE(index.load());
+	EXPECT_EQ(index.getLocationCount(), 0);
+}
+
+GTEST_TEST_F(FingerprintIndex, loadBroken) {
+	writeFile(_tempFile, std::vector<byte>(16, 0xFF));
+
+	Aurora::FingerprintIndex index(_tempFile.generic_string());
+
+	EXPECT_FALSE(index.load());
+	EXPECT_EQ(index.getLocationCount(), 0);
+}
+
+GTEST_TEST_F(FingerprintIndex, addPath) {
+	Aurora::FingerprintIndex index(_tempFile.generic_string());
+
+	EXPECT_EQ(index.addPath(_directory.generic_string()), 9);
+	EXPECT_TRUE(index.getFailures().empty());
+
+	EXPECT_EQ(index.getLocationCount(), 3);
+	EXPECT_EQ(index.getFingerprintCount(), 9);
+
+	const Aurora::FingerprintIndex::FingerprintList copies = index.findCopies("file2", Aurora::kFileTypeTXT);
+	ASSERT_EQ(copies.size(), 3);
+
+	for (size_t i = 0; i < copies.size(); i++) {
+		EXPECT_EQ(copies[i]->size, _files[2].size()) << "At index " << i;
+		EXPECT_TRUE(copies[i]->hasSameContents(*copies[0])) << "At index " << i;
+	}
+
+	EXPECT_TRUE(index.findCopies("nope", Aurora::kFileTypeTXT).empty());
+	EXPECT_TRUE(index.findCopies("file2", Aurora::kFileTypeGFF).empty());
+
+	// Names are case-insensitive
+	EXPECT_EQ(index.findCopies("FILE2", Aurora::kFileTypeTXT).size(), 3);
+}
+
+GTEST_TEST_F(FingerprintIndex, findDifferingCopies) {
+	Aurora::FingerprintIndex index(_tempFile.generic_string());
+	index.addPath(_directory.generic_string());
+
+	EXPECT_EQ(index.findDifferingCopies("file0", Aurora::kFileTypeTXT).size(), 1);
+	EXPECT_EQ(index.findDifferingCopies("file2", Aurora::kFileTypeTXT).size(), 1);
+
+	const Aurora::FingerprintIndex::FingerprintGroups groups =
+		index.findDifferingCopies("file1", Aurora::kFileTypeTXT);
+
+	ASSERT_EQ(groups.size(), 2);
+	ASSERT_EQ(groups[0].size(), 1);
+	ASSERT_EQ(groups[1].size(), 1);
+
+	EXPECT_FALSE(groups[0][0]->hasSameContents(*groups[1][0]));
+	EXPECT_NE(groups[0][0]->location, groups[1][0]->location);
+
+	const std::vector<Aurora::FingerprintIndex::FingerprintGroups> differences = index.findDifferences();
+	ASSERT_EQ(differences.size(), 1);
+	EXPECT_EQ(differences[0].size(), 2);
+	EXPECT_EQ(differences[0][0][0]->name, "file1");
+}
+
+GTEST_TEST_F(FingerprintIndex, findDuplicates) {
+	Aurora::FingerprintIndex index(_tempFile.generic_string());
+	index.addPath(_directory.generic_string());
+
+	// file0, file2 and file3
+	EXPECT_EQ(index.findDuplicates().size(), 3);
+
+	EXPECT_EQ(index.getDuplicatedSize(), _files[0].size() + 2 * _files[2].size() + _files[3].size());
+}
+
+GTEST_TEST_F(FingerprintIndex, save) {
+	{
+		Aurora::FingerprintIndex index(_tempFile.generic_string());
+		index.addPath(_directory.generic_string());
+
+		index.save();
+	}
+
+	// The index is written through a temporary file
+	EXPECT_TRUE(boost::filesystem::exists(_tempFile));
+	EXPECT_FALSE(boost::filesystem::exists(_tempFile.generic_string() + ".tmp"));
+
+	const boost::filesystem::path rimPath = _directory / "data" / "b.rim";
+	const std::time_t lastModified = boost::filesystem::last_write_time(rimPath);
+
+	{
+		Aurora::FingerprintIndex index(_tempFile.generic_string());
+		ASSERT_TRUE(index.load());
+
+		EXPECT_EQ(index.getLocationCount(), 3);
+		EXPECT_EQ(index.getFingerprintCount(), 9);
+		EXPECT_EQ(index.findDifferingCopies("file1", Aurora::kFileTypeTXT).size(), 2);
+
+		// Nothing changed, so nothing is hashed again
+		EXPECT_EQ(index.addPath(_directory.generic_string()), 0);
+		EXPECT_EQ(index.getFingerprintCount(), 9);
+
+		// Make b.rim the same as a.rim, with the same size but a different modification time
+		std::vector<byte> rim;
+		createRIM(rim, _files);
+		writeFile(rimPath, rim);
+		boost::filesystem::last_write_time(rimPath, lastModified - 10);
+
+		EXPECT_EQ(index.addPath(_directory.generic_string()), 4);
+		EXPECT_EQ(index.findDifferingCopies("file1", Aurora::kFileTypeTXT).size(), 1);
+
+		index.save();
+	}
+
+	boost::filesystem::remove(_directory / "file2.txt");
+
+	{
+		Aurora::FingerprintIndex index(_tempFile.generic_string());
+		ASSERT_TRUE(index.load());
+
+		EXPECT_EQ(index.findDifferingCopies("file1", Aurora::kFileTypeTXT).size(), 1);
+
+		// Removed files are forgotten
+		EXPECT_EQ(index.addPath(_directory.generic_string()), 0);
+		EXPECT_EQ(index.getLocationCount(), 2);
+		EXPECT_EQ(index.findCopies("file2", Aurora::kFileTypeTXT).size(), 2);
+	}
+}
+
+GTEST_TEST_F(FingerprintIndex, brokenArchive) {
+	writeFile(_directory / "data" / "c.rim", std::vector<byte>(16, 0xFF));
+
+	Aurora::FingerprintIndex index(_tempFile.generic_string());
+
+	EXPECT_EQ(index.addPath(_directory.generic_string()), 9);
+
+	ASSERT_EQ(index.getFailures().size(), 1);
+	EXPECT_EQ(index.getFailures()[0].index, Aurora::FingerprintIndex::kLooseFile);
+
+	EXPECT_EQ(index.getLocationCount(), 3);
+}
+
+GTEST_TEST_F(FingerprintIndex, brokenResource) {
+	// Cut off the end of the last resource's data, which belongs to the first resource
+	std::vector<byte> rim;
+	createRIM(rim, _files);
+	rim.resize(rim.size() - 1);
+
+	writeFile(_directory / "data" / "c.rim", rim);
+
+	Aurora::FingerprintIndex index(_tempFile.generic_string());
+
+	EXPECT_EQ(index.addPath(_directory.generic_string()), 13);
+
+	ASSERT_EQ(index.getFailures().size(), 1);
+	EXPECT_EQ(index.getFailures()[0].index, 0);
+
+	// Only the broken resource is dropped, not the whole archive
+	EXPECT_EQ(index.getLocationCount(), 4);
+	EXPECT_EQ(index.getFingerprintCount(), 12);
+	EXPECT_EQ(index.findCopies("file0", Aurora::kFileTypeTXT).size(), 2);
+}
@@ -0,0 +1,284 @@
+/* Phaethon - A FLOSS resource explorer for BioWare's Aurora engine games
+ *
+ * Phaethon is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * Phaethon is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * Phaethon is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Phaethon. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  Unit tests for our persistent index cache.
+ */
+
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include "gtest/gtest.h"
+
+#include "src/common/error.h"
+#include "src/common/scopedptr.h"
+#include "src/common/readstream.h"
+#include "src/common/filetree.h"
+
+#include "src/aurora/archive.h"
+#include "src/aurora/rimfile.h"
+#include "src/aurora/keyfile.h"
+#include "src/aurora/keydatafileresolver.h"
+#include "src/aurora/indexcache.h"
+
+#include "tests/aurora/archivetest.h"
+
+static void checkArchive(const Aurora::Archive &archive, const std::vector< std::vector<byte> > &files) {
+	const Aurora::ResourceTable &resources = archive.getResourceTable();
+	ASSERT_EQ(resources.size(), files.size());
+
+	for (size_t i = 0; i < files.size(); i++) {
+		EXPECT_EQ(resources.getNameString(i), Common::UString::format("file%u", (uint)i));
+		EXPECT_EQ(resources.getType(i), Aurora::kFileTypeTXT);
+
+		EXPECT_EQ(archive.getResourceSize(i), files[i].size());
+
+		Common::ScopedPtr<Common::SeekableReadStream> res(archive.getResource(i));
+		ASSERT_EQ(res->size(), files[i].size());
+
+		std::vector<byte> data(res->size());
+		res->read(&data[0], data.size());
+
+		EXPECT_EQ(data, files[i]) << "At index " << i;
+	}
+}
+
+class IndexCache : public TemporaryPathTest {
+protected:
+	void SetUp() {
+		TemporaryPathTest::SetUp();
+
+		boost::filesystem::create_directories(_directory / "data");
+	}
+};
+
+GTEST_TEST_F(IndexCache, loadMissing) {
+	Aurora::IndexCache cache(_tempFile.generic_string());
+
+	EXPECT_FALSE(cache.load());
+	EXPECT_EQ(cache.getArchiveCount(), 0);
+}
+
+GTEST_TEST_F(IndexCache, loadBroken) {
+	writeFile(_tempFile, std::vector<byte>(16, 0xFF));
+
+	Aurora::IndexCache cache(_tempFile.generic_string());
+
+	EXPECT_FALSE(cache.load());
+	EXPECT_EQ(cache.getArchiveCount(), 0);
+}
+
+GTEST_TEST_F(IndexCache, readPath) {
+	writeFile(_directory / "data" / "foo.txt", std::vector<byte>(4, 0));
+
+	{
+		Aurora::IndexCache cache(_tempFile.generic_string());
+
+		Common::FileTree tree;
+		cache.readPath(tree, _directory.generic_string());
+
+		cache.save();
+	}
+
+	Aurora::IndexCache cache(_tempFile.generic_string());
+	ASSERT_TRUE(cache.load());
+
+	Common::FileTree tree;
+	cache.readPath(tree, _directory.generic_string());
+
+	// Nothing changed, so the cache isn't written again
+	boost::filesystem::remove(_tempFile);
+	cache.save();
+	EXPECT_FALSE(boost::filesystem::exists(_tempFile));
+
+	const Common::FileTree::Entry &root = tree.getRoot();
+	EXPECT_TRUE(root.isDirectory());
+	ASSERT_EQ(root.children.size(), 1);
+
+	const Common::FileTree::Entry &data = root.children.front();
+	EXPECT_STREQ(data.name.c_str(), "data");
+	EXPECT_TRUE(data.isDirectory());
+	ASSERT_EQ(data.children.size(), 1);
+
+	const Common::FileTree::Entry &foo = data.children.front();
+	EXPECT_STREQ(foo.name.c_str(), "foo.txt");
+	EXPECT_FALSE(foo.isDirectory());
+	EXPECT_EQ(foo.path, data.path / "foo.txt");
+}
+
+GTEST_TEST_F(IndexCache, openArchive) {
+	std::vector< std::vector<byte> > files;
+	createFiles(files, 6);
+
+	std::vector<byte> data;
+	createRIM(data, files);
+
+	const boost::filesystem::path rimPath = _directory / "data" / "test.rim";
+	writeFile(rimPath, data);
+
+	{
+		Aurora::IndexCache cache(_tempFile.generic_string());
+
+		Common::ScopedPtr<Aurora::Archive> archive(cache.openArchive(rimPath.generic_string()));
+		checkArchive(*archive, files);
+
+		EXPECT_EQ(cache.getArchiveCount(), 1);
+
+		cache.save();
+	}
+
+	// The cache is written through a temporary file
+	EXPECT_TRUE(boost::filesystem::exists(_tempFile));
+	EXPECT_FALSE(boost::filesystem::exists(_tempFile.generic_string() + ".tmp"));
+
+	const std::time_t lastModified = boost::filesystem::last_write_time(rimPath);
+
+	Aurora::IndexCache cache(_tempFile.generic_string());
+	ASSERT_TRUE(cache.load());
+	EXPECT_EQ(cache.getArchiveCount(), 1);
+
+	// The index comes from the cache, the archive file isn't parsed yet
+	Common::ScopedPtr<Aurora::Archive> archive(cache.openArchive(rimPath.generic_string()));
+	EXPECT_FALSE(dynamic_cast<Aurora::RIMFile *>(archive.get()));
+
+	checkArchive(*archive, files);
+
+	// Break the archive without changing its size or modification time
+	std::vector<byte> broken = data;
+	memcpy(&broken[0], "XXXXXXXX", 8);
+
+	writeFile(rimPath, broken);
+	boost::filesystem::last_write_time(rimPath, lastModified);
+
+	// The checksum changed, so the archive is parsed again
+	EXPECT_THROW(cache.openArchive(rimPath.generic_string()), Common::Exception);
+
+	// With a changed modification time, the archive is parsed again as well
+	writeFile(rimPath, data);
+	boost::filesystem::last_write_time(rimPath, lastModified - 10);
+
+	archive.reset(cache.openArchive(rimPath.generic_string()));
+	EXPECT_TRUE(dynamic_cast<Aurora::RIMFile *>(archive.get()));
+
+	checkArchive(*archive, files);
+}
+
+GTEST_TEST_F(IndexCache, openKEY) {
+	std::vector< std::vector<byte> > files;
+	createFiles(files, 6);
+
+	std::vector<byte> bif, key;
+	createBIF(bif, files);
+	createKEY(key, "data/test.bif", files.size());
+
+	const boost::filesystem::path bifPath = _directory / "data" / "test.bif";
+	const boost::filesystem::path keyPath = _directory / "test.key";
+
+	writeFile(bifPath, bif);
+	writeFile(keyPath, key);
+
+	const std::time_t lastModified = boost::filesystem::last_write_time(bifPath);
+
+	// Break the data file without changing its size or modification time
+	std::vector<byte> broken = bif;
+	memcpy(&broken[0], "XXXXXXXX", 8);
+
+	{
+		Aurora::KEYDataFileResolver resolver(_directory.generic_string());
+		Aurora::IndexCache cache(_tempFile.generic_string());
+
+		// Indexing the KEY doesn't load the data files
+		Common::ScopedPtr<Aurora::Archive> archive(cache.openArchive(keyPath.generic_string(), &resolver));
+		cache.save();
+	}
+
+	{
+		writeFile(bifPath, broken);
+		boost::filesystem::last_write_time(bifPath, lastModified);
+
+		Aurora::KEYDataFileResolver resolver(_directory.generic_string());
+		Aurora::IndexCache cache(_tempFile.generic_string());
+		ASSERT_TRUE(cache.load());
+
+		// So the sizes aren't cached yet, and need the data file
+		Common::ScopedPtr<Aurora::Archive> archive(cache.openArchive(keyPath.generic_string(), &resolver));
+		EXPECT_EQ(archive->getResourceSize(0), 0xFFFFFFFFFFFFFFFFULL);
+	}
+
+	{
+		writeFile(bifPath, bif);
+		boost::filesystem::last_write_time(bifPath, lastModified);
+
+		Aurora::KEYDataFileResolver resolver(_directory.generic_string());
+		Aurora::IndexCache cache(_tempFile.generic_string());
+		ASSERT_TRUE(cache.load());
+
+		// Once the data file is loaded, the sizes of all its resources are added to the cache
+		Common::ScopedPtr<Aurora::Archive> archive(cache.openArchive(keyPath.generic_string(), &resolver));
+		EXPECT_EQ(archive->getResourceSize(0), files[0].size());
+
+		cache.save();
+	}
+
+	writeFile(bifPath, broken);
+	boost::filesystem::last_write_time(bifPath, lastModified);
+
+	Aurora::IndexCache cache(_tempFile.generic_string());
+	ASSERT_TRUE(cache.load());
+
+	{
+		// The resource sizes come from the cache, neither the KEY nor the BIF are parsed
+		Aurora::KEYDataFileResolver resolver(_directory.generic_string());
+
+		Common::ScopedPtr<Aurora::Archive> archive(cache.openArchive(keyPath.generic_string(), &resolver));
+		EXPECT_FALSE(dynamic_cast<Aurora::KEYFile *>(archive.get()));
+
+		for (size_t i = 0; i < files.size(); i++)
+			EXPECT_EQ(archive->getResourceSize(i), files[i].size()) << "At index " << i;
+
+		EXPECT_THROW(archive->getResource(0), Common::Exception);
+	}
+
+	{
+		// With a changed data file, the KEY is indexed again, without any sizes
+		boost::filesystem::last_write_time(bifPath, lastModified - 10);
+
+		Aurora::KEYDataFileResolver resolver(_directory.generic_string());
+
+		Common::ScopedPtr<Aurora::Archive> archive(cache.openArchive(keyPath.generic_string(), &resolver));
+		EXPECT_EQ(archive->getResourceSize(0), 0xFFFFFFFFFFFFFFFFULL);
+	}
+
+	{
+		// A KEY with missing data files is never taken from the cache
+		boost::filesystem::remove(bifPath);
+
+		Aurora::KEYDataFileResolver resolver(_directory.generic_string());
+
+		Common::ScopedPtr<Aurora::Archive> archive(cache.openArchive(keyPath.generic_string(), &resolver));
+		EXPECT_TRUE(dynamic_cast<Aurora::KEYFile *>(archive.get()));
+
+		archive.reset(cache.openArchive(keyPath.generic_string(), &resolver));
+		EXPECT_TRUE(dynamic_cast<Aurora::KEYFile *>(archive.get()));
+
+		EXPECT_EQ(archive->getResourceSize(0), 0xFFFFFFFFFFFFFFFFULL);
+	}
+}
@@ -76,7 +76,7 @@ GTEST_TEST(KEYFile10, getResources) {
 GTEST_TEST(KEYFile10, getResourceSize) {
 	Aurora::KEYFile key(new Common::MemoryReadStream(kKEY10File));
 
-	EXPECT_EQ(key.getResourceSize(0), 0xFFFFFFFF);
+	EXPECT_EQ(key.getResourceSize(0), 0xFFFFFFFFFFFFFFFFULL);
 
 	EXPECT_THROW(key.getResourceSize(1), Common::Exception);
 }
@@ -155,7 +155,7 @@ GTEST_TEST(KEYFile11, getResources) {
 GTEST_TEST(KEYFile11, getResourceSize) {
 	Aurora::KEYFile key(new Common::MemoryReadStream(kKEY11File));
 
-	EXPECT_EQ(key.getResourceSize(0), 0xFFFFFFFF);
+	EXPECT_EQ(key.getResourceSize(0), 0xFFFFFFFFFFFFFFFFULL);
 
 	EXPECT_THROW(key.getResourceSize(1), Common::Exception);
 }
@@ -0,0 +1,179 @@
+/* Phaethon - A FLOSS resource explorer for BioWare's Aurora engine games
+ *
+ * Phaethon is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * Phaethon is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * Phaethon is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Phaethon. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  Unit tests for our resource name dictionary.
+ */
+
+#include <cstring>
+
+#include "gtest/gtest.h"
+
+#include "src/common/error.h"
+#include "src/common/hash.h"
+#include "src/common/memreadstream.h"
+#include "src/common/memwritestream.h"
+
+#include "src/aurora/namedictionary.h"
+#include "src/aurora/resourcetable.h"
+
+static uint64 hashName(const char *name) {
+	return Aurora::NameDictionary::hashName(name, std::strlen(name));
+}
+
+GTEST_TEST(NameDictionary, hashName) {
+	EXPECT_EQ(hashName("ozymandias.txt"), Common::hashString("ozymandias.txt", Common::kHashFNV64));
+	EXPECT_EQ(hashName("Ozymandias.TXT"), Common::hashString("ozymandias.txt", Common::kHashFNV64));
+
+	// Non-ASCII names are hashed by their code points, with only the ASCII characters lowercased
+	EXPECT_EQ(hashName("\xC3\x84PFEL.txt"), Common::hashString(Common::UString("\xC3\x84pfel.txt"), Common::kHashFNV64));
+}
+
+GTEST_TEST(NameDictionary, empty) {
+	const Aurora::NameDictionary dictionary;
+
+	EXPECT_TRUE(dictionary.empty());
+	EXPECT_EQ(dictionary.size(), 0);
+
+	EXPECT_EQ(dictionary.getNameHashAlgo(), Common::kHashFNV64);
+	EXPECT_EQ(dictionary.find(hashName("foo.txt")), static_cast<const char *>(0));
+}
+
+GTEST_TEST(NameDictionary, add) {
+	Aurora::NameDictionary dictionary;
+
+	EXPECT_TRUE(dictionary.add("foo.txt"));
+	EXPECT_TRUE(dictionary.add("Bar.tga"));
+	EXPECT_FALSE(dictionary.add("FOO.txt"));
+	EXPECT_FALSE(dictionary.add(""));
+
+	std::vector<Common::UString> names;
+	names.push_back("baz.gda");
+	names.push_back("bar.tga");
+	names.push_back("quux.wav");
+	names.push_back("baz.gda");
+
+	EXPECT_EQ(dictionary.add(names), 2);
+
+	ASSERT_EQ(dictionary.size(), 4);
+
+	// The first name added for a hash wins
+	EXPECT_STREQ(dictionary.find(hashName("foo.txt")) , "foo.txt");
+	EXPECT_STREQ(dictionary.find(hashName("bar.tga")) , "Bar.tga");
+	EXPECT_STREQ(dictionary.find(hashName("baz.gda")) , "baz.gda");
+	EXPECT_STREQ(dictionary.find(hashName("quux.wav")), "quux.wav");
+
+	EXPECT_EQ(dictionary.find(hashName("nope.txt")), static_cast<const char *>(0));
+}
+
+GTEST_TEST(NameDictionary, addWordList) {
+	static const char *kWordList =
+		"# Some names\n"
+		"foo.txt\r\n"
+		"  bar.tga \t\n"
+		"\n"
+		"baz.gda";
+
+	Common::MemoryReadStream stream(reinterpret_cast<const byte *>(kWordList), std::strlen(kWordList));
+
+	Aurora::NameDictionary dictionary;
+	EXPECT_EQ(dictionary.addWordList(stream), 3);
+
+	ASSERT_EQ(dictionary.size(), 3);
+
+	EXPECT_STREQ(dictionary.find(hashName("foo.txt")), "foo.txt");
+	EXPECT_STREQ(dictionary.find(hashName("bar.tga")), "bar.tga");
+	EXPECT_STREQ(dictionary.find(hashName("baz.gda")), "baz.gda");
+}
+
+GTEST_TEST(NameDictionary, recoverNames) {
+	Aurora::ResourceTable resources;
+
+	resources.add("", 0, Aurora::kFileTypeTXT , 0, hashName("foo.txt"));
+	resources.add("", 0, Aurora::kFileTypeNone, 1, hashName("bar.tga"));
+	resources.add("", 0, Aurora::kFileTypeTXT , 2, hashName("nope.txt"));
+	resources.add("named", 5, Aurora::kFileTypeTXT, 3, hashName("baz.gda"));
+
+	Aurora::NameDictionary dictionary;
+	dictionary.add("foo.txt");
+	dictionary.add("bar.tga");
+	dictionary.add("baz.gda");
+
+	EXPECT_EQ(dictionary.recoverNames(resources), 2);
+
+	EXPECT_STREQ(resources.getNameData(0), "foo");
+	EXPECT_EQ(resources.getType(0), Aurora::kFileTypeTXT);
+
+	EXPECT_STREQ(resources.getNameData(1), "bar");
+	EXPECT_EQ(resources.getType(1), Aurora::kFileTypeTGA);
+
+	EXPECT_STREQ(resources.getNameData(2), "");
+	EXPECT_STREQ(resources.getNameData(3), "named");
+}
+
+GTEST_TEST(NameDictionary, save) {
+	Aurora::NameDictionary dictionary;
+	dictionary.add("foo.txt");
+	dictionary.add("bar.tga");
+	dictionary.add("baz.gda");
+
+	Common::MemoryWriteStreamDynamic stream(true);
+	dictionary.save(stream);
+
+	Common::MemoryReadStream data(stream.getData(), stream.size());
+
+	Aurora::NameDictionary loaded;
+	loaded.add("quux.wav");
+	loaded.load(data);
+
+	ASSERT_EQ(loaded.size(), 3);
+
+	EXPECT_STREQ(loaded.find(hashName("foo.txt")), "foo.txt");
+	EXPECT_STREQ(loaded.find(hashName("bar.tga")), "bar.tga");
+	EXPECT_STREQ(loaded.find(hashName("baz.gda")), "baz.gda");
+
+	EXPECT_EQ(loaded.find(hashName("quux.wav")), static_cast<const char *>(0));
+
+	// A loaded dictionary can be extended
+	EXPECT_TRUE(loaded.add("quux.wav"));
+	EXPECT_STREQ(loaded.find(hashName("quux.wav")), "quux.wav");
+}
+
+GTEST_TEST(NameDictionary, loadBroken) {
+	Aurora::NameDictionary dictionary;
+	dictionary.add("foo.txt");
+
+	Common::MemoryWriteStreamDynamic stream(true);
+	dictionary.save(stream);
+
+	std::vector<byte> data(stream.getData(), stream.getData() + stream.size());
+
+	// Truncated
+	Common::MemoryReadStream truncated(&data[0], data.size() - 1);
+	EXPECT_THROW(dictionary.load(truncated), Common::Exception);
+	EXPECT_TRUE(dictionary.empty());
+
+	// Name offset out of range
+	data[24] = 0xFF;
+
+	Common::MemoryReadStream broken(&data[0], data.size());
+	EXPECT_THROW(dictionary.load(broken), Common::Exception);
+	EXPECT_TRUE(dictionary.empty());
+}
@@ -0,0 +1,217 @@
+/* Phaethon - A FLOSS resource explorer for BioWare's Aurora engine games
+ *
+ * Phaethon is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * Phaethon is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * Phaethon is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Phaethon. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  Unit tests for our cache of decoded archive resources.
+ */
+
+#include <vector>
+
+#include <boost/thread/thread.hpp>
+
+#include "gtest/gtest.h"
+
+#include "src/common/error.h"
+#include "src/common/scopedptr.h"
+#include "src/common/atomic.h"
+#include "src/common/memreadstream.h"
+
+#include "src/aurora/rimfile.h"
+#include "src/aurora/resourcecache.h"
+
+#include "tests/aurora/archivetest.h"
+
+/** Create a RIM with this many TXT resources of 100 bytes each. */
+static void createRIM(std::vector<byte> &rim, std::vector< std::vector<byte> > &files, uint32 count) {
+	files.resize(count);
+
+	for (uint32 i = 0; i < count; i++) {
+		files[i].resize(100);
+		for (size_t j = 0; j < files[i].size(); j++)
+			files[i][j] = (byte) (i * 13 + j);
+	}
+
+	createRIM(rim, files);
+}
+
+static std::vector<byte> readAll(Common::SeekableReadStream &stream) {
+	std::vector<byte> data(stream.size());
+	if (!data.empty())
+		stream.read(&data[0], data.size());
+
+	return data;
+}
+
+static std::vector<byte> getResource(const Aurora::Archive &archive, uint32 index) {
+	Common::ScopedPtr<Common::SeekableReadStream> res(ResCache.getResource(archive, index));
+
+	return readAll(*res);
+}
+
+class ResourceCache : public ::testing::Test {
+protected:
+	std::vector<byte> _data;
+	std::vector< std::vector<byte> > _files;
+
+	Common::ScopedPtr<Aurora::RIMFile> _rim;
+
+	void SetUp() {
+		createRIM(_data, _files, 8);
+
+		_rim.reset(new Aurora::RIMFile(new Common::MemoryReadStream(&_data[0], _data.size())));
+
+		ResCache.clear();
+		ResCache.resetStatistics();
+		ResCache.setBudget(Aurora::ResourceCache::kDefaultBudget);
+	}
+
+	void TearDown() {
+		ResCache.clear();
+		ResCache.setBudget(Aurora::ResourceCache::kDefaultBudget);
+	}
+};
+
+GTEST_TEST_F(ResourceCache, hitsAndMisses) {
+	EXPECT_EQ(getResource(*_rim, 0), _files[0]);
+	EXPECT_EQ(getResource(*_rim, 0), _files[0]);
+	EXPECT_EQ(getResource(*_rim, 1), _files[1]);
+
+	const Aurora::ResourceCache::Statistics stats = ResCache.getStatistics();
+
+	EXPECT_EQ(stats.hits  , 1);
+	EXPECT_EQ(stats.misses, 2);
+	EXPECT_EQ(stats.count , 2);
+	EXPECT_EQ(stats.size  , 200);
+}
+
+GTEST_TEST_F(ResourceCache, evictLeastRecentlyUsed) {
+	ResCache.setBudget(300);
+
+	getResource(*_rim, 0);
+	getResource(*_rim, 1);
+	getResource(*_rim, 2);
+
+	// Touch 0, so that 1 is now the least recently used
+	getResource(*_rim, 0);
+
+	getResource(*_rim, 3);
+
+	Aurora::ResourceCache::Statistics stats = ResCache.getStatistics();
+	EXPECT_EQ(stats.count, 3);
+	EXPECT_EQ(stats.size , 300);
+
+	ResCache.resetStatistics();
+
+	getResource(*_rim, 0);
+	getResource(*_rim, 3);
+
+	stats = ResCache.getStatistics();
+	EXPECT_EQ(stats.hits  , 2);
+	EXPECT_EQ(stats.misses, 0);
+
+	EXPECT_EQ(getResource(*_rim, 1), _files[1]);
+
+	stats = ResCache.getStatistics();
+	EXPECT_EQ(stats.misses, 1);
+}
+
+GTEST_TEST_F(ResourceCache, tooLarge) {
+	ResCache.setBudget(50);
+
+	EXPECT_EQ(getResource(*_rim, 0), _files[0]);
+
+	const Aurora::ResourceCache::Statistics stats = ResCache.getStatistics();
+	EXPECT_EQ(stats.count, 0);
+	EXPECT_EQ(stats.size , 0);
+
+	// The stream doesn't read from the archive's data, which might be gone before the stream
+	Common::ScopedPtr<Common::SeekableReadStream> res(ResCache.getResource(*_rim, 1));
+
+	const Common::MemoryReadStream *memRes = dynamic_cast<const Common::MemoryReadStream *>(res.get());
+	ASSERT_NE(memRes, static_cast<const Common::MemoryReadStream *>(0));
+
+	EXPECT_TRUE((memRes->getData() < &_data[0]) || (memRes->getData() >= (&_data[0] + _data.size())));
+
+	_rim.reset();
+	_data.clear();
+
+	EXPECT_EQ(readAll(*res), _files[1]);
+}
+
+GTEST_TEST_F(ResourceCache, streamOutlivesEviction) {
+	Common::ScopedPtr<Common::SeekableReadStream> res(ResCache.getResource(*_rim, 2));
+
+	ResCache.clear();
+
+	EXPECT_EQ(readAll(*res), _files[2]);
+}
+
+GTEST_TEST_F(ResourceCache, remove) {
+	std::vector<byte> data;
+	std::vector< std::vector<byte> > files;
+	createRIM(data, files, 2);
+
+	const Aurora::RIMFile rim(new Common::MemoryReadStream(&data[0], data.size()));
+
+	getResource(*_rim, 0);
+	getResource(rim, 0);
+	getResource(rim, 1);
+
+	ASSERT_EQ(ResCache.getStatistics().count, 3);
+
+	ResCache.remove(rim);
+
+	EXPECT_EQ(ResCache.getStatistics().count, 1);
+	EXPECT_EQ(ResCache.getStatistics().size , 100);
+}
+
+GTEST_TEST_F(ResourceCache, concurrent) {
+	static const size_t kThreadCount = 8;
+	static const size_t kIterations  = 64;
+
+	// Small enough to force evictions while the threads are running
+	ResCache.setBudget(400);
+
+	boost::atomic<size_t> errors(0);
+
+	boost::thread_group threads;
+	for (size_t t = 0; t < kThreadCount; t++) {
+		threads.create_thread([this, &errors, t]() {
+			for (size_t n = 0; n < kIterations * _files.size(); n++) {
+				const uint32 index = (n * 7 + t) % _files.size();
+
+				try {
+					if (getResource(*_rim, index) != _files[index])
+						errors.fetch_add(1);
+				} catch (...) {
+					errors.fetch_add(1);
+				}
+			}
+		});
+	}
+
+	threads.join_all();
+
+	EXPECT_EQ(errors.load(), 0);
+
+	const Aurora::ResourceCache::Statistics stats = ResCache.getStatistics();
+	EXPECT_EQ(stats.hits + stats.misses, kThreadCount * kIterations * _files.size());
+	EXPECT_LE(stats.size, 400);
+}
@@ -0,0 +1,159 @@
+/* Phaethon - A FLOSS resource explorer for BioWare's Aurora engine games
+ *
+ * Phaethon is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * Phaethon is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * Phaethon is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Phaethon. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  Unit tests for our resource table class.
+ */
+
+#include "gtest/gtest.h"
+
+#include "src/common/error.h"
+
+#include "src/aurora/resourcetable.h"
+
+GTEST_TEST(ResourceTable, empty) {
+	Aurora::ResourceTable table;
+
+	EXPECT_TRUE(table.empty());
+	EXPECT_EQ(table.size(), 0);
+}
+
+GTEST_TEST(ResourceTable, add) {
+	Aurora::ResourceTable table;
+	table.reserve(3, 12);
+
+	EXPECT_EQ(table.add("foo", 3, Aurora::kFileTypeTXT, 0), 0);
+	EXPECT_EQ(table.add(Common::UString("barbaz"), Aurora::kFileTypeBMP, 1, 0x1234), 1);
+	EXPECT_EQ(table.add("", 0, Aurora::kFileTypeNone, 2), 2);
+
+	ASSERT_FALSE(table.empty());
+	ASSERT_EQ(table.size(), 3);
+
+	EXPECT_EQ(table.getName(0), "foo");
+	EXPECT_EQ(table.getName(1), "barbaz");
+	EXPECT_EQ(table.getName(2), "");
+
+	EXPECT_EQ(table.getType(0), Aurora::kFileTypeTXT);
+	EXPECT_EQ(table.getType(1), Aurora::kFileTypeBMP);
+	EXPECT_EQ(table.getType(2), Aurora::kFileTypeNone);
+
+	EXPECT_EQ(table.getIndex(0), 0);
+	EXPECT_EQ(table.getIndex(1), 1);
+	EXPECT_EQ(table.getIndex(2), 2);
+
+	EXPECT_EQ(table.getHash(0), 0);
+	EXPECT_EQ(table.getHash(1), 0x1234);
+	EXPECT_EQ(table.getHash(2), 0);
+}
+
+GTEST_TEST(ResourceTable, addFixed) {
+	static const byte kNames[] = {
+		'f', 'o', 'o', '\0', 'x', 'x', 'x', 'x',
+		'f', 'o', 'o', 'b', 'a', 'r', 'b', 'a',
+		0xC3, 0xB6, '\0', '\0', '\0', '\0', '\0', '\0'
+	};
+
+	Aurora::ResourceTable table;
+
+	EXPECT_EQ(table.addFixed(kNames +  0, 8, Aurora::kFileTypeTXT, 0), 0);
+	EXPECT_EQ(table.addFixed(kNames +  8, 8, Aurora::kFileTypeBMP, 1, 0x1234), 1);
+	EXPECT_EQ(table.addFixed(kNames + 16, 8, Aurora::kFileTypeNone, 2), 2);
+
+	ASSERT_EQ(table.size(), 3);
+
+	// Padded, filling the whole field and not ASCII
+	EXPECT_EQ(table.getName(0), "foo");
+	EXPECT_EQ(table.getName(1), "foobarba");
+	EXPECT_EQ(table.getName(2), "\xC3\xB6");
+
+	EXPECT_STREQ(table.getNameData(1), "foobarba");
+
+	EXPECT_EQ(table.getType(1), Aurora::kFileTypeBMP);
+	EXPECT_EQ(table.getIndex(2), 2);
+	EXPECT_EQ(table.getHash(1), 0x1234);
+
+	// Not valid UTF-8
+	EXPECT_THROW(table.addFixed(kNames + 17, 1, Aurora::kFileTypeTXT, 3), Common::Exception);
+}
+
+GTEST_TEST(ResourceTable, getNameData) {
+	Aurora::ResourceTable table;
+
+	table.add("foobar", 3, Aurora::kFileTypeTXT, 0);
+	table.add("", 0, Aurora::kFileTypeTXT, 1);
+
+	EXPECT_STREQ(table.getNameData(0), "foo");
+	EXPECT_STREQ(table.getNameData(1), "");
+}
+
+GTEST_TEST(ResourceTable, getNameString) {
+	Aurora::ResourceTable table;
+
+	table.add(Common::UString("f\xC3\xB6\xC3\xB6"), Aurora::kFileTypeTXT, 0);
+
+	const Common::UString name = table.getNameString(0);
+
+	EXPECT_STREQ(name.c_str(), "f\xC3\xB6\xC3\xB6");
+	EXPECT_EQ(name.size(), 3);
+}
+
+GTEST_TEST(ResourceTable, set) {
+	Aurora::ResourceTable table;
+
+	table.add("foo", 3, Aurora::kFileTypeNone, 0);
+
+	table.setType(0, Aurora::kFileTypeTXT);
+	table.setHash(0, 0x1234);
+
+	EXPECT_EQ(table.getType(0), Aurora::kFileTypeTXT);
+	EXPECT_EQ(table.getHash(0), 0x1234);
+	EXPECT_EQ(table.getName(0), "foo");
+}
+
+GTEST_TEST(ResourceTable, setName) {
+	Aurora::ResourceTable table;
+
+	table.add("", 0, Aurora::kFileTypeTXT, 0, 0x1234);
+	table.add("bar", 3, Aurora::kFileTypeBMP, 1);
+
+	table.setName(0, Common::UString("foobar"));
+
+	EXPECT_EQ(table.getName(0), "foobar");
+	EXPECT_STREQ(table.getNameData(0), "foobar");
+	EXPECT_EQ(table.getType(0), Aurora::kFileTypeTXT);
+	EXPECT_EQ(table.getHash(0), 0x1234);
+
+	EXPECT_EQ(table.getName(1), "bar");
+}
+
+GTEST_TEST(ResourceTable, clear) {
+	Aurora::ResourceTable table;
+
+	table.add("foo", 3, Aurora::kFileTypeTXT, 0);
+	table.clear();
+
+	EXPECT_TRUE(table.empty());
+
+	table.add("bar", 3, Aurora::kFileTypeBMP, 5);
+
+	ASSERT_EQ(table.size(), 1);
+	EXPECT_EQ(table.getName(0), "bar");
+	EXPECT_EQ(table.getIndex(0), 5);
+}
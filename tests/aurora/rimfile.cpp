@@ -22,10 +22,20 @@
  *  Unit tests for our RIM file archive class.
  */
 
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/thread/thread.hpp>
+
 #include "gtest/gtest.h"
 
 #include "src/common/error.h"
+#include "src/common/scopedptr.h"
+#include "src/common/atomic.h"
 #include "src/common/memreadstream.h"
+#include "src/common/readfile.h"
+#include "src/common/platform.h"
 
 #include "src/aurora/rimfile.h"
 
@@ -142,6 +152,30 @@ GTEST_TEST(RIMFile, findResourceName) {
 	EXPECT_EQ(rim.findResource("nope"      , Aurora::kFileTypeBMP), 0xFFFFFFFF);
 }
 
+GTEST_TEST(RIMFile, findResourceNameCase) {
+	Common::MemoryReadStream *stream = new Common::MemoryReadStream(kRIMFile);
+	const Aurora::RIMFile rim(stream);
+
+	EXPECT_EQ(rim.findResource("OZYMANDIAS", Aurora::kFileTypeTXT), 0);
+	EXPECT_EQ(rim.findResource("OzYmAnDiAs", Aurora::kFileTypeTXT), 0);
+}
+
+GTEST_TEST(RIMFile, findResourceNameCaseNonASCII) {
+	// Rename the resource to "Äzymandias"
+	std::vector<byte> data(kRIMFile, kRIMFile + sizeof(kRIMFile));
+	memcpy(&data[20], "\xC3\x84" "zymandias", 11);
+
+	const Aurora::RIMFile rim(new Common::MemoryReadStream(&data[0], data.size()));
+
+	// Like UString::toLower(), the name lookup only folds ASCII letters
+	ASSERT_STREQ(Common::UString("\xC3\x84").toLower().c_str(), "\xC3\x84");
+
+	EXPECT_EQ(rim.findResource("\xC3\x84" "zymandias", Aurora::kFileTypeTXT), 0);
+	EXPECT_EQ(rim.findResource("\xC3\x84" "ZYMANDIAS", Aurora::kFileTypeTXT), 0);
+
+	EXPECT_EQ(rim.findResource("\xC3\xA4" "zymandias", Aurora::kFileTypeTXT), 0xFFFFFFFF);
+}
+
 GTEST_TEST(RIMFile, getResource) {
 	Common::MemoryReadStream *stream = new Common::MemoryReadStream(kRIMFile);
 	const Aurora::RIMFile rim(stream);
@@ -156,3 +190,123 @@ GTEST_TEST(RIMFile, getResource) {
 
 	delete file;
 }
+
+GTEST_TEST(RIMFile, getResourceNoCopy) {
+	Common::MemoryReadStream *stream = new Common::MemoryReadStream(kRIMFile);
+	const Aurora::RIMFile rim(stream);
+
+	Common::SeekableReadStream *file = rim.getResource(0, true);
+	ASSERT_NE(file, static_cast<Common::SeekableReadStream *>(0));
+
+	ASSERT_EQ(file->size(), strlen(kFileData));
+
+	for (size_t i = 0; i < strlen(kFileData); i++)
+		EXPECT_EQ(file->readByte(), kFileData[i]) << "At index " << i;
+
+	delete file;
+}
+
+/** Create a RIM with many resources, each with distinct contents. */
+static void createLargeRIM(std::vector<byte> &rim, std::vector< std::vector<byte> > &files) {
+	static const uint32 kResourceCount = 64;
+
+	files.resize(kResourceCount);
+	rim.resize(20 + kResourceCount * 32);
+
+	memcpy(&rim[0], "RIM V1.0", 8);
+	WRITE_LE_UINT32(&rim[ 8], 0);
+	WRITE_LE_UINT32(&rim[12], kResourceCount);
+	WRITE_LE_UINT32(&rim[16], 20);
+
+	for (uint32 i = 0; i < kResourceCount; i++) {
+		files[i].resize(i * 97 + 1);
+		for (size_t j = 0; j < files[i].size(); j++)
+			files[i][j] = (byte) (i * 31 + j * 7);
+
+		byte *entry = &rim[20 + i * 32];
+		memset(entry, 0, 32);
+
+		const Common::UString name = Common::UString::format("file%u", i);
+		memcpy(entry, name.c_str(), strlen(name.c_str()));
+
+		WRITE_LE_UINT16(entry + 16, Aurora::kFileTypeTXT);
+		WRITE_LE_UINT32(entry + 24, rim.size());
+		WRITE_LE_UINT32(entry + 28, files[i].size());
+
+		rim.insert(rim.end(), files[i].begin(), files[i].end());
+	}
+}
+
+/** Extract all resources from many threads at once and compare their contents. */
+static void extractConcurrently(const Aurora::RIMFile &rim, const std::vector< std::vector<byte> > &files) {
+	static const size_t kThreadCount = 8;
+	static const size_t kIterations  = 16;
+
+	boost::atomic<size_t> errors(0);
+
+	boost::thread_group threads;
+	for (size_t t = 0; t < kThreadCount; t++) {
+		threads.create_thread([&rim, &files, &errors, t]() {
+			for (size_t n = 0; n < kIterations * files.size(); n++) {
+				const uint32 index = (t * 7 + n) % files.size();
+
+				try {
+					Common::ScopedPtr<Common::SeekableReadStream> file(rim.getResource(index, (n % 2) == 0));
+
+					const std::vector<byte> &data = files[index];
+					if (file->size() != data.size()) {
+						errors++;
+						continue;
+					}
+
+					std::vector<byte> readData(data.size());
+					if ((file->read(&readData[0], readData.size()) != readData.size()) || (readData != data))
+						errors++;
+
+				} catch (...) {
+					errors++;
+				}
+			}
+		});
+	}
+
+	threads.join_all();
+
+	EXPECT_EQ(errors.load(), 0);
+}
+
+GTEST_TEST(RIMFile, getResourceConcurrentMemory) {
+	std::vector<byte> data;
+	std::vector< std::vector<byte> > files;
+	createLargeRIM(data, files);
+
+	const Aurora::RIMFile rim(new Common::MemoryReadStream(&data[0], data.size()));
+	ASSERT_EQ(rim.getResourceTable().size(), files.size());
+
+	extractConcurrently(rim, files);
+}
+
+GTEST_TEST(RIMFile, getResourceConcurrentFile) {
+	std::vector<byte> data;
+	std::vector< std::vector<byte> > files;
+	createLargeRIM(data, files);
+
+	Common::Platform::init();
+
+	const boost::filesystem::path path = boost::filesystem::temp_directory_path() /
+		boost::filesystem::unique_path("%%%%_%%%%_%%%%_%%%%.xoreos");
+
+	boost::filesystem::ofstream rimFile(path, std::ofstream::binary);
+	rimFile.write(reinterpret_cast<const char *>(&data[0]), data.size());
+	rimFile.close();
+	ASSERT_FALSE(rimFile.fail());
+
+	{
+		const Aurora::RIMFile rim(new Common::ReadFile(path.generic_string()));
+		ASSERT_EQ(rim.getResourceTable().size(), files.size());
+
+		extractConcurrently(rim, files);
+	}
+
+	boost::filesystem::remove(path);
+}
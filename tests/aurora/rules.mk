@@ -19,7 +19,17 @@
 
 # Unit tests for the Aurora namespace.
 
+check_LTLIBRARIES += tests/aurora/libarchivetest.la
+
+tests_aurora_libarchivetest_la_SOURCES = \
+    tests/aurora/archivetest.h \
+    tests/aurora/archivetest.cpp \
+    $(EMPTY)
+
+tests_aurora_libarchivetest_la_CXXFLAGS = $(test_CXXFLAGS)
+
 aurora_LIBS = \
+    tests/aurora/libarchivetest.la \
     $(test_LIBS) \
     src/aurora/libaurora.la \
     src/common/libcommon.la \
@@ -41,6 +51,11 @@ tests_aurora_test_locstring_SOURCES  = tests/aurora/locstring.cpp
 tests_aurora_test_locstring_LDADD    = $(aurora_LIBS)
 tests_aurora_test_locstring_CXXFLAGS = $(test_CXXFLAGS)
 
+check_PROGRAMS                          += tests/aurora/test_resourcetable
+tests_aurora_test_resourcetable_SOURCES  = tests/aurora/resourcetable.cpp
+tests_aurora_test_resourcetable_LDADD    = $(aurora_LIBS)
+tests_aurora_test_resourcetable_CXXFLAGS = $(test_CXXFLAGS)
+
 check_PROGRAMS                    += tests/aurora/test_zipfile
 tests_aurora_test_zipfile_SOURCES  = tests/aurora/zipfile.cpp
 tests_aurora_test_zipfile_LDADD    = $(aurora_LIBS)
@@ -70,3 +85,33 @@ check_PROGRAMS                    += tests/aurora/test_erffile
 tests_aurora_test_erffile_SOURCES  = tests/aurora/erffile.cpp
 tests_aurora_test_erffile_LDADD    = $(aurora_LIBS)
 tests_aurora_test_erffile_CXXFLAGS = $(test_CXXFLAGS)
+
+check_PROGRAMS                             += tests/aurora/test_archiveextractor
+tests_aurora_test_archiveextractor_SOURCES  = tests/aurora/archiveextractor.cpp
+tests_aurora_test_archiveextractor_LDADD    = $(aurora_LIBS)
+tests_aurora_test_archiveextractor_CXXFLAGS = $(test_CXXFLAGS)
+
+check_PROGRAMS                          += tests/aurora/test_resourcecache
+tests_aurora_test_resourcecache_SOURCES  = tests/aurora/resourcecache.cpp
+tests_aurora_test_resourcecache_LDADD    = $(aurora_LIBS)
+tests_aurora_test_resourcecache_CXXFLAGS = $(test_CXXFLAGS)
+
+check_PROGRAMS                                += tests/aurora/test_keydatafileresolver
+tests_aurora_test_keydatafileresolver_SOURCES  = tests/aurora/keydatafileresolver.cpp
+tests_aurora_test_keydatafileresolver_LDADD    = $(aurora_LIBS)
+tests_aurora_test_keydatafileresolver_CXXFLAGS = $(test_CXXFLAGS)
+
+check_PROGRAMS                        += tests/aurora/test_indexcache
+tests_aurora_test_indexcache_SOURCES  = tests/aurora/indexcache.cpp
+tests_aurora_test_indexcache_LDADD    = $(aurora_LIBS)
+tests_aurora_test_indexcache_CXXFLAGS = $(test_CXXFLAGS)
+
+check_PROGRAMS                              += tests/aurora/test_fingerprintindex
+tests_aurora_test_fingerprintindex_SOURCES  = tests/aurora/fingerprintindex.cpp
+tests_aurora_test_fingerprintindex_LDADD    = $(aurora_LIBS)
+tests_aurora_test_fingerprintindex_CXXFLAGS = $(test_CXXFLAGS)
+
+check_PROGRAMS                            += tests/aurora/test_namedictionary
+tests_aurora_test_namedictionary_SOURCES  = tests/aurora/namedictionary.cpp
+tests_aurora_test_namedictionary_LDADD    = $(aurora_LIBS)
+tests_aurora_test_namedictionary_CXXFLAGS = $(test_CXXFLAGS)
@@ -22,12 +22,14 @@
  *  Unit tests for our Blowfish implementation.
  */
 
+#include <cstring>
 #include <vector>
 
 #include "gtest/gtest.h"
 
 #include "src/common/util.h"
 #include "src/common/error.h"
+#include "src/common/scopedptr.h"
 #include "src/common/memreadstream.h"
 #include "src/common/blowfish.h"
 
@@ -81,3 +83,232 @@ GTEST_TEST(Blowfish, misalign) {
 
 	EXPECT_THROW(Common::decryptBlowfishEBC(cipherText, key), Common::Exception);
 }
+
+GTEST_TEST(Blowfish, decryptInPlace) {
+	std::vector<byte> key;
+	createKey(key);
+
+	byte data[ARRAYSIZE(kCypherText)];
+	std::memcpy(data, kCypherText, sizeof(data));
+
+	Common::decryptBlowfishEBC(data, sizeof(data), key);
+
+	for (size_t i = 0; i < ARRAYSIZE(kClearText); i++)
+		EXPECT_EQ(data[i], kClearText[i]) << "At index " << i;
+}
+
+GTEST_TEST(Blowfish, decryptInPlaceMisalign) {
+	std::vector<byte> key;
+	createKey(key);
+
+	byte data[ARRAYSIZE(kCypherText)];
+	std::memcpy(data, kCypherText, sizeof(data));
+
+	EXPECT_THROW(Common::decryptBlowfishEBC(data, 7, key), Common::Exception);
+}
+
+GTEST_TEST(Blowfish, context) {
+	std::vector<byte> key;
+	createKey(key);
+
+	const Common::BlowfishContext ctx(key);
+
+	byte data[ARRAYSIZE(kCypherText)] = { 0 };
+	std::memcpy(data, kClearText, ARRAYSIZE(kClearText));
+
+	Common::encryptBlowfishEBC(data, sizeof(data), ctx);
+
+	for (size_t i = 0; i < ARRAYSIZE(kCypherText); i++)
+		EXPECT_EQ(data[i], kCypherText[i]) << "At index " << i;
+
+	Common::decryptBlowfishEBC(data, sizeof(data), ctx);
+
+	for (size_t i = 0; i < ARRAYSIZE(kClearText); i++)
+		EXPECT_EQ(data[i], kClearText[i]) << "At index " << i;
+}
+
+GTEST_TEST(Blowfish, contextInvalidKey) {
+	const std::vector<byte> key(3, 0);
+
+	EXPECT_THROW(Common::BlowfishContext ctx(key), Common::Exception);
+	EXPECT_THROW(Common::getBlowfishContext(key), Common::Exception);
+}
+
+GTEST_TEST(Blowfish, getContext) {
+	std::vector<byte> key;
+	createKey(key);
+
+	const Common::BlowfishContextPtr ctx1 = Common::getBlowfishContext(key);
+	const Common::BlowfishContextPtr ctx2 = Common::getBlowfishContext(key);
+
+	// The schedule for the same key is only computed once
+	EXPECT_EQ(ctx1.get(), ctx2.get());
+
+	key[0] ^= 0xFF;
+
+	const Common::BlowfishContextPtr ctx3 = Common::getBlowfishContext(key);
+	EXPECT_NE(ctx1.get(), ctx3.get());
+
+	const Common::BlowfishContext ctx(key);
+	EXPECT_EQ(std::memcmp(ctx3->P, ctx.P, sizeof(ctx.P)), 0);
+	EXPECT_EQ(std::memcmp(ctx3->S, ctx.S, sizeof(ctx.S)), 0);
+}
+
+/** Create a large buffer consisting of the padded clear text, repeated. */
+static void createLargeClearText(std::vector<byte> &data, size_t count) {
+	data.resize(count * ARRAYSIZE(kCypherText), 0);
+
+	for (size_t i = 0; i < count; i++)
+		std::memcpy(&data[i * ARRAYSIZE(kCypherText)], kClearText, ARRAYSIZE(kClearText));
+}
+
+GTEST_TEST(Blowfish, encryptInPlaceLarge) {
+	std::vector<byte> key;
+	createKey(key);
+
+	// A number of blocks not divisible by 4
+	std::vector<byte> data;
+	createLargeClearText(data, 131073);
+
+	Common::encryptBlowfishEBC(&data[0], data.size(), key);
+
+	for (size_t i = 0; i < data.size(); i++)
+		ASSERT_EQ(data[i], kCypherText[i % ARRAYSIZE(kCypherText)]) << "At index " << i;
+}
+
+GTEST_TEST(Blowfish, decryptInPlaceLarge) {
+	std::vector<byte> key;
+	createKey(key);
+
+	std::vector<byte> clearText;
+	createLargeClearText(clearText, 131073);
+
+	std::vector<byte> data = clearText;
+
+	Common::encryptBlowfishEBC(&data[0], data.size(), key);
+	Common::decryptBlowfishEBC(&data[0], data.size(), key);
+
+	EXPECT_TRUE(data == clearText);
+}
+
+GTEST_TEST(Blowfish, decryptLarge) {
+	std::vector<byte> key;
+	createKey(key);
+
+	std::vector<byte> clearText;
+	createLargeClearText(clearText, 131073);
+
+	std::vector<byte> cipherText = clearText;
+	Common::encryptBlowfishEBC(&cipherText[0], cipherText.size(), key);
+
+	Common::MemoryReadStream cipherStream(&cipherText[0], cipherText.size());
+
+	Common::MemoryReadStream *decrypted = Common::decryptBlowfishEBC(cipherStream, key);
+	ASSERT_EQ(decrypted->size(), clearText.size());
+
+	std::vector<byte> data(decrypted->size());
+	EXPECT_EQ(decrypted->read(&data[0], data.size()), data.size());
+
+	EXPECT_TRUE(data == clearText);
+
+	delete decrypted;
+}
+
+GTEST_TEST(BlowfishReadStream, read) {
+	std::vector<byte> key;
+	createKey(key);
+
+	Common::BlowfishReadStream clearText(new Common::MemoryReadStream(kCypherText), key);
+	ASSERT_EQ(clearText.size(), ARRAYSIZE(kCypherText));
+
+	for (size_t i = 0; i < ARRAYSIZE(kClearText); i++)
+		EXPECT_EQ(clearText.readByte(), kClearText[i]) << "At index " << i;
+}
+
+GTEST_TEST(BlowfishReadStream, readAt) {
+	std::vector<byte> key;
+	createKey(key);
+
+	Common::BlowfishReadStream clearText(new Common::MemoryReadStream(kCypherText), key);
+
+	// Reads starting and ending in the middle of blocks
+	for (size_t offset = 0; offset < ARRAYSIZE(kClearText); offset++) {
+		for (size_t size = 1; (offset + size) <= ARRAYSIZE(kClearText); size++) {
+			byte data[ARRAYSIZE(kCypherText)];
+			ASSERT_EQ(clearText.readAt(offset, data, size), size);
+
+			for (size_t i = 0; i < size; i++)
+				EXPECT_EQ(data[i], kClearText[offset + i]) << "At offset " << offset << ", index " << i;
+		}
+	}
+
+	EXPECT_EQ(clearText.pos(), 0);
+}
+
+GTEST_TEST(BlowfishReadStream, context) {
+	std::vector<byte> key;
+	createKey(key);
+
+	Common::BlowfishReadStream clearText(new Common::MemoryReadStream(kCypherText),
+	                                     Common::getBlowfishContext(key));
+
+	for (size_t i = 0; i < ARRAYSIZE(kClearText); i++)
+		EXPECT_EQ(clearText.readByte(), kClearText[i]) << "At index " << i;
+}
+
+GTEST_TEST(BlowfishReadStream, seek) {
+	std::vector<byte> key;
+	createKey(key);
+
+	Common::BlowfishReadStream clearText(new Common::MemoryReadStream(kCypherText), key);
+
+	clearText.seek(9);
+	EXPECT_EQ(clearText.readByte(), kClearText[9]);
+
+	clearText.seek(3);
+	EXPECT_EQ(clearText.readByte(), kClearText[3]);
+
+	EXPECT_THROW(clearText.seek(ARRAYSIZE(kCypherText) + 1), Common::Exception);
+}
+
+GTEST_TEST(BlowfishReadStream, misalign) {
+	std::vector<byte> key;
+	createKey(key);
+
+	EXPECT_THROW(Common::BlowfishReadStream(new Common::MemoryReadStream(kCypherText, 7), key), Common::Exception);
+}
+
+GTEST_TEST(Blowfish, encryptInPlaceThreaded) {
+	std::vector<byte> key;
+	createKey(key);
+
+	// Big enough to be split across 4 threads, with a number of blocks not divisible by 4
+	std::vector<byte> data;
+	createLargeClearText(data, 131073);
+
+	Common::encryptBlowfishEBC(&data[0], data.size(), key, 4);
+
+	for (size_t i = 0; i < data.size(); i++)
+		ASSERT_EQ(data[i], kCypherText[i % ARRAYSIZE(kCypherText)]) << "At index " << i;
+}
+
+GTEST_TEST(Blowfish, decryptThreaded) {
+	std::vector<byte> key;
+	createKey(key);
+
+	std::vector<byte> clearText;
+	createLargeClearText(clearText, 131073);
+
+	std::vector<byte> cipherText = clearText;
+	Common::encryptBlowfishEBC(&cipherText[0], cipherText.size(), key, 4);
+
+	Common::MemoryReadStream cipherStream(&cipherText[0], cipherText.size());
+
+	Common::ScopedPtr<Common::MemoryReadStream> decrypted(Common::decryptBlowfishEBC(cipherStream, key, 4));
+	ASSERT_EQ(decrypted->size(), clearText.size());
+
+	std::vector<byte> data(decrypted->size());
+	EXPECT_EQ(decrypted->read(&data[0], data.size()), data.size());
+
+	EXPECT_TRUE(data == clearText);
+}
@@ -0,0 +1,165 @@
+/* Phaethon - A FLOSS resource explorer for BioWare's Aurora engine games
+ *
+ * Phaethon is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * Phaethon is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * Phaethon is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Phaethon. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  Unit tests for our buffered read stream.
+ */
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "src/common/util.h"
+#include "src/common/error.h"
+#include "src/common/memreadstream.h"
+#include "src/common/bufferedreadstream.h"
+
+static const byte kData[] = {
+	0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0x10,
+	0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F, 0x20,
+	0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F, 0x30
+};
+
+/** Create a BufferedReadStream over kData. A buffer size of 0 means memory-backed. */
+static Common::BufferedReadStream *createStream(Common::MemoryReadStream &memory, size_t bufferSize) {
+	if (bufferSize == 0)
+		return new Common::BufferedReadStream(&memory, false);
+
+	// The substream isn't backed by memory, so this goes through the buffer
+	return new Common::BufferedReadStream(new Common::SeekableSubReadStream(&memory, 0, memory.size()),
+	                                      true, bufferSize);
+}
+
+static void checkIntegers(size_t bufferSize) {
+	Common::MemoryReadStream memory(kData);
+	Common::MemoryReadStream expected(kData);
+
+	Common::ScopedPtr<Common::BufferedReadStream> stream(createStream(memory, bufferSize));
+
+	ASSERT_EQ(stream->size(), ARRAYSIZE(kData));
+
+	EXPECT_EQ(stream->readByte()    , expected.readByte());
+	EXPECT_EQ(stream->readUint16LE(), expected.readUint16LE());
+	EXPECT_EQ(stream->readUint32LE(), expected.readUint32LE());
+	EXPECT_EQ(stream->readUint64LE(), expected.readUint64LE());
+	EXPECT_EQ(stream->readUint16BE(), expected.readUint16BE());
+	EXPECT_EQ(stream->readUint32BE(), expected.readUint32BE());
+	EXPECT_EQ(stream->readUint64BE(), expected.readUint64BE());
+	EXPECT_EQ(stream->readSint32LE(), expected.readSint32LE());
+	EXPECT_EQ(stream->readSint16BE(), expected.readSint16BE());
+
+	EXPECT_EQ(stream->pos(), expected.pos());
+	EXPECT_EQ(stream->pos(), 35);
+
+	// Reading through the base class goes through the buffer as well
+	Common::SeekableReadStream &base = *stream;
+	EXPECT_EQ(base.readUint32LE(), expected.readUint32LE());
+
+	EXPECT_EQ(stream->readUint64LE(), expected.readUint64LE());
+	EXPECT_EQ(stream->readByte(), 0x30);
+	EXPECT_FALSE(stream->eos());
+
+	EXPECT_THROW(stream->readByte(), Common::Exception);
+	EXPECT_TRUE(stream->eos());
+}
+
+GTEST_TEST(BufferedReadStream, readIntegers) {
+	checkIntegers(0);
+
+	// Small buffers, so that values straddle the window boundaries
+	for (size_t bufferSize = 8; bufferSize <= 17; bufferSize++)
+		checkIntegers(bufferSize);
+}
+
+GTEST_TEST(BufferedReadStream, read) {
+	for (size_t bufferSize = 0; bufferSize <= 16; bufferSize += 8) {
+		Common::MemoryReadStream memory(kData);
+		Common::ScopedPtr<Common::BufferedReadStream> stream(createStream(memory, bufferSize));
+
+		byte data[ARRAYSIZE(kData)];
+
+		// Small read, then one larger than the buffer, then the rest
+		ASSERT_EQ(stream->read(data, 3), 3);
+		ASSERT_EQ(stream->read(data + 3, 20), 20);
+		EXPECT_EQ(stream->readByte(), kData[23]);
+		ASSERT_EQ(stream->read(data + 24, 100), ARRAYSIZE(kData) - 24);
+
+		EXPECT_TRUE(stream->eos());
+
+		data[23] = kData[23];
+		for (size_t i = 0; i < ARRAYSIZE(kData); i++)
+			EXPECT_EQ(data[i], kData[i]) << "At index " << i << ", buffer size " << bufferSize;
+	}
+}
+
+GTEST_TEST(BufferedReadStream, seek) {
+	for (size_t bufferSize = 0; bufferSize <= 16; bufferSize += 8) {
+		Common::MemoryReadStream memory(kData);
+		Common::ScopedPtr<Common::BufferedReadStream> stream(createStream(memory, bufferSize));
+
+		EXPECT_EQ(stream->readByte(), kData[0]);
+
+		// Within the window
+		stream->seek(4);
+		EXPECT_EQ(stream->readByte(), kData[4]);
+
+		// Outside the window
+		stream->seek(40);
+		EXPECT_EQ(stream->readByte(), kData[40]);
+
+		stream->skip(-38);
+		EXPECT_EQ(stream->readByte(), kData[3]);
+
+		stream->seek(-2, Common::SeekableReadStream::kOriginEnd);
+		EXPECT_EQ(stream->readUint16LE(), READ_LE_UINT16(kData + ARRAYSIZE(kData) - 2));
+
+		EXPECT_THROW(stream->readByte(), Common::Exception);
+		EXPECT_TRUE(stream->eos());
+
+		stream->seek(0);
+		EXPECT_FALSE(stream->eos());
+		EXPECT_EQ(stream->readByte(), kData[0]);
+
+		EXPECT_THROW(stream->seek(ARRAYSIZE(kData) + 1), Common::Exception);
+	}
+}
+
+GTEST_TEST(BufferedReadStream, parentPosition) {
+	Common::MemoryReadStream memory(kData);
+	memory.seek(10);
+
+	Common::BufferedReadStream stream(&memory, false, 8);
+
+	// We start at the parent stream's position, but never move it
+	EXPECT_EQ(stream.pos(), 10);
+	EXPECT_EQ(stream.readUint32LE(), READ_LE_UINT32(kData + 10));
+
+	EXPECT_EQ(memory.pos(), 10);
+
+	Common::SeekableSubReadStream sub(&memory, 0, memory.size());
+	sub.seek(20);
+
+	Common::BufferedReadStream buffered(&sub, false, 8);
+
+	EXPECT_EQ(buffered.pos(), 20);
+	EXPECT_EQ(buffered.readUint32BE(), READ_BE_UINT32(kData + 20));
+
+	EXPECT_EQ(sub.pos(), 20);
+}
@@ -0,0 +1,105 @@
+/* Phaethon - A FLOSS resource explorer for BioWare's Aurora engine games
+ *
+ * Phaethon is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * Phaethon is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * Phaethon is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Phaethon. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  Unit tests for our CRC32 implementation.
+ */
+
+#include <cstring>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "src/common/crc32.h"
+#include "src/common/hash.h"
+#include "src/common/memreadstream.h"
+
+/** Calculate the CRC32 byte by byte, as a reference. */
+static uint32 calculateCRC32Bytewise(const byte *data, size_t size) {
+	uint32 crc = 0xFFFFFFFF;
+	for (size_t i = 0; i < size; i++)
+		crc = Common::hashCRC32(crc, data[i]);
+
+	return crc ^ 0xFFFFFFFF;
+}
+
+static void createData(std::vector<byte> &data, size_t size) {
+	data.resize(size);
+
+	uint32 x = 0x12345678;
+	for (size_t i = 0; i < size; i++) {
+		x = x * 1103515245 + 12345;
+		data[i] = (byte) (x >> 16);
+	}
+}
+
+GTEST_TEST(CRC32, calculate) {
+	const byte *data = reinterpret_cast<const byte *>("123456789");
+
+	EXPECT_EQ(Common::calculateCRC32(data, 9), 0xCBF43926);
+	EXPECT_EQ(Common::calculateCRC32(data, 0), 0x00000000);
+}
+
+GTEST_TEST(CRC32, calculateString) {
+	// Same as the CRC32 string hash, for ASCII strings
+	const char *string = "Foobar";
+
+	EXPECT_EQ(Common::calculateCRC32(reinterpret_cast<const byte *>(string), std::strlen(string)),
+	          Common::hashString(string, Common::kHashCRC32));
+}
+
+GTEST_TEST(CRC32, calculateLarge) {
+	std::vector<byte> data;
+	createData(data, 4096 + 64);
+
+	// All sizes around the block sizes, from all alignments
+	for (size_t offset = 0; offset < 16; offset++) {
+		for (size_t size = 0; size < 300; size++)
+			ASSERT_EQ(Common::calculateCRC32(&data[offset], size), calculateCRC32Bytewise(&data[offset], size))
+				<< "At offset " << offset << ", size " << size;
+
+		const size_t size = data.size() - offset;
+		ASSERT_EQ(Common::calculateCRC32(&data[offset], size), calculateCRC32Bytewise(&data[offset], size))
+			<< "At offset " << offset;
+	}
+}
+
+GTEST_TEST(CRC32, update) {
+	std::vector<byte> data;
+	createData(data, 1000);
+
+	const uint32 crc = Common::calculateCRC32(&data[0], data.size());
+
+	for (size_t split = 0; split <= data.size(); split += 37) {
+		uint32 part = Common::updateCRC32(0, &data[0], split);
+		part = Common::updateCRC32(part, &data[split], data.size() - split);
+
+		EXPECT_EQ(part, crc) << "At split " << split;
+	}
+}
+
+GTEST_TEST(CRC32, calculateStream) {
+	std::vector<byte> data;
+	createData(data, 200000);
+
+	Common::MemoryReadStream stream(&data[0], data.size());
+
+	EXPECT_EQ(Common::calculateCRC32(stream), calculateCRC32Bytewise(&data[0], data.size()));
+}
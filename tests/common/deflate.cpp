@@ -131,3 +131,116 @@ GTEST_TEST(DEFLATE, decompressFailInputCut) {
 	                                       kSizeDecompressed, Common::kWindowBitsMaxRaw),
 	             Common::Exception);
 }
+
+GTEST_TEST(InflateReadStream, read) {
+	static const size_t kSizeDecompressed = strlen(kDataUncompressed);
+
+	Common::InflateReadStream decompressed(new Common::MemoryReadStream(kDataCompressed),
+	                                       kSizeDecompressed, Common::kWindowBitsMaxRaw);
+
+	ASSERT_EQ(decompressed.size(), kSizeDecompressed);
+
+	for (size_t i = 0; i < kSizeDecompressed; i++)
+		EXPECT_EQ(decompressed.readByte(), kDataUncompressed[i]) << "At index " << i;
+
+	EXPECT_FALSE(decompressed.eos());
+	EXPECT_THROW(decompressed.readByte(), Common::Exception);
+	EXPECT_TRUE(decompressed.eos());
+}
+
+GTEST_TEST(InflateReadStream, readStreamInput) {
+	static const size_t kSizeDecompressed = strlen(kDataUncompressed);
+
+	/* Prepend a byte to the compressed data and read it from a non-memory
+	 * stream, starting after that byte. */
+
+	byte compressed[sizeof(kDataCompressed) + 1];
+	compressed[0] = 0xFF;
+	memcpy(compressed + 1, kDataCompressed, sizeof(kDataCompressed));
+
+	Common::MemoryReadStream compressedStream(compressed);
+
+	Common::SeekableSubReadStream *input =
+		new Common::SeekableSubReadStream(&compressedStream, 0, sizeof(compressed));
+	input->seek(1);
+
+	Common::InflateReadStream decompressed(input, kSizeDecompressed, Common::kWindowBitsMaxRaw);
+
+	ASSERT_EQ(decompressed.size(), kSizeDecompressed);
+
+	for (size_t i = 0; i < kSizeDecompressed; i++)
+		EXPECT_EQ(decompressed.readByte(), kDataUncompressed[i]) << "At index " << i;
+
+	EXPECT_EQ(input->pos(), 1);
+}
+
+GTEST_TEST(InflateReadStream, seek) {
+	static const size_t kSizeDecompressed = strlen(kDataUncompressed);
+
+	Common::InflateReadStream decompressed(new Common::MemoryReadStream(kDataCompressed),
+	                                       kSizeDecompressed, Common::kWindowBitsMaxRaw);
+
+	decompressed.seek(100);
+	EXPECT_EQ(decompressed.pos(), 100);
+	EXPECT_EQ(decompressed.readByte(), kDataUncompressed[100]);
+
+	decompressed.seek(10);
+	EXPECT_EQ(decompressed.pos(), 10);
+	EXPECT_EQ(decompressed.readByte(), kDataUncompressed[10]);
+
+	decompressed.seek(-1, Common::SeekableReadStream::kOriginEnd);
+	EXPECT_EQ(decompressed.readByte(), kDataUncompressed[kSizeDecompressed - 1]);
+
+	decompressed.seek(-2, Common::SeekableReadStream::kOriginCurrent);
+	EXPECT_EQ(decompressed.readByte(), kDataUncompressed[kSizeDecompressed - 2]);
+
+	EXPECT_THROW(decompressed.seek(kSizeDecompressed + 1), Common::Exception);
+}
+
+GTEST_TEST(InflateReadStream, unknownSize) {
+	static const size_t kSizeDecompressed = strlen(kDataUncompressed);
+
+	Common::InflateReadStream decompressed(new Common::MemoryReadStream(kDataCompressed),
+	                                       Common::SeekableReadStream::kSizeInvalid,
+	                                       Common::kWindowBitsMaxRaw);
+
+	EXPECT_EQ(decompressed.size(), Common::SeekableReadStream::kSizeInvalid);
+
+	decompressed.seek(0, Common::SeekableReadStream::kOriginEnd);
+	EXPECT_EQ(decompressed.size(), kSizeDecompressed);
+	EXPECT_EQ(decompressed.pos(), kSizeDecompressed);
+
+	decompressed.seek(0);
+	for (size_t i = 0; i < kSizeDecompressed; i++)
+		EXPECT_EQ(decompressed.readByte(), kDataUncompressed[i]) << "At index " << i;
+}
+
+GTEST_TEST(InflateReadStream, failOutputSmall) {
+	static const size_t kSizeDecompressed = strlen(kDataUncompressed) / 2;
+
+	Common::InflateReadStream decompressed(new Common::MemoryReadStream(kDataCompressed),
+	                                       kSizeDecompressed, Common::kWindowBitsMaxRaw);
+
+	byte buffer[sizeof(kDataCompressed) * 4];
+	EXPECT_THROW(decompressed.read(buffer, kSizeDecompressed), Common::Exception);
+}
+
+GTEST_TEST(InflateReadStream, failOutputBig) {
+	static const size_t kSizeDecompressed = strlen(kDataUncompressed) * 2;
+
+	Common::InflateReadStream decompressed(new Common::MemoryReadStream(kDataCompressed),
+	                                       kSizeDecompressed, Common::kWindowBitsMaxRaw);
+
+	byte buffer[sizeof(kDataCompressed) * 8];
+	EXPECT_THROW(decompressed.read(buffer, kSizeDecompressed), Common::Exception);
+}
+
+GTEST_TEST(InflateReadStream, failInputCut) {
+	static const size_t kSizeDecompressed = strlen(kDataUncompressed);
+
+	Common::InflateReadStream decompressed(new Common::MemoryReadStream(kDataCompressed, sizeof(kDataCompressed) / 2),
+	                                       kSizeDecompressed, Common::kWindowBitsMaxRaw);
+
+	byte buffer[sizeof(kDataCompressed) * 4];
+	EXPECT_THROW(decompressed.read(buffer, kSizeDecompressed), Common::Exception);
+}
@@ -25,6 +25,7 @@
 #include "gtest/gtest.h"
 
 #include "src/common/error.h"
+#include "src/common/scopedptr.h"
 #include "src/common/encoding.h"
 #include "src/common/memreadstream.h"
 #include "src/common/memwritestream.h"
@@ -50,6 +51,30 @@ GTEST_TEST(XOREOS_ENCODINGNAME, isValidCodePoint) {
 	EXPECT_FALSE(Common::isValidCodepoint(kEncoding, 0x81));
 }
 
+GTEST_TEST(XOREOS_ENCODINGNAME, upper) {
+	testSupport(kEncoding);
+
+	// Euro sign and em dash, which differ from Latin-1, and an undefined character
+	static const byte data1[] = { 0x80, 0x97, 0xE9 };
+	static const byte data2[] = { 'a', 0x81 };
+
+	const Common::UString string = Common::readString(data1, sizeof(data1), kEncoding);
+	EXPECT_STREQ(string.c_str(), "\xE2\x82\xAC\xE2\x80\x94\xC3\xA9");
+
+	Common::ScopedPtr<Common::MemoryReadStream> stream(Common::convertString(string, kEncoding, false));
+	ASSERT_TRUE(stream);
+	ASSERT_EQ(stream->size(), sizeof(data1));
+
+	for (size_t i = 0; i < sizeof(data1); i++)
+		EXPECT_EQ(stream->readByte(), data1[i]) << "At index " << i;
+
+	EXPECT_STREQ(Common::readString(data2, sizeof(data2), kEncoding).c_str(), "[!?!]");
+
+	// Not representable in CP1252
+	stream.reset(Common::convertString(Common::UString("\xE2\x82\xAD"), kEncoding));
+	EXPECT_FALSE(stream);
+}
+
 // -- Generalized encoding function tests --
 
 // Example string with terminating 0
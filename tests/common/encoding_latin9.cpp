@@ -25,6 +25,7 @@
 #include "gtest/gtest.h"
 
 #include "src/common/error.h"
+#include "src/common/scopedptr.h"
 #include "src/common/encoding.h"
 #include "src/common/memreadstream.h"
 #include "src/common/memwritestream.h"
@@ -50,6 +51,27 @@ GTEST_TEST(XOREOS_ENCODINGNAME, isValidCodePoint) {
 	EXPECT_FALSE(Common::isValidCodepoint(kEncoding, 0x80));
 }
 
+GTEST_TEST(XOREOS_ENCODINGNAME, upper) {
+	testSupport(kEncoding);
+
+	// Euro sign and S with caron, which differ from Latin-1
+	static const byte data[] = { 0xA4, 0xA6, 0xE9 };
+
+	const Common::UString string = Common::readString(data, sizeof(data), kEncoding);
+	EXPECT_STREQ(string.c_str(), "\xE2\x82\xAC\xC5\xA0\xC3\xA9");
+
+	Common::ScopedPtr<Common::MemoryReadStream> stream(Common::convertString(string, kEncoding, false));
+	ASSERT_TRUE(stream);
+	ASSERT_EQ(stream->size(), sizeof(data));
+
+	for (size_t i = 0; i < sizeof(data); i++)
+		EXPECT_EQ(stream->readByte(), data[i]) << "At index " << i;
+
+	// The generic currency sign of Latin-1 isn't in Latin-9
+	stream.reset(Common::convertString(Common::UString("\xC2\xA4"), kEncoding));
+	EXPECT_FALSE(stream);
+}
+
 // -- Generalized encoding function tests --
 
 // Example string with terminating 0
@@ -25,6 +25,7 @@
 #include "gtest/gtest.h"
 
 #include "src/common/error.h"
+#include "src/common/scopedptr.h"
 #include "src/common/encoding.h"
 #include "src/common/memreadstream.h"
 #include "src/common/memwritestream.h"
@@ -49,6 +50,36 @@ GTEST_TEST(XOREOS_ENCODINGNAME, isValidCodePoint) {
 	EXPECT_TRUE(Common::isValidCodepoint(kEncoding, 0x20));
 }
 
+GTEST_TEST(XOREOS_ENCODINGNAME, surrogates) {
+	testSupport(kEncoding);
+
+	// U+1F600, outside the BMP
+	static const byte data[] = { 0x3D, 0xD8, 0x00, 0xDE };
+
+	const Common::UString string = Common::readString(data, sizeof(data), kEncoding);
+	EXPECT_STREQ(string.c_str(), "\xF0\x9F\x98\x80");
+
+	Common::ScopedPtr<Common::MemoryReadStream> stream(Common::convertString(string, kEncoding, false));
+	ASSERT_TRUE(stream);
+	ASSERT_EQ(stream->size(), sizeof(data));
+
+	for (size_t i = 0; i < sizeof(data); i++)
+		EXPECT_EQ(stream->readByte(), data[i]) << "At index " << i;
+}
+
+GTEST_TEST(XOREOS_ENCODINGNAME, invalid) {
+	testSupport(kEncoding);
+
+	// A lone high surrogate, a lone low surrogate and an incomplete code unit
+	static const byte data1[] = { 'a', 0x00, 0x00, 0xD8, 'b', 0x00 };
+	static const byte data2[] = { 'a', 0x00, 0x00, 0xDC };
+	static const byte data3[] = { 'a', 0x00, 'b' };
+
+	EXPECT_STREQ(Common::readString(data1, sizeof(data1), kEncoding).c_str(), "[!?!]");
+	EXPECT_STREQ(Common::readString(data2, sizeof(data2), kEncoding).c_str(), "[!?!]");
+	EXPECT_STREQ(Common::readString(data3, sizeof(data3), kEncoding).c_str(), "[!?!]");
+}
+
 // -- Generalized encoding function tests --
 
 // Example string with terminating 0
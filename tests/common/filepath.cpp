@@ -52,6 +52,7 @@
 #include "gtest/gtest.h"
 
 #include "src/common/util.h"
+#include "src/common/error.h"
 #include "src/common/platform.h"
 #include "src/common/filepath.h"
 
@@ -188,6 +189,28 @@ GTEST_TEST_F(FilePath, relativize) {
 	EXPECT_STREQ(Common::FilePath::relativize("/path//to/foo/...", "/path/to/file.ext" ).c_str(), "");
 }
 
+GTEST_TEST_F(FilePath, renameFile) {
+	const boost::filesystem::path from = kDirectoryPath / "from.txt";
+	const boost::filesystem::path to   = kDirectoryPath / "to.txt";
+
+	boost::filesystem::ofstream fromFile(from, std::ofstream::binary);
+	fromFile.write("foo", 3);
+	fromFile.close();
+
+	boost::filesystem::ofstream toFile(to, std::ofstream::binary);
+	toFile.write("barbaz", 6);
+	toFile.close();
+
+	Common::FilePath::renameFile(from.generic_string(), to.generic_string());
+
+	EXPECT_FALSE(Common::FilePath::isRegularFile(from.generic_string()));
+	EXPECT_EQ(Common::FilePath::getFileSize(to.generic_string()), 3);
+
+	EXPECT_THROW(Common::FilePath::renameFile(from.generic_string(), to.generic_string()), Common::Exception);
+
+	boost::filesystem::remove(to);
+}
+
 GTEST_TEST_F(FilePath, escapeStringLiteral) {
 	EXPECT_STREQ(Common::FilePath::escapeStringLiteral("/file.ext").c_str(), "\\/file\\.ext");
 }
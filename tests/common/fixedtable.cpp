@@ -0,0 +1,88 @@
+/* Phaethon - A FLOSS resource explorer for BioWare's Aurora engine games
+ *
+ * Phaethon is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * Phaethon is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * Phaethon is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Phaethon. If not, see <http://www.gnu.org/licenses/>.
+ */
+/** @file
+ *  Unit tests for our fixed-size entry table.
+ */
+
+#include "gtest/gtest.h"
+
+#include "src/common/util.h"
+#include "src/common/error.h"
+#include "src/common/memreadstream.h"
+#include "src/common/fixedtable.h"
+
+static const byte kData[] = {
+	0xFF, 0xFF, 0xFF, 0xFF,
+	0x01, 0x02, 0x03, 0x04, 0x05, 0x06,
+	0x11, 0x12, 0x13, 0x14, 0x15, 0x16,
+	0x21, 0x22, 0x23, 0x24, 0x25, 0x26
+};
+
+static void checkTable(const Common::FixedTable &table) {
+	ASSERT_EQ(table.size(), 3);
+	EXPECT_EQ(table.getStride(), 6);
+
+	for (size_t i = 0; i < table.size(); i++) {
+		EXPECT_EQ(READ_LE_UINT16(table[i] + 0), 0x0201 + i * 0x1010) << "At index " << i;
+		EXPECT_EQ(READ_LE_UINT32(table[i] + 2), 0x06050403 + i * 0x10101010) << "At index " << i;
+	}
+}
+
+GTEST_TEST(FixedTable, memory) {
+	Common::MemoryReadStream stream(kData);
+
+	const Common::FixedTable table(stream, 4, 3, 6);
+	checkTable(table);
+
+	// The entries are used in place
+	EXPECT_EQ(table[0], kData + 4);
+
+	EXPECT_EQ(stream.pos(), 0);
+}
+
+GTEST_TEST(FixedTable, copy) {
+	Common::MemoryReadStream memory(kData);
+
+	// The substream isn't backed by memory, so the table is copied
+	Common::SeekableSubReadStream stream(&memory, 0, memory.size());
+	stream.seek(2);
+
+	const Common::FixedTable table(stream, 4, 3, 6);
+	checkTable(table);
+
+	EXPECT_NE(table[0], kData + 4);
+
+	EXPECT_EQ(stream.pos(), 2);
+}
+
+GTEST_TEST(FixedTable, empty) {
+	Common::MemoryReadStream stream(kData);
+
+	const Common::FixedTable table(stream, 0xFFFF, 0, 6);
+	EXPECT_EQ(table.size(), 0);
+}
+
+GTEST_TEST(FixedTable, outOfRange) {
+	Common::MemoryReadStream stream(kData);
+
+	EXPECT_THROW(Common::FixedTable(stream, 5, 3, 6), Common::Exception);
+	EXPECT_THROW(Common::FixedTable(stream, ARRAYSIZE(kData) + 1, 1, 1), Common::Exception);
+	EXPECT_THROW(Common::FixedTable(stream, 0, SIZE_MAX / 2, 6), Common::Exception);
+}
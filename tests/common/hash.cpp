@@ -22,12 +22,30 @@
  *  Unit tests for our generic string hash functions.
  */
 
+#include <cstring>
+
 #include "gtest/gtest.h"
 
 #include "src/common/hash.h"
+#include "src/common/encoding.h"
+#include "src/common/memreadstream.h"
 
 static const char *kString = "Foobar";
 
+/** Hash the string after converting it into the encoding, as a reference. */
+static uint64 hashConverted(const Common::UString &string, Common::HashAlgo algo, Common::Encoding encoding) {
+	Common::ScopedPtr<Common::MemoryReadStream> data(Common::convertString(string, encoding, false));
+
+	return Common::hashData(data->getData(), data->size(), algo);
+}
+
+static void checkEncoding(const Common::UString &string, Common::Encoding encoding) {
+	for (int algo = 0; algo < Common::kHashMAX; algo++)
+		EXPECT_EQ(Common::hashString(string, (Common::HashAlgo) algo, encoding),
+		          hashConverted(string, (Common::HashAlgo) algo, encoding))
+			<< "For algorithm " << algo << ", encoding " << (int) encoding;
+}
+
 GTEST_TEST(Hash, DJB2) {
 	EXPECT_EQ(Common::hashString(kString, Common::kHashDJB2), 0xB33F4C9E);
 }
@@ -60,6 +78,52 @@ GTEST_TEST(Hash, CRC32Encoding) {
 	EXPECT_EQ(Common::hashString(kString, Common::kHashCRC32, Common::kEncodingUTF16LE), 0x56031CD6);
 }
 
+GTEST_TEST(Hash, data) {
+	const byte *data = reinterpret_cast<const byte *>(kString);
+	const size_t size = std::strlen(kString);
+
+	EXPECT_EQ(Common::hashData(data, size, Common::kHashDJB2 ), 0xB33F4C9E);
+	EXPECT_EQ(Common::hashData(data, size, Common::kHashFNV32), 0xED18E8C2);
+	EXPECT_EQ(Common::hashData(data, size, Common::kHashFNV64), UINT64_C(0x744E9FFF32CA0A22));
+	EXPECT_EQ(Common::hashData(data, size, Common::kHashCRC32), 0x995A1AA3);
+}
+
+GTEST_TEST(Hash, codepoints) {
+	// "Stra\u00DFe \u20AC \U0001D11E", with non-ASCII code points of 2, 3 and 4 bytes in UTF-8
+	const Common::UString string("Stra\xC3\x9F" "e \xE2\x82\xAC \xF0\x9D\x84\x9E");
+
+	uint32 hash = 5381;
+	for (Common::UString::iterator it = string.begin(); it != string.end(); ++it)
+		hash = Common::hashDJB2(hash, *it);
+
+	EXPECT_EQ(Common::hashString(string, Common::kHashDJB2), hash);
+}
+
+GTEST_TEST(Hash, encodingASCII) {
+	checkEncoding(kString, Common::kEncodingASCII);
+	checkEncoding(kString, Common::kEncodingCP1252);
+	checkEncoding(kString, Common::kEncodingLatin9);
+}
+
+GTEST_TEST(Hash, encodingNonASCII) {
+	// "Stra\u00DFe \u20AC", which needs converting for the single-byte encodings
+	const Common::UString string("Stra\xC3\x9F" "e \xE2\x82\xAC");
+
+	checkEncoding(string, Common::kEncodingUTF8);
+	checkEncoding(string, Common::kEncodingCP1252);
+	checkEncoding(string, Common::kEncodingLatin9);
+	checkEncoding(string, Common::kEncodingUTF16LE);
+	checkEncoding(string, Common::kEncodingUTF16BE);
+}
+
+GTEST_TEST(Hash, encodingUTF16Surrogates) {
+	// "\U0001D11E", a code point outside the Basic Multilingual Plane
+	const Common::UString string("G \xF0\x9D\x84\x9E");
+
+	checkEncoding(string, Common::kEncodingUTF16LE);
+	checkEncoding(string, Common::kEncodingUTF16BE);
+}
+
 GTEST_TEST(Hash, formatHash) {
 	EXPECT_STREQ(Common::formatHash(UINT64_C(0x1234567890ABCDEF)).c_str(), "0x1234567890ABCDEF");
 }
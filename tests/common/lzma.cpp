@@ -132,3 +132,120 @@ GTEST_TEST(LZMA1, decompressFailInputCut) {
 	EXPECT_THROW(Common::decompressLZMA1(kDataCompressed, kSizeCompressed, kSizeDecompressed),
 	             Common::Exception);
 }
+
+GTEST_TEST(LZMAReadStream, read) {
+	static const size_t kSizeDecompressed = strlen(kDataUncompressed);
+
+	Common::LZMAReadStream stream(new Common::MemoryReadStream(kDataCompressed), kSizeDecompressed);
+	ASSERT_EQ(stream.size(), kSizeDecompressed);
+
+	for (size_t i = 0; i < kSizeDecompressed; i++)
+		EXPECT_EQ(stream.readByte(), kDataUncompressed[i]) << "At index " << i;
+
+	EXPECT_FALSE(stream.eos());
+
+	byte data;
+	EXPECT_EQ(stream.read(&data, 1), 0);
+	EXPECT_TRUE(stream.eos());
+}
+
+GTEST_TEST(LZMAReadStream, readUnknownSize) {
+	static const size_t kSizeDecompressed = strlen(kDataUncompressed);
+
+	Common::LZMAReadStream stream(new Common::MemoryReadStream(kDataCompressed), Common::SeekableReadStream::kSizeInvalid);
+
+	byte data[1024];
+	ASSERT_EQ(stream.read(data, sizeof(data)), kSizeDecompressed);
+
+	EXPECT_TRUE(stream.eos());
+	EXPECT_EQ(stream.size(), kSizeDecompressed);
+
+	for (size_t i = 0; i < kSizeDecompressed; i++)
+		EXPECT_EQ(data[i], kDataUncompressed[i]) << "At index " << i;
+}
+
+GTEST_TEST(LZMAReadStream, readNonMemory) {
+	static const size_t kSizeDecompressed = strlen(kDataUncompressed);
+
+	// Not a MemoryReadStream, so the compressed data is read in chunks
+	Common::MemoryReadStream compressed(kDataCompressed);
+	Common::LZMAReadStream stream(new Common::SeekableSubReadStream(&compressed, 0, compressed.size()),
+	                              kSizeDecompressed);
+
+	for (size_t i = 0; i < kSizeDecompressed; i++)
+		EXPECT_EQ(stream.readByte(), kDataUncompressed[i]) << "At index " << i;
+
+	EXPECT_EQ(compressed.pos(), 0);
+}
+
+GTEST_TEST(LZMAReadStream, seek) {
+	static const size_t kSizeDecompressed = strlen(kDataUncompressed);
+
+	Common::LZMAReadStream stream(new Common::MemoryReadStream(kDataCompressed), kSizeDecompressed);
+
+	stream.seek(100);
+	EXPECT_EQ(stream.pos(), 100);
+	EXPECT_EQ(stream.readByte(), kDataUncompressed[100]);
+
+	stream.seek(10);
+	EXPECT_EQ(stream.pos(), 10);
+	EXPECT_EQ(stream.readByte(), kDataUncompressed[10]);
+
+	stream.seek(-1, Common::SeekableReadStream::kOriginEnd);
+	EXPECT_EQ(stream.readByte(), kDataUncompressed[kSizeDecompressed - 1]);
+
+	EXPECT_THROW(stream.seek(kSizeDecompressed + 1), Common::Exception);
+}
+
+GTEST_TEST(LZMAReadStream, interleaved) {
+	static const size_t kSizeDecompressed = strlen(kDataUncompressed);
+
+	// Several streams alive at the same time need their own decoders
+	Common::LZMAReadStream stream1(new Common::MemoryReadStream(kDataCompressed), kSizeDecompressed);
+	Common::LZMAReadStream stream2(new Common::MemoryReadStream(kDataCompressed), kSizeDecompressed);
+
+	for (size_t i = 0; i < kSizeDecompressed; i++) {
+		EXPECT_EQ(stream1.readByte(), kDataUncompressed[i]) << "At index " << i;
+		EXPECT_EQ(stream2.readByte(), kDataUncompressed[i]) << "At index " << i;
+	}
+}
+
+GTEST_TEST(LZMAReadStream, reuseDecoder) {
+	static const size_t kSizeDecompressed = strlen(kDataUncompressed);
+
+	// Decoders are reused after a stream is done with them
+	for (size_t n = 0; n < 8; n++) {
+		Common::LZMAReadStream stream(new Common::MemoryReadStream(kDataCompressed), kSizeDecompressed);
+
+		for (size_t i = 0; i < kSizeDecompressed; i++)
+			ASSERT_EQ(stream.readByte(), kDataUncompressed[i]) << "At index " << i << ", pass " << n;
+	}
+}
+
+GTEST_TEST(LZMAReadStream, failOutputSmall) {
+	static const size_t kSizeDecompressed = strlen(kDataUncompressed) / 2;
+
+	Common::LZMAReadStream stream(new Common::MemoryReadStream(kDataCompressed), kSizeDecompressed);
+
+	byte data[1024];
+	EXPECT_THROW(stream.read(data, sizeof(data)), Common::Exception);
+}
+
+GTEST_TEST(LZMAReadStream, failOutputBig) {
+	static const size_t kSizeDecompressed = strlen(kDataUncompressed) * 2;
+
+	Common::LZMAReadStream stream(new Common::MemoryReadStream(kDataCompressed), kSizeDecompressed);
+
+	byte data[1024];
+	EXPECT_THROW(stream.read(data, sizeof(data)), Common::Exception);
+}
+
+GTEST_TEST(LZMAReadStream, failInputCut) {
+	static const size_t kSizeCompressed   = sizeof(kDataCompressed) / 2;
+	static const size_t kSizeDecompressed = strlen(kDataUncompressed);
+
+	Common::LZMAReadStream stream(new Common::MemoryReadStream(kDataCompressed, kSizeCompressed), kSizeDecompressed);
+
+	byte data[1024];
+	EXPECT_THROW(stream.read(data, sizeof(data)), Common::Exception);
+}
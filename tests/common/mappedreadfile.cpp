@@ -0,0 +1,130 @@
+/* Phaethon - A FLOSS resource explorer for BioWare's Aurora engine games
+ *
+ * Phaethon is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * Phaethon is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * Phaethon is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Phaethon. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  Unit tests for our memory-mapped file read stream.
+ */
+
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+
+#include "gtest/gtest.h"
+
+#include "src/common/util.h"
+#include "src/common/error.h"
+#include "src/common/scopedptr.h"
+#include "src/common/platform.h"
+#include "src/common/mappedreadfile.h"
+
+static const byte kFileData[5] = { 0x12, 0x34, 0x56, 0x78, 0x90 };
+
+boost::filesystem::path kFilePath;
+boost::filesystem::path kEmptyFilePath;
+
+static void writeFile(const boost::filesystem::path &path, const byte *data, size_t size) {
+	boost::filesystem::ofstream testFile(path, std::ofstream::binary);
+
+	testFile.write(reinterpret_cast<const char *>(data), size);
+	testFile.flush();
+	ASSERT_FALSE(testFile.fail());
+
+	testFile.close();
+}
+
+class MappedReadFile : public ::testing::Test {
+protected:
+	static void SetUpTestCase() {
+		Common::Platform::init();
+
+		boost::filesystem::path tmpPath = boost::filesystem::temp_directory_path();
+
+		kFilePath      = tmpPath / boost::filesystem::unique_path("%%%%_%%%%_%%%%_%%%%.xoreos");
+		kEmptyFilePath = tmpPath / boost::filesystem::unique_path("%%%%_%%%%_%%%%_%%%%.xoreos");
+
+		writeFile(kFilePath, kFileData, ARRAYSIZE(kFileData));
+		writeFile(kEmptyFilePath, 0, 0);
+	}
+
+	static void TearDownTestCase() {
+		if (!kFilePath.empty())
+			boost::filesystem::remove(kFilePath);
+		if (!kEmptyFilePath.empty())
+			boost::filesystem::remove(kEmptyFilePath);
+	}
+};
+
+GTEST_TEST_F(MappedReadFile, read) {
+	Common::MappedReadFile file(kFilePath.generic_string());
+
+	ASSERT_EQ(file.size(), ARRAYSIZE(kFileData));
+
+	byte readData[ARRAYSIZE(kFileData)];
+	const size_t readCount = file.read(readData, sizeof(readData));
+	EXPECT_EQ(readCount, ARRAYSIZE(readData));
+
+	for (size_t i = 0; i < ARRAYSIZE(kFileData); i++)
+		EXPECT_EQ(readData[i], kFileData[i]) << "At index " << i;
+
+	EXPECT_EQ(file.read(readData, 1), 0);
+	EXPECT_TRUE(file.eos());
+}
+
+GTEST_TEST_F(MappedReadFile, empty) {
+	Common::MappedReadFile file(kEmptyFilePath.generic_string());
+
+	EXPECT_EQ(file.size(), 0);
+
+	byte readData[1];
+	EXPECT_EQ(file.read(readData, sizeof(readData)), 0);
+	EXPECT_TRUE(file.eos());
+}
+
+GTEST_TEST_F(MappedReadFile, missing) {
+	EXPECT_THROW(Common::MappedReadFile file((kFilePath.generic_string() + ".missing").c_str()), Common::Exception);
+	EXPECT_THROW(Common::openReadFile((kFilePath.generic_string() + ".missing").c_str()), Common::Exception);
+}
+
+GTEST_TEST_F(MappedReadFile, createMemoryView) {
+	Common::MappedReadFile file(kFilePath.generic_string());
+	file.seek(1);
+
+	Common::ScopedPtr<Common::SeekableReadStream> view(Common::createMemoryView(file, 2, 4));
+	ASSERT_TRUE(view);
+
+	// The view references the mapping directly, without touching the file's position
+	EXPECT_EQ(file.pos(), 1);
+
+	ASSERT_EQ(view->size(), 2);
+	EXPECT_EQ(view->readByte(), kFileData[2]);
+	EXPECT_EQ(view->readByte(), kFileData[3]);
+
+	EXPECT_THROW(Common::createMemoryView(file, 2, ARRAYSIZE(kFileData) + 1), Common::Exception);
+}
+
+GTEST_TEST_F(MappedReadFile, openReadFile) {
+	Common::ScopedPtr<Common::SeekableReadStream> file(Common::openReadFile(kFilePath.generic_string()));
+	ASSERT_TRUE(file);
+
+	EXPECT_NE(dynamic_cast<Common::MappedReadFile *>(file.get()), static_cast<Common::MappedReadFile *>(0));
+
+	ASSERT_EQ(file->size(), ARRAYSIZE(kFileData));
+	for (size_t i = 0; i < ARRAYSIZE(kFileData); i++)
+		EXPECT_EQ(file->readByte(), kFileData[i]) << "At index " << i;
+}
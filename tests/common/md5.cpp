@@ -25,9 +25,11 @@
 #include <cstring>
 
 #include <vector>
+#include <algorithm>
 
 #include "gtest/gtest.h"
 
+#include "src/common/util.h"
 #include "src/common/md5.h"
 #include "src/common/ustring.h"
 #include "src/common/memreadstream.h"
@@ -122,3 +124,133 @@ GTEST_TEST(MD5, compareVector) {
 
 	EXPECT_TRUE(Common::compareMD5Digest(data, digest));
 }
+
+/** Create an array of pseudo-random data. */
+static void createData(std::vector<byte> &data, size_t size, uint32 seed) {
+	data.resize(size);
+
+	for (size_t i = 0; i < size; i++) {
+		seed = seed * 1103515245 + 12345;
+		data[i] = (byte) (seed >> 16);
+	}
+}
+
+GTEST_TEST(MD5Hasher, update) {
+	Common::MD5Hasher hasher;
+
+	hasher.update(kData, 3);
+	hasher.update(kData + 3, sizeof(kData) - 3);
+
+	std::vector<byte> digest;
+	hasher.finish(digest);
+
+	compareData(digest, kDigestData);
+}
+
+GTEST_TEST(MD5Hasher, updateStream) {
+	Common::MD5Hasher hasher;
+
+	Common::MemoryReadStream stream(kData);
+	hasher.update(stream);
+
+	std::vector<byte> digest;
+	hasher.finish(digest);
+
+	compareData(digest, kDigestData);
+}
+
+GTEST_TEST(MD5Hasher, updateLarge) {
+	std::vector<byte> data;
+	createData(data, 300000, 23);
+
+	std::vector<byte> digest1;
+	Common::hashMD5(data, digest1);
+
+	// Pieces both smaller and larger than the internal buffer
+	Common::MD5Hasher hasher;
+
+	size_t pos = 0, size = 1;
+	while (pos < data.size()) {
+		const size_t n = std::min(size, data.size() - pos);
+		hasher.update(&data[pos], n);
+
+		pos  += n;
+		size *= 3;
+	}
+
+	std::vector<byte> digest2;
+	hasher.finish(digest2);
+
+	EXPECT_TRUE(digest1 == digest2);
+}
+
+GTEST_TEST(MD5Hasher, reuse) {
+	Common::MD5Hasher hasher;
+
+	std::vector<byte> digest;
+
+	hasher.update(reinterpret_cast<const byte *>(kString), strlen(kString));
+	hasher.finish(digest);
+
+	compareData(digest, kDigestString);
+
+	hasher.update(kData, sizeof(kData));
+	hasher.finish(digest);
+
+	compareData(digest, kDigestData);
+}
+
+GTEST_TEST(MD5Hasher, reset) {
+	Common::MD5Hasher hasher;
+
+	hasher.update(reinterpret_cast<const byte *>(kString), strlen(kString));
+	hasher.reset();
+
+	hasher.update(kData, sizeof(kData));
+
+	std::vector<byte> digest;
+	hasher.finish(digest);
+
+	compareData(digest, kDigestData);
+}
+
+GTEST_TEST(MD5, hashMultiple) {
+	static const size_t kSizes[] = { 0, 1, 55, 56, 63, 64, 65, 128, 1000, 4096, 100000, 3, 640, 64, 129 };
+
+	std::vector< std::vector<byte> > data(ARRAYSIZE(kSizes));
+
+	std::vector<const byte *> dataPtr;
+	std::vector<size_t> dataLength;
+
+	for (size_t i = 0; i < ARRAYSIZE(kSizes); i++) {
+		createData(data[i], kSizes[i], i);
+
+		dataPtr.push_back(data[i].empty() ? 0 : &data[i][0]);
+		dataLength.push_back(data[i].size());
+	}
+
+	std::vector< std::vector<byte> > digests;
+	Common::hashMD5(dataPtr, dataLength, digests);
+
+	ASSERT_EQ(digests.size(), data.size());
+
+	for (size_t i = 0; i < data.size(); i++) {
+		std::vector<byte> digest;
+		Common::hashMD5(dataPtr[i], dataLength[i], digest);
+
+		EXPECT_TRUE(digests[i] == digest) << "At index " << i;
+	}
+}
+
+GTEST_TEST(MD5, hashMultipleData) {
+	std::vector<const byte *> dataPtr(5, kData);
+	std::vector<size_t> dataLength(5, sizeof(kData));
+
+	std::vector< std::vector<byte> > digests;
+	Common::hashMD5(dataPtr, dataLength, digests);
+
+	ASSERT_EQ(digests.size(), 5);
+
+	for (size_t i = 0; i < digests.size(); i++)
+		compareData(digests[i], kDigestData);
+}
@@ -88,6 +88,47 @@ GTEST_TEST(MemoryReadStream, read) {
 	EXPECT_TRUE(stream.eos());
 }
 
+GTEST_TEST(MemoryReadStream, readAt) {
+	static const byte data[5] = { 0x12, 0x34, 0x56, 0x78, 0x90 };
+	Common::MemoryReadStream stream(data);
+
+	stream.seek(1);
+
+	byte readData[4] = { 0x00, 0x00, 0x00, 0x00 };
+	EXPECT_EQ(stream.readAt(2, readData, 2), 2);
+	EXPECT_EQ(readData[0], 0x56);
+	EXPECT_EQ(readData[1], 0x78);
+
+	EXPECT_EQ(stream.readAt(3, readData, 4), 2);
+	EXPECT_EQ(readData[0], 0x78);
+	EXPECT_EQ(readData[1], 0x90);
+
+	EXPECT_EQ(stream.readAt(5, readData, 1), 0);
+
+	// The position and the end-of-stream indicator must not change
+	EXPECT_EQ(stream.pos(), 1);
+	EXPECT_FALSE(stream.eos());
+}
+
+GTEST_TEST(MemoryReadStream, readStreamAt) {
+	static const byte data[5] = { 0x12, 0x34, 0x56, 0x78, 0x90 };
+	Common::MemoryReadStream stream(data);
+
+	Common::SeekableReadStream *subStream = stream.readStreamAt(1, 3);
+	ASSERT_NE(subStream, static_cast<Common::SeekableReadStream *>(0));
+
+	EXPECT_EQ(stream.pos(), 0);
+
+	ASSERT_EQ(subStream->size(), 3);
+	EXPECT_EQ(subStream->readByte(), 0x34);
+	EXPECT_EQ(subStream->readByte(), 0x56);
+	EXPECT_EQ(subStream->readByte(), 0x78);
+
+	delete subStream;
+
+	EXPECT_THROW(stream.readStreamAt(3, 3), Common::Exception);
+}
+
 GTEST_TEST(MemoryReadStream, readStream) {
 	static const byte data[3] = { 0x12, 0x34, 0x56 };
 	Common::MemoryReadStream stream(data);
@@ -33,6 +33,7 @@
 #include "src/common/util.h"
 #include "src/common/platform.h"
 #include "src/common/readfile.h"
+#include "src/common/filepath.h"
 
 boost::filesystem::path kFilePath;
 
@@ -87,3 +88,86 @@ GTEST_TEST_F(ReadFile, write) {
 	for (size_t i = 0; i < ARRAYSIZE(data); i++)
 		EXPECT_EQ(readData[i], data[i]) << "At index " << i;
 }
+
+GTEST_TEST_F(ReadFile, readAt) {
+	ASSERT_FALSE(kFilePath.empty());
+
+	static const byte data[5] = { 0x12, 0x34, 0x56, 0x78, 0x90 };
+
+	// Create the input file
+
+	boost::filesystem::ofstream testFile(kFilePath, std::ofstream::binary);
+
+	testFile.write(reinterpret_cast<const char *>(data), ARRAYSIZE(data));
+	testFile.flush();
+	ASSERT_FALSE(testFile.fail());
+
+	testFile.close();
+
+	// Read from the middle of the file, without changing the file position
+
+	Common::ReadFile file(kFilePath.generic_string());
+	ASSERT_TRUE(file.isOpen());
+
+	file.seek(1);
+
+	byte readData[4] = { 0x00, 0x00, 0x00, 0x00 };
+	EXPECT_EQ(file.readAt(2, readData, 2), 2);
+	EXPECT_EQ(readData[0], data[2]);
+	EXPECT_EQ(readData[1], data[3]);
+
+	EXPECT_EQ(file.readAt(3, readData, 4), 2);
+	EXPECT_EQ(readData[0], data[3]);
+	EXPECT_EQ(readData[1], data[4]);
+
+	EXPECT_EQ(file.pos(), 1);
+	EXPECT_EQ(file.readByte(), data[1]);
+}
+
+GTEST_TEST_F(ReadFile, large) {
+	ASSERT_FALSE(kFilePath.empty());
+
+	// Stream positions can't go past 4GB on 32-bit systems
+	if (sizeof(size_t) < 8)
+		return;
+
+	static const byte data[5] = { 0x12, 0x34, 0x56, 0x78, 0x90 };
+	static const uint64 kOffset = 0x100000010ULL;
+
+	// Create a sparse input file larger than 4GB, with data only at its very end
+
+	boost::filesystem::ofstream testFile(kFilePath, std::ofstream::binary);
+
+	testFile.seekp(kOffset);
+	testFile.write(reinterpret_cast<const char *>(data), ARRAYSIZE(data));
+	testFile.flush();
+	ASSERT_FALSE(testFile.fail());
+
+	testFile.close();
+
+	EXPECT_EQ(Common::FilePath::getFileSize(kFilePath.generic_string()), kOffset + ARRAYSIZE(data));
+
+	Common::ReadFile file(kFilePath.generic_string());
+	ASSERT_TRUE(file.isOpen());
+
+	EXPECT_EQ(file.size(), kOffset + ARRAYSIZE(data));
+
+	file.seek(kOffset + 1);
+	EXPECT_EQ(file.pos(), kOffset + 1);
+	EXPECT_EQ(file.readByte(), data[1]);
+
+	file.seek(-1, Common::SeekableReadStream::kOriginEnd);
+	EXPECT_EQ(file.readByte(), data[4]);
+
+	byte readData[2] = { 0x00, 0x00 };
+	EXPECT_EQ(file.readAt(kOffset + 2, readData, 2), 2);
+	EXPECT_EQ(readData[0], data[2]);
+	EXPECT_EQ(readData[1], data[3]);
+
+	// A substream into the end of the file
+	Common::SeekableSubReadStream sub(&file, kOffset, kOffset + ARRAYSIZE(data));
+	ASSERT_EQ(sub.size(), ARRAYSIZE(data));
+
+	for (size_t i = 0; i < ARRAYSIZE(data); i++)
+		EXPECT_EQ(sub.readByte(), data[i]) << "At index " << i;
+}
@@ -0,0 +1,125 @@
+/* Phaethon - A FLOSS resource explorer for BioWare's Aurora engine games
+ *
+ * Phaethon is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * Phaethon is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * Phaethon is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Phaethon. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  Unit tests for our bounded pool of open files.
+ */
+
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+
+#include "gtest/gtest.h"
+
+#include "src/common/util.h"
+#include "src/common/error.h"
+#include "src/common/platform.h"
+#include "src/common/readfile.h"
+#include "src/common/readfilepool.h"
+
+static const size_t kFileCount = 4;
+static const size_t kFileSize  = 5;
+
+boost::filesystem::path kFilePaths[kFileCount];
+
+static byte getFileData(size_t file, size_t n) {
+	return (byte) (file * 16 + n);
+}
+
+class ReadFilePool : public ::testing::Test {
+protected:
+	static void SetUpTestCase() {
+		Common::Platform::init();
+
+		boost::filesystem::path tmpPath = boost::filesystem::temp_directory_path();
+
+		for (size_t i = 0; i < kFileCount; i++) {
+			kFilePaths[i] = tmpPath / boost::filesystem::unique_path("%%%%_%%%%_%%%%_%%%%.xoreos");
+
+			boost::filesystem::ofstream testFile(kFilePaths[i], std::ofstream::binary);
+			for (size_t j = 0; j < kFileSize; j++)
+				testFile.put(getFileData(i, j));
+
+			testFile.close();
+		}
+	}
+
+	static void TearDownTestCase() {
+		for (size_t i = 0; i < kFileCount; i++)
+			if (!kFilePaths[i].empty())
+				boost::filesystem::remove(kFilePaths[i]);
+	}
+};
+
+GTEST_TEST_F(ReadFilePool, getFile) {
+	Common::ReadFilePool pool(2);
+
+	boost::shared_ptr<Common::ReadFile> file1 = pool.getFile(kFilePaths[0].generic_string());
+	boost::shared_ptr<Common::ReadFile> file2 = pool.getFile(kFilePaths[0].generic_string());
+
+	EXPECT_EQ(file1, file2);
+	EXPECT_EQ(pool.getOpenFileCount(), 1);
+
+	EXPECT_THROW(pool.getFile((kFilePaths[0].generic_string() + ".missing").c_str()), Common::Exception);
+}
+
+GTEST_TEST_F(ReadFilePool, bounded) {
+	Common::ReadFilePool pool(2);
+
+	for (size_t i = 0; i < kFileCount; i++) {
+		pool.getFile(kFilePaths[i].generic_string());
+
+		EXPECT_LE(pool.getOpenFileCount(), 2);
+	}
+
+	pool.clear();
+	EXPECT_EQ(pool.getOpenFileCount(), 0);
+}
+
+GTEST_TEST_F(ReadFilePool, pooledReadFile) {
+	Common::ReadFilePool pool(1);
+
+	Common::PooledReadFile file1(pool, kFilePaths[0].generic_string());
+	Common::PooledReadFile file2(pool, kFilePaths[1].generic_string());
+
+	ASSERT_EQ(file1.size(), kFileSize);
+	ASSERT_EQ(file2.size(), kFileSize);
+
+	// Alternate between the files, forcing the pool to reopen them each time
+	for (size_t i = 0; i < kFileSize; i++) {
+		EXPECT_EQ(file1.readByte(), getFileData(0, i)) << "At index " << i;
+		EXPECT_EQ(file2.readByte(), getFileData(1, i)) << "At index " << i;
+
+		EXPECT_EQ(pool.getOpenFileCount(), 1);
+	}
+
+	byte data[1];
+	EXPECT_EQ(file1.read(data, 1), 0);
+	EXPECT_TRUE(file1.eos());
+
+	file1.seek(-2, Common::SeekableReadStream::kOriginEnd);
+	EXPECT_FALSE(file1.eos());
+	EXPECT_EQ(file1.pos(), kFileSize - 2);
+	EXPECT_EQ(file1.readByte(), getFileData(0, kFileSize - 2));
+
+	EXPECT_EQ(file2.readAt(1, data, 1), 1);
+	EXPECT_EQ(data[0], getFileData(1, 1));
+
+	EXPECT_THROW(file1.seek(kFileSize + 1), Common::Exception);
+}
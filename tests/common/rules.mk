@@ -70,6 +70,16 @@ tests_common_test_memreadstream_SOURCES  = tests/common/memreadstream.cpp
 tests_common_test_memreadstream_LDADD    = $(common_LIBS)
 tests_common_test_memreadstream_CXXFLAGS = $(test_CXXFLAGS)
 
+check_PROGRAMS                               += tests/common/test_bufferedreadstream
+tests_common_test_bufferedreadstream_SOURCES  = tests/common/bufferedreadstream.cpp
+tests_common_test_bufferedreadstream_LDADD    = $(common_LIBS)
+tests_common_test_bufferedreadstream_CXXFLAGS = $(test_CXXFLAGS)
+
+check_PROGRAMS                        += tests/common/test_fixedtable
+tests_common_test_fixedtable_SOURCES  = tests/common/fixedtable.cpp
+tests_common_test_fixedtable_LDADD    = $(common_LIBS)
+tests_common_test_fixedtable_CXXFLAGS = $(test_CXXFLAGS)
+
 check_PROGRAMS                           += tests/common/test_memwritestream
 tests_common_test_memwritestream_SOURCES  = tests/common/memwritestream.cpp
 tests_common_test_memwritestream_LDADD    = $(common_LIBS)
@@ -80,6 +90,16 @@ tests_common_test_readfile_SOURCES  = tests/common/readfile.cpp
 tests_common_test_readfile_LDADD    = $(common_LIBS)
 tests_common_test_readfile_CXXFLAGS = $(test_CXXFLAGS)
 
+check_PROGRAMS                           += tests/common/test_mappedreadfile
+tests_common_test_mappedreadfile_SOURCES  = tests/common/mappedreadfile.cpp
+tests_common_test_mappedreadfile_LDADD    = $(common_LIBS)
+tests_common_test_mappedreadfile_CXXFLAGS = $(test_CXXFLAGS)
+
+check_PROGRAMS                         += tests/common/test_readfilepool
+tests_common_test_readfilepool_SOURCES  = tests/common/readfilepool.cpp
+tests_common_test_readfilepool_LDADD    = $(common_LIBS)
+tests_common_test_readfilepool_CXXFLAGS = $(test_CXXFLAGS)
+
 check_PROGRAMS                      += tests/common/test_writefile
 tests_common_test_writefile_SOURCES  = tests/common/writefile.cpp
 tests_common_test_writefile_LDADD    = $(common_LIBS)
@@ -182,6 +202,11 @@ tests_common_test_md5_SOURCES  = tests/common/md5.cpp
 tests_common_test_md5_LDADD    = $(common_LIBS)
 tests_common_test_md5_CXXFLAGS = $(test_CXXFLAGS)
 
+check_PROGRAMS                  += tests/common/test_crc32
+tests_common_test_crc32_SOURCES  = tests/common/crc32.cpp
+tests_common_test_crc32_LDADD    = $(common_LIBS)
+tests_common_test_crc32_CXXFLAGS = $(test_CXXFLAGS)
+
 check_PROGRAMS                    += tests/common/test_deflate
 tests_common_test_deflate_SOURCES  = tests/common/deflate.cpp
 tests_common_test_deflate_LDADD    = $(common_LIBS)
@@ -347,3 +347,26 @@ GTEST_TEST(StrUtil, parseDouble) {
 	Common::parseString( "0.0", x);
 	EXPECT_DOUBLE_EQ(x, 0.0);
 }
+
+GTEST_TEST(StrUtil, matchGlob) {
+	EXPECT_TRUE(Common::matchGlob("foobar.tga", "*.tga"));
+	EXPECT_TRUE(Common::matchGlob("foobar.tga", "foo*"));
+	EXPECT_TRUE(Common::matchGlob("foobar.tga", "f?o*r.*"));
+	EXPECT_TRUE(Common::matchGlob("foobar.tga", "*"));
+	EXPECT_TRUE(Common::matchGlob("foobar.tga", "**.t*a"));
+	EXPECT_TRUE(Common::matchGlob("foobar.tga", "foobar.tga"));
+	EXPECT_TRUE(Common::matchGlob(""          , "*"));
+	EXPECT_TRUE(Common::matchGlob(""          , ""));
+
+	EXPECT_FALSE(Common::matchGlob("foobar.tga", "*.wav"));
+	EXPECT_FALSE(Common::matchGlob("foobar.tga", "foobar"));
+	EXPECT_FALSE(Common::matchGlob("foobar.tga", "?foobar.tga"));
+	EXPECT_FALSE(Common::matchGlob("foobar.tga", ""));
+	EXPECT_FALSE(Common::matchGlob(""          , "?"));
+}
+
+GTEST_TEST(StrUtil, matchGlobCase) {
+	EXPECT_FALSE(Common::matchGlob("FooBar.TGA", "*.tga"));
+	EXPECT_TRUE (Common::matchGlob("FooBar.TGA", "*.tga", true));
+	EXPECT_TRUE (Common::matchGlob("foobar.tga", "FOO*", true));
+}
@@ -22,6 +22,10 @@
  *  Unit tests for our UString class.
  */
 
+#include <cstring>
+#include <string>
+#include <utility>
+
 #include "gtest/gtest.h"
 
 #include "src/common/util.h"
@@ -100,6 +104,50 @@ GTEST_TEST(UString, constructorCopyIterators) {
 	EXPECT_STREQ(str1.c_str(), str2.c_str());
 }
 
+GTEST_TEST(UString, constructorCopyIteratorsUTF8) {
+	const Common::UString str1((const char *) kTestStringUTF8);
+
+	Common::UString::iterator begin = str1.begin();
+	Common::UString::iterator end   = str1.end();
+	++begin;
+	--end;
+
+	const Common::UString str2(begin, end);
+
+	EXPECT_EQ(str2.size(), 4);
+	EXPECT_STREQ(str2.c_str(), "\xC3\xB6\xC3\xB6" "b" "\xC3\xA4");
+}
+
+GTEST_TEST(UString, constructorMove) {
+	Common::UString str1(kTestString1);
+	const Common::UString str2(std::move(str1));
+
+	EXPECT_STREQ(str2.c_str(), kTestString1);
+	EXPECT_EQ(str2.size(), strlen(kTestString1));
+
+	EXPECT_TRUE(str1.empty());
+	EXPECT_STREQ(str1.c_str(), "");
+
+	std::string std3((const char *) kTestStringUTF8);
+	const Common::UString str3(std::move(std3));
+
+	EXPECT_STREQ(str3.c_str(), (const char *) kTestStringUTF8);
+	EXPECT_EQ(str3.size(), 6);
+}
+
+GTEST_TEST(UString, assignMove) {
+	Common::UString str1(kTestString1);
+	Common::UString str2(kTestString2);
+
+	str2 = std::move(str1);
+
+	EXPECT_STREQ(str2.c_str(), kTestString1);
+	EXPECT_EQ(str2.size(), strlen(kTestString1));
+
+	EXPECT_TRUE(str1.empty());
+	EXPECT_EQ(str1.size(), 0);
+}
+
 GTEST_TEST(UString, iteratorsASCII) {
 	const Common::UString str(kTestString1);
 
@@ -554,3 +602,56 @@ GTEST_TEST(UString, append) {
 
 	EXPECT_STREQ(str.c_str(), "Foobar Barfoo Quux");
 }
+
+GTEST_TEST(UStringView, constructor) {
+	const Common::UStringView view1;
+	EXPECT_TRUE(view1.empty());
+	EXPECT_EQ(view1.size(), 0);
+
+	const Common::UStringView view2(kTestString1);
+	EXPECT_EQ(view2.data(), kTestString1);
+	EXPECT_EQ(view2.size(), strlen(kTestString1));
+
+	const Common::UStringView view3(kTestString1, 3);
+	EXPECT_EQ(view3.size(), 3);
+	EXPECT_EQ(view3, kTestStringSub1);
+
+	// The size is in bytes, not characters
+	const Common::UString str((const char *) kTestStringUTF8);
+	const Common::UStringView view4(str);
+	EXPECT_EQ(view4.data(), str.c_str());
+	EXPECT_EQ(view4.size(), 9);
+
+	const Common::UString copy(view3);
+	EXPECT_STREQ(copy.c_str(), kTestStringSub1);
+}
+
+GTEST_TEST(UStringView, equals) {
+	const Common::UStringView view(kTestString1);
+
+	EXPECT_EQ(view, kTestString1);
+	EXPECT_NE(view, kTestString2);
+	EXPECT_NE(view, kTestStringSub1);
+	EXPECT_NE(view, kTestStringLower1);
+
+	EXPECT_TRUE(view.equalsIgnoreCase(kTestStringLower1));
+	EXPECT_TRUE(view.equalsIgnoreCase(kTestStringUpper1));
+	EXPECT_FALSE(view.equalsIgnoreCase(kTestString2));
+
+	// Like UString, only ASCII characters are case-folded
+	const Common::UStringView viewUTF8((const char *) kTestStringUTF8);
+	EXPECT_FALSE(viewUTF8.equalsIgnoreCase((const char *) kTestStringUpperUTF8));
+	EXPECT_TRUE(viewUTF8.equalsIgnoreCase("f\xC3\xB6\xC3\xB6" "B" "\xC3\xA4R"));
+}
+
+GTEST_TEST(UStringView, toLowerASCII) {
+	EXPECT_EQ(Common::UStringView::toLowerASCII('A'), 'a');
+	EXPECT_EQ(Common::UStringView::toLowerASCII('Z'), 'z');
+	EXPECT_EQ(Common::UStringView::toLowerASCII('a'), 'a');
+	EXPECT_EQ(Common::UStringView::toLowerASCII('@'), '@');
+	EXPECT_EQ(Common::UStringView::toLowerASCII('['), '[');
+
+	// Bytes of multi-byte UTF-8 sequences are left alone
+	EXPECT_EQ(Common::UStringView::toLowerASCII('\xC3'), '\xC3');
+	EXPECT_EQ(Common::UStringView::toLowerASCII('\x84'), '\x84');
+}
@@ -22,11 +22,16 @@
  *  Unit tests for our ZIP file reader.
  */
 
+#include <cstring>
+#include <vector>
+
 #include "gtest/gtest.h"
 
 #include "src/common/zipfile.h"
 #include "src/common/memreadstream.h"
 #include "src/common/error.h"
+#include "src/common/ustring.h"
+#include "src/common/crc32.h"
 
 // Percy Bysshe Shelley's "Ozymandias"
 static const char *kDataUncompressed =
@@ -119,8 +124,249 @@ GTEST_TEST(ZIPFile, getFile) {
 	delete file;
 }
 
+GTEST_TEST(ZIPFile, verifyFile) {
+	Common::MemoryReadStream *stream = new Common::MemoryReadStream(kDataCompressed);
+	const Common::ZipFile zip(stream);
+
+	EXPECT_TRUE(zip.verifyFile(0));
+
+	EXPECT_THROW(zip.verifyFile(1), Common::Exception);
+}
+
+GTEST_TEST(ZIPFile, verifyFileMismatch) {
+	byte data[sizeof(kDataCompressed)];
+	memcpy(data, kDataCompressed, sizeof(data));
+
+	// Break the CRC32 in the central directory
+	data[0x1BF + 16] ^= 0xFF;
+
+	Common::MemoryReadStream *stream = new Common::MemoryReadStream(data);
+	const Common::ZipFile zip(stream);
+
+	EXPECT_FALSE(zip.verifyFile(0));
+}
+
 GTEST_TEST(ZIPFile, brokenZIP) {
 	Common::MemoryReadStream *stream = new Common::MemoryReadStream(kDataCompressed, sizeof(kDataCompressed) / 2);
 
 	EXPECT_THROW(Common::ZipFile zip(stream), Common::Exception);
 }
+
+static void writeUint16(std::vector<byte> &data, uint16 value) {
+	data.push_back(value & 0xFF);
+	data.push_back(value >> 8);
+}
+
+static void writeUint32(std::vector<byte> &data, uint32 value) {
+	writeUint16(data, value & 0xFFFF);
+	writeUint16(data, value >> 16);
+}
+
+static void writeUint64(std::vector<byte> &data, uint64 value) {
+	writeUint32(data, value & 0xFFFFFFFF);
+	writeUint32(data, value >> 32);
+}
+
+static void writeBytes(std::vector<byte> &data, const char *str) {
+	data.insert(data.end(), str, str + strlen(str));
+}
+
+/** Create a ZIP with these uncompressed files, optionally with all sizes and offsets in ZIP64 records. */
+static void createZIP(std::vector<byte> &zip, const std::vector<Common::UString> &names,
+                      const std::vector<Common::UString> &contents, bool zip64, size_t commentLength = 0) {
+
+	std::vector<uint32> offsets;
+
+	for (size_t i = 0; i < names.size(); i++) {
+		offsets.push_back(zip.size());
+
+		const uint32 size = strlen(contents[i].c_str());
+
+		writeUint32(zip, 0x04034B50);
+		writeUint16(zip, 20);
+		writeUint16(zip, 0);
+		writeUint16(zip, 0);
+		writeUint32(zip, 0);
+		writeUint32(zip, Common::calculateCRC32(reinterpret_cast<const byte *>(contents[i].c_str()), size));
+		writeUint32(zip, size);
+		writeUint32(zip, size);
+		writeUint16(zip, strlen(names[i].c_str()));
+		writeUint16(zip, 0);
+		writeBytes(zip, names[i].c_str());
+		writeBytes(zip, contents[i].c_str());
+	}
+
+	const size_t dirOffset = zip.size();
+
+	for (size_t i = 0; i < names.size(); i++) {
+		const uint32 size = strlen(contents[i].c_str());
+
+		writeUint32(zip, 0x02014B50);
+		writeUint16(zip, 20);
+		writeUint16(zip, 45);
+		writeUint16(zip, 0);
+		writeUint16(zip, 0);
+		writeUint32(zip, 0);
+		writeUint32(zip, Common::calculateCRC32(reinterpret_cast<const byte *>(contents[i].c_str()), size));
+		writeUint32(zip, zip64 ? 0xFFFFFFFF : size);
+		writeUint32(zip, zip64 ? 0xFFFFFFFF : size);
+		writeUint16(zip, strlen(names[i].c_str()));
+		writeUint16(zip, zip64 ? (9 + 28) : 0);
+		writeUint16(zip, 0);
+		writeUint16(zip, 0);
+		writeUint16(zip, 0);
+		writeUint32(zip, 0);
+		writeUint32(zip, zip64 ? 0xFFFFFFFF : offsets[i]);
+		writeBytes(zip, names[i].c_str());
+
+		if (zip64) {
+			// An unrelated extra field first, which has to be skipped
+			writeUint16(zip, 0x5455);
+			writeUint16(zip, 5);
+			writeUint32(zip, 0);
+			zip.push_back(0);
+
+			writeUint16(zip, 0x0001);
+			writeUint16(zip, 24);
+			writeUint64(zip, size);
+			writeUint64(zip, size);
+			writeUint64(zip, offsets[i]);
+		}
+	}
+
+	const size_t dirSize = zip.size() - dirOffset;
+
+	if (zip64) {
+		const size_t endOffset = zip.size();
+
+		writeUint32(zip, 0x06064B50);
+		writeUint64(zip, 44);
+		writeUint16(zip, 45);
+		writeUint16(zip, 45);
+		writeUint32(zip, 0);
+		writeUint32(zip, 0);
+		writeUint64(zip, names.size());
+		writeUint64(zip, names.size());
+		writeUint64(zip, dirSize);
+		writeUint64(zip, dirOffset);
+
+		writeUint32(zip, 0x07064B50);
+		writeUint32(zip, 0);
+		writeUint64(zip, endOffset);
+		writeUint32(zip, 1);
+	}
+
+	writeUint32(zip, 0x06054B50);
+	writeUint16(zip, 0);
+	writeUint16(zip, 0);
+	writeUint16(zip, zip64 ? 0xFFFF : names.size());
+	writeUint16(zip, zip64 ? 0xFFFF : names.size());
+	writeUint32(zip, zip64 ? 0xFFFFFFFF : dirSize);
+	writeUint32(zip, zip64 ? 0xFFFFFFFF : dirOffset);
+	writeUint16(zip, commentLength);
+
+	zip.resize(zip.size() + commentLength, 'x');
+}
+
+static void checkZIP(const Common::ZipFile &zip, const std::vector<Common::UString> &names,
+                     const std::vector<Common::UString> &contents) {
+
+	const Common::ZipFile::FileList &files = zip.getFiles();
+	ASSERT_EQ(files.size(), names.size());
+
+	size_t i = 0;
+	for (Common::ZipFile::FileList::const_iterator f = files.begin(); f != files.end(); ++f, ++i) {
+		EXPECT_EQ(f->index, i);
+		EXPECT_STREQ(f->name.c_str(), names[i].c_str());
+
+		EXPECT_EQ(zip.getFileSize(i), strlen(contents[i].c_str()));
+		EXPECT_TRUE(zip.verifyFile(i)) << "At index " << i;
+	}
+}
+
+GTEST_TEST(ZIPFile, zip64) {
+	std::vector<Common::UString> names, contents;
+	names.push_back("foo.txt");
+	names.push_back("bar.txt");
+	contents.push_back("Foobar");
+	contents.push_back("Barfoo and more");
+
+	std::vector<byte> data;
+	createZIP(data, names, contents, true);
+
+	const Common::ZipFile zip(new Common::MemoryReadStream(&data[0], data.size()));
+	checkZIP(zip, names, contents);
+
+	Common::SeekableReadStream *file = zip.getFile(1);
+	ASSERT_EQ(file->size(), strlen(contents[1].c_str()));
+
+	for (size_t i = 0; i < file->size(); i++)
+		EXPECT_EQ(file->readByte(), contents[1].c_str()[i]) << "At index " << i;
+
+	delete file;
+}
+
+GTEST_TEST(ZIPFile, zip64ManyFiles) {
+	// More files than fit into the count of the classic end of central directory record
+	std::vector<Common::UString> names, contents;
+	for (uint i = 0; i < 70000; i++) {
+		names.push_back(Common::UString::format("%u.txt", i));
+		contents.push_back(Common::UString::format("%u", i * 3));
+	}
+
+	std::vector<byte> data;
+	createZIP(data, names, contents, true);
+
+	const Common::ZipFile zip(new Common::MemoryReadStream(&data[0], data.size()));
+	checkZIP(zip, names, contents);
+}
+
+GTEST_TEST(ZIPFile, maxFilesWithoutZIP64) {
+	// Exactly 65535 files still fit into the classic end of central directory record
+	std::vector<Common::UString> names, contents;
+	for (uint i = 0; i < 0xFFFF; i++) {
+		names.push_back(Common::UString::format("%u.txt", i));
+		contents.push_back(Common::UString::format("%u", i * 3));
+	}
+
+	std::vector<byte> data;
+	createZIP(data, names, contents, false);
+
+	const Common::ZipFile zip(new Common::MemoryReadStream(&data[0], data.size()));
+	checkZIP(zip, names, contents);
+}
+
+GTEST_TEST(ZIPFile, zip64Broken) {
+	std::vector<Common::UString> names, contents;
+	names.push_back("foo.txt");
+	contents.push_back("Foobar");
+
+	std::vector<byte> data;
+	createZIP(data, names, contents, true);
+
+	// Break the ZIP64 end of central directory locator
+	data[data.size() - 22 - 20] ^= 0xFF;
+
+	EXPECT_THROW(Common::ZipFile zip(new Common::MemoryReadStream(&data[0], data.size())), Common::Exception);
+}
+
+GTEST_TEST(ZIPFile, comment) {
+	std::vector<Common::UString> names, contents;
+	names.push_back("foo.txt");
+	contents.push_back("Foobar");
+
+	// The end of central directory record is found behind a long comment
+	std::vector<byte> data;
+	createZIP(data, names, contents, false, 0xFFFF);
+
+	const Common::ZipFile zip(new Common::MemoryReadStream(&data[0], data.size()));
+	checkZIP(zip, names, contents);
+}
+
+GTEST_TEST(ZIPFile, empty) {
+	std::vector<byte> data;
+	createZIP(data, std::vector<Common::UString>(), std::vector<Common::UString>(), false);
+
+	const Common::ZipFile zip(new Common::MemoryReadStream(&data[0], data.size()));
+	EXPECT_TRUE(zip.getFiles().empty());
+}